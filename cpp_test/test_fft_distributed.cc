@@ -0,0 +1,267 @@
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ *  Author: Martin Reinecke
+ */
+
+/*
+ *  Compares the distributed FFTs in fft/fft_distributed.h with the serial
+ *  transforms of the complete arrays.
+ *
+ *  Single task:
+ *    g++ -std=c++17 -O2 -pthread -I src cpp_test/test_fft_distributed.cc
+ *    ./a.out
+ *  MPI (also tests tasks without any local rows):
+ *    mpicxx -std=c++17 -O2 -pthread -DDUCC0_USE_MPI -I src \
+ *      cpp_test/test_fft_distributed.cc
+ *    for n in 1 2 3 4 6 8; do mpirun -np $n ./a.out || break; done
+ */
+
+#include <complex>
+#include <cstdio>
+#include <random>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/infra/types.cc"
+#include "ducc0/infra/communication.cc"
+#include "ducc0/fft/fftnd_impl.h"
+#include "ducc0/fft/fft_distributed.h"
+
+using namespace ducc0;
+using namespace std;
+
+namespace {
+
+using shape_t = fmav_info::shape_t;
+using dcmplx = complex<double>;
+
+shape_t all_axes(size_t ndim)
+  {
+  shape_t res(ndim);
+  for (size_t i=0; i<ndim; ++i) res[i] = i;
+  return res;
+  }
+
+template<typename T> vfmav<T> random_array(const shape_t &shape)
+  {
+  vfmav<T> res(shape);
+  mt19937 rng(42);
+  uniform_real_distribution<double> dist(-0.5, 0.5);
+  mav_apply([&](T &v)
+    {
+    if constexpr (is_same<T,double>::value)
+      v = dist(rng);
+    else
+      v = T(dist(rng), dist(rng));
+    }, 1, res);
+  return res;
+  }
+
+// the part of the global array \a arr which starts at \a lo and has the
+// shape \a shape
+template<typename T> vfmav<T> block(const vfmav<T> &arr, const shape_t &lo,
+  const shape_t &shape)
+  {
+  // slice(i,i) would select a single index, so empty blocks need special care
+  for (auto s: shape)
+    if (s==0) return vfmav<T>(shape);
+  vector<slice> slc(arr.ndim());
+  for (size_t i=0; i<arr.ndim(); ++i)
+    slc[i] = slice(lo[i], lo[i]+shape[i]);
+  return arr.subarray(slc);
+  }
+
+// local copy of a block of the global array \a arr
+template<typename T> vfmav<T> local_copy(const vfmav<T> &arr,
+  const shape_t &lo, const shape_t &shape)
+  {
+  vfmav<T> res(shape);
+  mav_apply([](T &a, const T &b) { a=b; }, 1, res, block(arr, lo, shape));
+  return res;
+  }
+
+// the local index range of axis \a ax of length \a n, which is distributed
+// over \a comm; returns the offsets and shape of the local block
+void local_range(const Communicator &comm, size_t ax, shape_t &lo,
+  shape_t &shape)
+  {
+  auto [l, h] = dist_range(shape[ax], comm);
+  lo[ax] = l;
+  shape[ax] = h-l;
+  }
+
+// squared error and squared norm of the local block of the global reference
+template<typename T> void accumulate(const cfmav<T> &res,
+  const vfmav<T> &ref, const shape_t &lo, double &err, double &nrm)
+  {
+  mav_apply([&](const T &a, const T &b)
+    { err += norm(a-b); nrm += norm(b); }, 1, res, block(ref, lo, res.shape()));
+  }
+
+bool check(const Communicator &comm, const char *name, const shape_t &shape,
+  double err, double nrm)
+  {
+  err = comm.allreduce(err, Communicator::Sum);
+  nrm = comm.allreduce(nrm, Communicator::Sum);
+  double rel = sqrt(err/nrm);
+  bool ok = rel<1e-13;
+  if (comm.master() && !ok)
+    {
+    printf("%s failed for shape (", name);
+    for (size_t i=0; i<shape.size(); ++i)
+      printf("%s%zu", i==0 ? "" : ",", shape[i]);
+    printf("): relative error %g\n", rel);
+    }
+  return ok;
+  }
+
+bool test_slab(const Communicator &comm, const shape_t &shape)
+  {
+  bool ok = true;
+  auto ndim = shape.size();
+  auto axes = all_axes(ndim);
+  auto in = random_array<dcmplx>(shape);
+  vfmav<dcmplx> ref(shape);
+  c2c(in, ref, axes, true, 1.5);
+
+  shape_t lo_s(ndim, 0), shp_s(shape), lo_t(ndim, 0), shp_t(shape);
+  local_range(comm, 0, lo_s, shp_s);
+  local_range(comm, 1, lo_t, shp_t);
+
+  double err=0, nrm=0;
+  vfmav<dcmplx> out_t(shp_t);
+  c2c_slab(comm, local_copy(in, lo_s, shp_s), out_t, true, 1.5, 1, false);
+  accumulate<dcmplx>(out_t, ref, lo_t, err, nrm);
+  ok &= check(comm, "c2c_slab", shape, err, nrm);
+
+  err = nrm = 0;
+  vfmav<dcmplx> out_s(shp_s);
+  c2c_slab(comm, local_copy(ref, lo_t, shp_t), out_s, false, 1./1.5/in.size(),
+    1, true);
+  accumulate<dcmplx>(out_s, in, lo_s, err, nrm);
+  ok &= check(comm, "c2c_slab (transposed input)", shape, err, nrm);
+
+  auto rin = random_array<double>(shape);
+  shape_t hshape(shape);
+  hshape.back() = hshape.back()/2+1;
+  vfmav<dcmplx> rref(hshape);
+  r2c(rin, rref, axes, true, 1.5);
+  shape_t lo_h(ndim, 0), shp_h(hshape);
+  local_range(comm, 1, lo_h, shp_h);
+
+  err = nrm = 0;
+  vfmav<dcmplx> rout(shp_h);
+  r2c_slab(comm, local_copy(rin, lo_s, shp_s), rout, true, 1.5);
+  accumulate<dcmplx>(rout, rref, lo_h, err, nrm);
+  ok &= check(comm, "r2c_slab", shape, err, nrm);
+
+  err = nrm = 0;
+  vfmav<double> rback(shp_s);
+  c2r_slab(comm, local_copy(rref, lo_h, shp_h), rback, false,
+    1./1.5/rin.size());
+  accumulate<double>(rback, rin, lo_s, err, nrm);
+  ok &= check(comm, "c2r_slab", shape, err, nrm);
+  return ok;
+  }
+
+bool test_pencil(const Communicator &comm, const Communicator &comm0,
+  const Communicator &comm1, const shape_t &shape)
+  {
+  bool ok = true;
+  auto ndim = shape.size();
+  auto axes = all_axes(ndim);
+  auto in = random_array<dcmplx>(shape);
+  vfmav<dcmplx> ref(shape);
+  c2c(in, ref, axes, true, 1.5);
+
+  shape_t lo_s(ndim, 0), shp_s(shape), lo_t(ndim, 0), shp_t(shape);
+  local_range(comm0, 0, lo_s, shp_s);
+  local_range(comm1, 1, lo_s, shp_s);
+  local_range(comm0, 1, lo_t, shp_t);
+  local_range(comm1, 2, lo_t, shp_t);
+
+  double err=0, nrm=0;
+  vfmav<dcmplx> out_t(shp_t);
+  c2c_pencil(comm0, comm1, local_copy(in, lo_s, shp_s), out_t, true, 1.5, 1,
+    false);
+  accumulate<dcmplx>(out_t, ref, lo_t, err, nrm);
+  ok &= check(comm, "c2c_pencil", shape, err, nrm);
+
+  err = nrm = 0;
+  vfmav<dcmplx> out_s(shp_s);
+  c2c_pencil(comm0, comm1, local_copy(ref, lo_t, shp_t), out_s, false,
+    1./1.5/in.size(), 1, true);
+  accumulate<dcmplx>(out_s, in, lo_s, err, nrm);
+  ok &= check(comm, "c2c_pencil (transposed input)", shape, err, nrm);
+
+  auto rin = random_array<double>(shape);
+  shape_t hshape(shape);
+  hshape.back() = hshape.back()/2+1;
+  vfmav<dcmplx> rref(hshape);
+  r2c(rin, rref, axes, true, 1.5);
+  shape_t lo_h(ndim, 0), shp_h(hshape);
+  local_range(comm0, 1, lo_h, shp_h);
+  local_range(comm1, 2, lo_h, shp_h);
+
+  err = nrm = 0;
+  vfmav<dcmplx> rout(shp_h);
+  r2c_pencil(comm0, comm1, local_copy(rin, lo_s, shp_s), rout, true, 1.5);
+  accumulate<dcmplx>(rout, rref, lo_h, err, nrm);
+  ok &= check(comm, "r2c_pencil", shape, err, nrm);
+
+  err = nrm = 0;
+  vfmav<double> rback(shp_s);
+  c2r_pencil(comm0, comm1, local_copy(rref, lo_h, shp_h), rback, false,
+    1./1.5/rin.size());
+  accumulate<double>(rback, rin, lo_s, err, nrm);
+  ok &= check(comm, "c2r_pencil", shape, err, nrm);
+  return ok;
+  }
+
+}
+
+int main(int argc, char **argv)
+  {
+#ifdef DUCC0_USE_MPI
+  MPI_Init(&argc, &argv);
+#else
+  (void)argc; (void)argv;
+#endif
+  bool ok = true;
+  {
+  Communicator comm;
+  // shapes with fewer rows or columns than tasks are included on purpose
+  for (const auto &shape: vector<shape_t>{{16,12}, {5,7}, {3,2}, {1,9},
+    {6,5,7}, {2,3,4}, {7,1,6}, {4,6,3,5}})
+    ok &= test_slab(comm, shape);
+  // process grid for the pencil decomposition: rank = r0*nr1 + r1
+  size_t nr1 = (comm.num_ranks()%2==0) ? 2 : 1;
+  auto comm1 = comm.split(size_t(comm.rank())/nr1);
+  auto comm0 = comm.split(size_t(comm.rank())%nr1);
+  for (const auto &shape: vector<shape_t>{{8,6,10}, {5,3,7}, {2,1,4},
+    {1,5,3}, {3,4,5,6}})
+    ok &= test_pencil(comm, comm0, comm1, shape);
+  if (comm.master())
+    printf("%s (%d tasks)\n", ok ? "passed" : "FAILED", comm.num_ranks());
+  }
+#ifdef DUCC0_USE_MPI
+  MPI_Finalize();
+#endif
+  return ok ? 0 : 1;
+  }
@@ -0,0 +1,251 @@
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ *  Author: Martin Reinecke
+ */
+
+/*
+ *  Compares the distributed SHTs in sht/sht_distributed.h with the serial
+ *  synthesis() and adjoint_synthesis() of the complete a_lm and maps.
+ *
+ *  Single task:
+ *    g++ -std=c++17 -O2 -pthread -I src cpp_test/test_sht_distributed.cc
+ *    ./a.out
+ *  MPI (also tests tasks without any local m values or rings):
+ *    mpicxx -std=c++17 -O2 -pthread -DDUCC0_USE_MPI -I src \
+ *      cpp_test/test_sht_distributed.cc
+ *    for n in 1 2 3 4 6 8; do mpirun -np $n ./a.out || break; done
+ */
+
+#include <complex>
+#include <cstdio>
+#include <random>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/infra/types.cc"
+#include "ducc0/infra/communication.cc"
+#include "ducc0/math/gl_integrator.cc"
+#include "ducc0/math/gridding_kernel.cc"
+#include "ducc0/sht/sht.cc"
+#include "ducc0/sht/sht_distributed.h"
+#include "ducc0/fft/fftnd_impl.h"
+
+using namespace ducc0;
+using namespace std;
+
+namespace {
+
+using dcmplx = complex<double>;
+
+// global map geometry; nphi and phi0 vary from ring to ring on purpose
+struct geometry
+  {
+  vmav<double,1> theta, phi0;
+  vmav<size_t,1> nphi, ringstart;
+  size_t npix;
+
+  geometry(size_t nrings, size_t lmax)
+    : theta({nrings}), phi0({nrings}), nphi({nrings}), ringstart({nrings}),
+      npix(0)
+    {
+    for (size_t i=0; i<nrings; ++i)
+      {
+      theta(i) = (i+0.5)*pi/nrings;
+      phi0(i) = 0.1*i;
+      nphi(i) = 2*lmax+2+2*min(i, nrings-1-i);
+      ringstart(i) = npix;
+      npix += nphi(i);
+      }
+    }
+  };
+
+// the a_lm of the m values mv, stored contiguously
+struct alm_block
+  {
+  vmav<dcmplx,2> alm;
+  vmav<size_t,1> mval, mstart;
+
+  alm_block(size_t ncomp, size_t lmax, const vector<size_t> &mv)
+    : alm({ncomp, nalm(lmax, mv)}), mval({mv.size()}), mstart({mv.size()})
+    {
+    for (size_t i=0, ofs=0; i<mv.size(); ++i)
+      {
+      mval(i) = mv[i];
+      mstart(i) = ofs-mv[i];
+      ofs += lmax+1-mv[i];
+      }
+    }
+  static size_t nalm(size_t lmax, const vector<size_t> &mv)
+    {
+    size_t res=0;
+    for (auto m: mv) res += lmax+1-m;
+    return res;
+    }
+  };
+
+vector<size_t> range(size_t n)
+  {
+  vector<size_t> res(n);
+  for (size_t i=0; i<n; ++i) res[i] = i;
+  return res;
+  }
+
+// the rings rv of the global map, stored contiguously
+struct map_block
+  {
+  vmav<double,2> map;
+  vmav<double,1> theta, phi0;
+  vmav<size_t,1> nphi, ringstart;
+
+  map_block(size_t ncomp, const geometry &geom, const vector<size_t> &rv)
+    : map({ncomp, npix(geom, rv)}), theta({rv.size()}), phi0({rv.size()}),
+      nphi({rv.size()}), ringstart({rv.size()})
+    {
+    for (size_t i=0, ofs=0; i<rv.size(); ++i)
+      {
+      theta(i) = geom.theta(rv[i]);
+      phi0(i) = geom.phi0(rv[i]);
+      nphi(i) = geom.nphi(rv[i]);
+      ringstart(i) = ofs;
+      ofs += nphi(i);
+      }
+    }
+  static size_t npix(const geometry &geom, const vector<size_t> &rv)
+    {
+    size_t res=0;
+    for (auto r: rv) res += geom.nphi(r);
+    return res;
+    }
+  };
+
+bool check(const Communicator &comm, const char *name, size_t lmax,
+  size_t spin, SHT_mode mode, double err, double nrm)
+  {
+  err = comm.allreduce(err, Communicator::Sum);
+  nrm = comm.allreduce(nrm, Communicator::Sum);
+  double rel = sqrt(err/nrm);
+  bool ok = rel<1e-13;
+  if (comm.master() && !ok)
+    printf("%s failed for lmax=%zu, spin=%zu, mode=%d: relative error %g\n",
+      name, lmax, spin, int(mode), rel);
+  return ok;
+  }
+
+bool test(const Communicator &comm, size_t lmax, size_t nrings, size_t spin,
+  SHT_mode mode)
+  {
+  bool ok = true;
+  size_t ncalm = ((spin>0) && (mode==STANDARD)) ? 2 : 1;
+  size_t ncmap = ((spin>0) || (mode!=STANDARD)) ? 2 : 1;
+  // spin is ignored in DERIV1 mode, but synthesis() requires it to be >0
+  size_t sspin = (mode==DERIV1) ? 1 : spin;
+  if (lmax<sspin) return true;
+  geometry geom(nrings, lmax);
+
+  alm_block galm(ncalm, lmax, range(lmax+1));
+  mt19937 rng(42);
+  normal_distribution<double> nd;
+  for (size_t c=0; c<ncalm; ++c)
+    for (size_t m=0; m<=lmax; ++m)
+      for (size_t l=m; l<=lmax; ++l)
+        galm.alm(c, galm.mstart(m)+l) = (l<sspin) ? 0. :
+          dcmplx(nd(rng), (m==0) ? 0. : nd(rng));
+  vmav<double,2> gmap({ncmap, geom.npix});
+  synthesis(galm.alm, gmap, sspin, lmax, galm.mstart, 1, geom.theta,
+    geom.nphi, geom.phi0, geom.ringstart, 1, 1, mode);
+
+  auto mv = distributed_mvals(lmax, comm);
+  auto rv = distributed_rings(nrings, comm);
+  alm_block lalm(ncalm, lmax, mv);
+  for (size_t c=0; c<ncalm; ++c)
+    for (size_t i=0; i<mv.size(); ++i)
+      for (size_t l=mv[i]; l<=lmax; ++l)
+        lalm.alm(c, lalm.mstart(i)+l) = galm.alm(c, galm.mstart(mv[i])+l);
+  map_block lmap(ncmap, geom, rv);
+
+  synthesis_mpi(comm, lalm.alm, lmap.map, spin, lmax, lalm.mval,
+    lalm.mstart, 1, lmap.theta, lmap.nphi, lmap.phi0, lmap.ringstart, 1, 1,
+    mode);
+  double err=0, nrm=0;
+  for (size_t c=0; c<ncmap; ++c)
+    for (size_t i=0; i<rv.size(); ++i)
+      for (size_t p=0; p<lmap.nphi(i); ++p)
+        {
+        double a = lmap.map(c, lmap.ringstart(i)+p),
+               b = gmap(c, geom.ringstart(rv[i])+p);
+        err += (a-b)*(a-b);
+        nrm += b*b;
+        }
+  ok &= check(comm, "synthesis_mpi", lmax, spin, mode, err, nrm);
+
+  adjoint_synthesis(galm.alm, gmap, sspin, lmax, galm.mstart, 1, geom.theta,
+    geom.nphi, geom.phi0, geom.ringstart, 1, 1, mode);
+  for (size_t c=0; c<ncmap; ++c)
+    for (size_t i=0; i<rv.size(); ++i)
+      for (size_t p=0; p<lmap.nphi(i); ++p)
+        lmap.map(c, lmap.ringstart(i)+p) = gmap(c, geom.ringstart(rv[i])+p);
+  adjoint_synthesis_mpi(comm, lalm.alm, lmap.map, spin, lmax, lalm.mval,
+    lalm.mstart, 1, lmap.theta, lmap.nphi, lmap.phi0, lmap.ringstart, 1, 1,
+    mode);
+  err = nrm = 0;
+  for (size_t c=0; c<ncalm; ++c)
+    for (size_t i=0; i<mv.size(); ++i)
+      for (size_t l=mv[i]; l<=lmax; ++l)
+        {
+        auto a = lalm.alm(c, lalm.mstart(i)+l),
+             b = galm.alm(c, galm.mstart(mv[i])+l);
+        err += norm(a-b);
+        nrm += norm(b);
+        }
+  ok &= check(comm, "adjoint_synthesis_mpi", lmax, spin, mode, err, nrm);
+  return ok;
+  }
+
+}
+
+int main(int argc, char **argv)
+  {
+#ifdef DUCC0_USE_MPI
+  MPI_Init(&argc, &argv);
+#else
+  (void)argc; (void)argv;
+#endif
+  bool ok = true;
+  {
+  Communicator comm;
+  // sizes with fewer m values or ring pairs than tasks are included on
+  // purpose
+  for (auto [lmax, nrings]: vector<pair<size_t,size_t>>{{40,43}, {31,32},
+    {2,5}, {3,1}, {0,4}})
+    {
+    for (size_t spin: {0, 1, 2, 3})
+      ok &= test(comm, lmax, nrings, spin, STANDARD);
+    for (size_t spin: {1, 2})
+      ok &= test(comm, lmax, nrings, spin, GRAD_ONLY);
+    for (size_t spin: {0, 1})
+      ok &= test(comm, lmax, nrings, spin, DERIV1);
+    }
+  if (comm.master())
+    printf("%s (%d tasks)\n", ok ? "passed" : "FAILED", comm.num_ranks());
+  }
+#ifdef DUCC0_USE_MPI
+  MPI_Finalize();
+#endif
+  return ok ? 0 : 1;
+  }
@@ -0,0 +1,309 @@
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+ *  Copyright (C) 2023 Max-Planck-Society
+ *  Author: Martin Reinecke
+ */
+
+/*
+ *  Compares the Wgridder plan, dirty2dirty(), ms2dirty_multi(), w plane
+ *  batching and the streaming accumulator in wgridder/wgridder.h with
+ *  the plain ms2dirty() and dirty2ms() functions.
+ *
+ *    g++ -std=c++17 -O2 -pthread -I src cpp_test/test_wgridder.cc
+ *    ./a.out
+ */
+
+#include <complex>
+#include <cstdio>
+#include <random>
+#include "ducc0/infra/string_utils.cc"
+#include "ducc0/infra/threading.cc"
+#include "ducc0/infra/mav.cc"
+#include "ducc0/math/gl_integrator.cc"
+#include "ducc0/math/gridding_kernel.cc"
+#include "ducc0/wgridder/wgridder.cc"
+#include "ducc0/wgridder/wgridder.h"
+#include "ducc0/fft/fftnd_impl.h"
+
+using namespace ducc0;
+using namespace std;
+
+namespace {
+
+template<typename T> struct problem
+  {
+  size_t nrow, nchan, nx, ny;
+  double pix, eps, wmax;
+  bool wgrid, flip;
+  double cx, cy;
+  vmav<double,2> uvw;
+  vmav<double,1> freq;
+  vmav<T,2> wgt;
+  vmav<uint8_t,2> mask;
+  vmav<complex<T>,2> ms;
+  vmav<T,2> dirty;
+
+  problem(size_t nrow_, size_t nchan_, size_t nx_, double eps_, bool wgrid_,
+    bool flip_, double center, double wfrac)
+    : nrow(nrow_), nchan(nchan_), nx(nx_), ny(nx_+2), pix(0.8/nx_),
+      eps(eps_), wmax(0), wgrid(wgrid_), flip(flip_), cx(center),
+      cy(-center), uvw({nrow,3}), freq({nchan}), wgt({nrow,nchan}),
+      mask({nrow,nchan}), ms({nrow,nchan}), dirty({nx,ny})
+    {
+    mt19937 rng(42);
+    uniform_real_distribution<double> u(-1,1);
+    for (size_t i=0; i<nchan; ++i)
+      freq(i) = 1e9+1e7*i;
+    double scale = 0.25*299792458./1e9*nx;
+    for (size_t i=0; i<nrow; ++i)
+      {
+      uvw(i,0) = u(rng)*scale;
+      uvw(i,1) = u(rng)*scale;
+      uvw(i,2) = u(rng)*scale*wfrac;
+      wmax = max(wmax, abs(uvw(i,2)));
+      for (size_t j=0; j<nchan; ++j)
+        {
+        wgt(i,j) = T(u(rng)+1);
+        mask(i,j) = u(rng)>-0.7;
+        ms(i,j) = complex<T>(T(u(rng)), T(u(rng)));
+        }
+      }
+    for (size_t i=0; i<nx; ++i)
+      for (size_t j=0; j<ny; ++j)
+        dirty(i,j) = T(u(rng));
+    }
+
+  Wgridder<T,T,T,T> plan() const
+    {
+    return Wgridder<T,T,T,T>(uvw, freq, wgt, mask, nx, ny, pix, pix, eps,
+      wgrid, 1, 0, flip, true, 1.1, 2.6, cx, cy, true);
+    }
+  void ms2dirty(const cmav<complex<T>,2> &ms_, const vmav<T,2> &dirty_) const
+    {
+    ducc0::ms2dirty<T,T>(uvw, freq, ms_, wgt, mask, pix, pix, eps, wgrid, 1,
+      dirty_, 0, flip, true, 1.1, 2.6, cx, cy);
+    }
+  void dirty2ms(const cmav<T,2> &dirty_, const vmav<complex<T>,2> &ms_) const
+    {
+    ducc0::dirty2ms<T,T>(uvw, freq, dirty_, wgt, mask, pix, pix, eps, wgrid,
+      1, ms_, 0, flip, true, 1.1, 2.6, cx, cy);
+    }
+  };
+
+template<typename T, size_t ndim> double l2error(const cmav<T,ndim> &a,
+  const cmav<T,ndim> &b)
+  {
+  double err=0, nrm=0;
+  mav_apply([&](const T &va, const T &vb)
+    {
+    err += norm(complex<double>(va-vb));
+    nrm += norm(complex<double>(vb));
+    }, 1, a, b);
+  return sqrt(err/nrm);
+  }
+
+bool check(const char *name, double err, double tol)
+  {
+  bool ok = err<=tol;
+  if (!ok)
+    printf("%s failed: relative error %g (tolerance %g)\n", name, err, tol);
+  return ok;
+  }
+
+// plan executions must reproduce the plain functions
+template<typename T> bool test_plan(const problem<T> &p, double tol)
+  {
+  bool ok = true;
+  auto plan = p.plan();
+  vmav<T,2> d1({p.nx,p.ny}), d2({p.nx,p.ny});
+  p.ms2dirty(p.ms, d1);
+  for (size_t i=0; i<2; ++i)  // a plan may be executed repeatedly
+    {
+    plan.ms2dirty(p.ms, d2);
+    ok &= check("Wgridder::ms2dirty", l2error<T,2>(d2, d1), tol);
+    }
+  vmav<complex<T>,2> m1({p.nrow,p.nchan}), m2({p.nrow,p.nchan});
+  p.dirty2ms(p.dirty, m1);
+  mav_apply([](complex<T> &v){v=T(123);}, 1, m2);
+  plan.dirty2ms(p.dirty, m2);
+  ok &= check("Wgridder::dirty2ms", l2error<complex<T>,2>(m2, m1), tol);
+  return ok;
+  }
+
+// dirty2dirty must match ms2dirty(dirty2ms()), also when run in place
+template<typename T> bool test_dirty2dirty(const problem<T> &p, double tol)
+  {
+  bool ok = true;
+  vmav<complex<T>,2> m({p.nrow,p.nchan});
+  vmav<T,2> d1({p.nx,p.ny}), d2({p.nx,p.ny});
+  p.dirty2ms(p.dirty, m);
+  p.ms2dirty(m, d1);
+  dirty2dirty<T,T>(p.uvw, p.freq, p.dirty, p.wgt, p.mask, p.pix, p.pix,
+    p.eps, p.wgrid, 1, d2, 0, p.flip, true, 1.1, 2.6, p.cx, p.cy);
+  ok &= check("dirty2dirty", l2error<T,2>(d2, d1), tol);
+  auto plan = p.plan();
+  mav_apply([](T &out, const T &in){out=in;}, 1, d2, p.dirty);
+  plan.dirty2dirty(d2, d2);
+  ok &= check("Wgridder::dirty2dirty (in place)", l2error<T,2>(d2, d1), tol);
+  return ok;
+  }
+
+// ms2dirty_multi and dirty2ms_multi must match separate ms2dirty and
+// dirty2ms calls; the former also with w plane batching
+template<typename T> bool test_multi(const problem<T> &p, size_t ncorr,
+  size_t nterm, double tol)
+  {
+  bool ok = true;
+  mt19937 rng(17);
+  uniform_real_distribution<double> u(-1,1);
+  vmav<complex<T>,3> ms({ncorr,p.nrow,p.nchan});
+  mav_apply([&](complex<T> &v){v=complex<T>(T(u(rng)), T(u(rng)));}, 1, ms);
+  // no Taylor terms means a single term of ones
+  size_t nimg = ncorr*max<size_t>(nterm, 1);
+  vmav<T,2> taylor({nterm,p.nchan});
+  for (size_t t=0; t<nterm; ++t)
+    for (size_t j=0; j<p.nchan; ++j)
+      taylor(t,j) = T(pow((p.freq(j)-1.05e9)/1e9, double(t)));
+  vmav<T,3> d1({nimg,p.nx,p.ny}), d2({nimg,p.nx,p.ny});
+  vmav<complex<T>,2> tms({p.nrow,p.nchan});
+  for (size_t k=0; k<nimg; ++k)
+    {
+    size_t c=k/(nimg/ncorr), t=k%(nimg/ncorr);
+    for (size_t i=0; i<p.nrow; ++i)
+      for (size_t j=0; j<p.nchan; ++j)
+        tms(i,j) = (nterm==0) ? ms(c,i,j) : ms(c,i,j)*taylor(t,j);
+    p.ms2dirty(tms, subarray<2>(d1, {{k}, {}, {}}));
+    }
+  ms2dirty_multi<T,T>(p.uvw, p.freq, ms, taylor, p.wgt, p.mask, p.pix,
+    p.pix, p.eps, p.wgrid, 1, d2, 0, p.flip, true, 1.1, 2.6, p.cx, p.cy);
+  ok &= check("ms2dirty_multi", l2error<T,3>(d2, d1), tol);
+
+  vmav<T,3> dimg({nimg,p.nx,p.ny});
+  mav_apply([&](T &v){v=T(u(rng));}, 1, dimg);
+  vmav<complex<T>,3> m1({ncorr,p.nrow,p.nchan}), m2({ncorr,p.nrow,p.nchan});
+  for (size_t k=0; k<nimg; ++k)
+    {
+    size_t c=k/(nimg/ncorr), t=k%(nimg/ncorr);
+    p.dirty2ms(subarray<2>(dimg, {{k}, {}, {}}), tms);
+    for (size_t i=0; i<p.nrow; ++i)
+      for (size_t j=0; j<p.nchan; ++j)
+        m1(c,i,j) += (nterm==0) ? tms(i,j) : tms(i,j)*taylor(t,j);
+    }
+  mav_apply([](complex<T> &v){v=T(123);}, 1, m2);
+  dirty2ms_multi<T,T>(p.uvw, p.freq, dimg, taylor, p.wgt, p.mask, p.pix,
+    p.pix, p.eps, p.wgrid, 1, m2, 0, p.flip, true, 1.1, 2.6, p.cx, p.cy);
+  ok &= check("dirty2ms_multi", l2error<complex<T>,3>(m2, m1), tol);
+
+  auto plan = p.plan();
+  // budgets for a single plane, a few planes and all planes
+  for (size_t nbatch: {1, 3, 1000})
+    {
+    plan.set_max_grid_memory(nbatch*4*p.nx*p.ny*ncorr*sizeof(complex<T>));
+    plan.ms2dirty_multi(ms, taylor, d2);
+    ok &= check("Wgridder::ms2dirty_multi (batched)", l2error<T,3>(d2, d1),
+      tol);
+    auto d2s = subarray<2>(d2, {{0}, {}, {}});
+    plan.ms2dirty(subarray<2>(ms, {{0}, {}, {}}), d2s);
+    for (size_t i=0; i<p.nrow; ++i)
+      for (size_t j=0; j<p.nchan; ++j)
+        tms(i,j) = ms(0,i,j);
+    vmav<T,2> d1s({p.nx,p.ny});
+    p.ms2dirty(tms, d1s);
+    ok &= check("Wgridder::ms2dirty (batched)", l2error<T,2>(d2s, d1s), tol);
+    }
+  return ok;
+  }
+
+// visibilities added in chunks must give the ms2dirty image; the
+// accumulator uses its own w planes, so the results agree only to
+// about epsilon
+template<typename T> bool test_accumulator(const problem<T> &p,
+  size_t nchunk, double tol)
+  {
+  bool ok = true;
+  vmav<T,2> d1({p.nx,p.ny}), d2({p.nx,p.ny});
+  p.ms2dirty(p.ms, d1);
+  Wgridder<T,T,T,T> acc(p.freq, 1.1*p.wmax, p.nrow*p.nchan, p.nx, p.ny,
+    p.pix, p.pix, p.eps, p.wgrid, 1, 0, p.flip, true, 1.1, 2.6, p.cx, p.cy,
+    true);
+  for (size_t pass=0; pass<2; ++pass)  // finalize() resets the accumulator
+    {
+    for (size_t c=0; c<nchunk; ++c)
+      {
+      size_t lo=c*p.nrow/nchunk, hi=(c+1)*p.nrow/nchunk;
+      acc.add(subarray<2>(p.uvw, {{lo,hi}, {}}),
+              subarray<2>(p.ms, {{lo,hi}, {}}),
+              subarray<2>(p.wgt, {{lo,hi}, {}}),
+              subarray<2>(p.mask, {{lo,hi}, {}}));
+      }
+    acc.finalize(d2);
+    ok &= check("accumulator", l2error<T,2>(d2, d1), tol);
+    }
+  acc.finalize(d2);
+  bool zero = true;
+  mav_apply([&](const T &v){ if (v!=T(0)) zero=false; }, 1, d2);
+  if (!zero) printf("accumulator failed: image of empty accumulator is not 0\n");
+  ok &= zero;
+  if (p.wgrid && (p.wmax>0))
+    {
+    vmav<double,2> uvw2({1,3});
+    uvw2(0,2) = 2*p.wmax;
+    bool thrown = false;
+    try
+      {
+      acc.add(uvw2, subarray<2>(p.ms, {{0,1}, {}}),
+        vmav<T,2>::build_empty(), vmav<uint8_t,2>::build_empty());
+      }
+    catch (const exception &) { thrown = true; }
+    if (!thrown) printf("accumulator failed: |w|>wmax was accepted\n");
+    ok &= thrown;
+    }
+  return ok;
+  }
+
+template<typename T> bool test(size_t nx, double eps, bool wgrid, bool flip,
+  double center, double wfrac, double tol, double acctol)
+  {
+  problem<T> p(1000, 8, nx, eps, wgrid, flip, center, wfrac);
+  bool ok = true;
+  ok &= test_plan(p, tol);
+  ok &= test_dirty2dirty(p, tol);
+  ok &= test_multi(p, 2, 2, tol);
+  ok &= test_multi(p, 3, 0, tol);
+  ok &= test_accumulator(p, 3, acctol);
+  if (!ok)
+    printf("  (%s, nx=%zu, eps=%g, wgridding=%d, negate_v=%d, center=%g)\n",
+      (sizeof(T)==4) ? "float" : "double", nx, eps, int(wgrid), int(flip),
+      center);
+  return ok;
+  }
+
+}
+
+int main()
+  {
+  bool ok = true;
+  ok &= test<double>(64, 1e-10, false, false, 0., 0.1, 1e-11, 1e-9);
+  ok &= test<double>(64, 1e-10, true, false, 0., 0.5, 1e-11, 1e-9);
+  ok &= test<double>(96, 1e-7, true, true, 0.05, 0.3, 1e-11, 1e-6);
+  ok &= test<double>(64, 1e-10, true, false, 0., 0., 1e-11, 1e-9);
+  ok &= test<float>(64, 1e-5, true, false, 0., 0.5, 1e-5, 1e-4);
+  ok &= test<float>(64, 1e-4, false, true, 0.02, 0.1, 1e-5, 1e-3);
+  printf("%s\n", ok ? "passed" : "FAILED");
+  return ok ? 0 : 1;
+  }
@@ -101,6 +101,63 @@ shape_t makeaxes(const py::array &in, const py::object &axes)
   throw std::runtime_error("unsupported data type"); \
   }
 
+// float16 and bfloat16 arrays are not known to pybind11, so they need some
+// manual handling
+template<typename Ts> bool isPyarr16(const py::object &obj)
+  {
+  if constexpr (!ducc0::detail_fft::is_fft_storage16<Ts>::value)
+    return false;
+  else
+    {
+    if (!py::isinstance<py::array>(obj)) return false;
+    auto dtype = py::reinterpret_borrow<py::array>(obj).dtype();
+    if (dtype.itemsize()!=2) return false;
+    auto name = py::str(dtype).cast<std::string>();
+    return name==(std::is_same_v<Ts, float16> ? "float16" : "bfloat16");
+    }
+  }
+
+template<typename Ts> cfmav<Ts> to_cfmav_storage(const py::object &obj)
+  {
+  if constexpr (!ducc0::detail_fft::is_fft_storage16<Ts>::value)
+    return to_cfmav<Ts>(obj);
+  else
+    {
+    MR_assert(isPyarr16<Ts>(obj), "incorrect data type");
+    auto arr = py::reinterpret_borrow<py::array>(obj);
+    return cfmav<Ts>(reinterpret_cast<const Ts *>(arr.data()),
+      detail_pybind::copy_shape(arr), detail_pybind::copy_strides<Ts>(arr, false));
+    }
+  }
+template<typename Ts> vfmav<Ts> to_vfmav_storage(const py::object &obj)
+  {
+  if constexpr (!ducc0::detail_fft::is_fft_storage16<Ts>::value)
+    return to_vfmav<Ts>(obj);
+  else
+    {
+    MR_assert(isPyarr16<Ts>(obj), "incorrect data type");
+    auto arr = py::reinterpret_borrow<py::array>(obj);
+    return vfmav<Ts>(reinterpret_cast<Ts *>(arr.mutable_data()),
+      detail_pybind::copy_shape(arr), detail_pybind::copy_strides<Ts>(arr, true));
+    }
+  }
+// 16-bit output arrays cannot be created here and must be provided
+template<typename Ts> py::array get_optional_Pyarr_storage(py::object &arr_,
+  const shape_t &dims)
+  {
+  if constexpr (!ducc0::detail_fft::is_fft_storage16<Ts>::value)
+    return get_optional_Pyarr<Ts>(arr_, dims);
+  else
+    {
+    MR_assert(isPyarr16<Ts>(arr_), "incorrect data type");
+    auto tmp = py::reinterpret_borrow<py::array>(arr_);
+    MR_assert(dims.size()==size_t(tmp.ndim()), "dimension mismatch");
+    for (size_t i=0; i<dims.size(); ++i)
+      MR_assert(dims[i]==size_t(tmp.shape(int(i))), "dimension mismatch");
+    return tmp;
+    }
+  }
+
 template<typename T> T norm_fct(int inorm, size_t N)
   {
   if (inorm==0) return T(1);
@@ -135,12 +192,12 @@ template<typename T> py::array c2c_internal(const py::array &in,
   return out;
   }
 
-template<typename T> py::array c2c_sym_internal(const py::array &in,
+template<typename T, typename Ts=T> py::array c2c_sym_internal(const py::array &in,
   const py::object &axes_, bool forward, int inorm, py::object &out_,
   size_t nthreads)
   {
   auto axes = makeaxes(in, axes_);
-  auto ain = to_cfmav<T>(in);
+  auto ain = to_cfmav_storage<Ts>(in);
   auto out = get_optional_Pyarr<std::complex<T>>(out_, ain.shape());
   auto aout = to_vfmav<std::complex<T>>(out);
   {
@@ -168,16 +225,47 @@ py::array c2c(const py::array &a, const py::object &axes_, bool forward,
     DISPATCH(a, c128, c64, clong, c2c_internal, (a, axes_, forward,
              inorm, out_, nthreads))
 
+  if (isPyarr16<float16>(a))
+    return c2c_sym_internal<float, float16>(a, axes_, forward, inorm, out_,
+      nthreads);
+  if (isPyarr16<bfloat16>(a))
+    return c2c_sym_internal<float, bfloat16>(a, axes_, forward, inorm, out_,
+      nthreads);
   DISPATCH(a, f64, f32, flong, c2c_sym_internal, (a, axes_, forward,
            inorm, out_, nthreads))
   }
 
-template<typename T> py::array r2c_internal(const py::array &in,
+template<typename T> py::array c2c_out_of_core_internal(const py::array &in,
+  const py::object &axes_, bool forward, int inorm, py::object &out_,
+  size_t memory_limit, size_t nthreads)
+  {
+  auto axes = makeaxes(in, axes_);
+  auto ain = to_cfmav<std::complex<T>>(in);
+  auto out = get_optional_Pyarr<std::complex<T>>(out_, ain.shape());
+  auto aout = to_vfmav<std::complex<T>>(out);
+  {
+  py::gil_scoped_release release;
+  T fct = norm_fct<T>(inorm, ain.shape(), axes);
+  ducc0::c2c_out_of_core(ain, aout, axes, forward, fct, memory_limit,
+    nthreads);
+  }
+  return out;
+  }
+
+py::array c2c_out_of_core(const py::array &a, const py::object &axes_,
+  bool forward, int inorm, py::object &out_, size_t memory_limit,
+  size_t nthreads)
+  {
+  DISPATCH(a, c128, c64, clong, c2c_out_of_core_internal, (a, axes_, forward,
+           inorm, out_, memory_limit, nthreads))
+  }
+
+template<typename T, typename Ts=T> py::array r2c_internal(const py::array &in,
   const py::object &axes_, bool forward, int inorm, py::object &out_,
   size_t nthreads)
   {
   auto axes = makeaxes(in, axes_);
-  auto ain = to_cfmav<T>(in);
+  auto ain = to_cfmav_storage<Ts>(in);
   auto dims_out(ain.shape());
   dims_out[axes.back()] = (dims_out[axes.back()]>>1)+1;
   auto out = get_optional_Pyarr<std::complex<T>>(out_, dims_out);
@@ -193,6 +281,12 @@ template<typename T> py::array r2c_internal(const py::array &in,
 py::array r2c(const py::array &in, const py::object &axes_, bool forward,
   int inorm, py::object &out_, size_t nthreads)
   {
+  if (isPyarr16<float16>(in))
+    return r2c_internal<float, float16>(in, axes_, forward, inorm, out_,
+      nthreads);
+  if (isPyarr16<bfloat16>(in))
+    return r2c_internal<float, bfloat16>(in, axes_, forward, inorm, out_,
+      nthreads);
   DISPATCH(in, f64, f32, flong, r2c_internal, (in, axes_, forward, inorm, out_,
     nthreads))
   }
@@ -296,7 +390,7 @@ py::array dst(const py::array &in, int type, const py::object &axes_,
     out_, nthreads))
   }
 
-template<typename T> py::array c2r_internal(const py::array &in,
+template<typename T, typename Ts=T> py::array c2r_internal(const py::array &in,
   const py::object &axes_, size_t lastsize, bool forward, int inorm,
   py::object &out_, size_t nthreads, bool allow_overwriting_input)
   {
@@ -308,8 +402,8 @@ template<typename T> py::array c2r_internal(const py::array &in,
   if ((lastsize/2) + 1 != ain_c.shape(axis))
     throw std::invalid_argument("bad lastsize");
   dims_out[axis] = lastsize;
-  auto out = get_optional_Pyarr<T>(out_, dims_out);
-  auto aout = to_vfmav<T>(out);
+  auto out = get_optional_Pyarr_storage<Ts>(out_, dims_out);
+  auto aout = to_vfmav_storage<Ts>(out);
   T fct = norm_fct<T>(inorm, aout.shape(), axes);
   if (allow_overwriting_input)
     {
@@ -331,6 +425,15 @@ py::array c2r(py::array &in, const py::object &axes_, size_t lastsize,
   bool forward, int inorm, py::object &out_, size_t nthreads,
   bool allow_overwriting_input)
   {
+  if (isPyarr16<float16>(out_) || isPyarr16<bfloat16>(out_))
+    {
+    MR_assert(isPyarr<c64>(in), "16-bit output requires complex64 input");
+    if (isPyarr16<float16>(out_))
+      return c2r_internal<float, float16>(in, axes_, lastsize, forward, inorm,
+        out_, nthreads, allow_overwriting_input);
+    return c2r_internal<float, bfloat16>(in, axes_, lastsize, forward, inorm,
+      out_, nthreads, allow_overwriting_input);
+    }
   DISPATCH(in, c128, c64, clong, c2r_internal, (in, axes_, lastsize, forward,
     inorm, out_, nthreads, allow_overwriting_input))
   }
@@ -478,6 +581,308 @@ py::array convolve_axis(const py::array &in, py::array &out, size_t axis,
       kernel, nthreads))
   }
 
+void tune(size_t length, const py::object &dtype_)
+  {
+  auto dtype = py::dtype::from_args(dtype_);
+  size_t prec = (dtype.kind()=='c') ? dtype.itemsize()/2 : dtype.itemsize();
+  MR_assert((dtype.kind()=='c') || (dtype.kind()=='f'), "unsupported data type");
+  py::gil_scoped_release release;
+  if (prec==sizeof(double))
+    ducc0::tune_fft<double>(length);
+  else if (prec==sizeof(float))
+    ducc0::tune_fft<float>(length);
+  else if (prec==sizeof(ldbl_t))
+    ducc0::tune_fft<ldbl_t>(length);
+  else
+    throw std::runtime_error("unsupported data type");
+  }
+
+void save_wisdom(const std::string &filename)
+  { ducc0::save_fft_wisdom(filename); }
+void load_wisdom(const std::string &filename)
+  { ducc0::load_fft_wisdom(filename); }
+void forget_wisdom()
+  { ducc0::forget_fft_wisdom(); }
+void set_autotuning(bool enable)
+  { ducc0::set_fft_autotuning(enable); }
+
+void set_plan_cache_limits(size_t max_entries, size_t max_bytes,
+  size_t thread_local_entries)
+  { ducc0::set_fft_plan_cache_limits(max_entries, max_bytes, thread_local_entries); }
+py::dict plan_cache_info()
+  {
+  auto info = ducc0::get_fft_plan_cache_info();
+  py::dict res;
+  res["hits"] = info.hits;
+  res["misses"] = info.misses;
+  res["evictions"] = info.evictions;
+  res["entries"] = info.entries;
+  res["bytes"] = info.bytes;
+  return res;
+  }
+void clear_plan_cache()
+  { ducc0::clear_fft_plan_cache(); }
+
+class Py_FFTPlan
+  {
+  private:
+    template<typename T> struct plans
+      {
+      std::unique_ptr<ducc0::c2c_plan<T>> c2c;
+      std::unique_ptr<ducc0::r2c_plan<T>> r2c;
+      std::unique_ptr<ducc0::c2r_plan<T>> c2r;
+      };
+    std::string kind;
+    shape_t axes, oshape, nshape;
+    py::dtype dtype;
+    plans<f64> pd;
+    plans<f32> pf;
+    plans<flong> pl;
+
+    template<typename T> plans<T> &getplans()
+      {
+      if constexpr (std::is_same<T,f64>::value) return pd;
+      else if constexpr (std::is_same<T,f32>::value) return pf;
+      else return pl;
+      }
+
+    template<typename T> void construct(const py::array &a,
+      const py::object &out_, size_t lastsize, size_t nthreads)
+      {
+      auto &p(getplans<T>());
+      if (kind=="c2c")
+        {
+        auto ain = to_cfmav<std::complex<T>>(a);
+        oshape = nshape = ain.shape();
+        py::object out(out_);
+        auto oarr = get_optional_Pyarr<std::complex<T>>(out, oshape);
+        auto aout = to_vfmav<std::complex<T>>(oarr);
+        py::gil_scoped_release release;
+        p.c2c = std::make_unique<ducc0::c2c_plan<T>>(ain, aout, axes,
+          ain.data()==aout.data(), nthreads);
+        }
+      else if (kind=="r2c")
+        {
+        auto ain = to_cfmav<T>(a);
+        oshape = nshape = ain.shape();
+        oshape[axes.back()] = (oshape[axes.back()]>>1)+1;
+        py::object out(out_);
+        auto oarr = get_optional_Pyarr<std::complex<T>>(out, oshape);
+        auto aout = to_vfmav<std::complex<T>>(oarr);
+        py::gil_scoped_release release;
+        p.r2c = std::make_unique<ducc0::r2c_plan<T>>(ain, aout, axes, nthreads);
+        }
+      else if (kind=="c2r")
+        {
+        auto ain = to_cfmav<std::complex<T>>(a);
+        size_t axis = axes.back();
+        if (lastsize==0) lastsize=2*ain.shape(axis)-1;
+        if ((lastsize/2) + 1 != ain.shape(axis))
+          throw std::invalid_argument("bad lastsize");
+        oshape = nshape = ain.shape();
+        oshape[axis] = nshape[axis] = lastsize;
+        py::object out(out_);
+        auto oarr = get_optional_Pyarr<T>(out, oshape);
+        auto aout = to_vfmav<T>(oarr);
+        py::gil_scoped_release release;
+        p.c2r = std::make_unique<ducc0::c2r_plan<T>>(ain, aout, axes, nthreads);
+        }
+      else
+        throw std::invalid_argument("kind must be 'c2c', 'r2c' or 'c2r'");
+      }
+
+    template<typename T> py::array do_execute(const py::array &a,
+      bool forward, int inorm, py::object &out_)
+      {
+      auto &p(getplans<T>());
+      T fct = norm_fct<T>(inorm, nshape, axes);
+      if (p.c2c)
+        {
+        auto ain = to_cfmav<std::complex<T>>(a);
+        auto out = get_optional_Pyarr<std::complex<T>>(out_, oshape);
+        auto aout = to_vfmav<std::complex<T>>(out);
+        {
+        py::gil_scoped_release release;
+        p.c2c->exec(ain, aout, forward, fct);
+        }
+        return out;
+        }
+      if (p.r2c)
+        {
+        auto ain = to_cfmav<T>(a);
+        auto out = get_optional_Pyarr<std::complex<T>>(out_, oshape);
+        auto aout = to_vfmav<std::complex<T>>(out);
+        {
+        py::gil_scoped_release release;
+        p.r2c->exec(ain, aout, forward, fct);
+        }
+        return out;
+        }
+      auto ain = to_cfmav<std::complex<T>>(a);
+      auto out = get_optional_Pyarr<T>(out_, oshape);
+      auto aout = to_vfmav<T>(out);
+      {
+      py::gil_scoped_release release;
+      p.c2r->exec(ain, aout, forward, fct);
+      }
+      return out;
+      }
+
+    void init(const py::array &a, const py::object &out, size_t lastsize,
+      size_t nthreads)
+      {
+      if (kind=="r2c")
+        DISPATCH(a, f64, f32, flong, construct, (a, out, lastsize, nthreads))
+      else
+        DISPATCH(a, c128, c64, clong, construct, (a, out, lastsize, nthreads))
+      }
+
+  public:
+    Py_FFTPlan(const std::string &kind_, const py::array &a,
+      const py::object &axes_, const py::object &out, size_t lastsize,
+      size_t nthreads)
+      : kind(kind_), axes(makeaxes(a, axes_)), dtype(a.dtype())
+      { init(a, out, lastsize, nthreads); }
+
+    py::array execute(const py::array &a, bool forward, int inorm,
+      py::object &out)
+      {
+      MR_assert(a.dtype().equal(dtype), "data type does not match the plan");
+      if (kind=="r2c")
+        DISPATCH(a, f64, f32, flong, do_execute, (a, forward, inorm, out))
+      else
+        DISPATCH(a, c128, c64, clong, do_execute, (a, forward, inorm, out))
+      }
+  };
+
+class Py_FFTConvolver
+  {
+  private:
+    template<typename T> struct convolvers
+      {
+      std::unique_ptr<ducc0::fft_convolver<T>> r;
+      std::unique_ptr<ducc0::fft_convolver<std::complex<T>>> c;
+      };
+    py::dtype dtype;
+    convolvers<f64> cd;
+    convolvers<f32> cf;
+    convolvers<flong> cl;
+
+    template<typename T> convolvers<T> &getconvolvers()
+      {
+      if constexpr (std::is_same<T,f64>::value) return cd;
+      else if constexpr (std::is_same<T,f32>::value) return cf;
+      else return cl;
+      }
+
+    template<typename T> void construct(const py::array &kernel,
+      bool correlate, size_t fftlen)
+      {
+      auto &c(getconvolvers<T>());
+      if (kernel.dtype().kind()=='c')
+        c.c = std::make_unique<ducc0::fft_convolver<std::complex<T>>>(
+          to_cmav<std::complex<T>,1>(kernel), correlate, fftlen);
+      else
+        c.r = std::make_unique<ducc0::fft_convolver<T>>(
+          to_cmav<T,1>(kernel), correlate, fftlen);
+      }
+
+    template<typename T, typename Tconv> py::array do_apply2(Tconv &conv,
+      const py::array &a, int axis, ptrdiff_t shift, py::object &out_,
+      size_t nthreads)
+      {
+      if (axis<0) axis+=a.ndim();
+      MR_assert((axis>=0) && (axis<a.ndim()), "bad axis number");
+      auto ain = to_cfmav<T>(a);
+      auto out = out_.is_none() ? make_Pyarr<T>(ain.shape())
+                               : detail_pybind::toPyarr<T>(out_);
+      auto aout = to_vfmav<T>(out);
+      {
+      py::gil_scoped_release release;
+      conv.apply(ain, aout, size_t(axis), shift, nthreads);
+      }
+      return out;
+      }
+    template<typename T> py::array do_apply(const py::array &a, int axis,
+      ptrdiff_t shift, py::object &out_, size_t nthreads)
+      {
+      auto &c(getconvolvers<T>());
+      if (c.c)
+        return do_apply2<std::complex<T>>(*c.c, a, axis, shift, out_, nthreads);
+      return do_apply2<T>(*c.r, a, axis, shift, out_, nthreads);
+      }
+
+    template<typename T, typename Tconv> py::array do_process2(Tconv &conv,
+      const py::array &a, py::object &out_)
+      {
+      auto ain = to_cmav<T,1>(a);
+      auto out = get_optional_Pyarr<T>(out_, {ain.shape(0)});
+      auto aout = to_vmav<T,1>(out);
+      {
+      py::gil_scoped_release release;
+      conv.process(ain, aout);
+      }
+      return out;
+      }
+    template<typename T> py::array do_process(const py::array &a,
+      py::object &out_)
+      {
+      auto &c(getconvolvers<T>());
+      if (c.c)
+        return do_process2<std::complex<T>>(*c.c, a, out_);
+      return do_process2<T>(*c.r, a, out_);
+      }
+
+    void init(const py::array &kernel, bool correlate, size_t fftlen)
+      {
+      if (kernel.dtype().kind()=='c')
+        DISPATCH(kernel, c128, c64, clong, construct, (kernel, correlate, fftlen))
+      else
+        DISPATCH(kernel, f64, f32, flong, construct, (kernel, correlate, fftlen))
+      }
+
+    template<typename Func> void visit(Func &&func) const
+      {
+      if (cd.r) func(*cd.r);
+      if (cd.c) func(*cd.c);
+      if (cf.r) func(*cf.r);
+      if (cf.c) func(*cf.c);
+      if (cl.r) func(*cl.r);
+      if (cl.c) func(*cl.c);
+      }
+
+  public:
+    Py_FFTConvolver(const py::array &kernel, bool correlate, size_t fftlen)
+      : dtype(kernel.dtype())
+      { init(kernel, correlate, fftlen); }
+
+    py::array apply(const py::array &a, int axis, ptrdiff_t shift,
+      py::object &out, size_t nthreads)
+      {
+      MR_assert(a.dtype().equal(dtype), "data type does not match the kernel");
+      if (dtype.kind()=='c')
+        DISPATCH(a, c128, c64, clong, do_apply, (a, axis, shift, out, nthreads))
+      else
+        DISPATCH(a, f64, f32, flong, do_apply, (a, axis, shift, out, nthreads))
+      }
+    py::array process(const py::array &a, py::object &out)
+      {
+      MR_assert(a.dtype().equal(dtype), "data type does not match the kernel");
+      if (dtype.kind()=='c')
+        DISPATCH(a, c128, c64, clong, do_process, (a, out))
+      else
+        DISPATCH(a, f64, f32, flong, do_process, (a, out))
+      }
+    void reset()
+      { visit([](auto &conv) { conv.reset(); }); }
+    size_t fftlen() const
+      {
+      size_t res=0;
+      visit([&res](const auto &conv) { res=conv.fftlen(); });
+      return res;
+      }
+  };
+
 const char *fft_DS = R"""(Fast Fourier, sine/cosine, and Hartley transforms.
 
 This module supports
@@ -496,7 +901,9 @@ Parameters
 ----------
 a : numpy.ndarray (any complex or real type)
     The input data. If its type is real, a more efficient real-to-complex
-    transform will be used.
+    transform will be used. Real input may also be of type float16 or
+    bfloat16 (from the `ml_dtypes` package); it is converted on the fly, and
+    the transform is done in single precision.
 axes : list of integers
     The axes along which the FFT is carried out.
     If not set, all axes will be transformed.
@@ -522,12 +929,54 @@ numpy.ndarray (same shape as `a`, complex type with same accuracy as `a`)
     The transformed data.
 )""";
 
+const char *c2c_out_of_core_DS = R"""(Performs a complex FFT on arrays which do not fit into main memory.
+
+The arrays are typically created via `numpy.memmap`. They are only accessed
+in tiles of at most `memory_limit` bytes, which are visited in storage order,
+so that the resulting I/O is mostly sequential. Every transformed axis which
+does not fit into memory together with all axes of smaller stride requires an
+additional pass over the data.
+
+Parameters
+----------
+a : numpy.ndarray (any complex type)
+    The input data
+axes : list of integers
+    The axes along which the FFT is carried out.
+    If not set, all axes will be transformed.
+forward : bool
+    If `True`, a negative sign is used in the exponent, else a positive one.
+inorm : int
+    Normalization type
+      | 0 : no normalization
+      | 1 : divide by sqrt(N)
+      | 2 : divide by N
+
+    where N is the product of the lengths of the transformed axes.
+out : numpy.ndarray (same shape and data type as `a`)
+    May be identical to `a` (except for one-dimensional arrays larger than
+    `memory_limit`), but if it isn't, it must not overlap with `a`.
+    If None, a new array is allocated in main memory to store the output.
+memory_limit : int
+    Maximum size of the internal buffer (in bytes)
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the number
+    of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray (same shape and data type as `a`)
+    The transformed data.
+)""";
+
 const char *r2c_DS = R"""(Performs an FFT whose input is strictly real.
 
 Parameters
 ----------
 a : numpy.ndarray (any real type)
-    The input data
+    The input data. float16 and bfloat16 (from the `ml_dtypes` package) are
+    accepted as well; they are converted on the fly, and the transform is done
+    in single precision (i.e. the output is complex64).
 axes : list of integers
     The axes along which the FFT is carried out.
     If not set, this is assumed to be `list(range(a.ndim))`.
@@ -584,6 +1033,8 @@ out : numpy.ndarray (real type with same accuracy as `a`)
     For the required shape, see the `Returns` section.
     Must not overlap with `a`.
     If None, a new array is allocated to store the output.
+    If `a` is complex64, `out` may also be of type float16 or bfloat16;
+    the results are then rounded on the fly while being stored.
 nthreads : int
     Number of threads to use. If 0, use the system default (typically the number
     of hardware threads on the compute node).
@@ -965,6 +1416,229 @@ out : int
 
 )""";
 
+const char *tune_DS = R"""(Measures the speed of alternative algorithms for 1D FFTs
+of a given length on this machine and remembers the fastest ones.
+
+All transforms of this length created afterwards (complex and real, in all
+modules of ducc0) will use the measured algorithms.
+
+Parameters
+----------
+length : int
+    The transform length to tune.
+dtype : numpy.dtype, optional
+    The data type of the transforms. Complex types are treated like the real
+    type with the same precision.
+
+Notes
+-----
+Tuning a single length typically takes a few milliseconds. The results
+("wisdom") can be stored with `save_wisdom` and loaded again with
+`load_wisdom`.
+)""";
+
+const char *save_wisdom_DS = R"""(Writes the current FFT wisdom to a text file.
+
+Parameters
+----------
+filename : str
+    The name of the output file.
+)""";
+
+const char *load_wisdom_DS = R"""(Adds the FFT wisdom stored in a text file to the current wisdom.
+
+Parameters
+----------
+filename : str
+    The name of a file written by `save_wisdom`.
+)""";
+
+const char *forget_wisdom_DS = R"""(Discards all FFT wisdom.
+)""";
+
+const char *set_autotuning_DS = R"""(Switches automatic tuning on or off.
+
+If switched on, every new 1D FFT plan for which no wisdom exists is tuned
+(as in `tune`) before it is used. This makes the first transform of every
+length considerably slower. Off by default.
+
+Parameters
+----------
+enable : bool
+)""";
+
+const char *set_plan_cache_limits_DS = R"""(Configures the cache of FFT plans.
+
+Plans (including their twiddle factors) are cached across calls, so that
+repeated transforms of the same length do not need to recompute them.
+
+Parameters
+----------
+max_entries : int
+    Maximum number of plans kept in the cache.
+max_bytes : int
+    If nonzero, plans are also evicted when the estimated memory held by all
+    cached plans exceeds this number of bytes.
+thread_local_entries : int
+    If nonzero, every thread additionally remembers this many recently used
+    plans, which can be retrieved without any synchronization between threads.
+    Useful when many threads run small transforms concurrently.
+)""";
+
+const char *plan_cache_info_DS = R"""(Returns statistics of the FFT plan cache.
+
+Returns
+-------
+dict
+    "hits": number of lookups answered from the cache;
+    "misses": number of lookups which required computing a new plan;
+    "evictions": number of plans removed to stay within the cache limits;
+    "entries": number of plans currently held by the cache;
+    "bytes": estimated memory held by these plans.
+)""";
+
+const char *clear_plan_cache_DS = R"""(Removes all plans from the FFT plan cache.
+
+The statistics reported by `plan_cache_info` are not reset.
+)""";
+
+const char *Plan_DS = R"""(Reusable multi-dimensional FFT
+
+Precomputes all 1D plans and scratch buffers for repeated transforms of arrays
+with identical shape, strides and data type, so that `execute` does not
+need to repeat this setup on every call. This is beneficial when many small or
+medium-sized transforms have to be carried out.
+A plan object must not be executed by several threads at the same time.
+)""";
+
+const char *Plan_init_DS = R"""(Creates a new plan.
+
+Parameters
+----------
+kind : str
+    "c2c", "r2c" or "c2r", with the same meaning as the functions of the same
+    name.
+a : numpy.ndarray
+    An example input array; all arrays passed to `execute` must have its
+    shape, strides and data type.
+axes : list of integers
+    The axes along which the FFT is carried out.
+    If not set, all axes will be transformed.
+    For "r2c" and "c2r", the real-valued transform is done along the last
+    listed axis.
+out : numpy.ndarray, optional
+    An example output array; all output arrays passed to `execute` must have
+    its shape and strides.
+    If not set, `execute` expects (or allocates) C-contiguous output arrays.
+    If it shares its memory with `a` (only for "c2c"), the plan will only
+    accept in-place transforms.
+lastsize : int
+    Only used for "c2r"; see `c2r`.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically governed
+    by the `OMP_NUM_THREADS` environment variable).
+)""";
+
+const char *Plan_execute_DS = R"""(Executes the plan.
+
+Parameters
+----------
+a : numpy.ndarray
+    The input data; must match the layout given at construction.
+forward : bool
+    If `True`, a negative sign is used in the exponent, else a positive one.
+inorm : int
+    Normalization type, as in `c2c`.
+out : numpy.ndarray, optional
+    May be provided to store the result; must match the layout given at
+    construction.
+
+Returns
+-------
+numpy.ndarray
+    The transformed data. Identical to `out`, if it was provided.
+)""";
+
+const char *Convolver_DS = R"""(Fast linear convolution or correlation with a fixed kernel
+
+The spectrum of the kernel is computed once on construction. The data are
+processed in blocks with the overlap-save method; forward FFT, multiplication
+with the kernel spectrum and backward FFT of every block happen in small
+scratch buffers, so no complex intermediate array of the size of the input
+is created.
+Real kernels can only be applied to real data of the same precision, complex
+kernels only to complex data of the same precision.
+A Convolver object must not be used by several threads at the same time.
+)""";
+
+const char *Convolver_init_DS = R"""(Creates a new convolver.
+
+Parameters
+----------
+kernel : numpy.ndarray((nkernel,), dtype=numpy.float32, numpy.float64, numpy.complex64 or numpy.complex128)
+    The filter kernel.
+correlate : bool
+    If `True`, a correlation with the kernel is computed instead of a
+    convolution.
+fftlen : int
+    The FFT length used for the individual blocks; must be at least `nkernel`.
+    If 0, a suitable length is chosen automatically.
+)""";
+
+const char *Convolver_apply_DS = R"""(Filters all 1D lines of an array along an axis.
+
+For convolution, output element `i` along `axis` is
+`sum_j kernel[j]*a[i+shift-j]`; entries outside `a` are treated as zero.
+Correlation is carried out as convolution with `conj(kernel[::-1])`.
+The "full", "same" and "valid" modes of `numpy.convolve` correspond to
+`shift` values of 0, (nkernel-1)//2 and nkernel-1, together with the
+appropriate output lengths.
+
+Parameters
+----------
+a : numpy.ndarray (same data type as the kernel)
+    The input data
+axis : int
+    The axis along which the filter is applied
+shift : int
+    The offset between input and output indices (see above)
+out : numpy.ndarray, optional
+    The output array. Its shape must match `a` except along `axis`, where it
+    can have any length. May be identical to `a`.
+    If None, a new array with the shape of `a` is allocated.
+nthreads : int
+    Number of threads to use. If 0, use the system default (typically the
+    number of hardware threads on the compute node).
+
+Returns
+-------
+numpy.ndarray
+    The filtered data. Identical to `out`, if it was provided.
+)""";
+
+const char *Convolver_process_DS = R"""(Filters the next chunk of a stream.
+
+The output has the same length as the input chunk; the result is identical
+to `apply` with `shift=0` on the concatenation of all chunks since the
+construction or the last call to `reset`. The stream is assumed to be zero
+before its start, and its last nkernel-1 elements are kept inside the object.
+
+Parameters
+----------
+a : numpy.ndarray((nchunk,), same data type as the kernel)
+    The next part of the stream
+out : numpy.ndarray((nchunk,), same data type as the kernel), optional
+    The output array; must not overlap with `a`.
+    If None, a new array is allocated.
+
+Returns
+-------
+numpy.ndarray((nchunk,), same data type as the kernel)
+    The filtered chunk. Identical to `out`, if it was provided.
+)""";
+
+const char *Convolver_reset_DS = R"""(Starts a new stream for `process`.)""";
+
 } // unnamed namespace
 
 void add_fft(py::module_ &msup)
@@ -974,6 +1648,9 @@ void add_fft(py::module_ &msup)
   m.doc() = fft_DS;
   m.def("c2c", c2c, c2c_DS, "a"_a, "axes"_a=None, "forward"_a=true,
     "inorm"_a=0, "out"_a=None, "nthreads"_a=1);
+  m.def("c2c_out_of_core", c2c_out_of_core, c2c_out_of_core_DS, "a"_a,
+    "axes"_a=None, "forward"_a=true, "inorm"_a=0, "out"_a=None,
+    "memory_limit"_a=size_t(1)<<30, "nthreads"_a=1);
   m.def("r2c", r2c, r2c_DS, "a"_a, "axes"_a=None, "forward"_a=true,
     "inorm"_a=0, "out"_a=None, "nthreads"_a=1);
   m.def("c2r", c2r, c2r_DS, "a"_a, "axes"_a=None, "lastsize"_a=0,
@@ -998,6 +1675,34 @@ void add_fft(py::module_ &msup)
   m.def("convolve_axis", convolve_axis, convolve_axis_DS, "in"_a, "out"_a,
     "axis"_a, "kernel"_a, "nthreads"_a=1);
 
+  m.def("tune", tune, tune_DS, "length"_a, "dtype"_a="f8");
+  m.def("save_wisdom", save_wisdom, save_wisdom_DS, "filename"_a);
+  m.def("load_wisdom", load_wisdom, load_wisdom_DS, "filename"_a);
+  m.def("forget_wisdom", forget_wisdom, forget_wisdom_DS);
+  m.def("set_autotuning", set_autotuning, set_autotuning_DS, "enable"_a);
+  m.def("set_plan_cache_limits", set_plan_cache_limits,
+    set_plan_cache_limits_DS, "max_entries"_a=64, "max_bytes"_a=0,
+    "thread_local_entries"_a=0);
+  m.def("plan_cache_info", plan_cache_info, plan_cache_info_DS);
+  m.def("clear_plan_cache", clear_plan_cache, clear_plan_cache_DS);
+
+  py::class_<Py_FFTPlan> (m, "Plan", Plan_DS, py::module_local())
+    .def(py::init<const std::string &, const py::array &, const py::object &,
+      const py::object &, size_t, size_t>(), Plan_init_DS, "kind"_a, "a"_a,
+      "axes"_a=None, "out"_a=None, "lastsize"_a=0, "nthreads"_a=1)
+    .def("execute", &Py_FFTPlan::execute, Plan_execute_DS, "a"_a,
+      "forward"_a=true, "inorm"_a=0, "out"_a=None);
+
+  py::class_<Py_FFTConvolver> (m, "Convolver", Convolver_DS, py::module_local())
+    .def(py::init<const py::array &, bool, size_t>(), Convolver_init_DS,
+      "kernel"_a, "correlate"_a=false, "fftlen"_a=0)
+    .def("apply", &Py_FFTConvolver::apply, Convolver_apply_DS, "a"_a,
+      "axis"_a=-1, "shift"_a=0, "out"_a=None, "nthreads"_a=1)
+    .def("process", &Py_FFTConvolver::process, Convolver_process_DS, "a"_a,
+      "out"_a=None)
+    .def("reset", &Py_FFTConvolver::reset, Convolver_reset_DS)
+    .def_property_readonly("fftlen", &Py_FFTConvolver::fftlen);
+
   static PyMethodDef good_size_meth[] =
     {{"good_size", good_size, METH_VARARGS, good_size_DS},
      {nullptr, nullptr, 0, nullptr}};
@@ -85,6 +85,92 @@ py::array Py_rotate_alm(const py::array &alm, size_t lmax,
   MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
   }
 
+template<typename T> py::array Py2_alm2cl(const py::array &alm_,
+  size_t lmax, const py::object &mmax_, size_t nthreads, py::object &cl__)
+  {
+  size_t mmax = mmax_.is_none() ? lmax : mmax_.cast<size_t>();
+  bool single = (alm_.ndim()==1);
+  auto alm = single ? to_cmav<complex<T>,1>(alm_).prepend_1()
+                    : to_cmav<complex<T>,2>(alm_);
+  size_t nsets = alm.shape(0);
+  auto cl_ = single ? get_optional_Pyarr<double>(cl__, {lmax+1})
+                    : get_optional_Pyarr<double>(cl__, {nsets, nsets, lmax+1});
+  auto cl = single ? to_vmav<double,1>(cl_).prepend_1().prepend_1()
+                   : to_vmav<double,3>(cl_);
+  {
+  py::gil_scoped_release release;
+  Alm_Base base(lmax, mmax);
+  alm2cl(alm, base, cl, nthreads);
+  }
+  return cl_;
+  }
+py::array Py_alm2cl(const py::array &alm, size_t lmax,
+  const py::object &mmax, size_t nthreads, py::object &cl)
+  {
+  if (isPyarr<complex<float>>(alm))
+    return Py2_alm2cl<float>(alm, lmax, mmax, nthreads, cl);
+  if (isPyarr<complex<double>>(alm))
+    return Py2_alm2cl<double>(alm, lmax, mmax, nthreads, cl);
+  MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
+  }
+
+class Py_AlmRotator
+  {
+  private:
+    Alm_Rotator rot;
+
+    template<typename T> py::array rotate2(const py::array &alm_,
+      const py::array &angles_, size_t nthreads) const
+      {
+      bool single = (alm_.ndim()==1);
+      auto a1 = single ? to_cmav<complex<T>,1>(alm_).prepend_1()
+                       : to_cmav<complex<T>,2>(alm_);
+      auto alm = single ? make_Pyarr<complex<T>>({a1.shape(1)})
+                        : make_Pyarr<complex<T>>({a1.shape(0), a1.shape(1)});
+      auto a2 = single ? to_vmav<complex<T>,1>(alm).prepend_1()
+                       : to_vmav<complex<T>,2>(alm);
+      vmav<double,2> angles({a1.shape(0), 3});
+      if (angles_.ndim()==1)
+        {
+        auto ang = to_cmav<double,1>(angles_);
+        MR_assert(ang.shape(0)==3, "angles must have shape (3,) or (nsets, 3)");
+        for (size_t i=0; i<angles.shape(0); ++i)
+          for (size_t j=0; j<3; ++j)
+            angles(i,j) = ang(j);
+        }
+      else
+        {
+        auto ang = to_cmav<double,2>(angles_);
+        MR_assert((ang.shape(0)==angles.shape(0)) && (ang.shape(1)==3),
+          "angles must have shape (3,) or (nsets, 3)");
+        mav_apply([](double &out, double in) { out=in; }, 1, angles, ang);
+        }
+      {
+      py::gil_scoped_release release;
+      mav_apply([](complex<T> &out, const complex<T> &in) { out=in; }, nthreads,
+        a2, a1);
+      rot.rotate(a2, angles, nthreads);
+      }
+      return alm;
+      }
+
+  public:
+    Py_AlmRotator(size_t lmax, size_t nthreads, size_t max_bytes)
+      : rot(lmax, nthreads, max_bytes) {}
+
+    py::array rotate(const py::array &alm, const py::array &angles,
+      size_t nthreads) const
+      {
+      if (isPyarr<complex<float>>(alm))
+        return rotate2<float>(alm, angles, nthreads);
+      if (isPyarr<complex<double>>(alm))
+        return rotate2<double>(alm, angles, nthreads);
+      MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
+      }
+    size_t lmax() const { return rot.Lmax(); }
+    bool cached() const { return rot.cached(); }
+  };
+
 void getmstuff(size_t lmax, const py::object &mval_, const py::object &mstart_,
   vmav<size_t,1> &mval, vmav<size_t,1> &mstart)
   {
@@ -150,6 +236,18 @@ py::array Py_get_gridweights(const string &type, size_t ntheta)
   return wgt_;
   }
 
+py::dict Py_table_cache_info()
+  {
+  auto info = get_sht_table_cache_info();
+  py::dict res;
+  res["hits"] = info.hits;
+  res["misses"] = info.misses;
+  res["evictions"] = info.evictions;
+  res["entries"] = info.entries;
+  res["bytes"] = info.bytes;
+  return res;
+  }
+
 size_t min_almdim(size_t lmax, const cmav<size_t,1> &mval,
   const cmav<size_t,1> &mstart, ptrdiff_t lstride)
   {
@@ -307,8 +405,9 @@ template<typename T> py::array Py2_alm2leg(const py::array &alm_, size_t spin,
   getmstuff(lmax, mval_, mstart_, mval, mstart);
   MR_assert(alm.shape(1)>=min_almdim(lmax, mval, mstart, lstride),
     "bad a_lm array size");
+  size_t nleg = (mode==STANDARD) ? alm.shape(0) : 2*alm.shape(0);
   auto leg_ = get_optional_Pyarr<complex<T>>(leg__,
-    {get_nmaps(spin,mode),theta.shape(0),mval.shape(0)});
+    {nleg,theta.shape(0),mval.shape(0)});
   auto leg = to_vmav<complex<T>,3>(leg_);
   {
   py::gil_scoped_release release;
@@ -337,7 +436,8 @@ py::array Py_alm2leg_deriv1(const py::array &alm, size_t lmax,
 template<typename T> py::array Py2_leg2alm(const py::array &leg_,
   const py::array &theta_, size_t spin, size_t lmax, const py::object &mval_,
   const py::object &mstart_, ptrdiff_t lstride, size_t nthreads,
-  py::object &alm__,const string &mode_, bool theta_interpol=false)
+  py::object &alm__,const string &mode_, bool theta_interpol,
+  py::object &cl__)
   {
   auto mode = get_mode(mode_);
   auto leg = to_cmav<complex<T>,3>(leg_);
@@ -345,11 +445,21 @@ template<typename T> py::array Py2_leg2alm(const py::array &leg_,
   MR_assert(leg.shape(1)==theta.shape(0), "bad leg array size");
   vmav<size_t,1> mval, mstart;
   getmstuff(lmax, mval_, mstart_, mval, mstart);
+  size_t nleg_set = (spin==0) ? 1 : 2;
+  MR_assert((leg.shape(0)>0) && (leg.shape(0)%nleg_set==0),
+    "bad number of components in leg array");
+  size_t nalm = (mode==STANDARD) ? leg.shape(0) : leg.shape(0)/2;
   auto alm_ = get_optional_Pyarr_minshape<complex<T>>(alm__,
-    {get_nalm(spin,mode),min_almdim(lmax, mval, mstart, lstride)});
+    {nalm,min_almdim(lmax, mval, mstart, lstride)});
   auto alm = to_vmav<complex<T>,2>(alm_);
-  MR_assert(leg.shape(0)==1+(spin>0),
-    "bad number of components in leg array");
+  if (!cl__.is_none())
+    {
+    auto cl = to_vmav<double,3>(cl__);
+    py::gil_scoped_release release;
+    leg2alm_cl(alm, cl, leg, spin, lmax, mval, mstart, lstride, theta, nthreads,
+      mode, theta_interpol);
+    return alm_;
+    }
   {
   py::gil_scoped_release release;
   leg2alm(alm, leg, spin, lmax, mval, mstart, lstride, theta, nthreads, mode, theta_interpol);
@@ -358,14 +468,15 @@ template<typename T> py::array Py2_leg2alm(const py::array &leg_,
   }
 py::array Py_leg2alm(const py::array &leg, size_t lmax, const py::array &theta,
   size_t spin, const py::object &mval, const py::object &mstart,
-  ptrdiff_t lstride, size_t nthreads, py::object &alm, const string &mode, bool theta_interpol=false)
+  ptrdiff_t lstride, size_t nthreads, py::object &alm, const string &mode,
+  bool theta_interpol, py::object &cl)
   {
   if (isPyarr<complex<float>>(leg))
     return Py2_leg2alm<float>(leg, theta, spin, lmax, mval, mstart, lstride,
-      nthreads, alm, mode, theta_interpol);
+      nthreads, alm, mode, theta_interpol, cl);
   if (isPyarr<complex<double>>(leg))
     return Py2_leg2alm<double>(leg, theta, spin, lmax, mval, mstart, lstride,
-      nthreads, alm, mode, theta_interpol);
+      nthreads, alm, mode, theta_interpol, cl);
   MR_fail("type matching failed: 'leg' has neither type 'c8' nor 'c16'");
   }
 template<typename T> py::array Py2_map2leg(const py::array &map_,
@@ -429,6 +540,20 @@ py::array Py_leg2map(const py::array &leg, const py::array &nphi,
   MR_fail("type matching failed: 'leg' has neither type 'c8' nor 'c16'");
   }
 
+// Returns true if the first two dimensions of arr can be viewed as one.
+bool leading_dims_mergeable(const mav_info<3> &arr)
+  { return arr.stride(0)==ptrdiff_t(arr.shape(1))*arr.stride(1); }
+template<typename T> cmav<T,2> merge_leading_dims(const cmav<T,3> &arr)
+  {
+  return arr.template reinterpret<2>({arr.shape(0)*arr.shape(1), arr.shape(2)},
+    {arr.stride(1), arr.stride(2)});
+  }
+template<typename T> vmav<T,2> merge_leading_dims(const vmav<T,3> &arr)
+  {
+  return arr.template reinterpret<2>({arr.shape(0)*arr.shape(1), arr.shape(2)},
+    {arr.stride(1), arr.stride(2)});
+  }
+
 // FIXME: open questions
 // - do we build mstart automatically and just take mmax?
 // - phi0, ringstart = None => build assuming phi0=0, rings sequential?
@@ -440,7 +565,7 @@ template<typename T> py::array Py2_synthesis(const py::array &alm_,
   const py::array &nphi_,
   const py::array &phi0_, const py::array &ringstart_,
   ptrdiff_t pixstride, size_t nthreads, const py::object &mmax_,
-  const string &mode_, bool theta_interpol=false)
+  const string &mode_, bool theta_interpol, double epsilon, double &maxskip)
   {
   auto mode = get_mode(mode_);
   auto mstart = get_mstart(lmax, mmax_, mstart_);
@@ -453,7 +578,7 @@ template<typename T> py::array Py2_synthesis(const py::array &alm_,
   vector<size_t> mapshp(alm_.ndim());
   for(size_t i=0; i<mapshp.size(); ++i) mapshp[i] = alm_.shape()[i];
   mapshp[mapshp.size()-1] = min_mapdim(nphi, ringstart, pixstride);
-  mapshp[mapshp.size()-2] = get_nmaps(spin, mode);
+  mapshp[mapshp.size()-2] = (mode==STANDARD) ? alm.shape(1) : 2*alm.shape(1);
   auto map_ = get_optional_Pyarr_minshape<T>(map__, mapshp);
   auto map = to_vmav_with_optional_leading_dimensions<T,3>(map_);
   MR_assert(map.shape(0)==alm.shape(0), "bad number of components in map array");
@@ -461,33 +586,55 @@ template<typename T> py::array Py2_synthesis(const py::array &alm_,
   size_t nthreads_outer=1;
   if (alm.shape(0)>nthreads)  // parallelize over entire transforms
     { nthreads_outer=nthreads; nthreads=1; }
+  if ((alm.shape(0)>1) && (nthreads_outer==1)
+    && leading_dims_mergeable(alm) && leading_dims_mergeable(map))
+    {  // single call, sharing the Legendre functions between all transforms
+    py::gil_scoped_release release;
+    maxskip = synthesis(merge_leading_dims(alm), merge_leading_dims(map),
+      spin, lmax, mstart, lstride, theta, nphi, phi0, ringstart, pixstride,
+      nthreads, mode, theta_interpol, epsilon);
+    return map_;
+    }
   {
   py::gil_scoped_release release;
+  vector<double> skip(alm.shape(0), 0.);
   execDynamic(alm.shape(0), nthreads_outer, 1, [&](Scheduler &sched)
     {
     while (auto rng=sched.getNext())
       for(auto itrans=rng.lo; itrans<rng.hi; ++itrans)
-        synthesis(subarray<2>(alm, {{itrans},{},{}}),
+        skip[itrans] = synthesis(subarray<2>(alm, {{itrans},{},{}}),
           subarray<2>(map, {{itrans},{},{}}), spin, lmax, mstart, lstride, theta, nphi,
-          phi0, ringstart, pixstride, nthreads, mode, theta_interpol);
+          phi0, ringstart, pixstride, nthreads, mode, theta_interpol, epsilon);
     });
+  maxskip = 0.;
+  for (auto v: skip) maxskip = max(maxskip, v);
   }
   return map_;
   }
-py::array Py_synthesis(const py::array &alm, const py::array &theta,
+py::object Py_synthesis(const py::array &alm, const py::array &theta,
   size_t lmax, const py::object &mstart,
   const py::array &nphi,
   const py::array &phi0, const py::array &ringstart, size_t spin,
   ptrdiff_t lstride, ptrdiff_t pixstride, size_t nthreads, py::object &map,
-  const py::object &mmax_, const string &mode, bool theta_interpol=false)
+  const py::object &mmax_, const string &mode, bool theta_interpol=false,
+  double epsilon=0.)
   {
+  MR_assert(epsilon>=0., "epsilon must not be negative");
+  double maxskip=0.;
+  py::array res;
   if (isPyarr<complex<float>>(alm))
-    return Py2_synthesis<float>(alm, map, spin, lmax, mstart, lstride, theta,
-      nphi, phi0, ringstart, pixstride, nthreads, mmax_, mode, theta_interpol);
+    res = Py2_synthesis<float>(alm, map, spin, lmax, mstart, lstride, theta,
+      nphi, phi0, ringstart, pixstride, nthreads, mmax_, mode, theta_interpol,
+      epsilon, maxskip);
   else if (isPyarr<complex<double>>(alm))
-    return Py2_synthesis<double>(alm, map, spin, lmax, mstart, lstride, theta,
-      nphi, phi0, ringstart, pixstride, nthreads, mmax_, mode, theta_interpol);
-  MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
+    res = Py2_synthesis<double>(alm, map, spin, lmax, mstart, lstride, theta,
+      nphi, phi0, ringstart, pixstride, nthreads, mmax_, mode, theta_interpol,
+      epsilon, maxskip);
+  else
+    MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
+  if (epsilon>0.)
+    return py::make_tuple(res, maxskip);
+  return res;
   }
 py::array Py_synthesis_deriv1(const py::array &alm, const py::array &theta,
   size_t lmax, const py::object &mstart,
@@ -496,7 +643,7 @@ py::array Py_synthesis_deriv1(const py::array &alm, const py::array &theta,
   size_t nthreads, py::object &map, const py::object &mmax_, bool theta_interpol=false)
   {
   return Py_synthesis(alm, theta, lmax, mstart, nphi, phi0, ringstart, 1, lstride,
-    pixstride, nthreads, map, mmax_, "DERIV1", theta_interpol);
+    pixstride, nthreads, map, mmax_, "DERIV1", theta_interpol).cast<py::array>();
   }
 
 
@@ -608,7 +755,8 @@ template<typename T> py::array Py2_adjoint_synthesis(py::object &alm__,
   size_t lmax, const py::object &mstart_, ptrdiff_t lstride,
   const py::array &map_, const py::array &theta_, const py::array &phi0_,
   const py::array &nphi_, const py::array &ringstart_, size_t spin,
-  ptrdiff_t pixstride, size_t nthreads, const py::object &mmax_, const string &mode_, bool theta_interpol=false)
+  ptrdiff_t pixstride, size_t nthreads, const py::object &mmax_, const string &mode_,
+  bool theta_interpol, double epsilon, double &maxskip)
   {
   auto mode = get_mode(mode_);
   auto mstart = get_mstart(lmax, mmax_, mstart_);
@@ -621,7 +769,7 @@ template<typename T> py::array Py2_adjoint_synthesis(py::object &alm__,
   vector<size_t> almshp(map_.ndim());
   for(size_t i=0; i<almshp.size(); ++i) almshp[i] = map_.shape()[i];
   almshp[almshp.size()-1] = min_almdim(lmax, mstart, lstride);
-  almshp[almshp.size()-2] = get_nalm(spin, mode);
+  almshp[almshp.size()-2] = (mode==STANDARD) ? map.shape(1) : map.shape(1)/2;
   auto alm_ = get_optional_Pyarr_minshape<complex<T>>(alm__, almshp);
   auto alm = to_vmav_with_optional_leading_dimensions<complex<T>,3>(alm_);
   MR_assert(map.shape(0)==alm.shape(0), "bad number of components in alm array");
@@ -629,20 +777,33 @@ template<typename T> py::array Py2_adjoint_synthesis(py::object &alm__,
   size_t nthreads_outer=1;
   if (map.shape(0)>nthreads)  // parallelize over entire transforms
     { nthreads_outer=nthreads; nthreads=1; }
+  if ((map.shape(0)>1) && (nthreads_outer==1)
+    && leading_dims_mergeable(alm) && leading_dims_mergeable(map))
+    {  // single call, sharing the Legendre functions between all transforms
+    py::gil_scoped_release release;
+    maxskip = adjoint_synthesis(merge_leading_dims(alm),
+      merge_leading_dims(map), spin, lmax, mstart, lstride, theta, nphi, phi0,
+      ringstart, pixstride, nthreads, mode, theta_interpol, epsilon);
+    return alm_;
+    }
   {
   py::gil_scoped_release release;
+  vector<double> skip(map.shape(0), 0.);
   execDynamic(map.shape(0), nthreads_outer, 1, [&](Scheduler &sched)
     {
     while (auto rng=sched.getNext())
       for(auto itrans=rng.lo; itrans<rng.hi; ++itrans)
-        adjoint_synthesis(subarray<2>(alm, {{itrans},{},{}}),
+        skip[itrans] = adjoint_synthesis(subarray<2>(alm, {{itrans},{},{}}),
           subarray<2>(map, {{itrans},{},{}}), spin, lmax, mstart, lstride, theta,
-          nphi, phi0, ringstart, pixstride, nthreads, mode, theta_interpol);
+          nphi, phi0, ringstart, pixstride, nthreads, mode, theta_interpol,
+          epsilon);
     });
+  maxskip = 0.;
+  for (auto v: skip) maxskip = max(maxskip, v);
   }
   return alm_;
   }
-py::array Py_adjoint_synthesis(const py::array &map, const py::array &theta,
+py::object Py_adjoint_synthesis(const py::array &map, const py::array &theta,
   size_t lmax,
   const py::object &mstart,
   const py::array &nphi,
@@ -650,22 +811,133 @@ py::array Py_adjoint_synthesis(const py::array &map, const py::array &theta,
   ptrdiff_t lstride, ptrdiff_t pixstride,
   size_t nthreads,
   py::object &alm, const py::object &mmax_,
-  const string &mode, bool theta_interpol=false)
+  const string &mode, bool theta_interpol=false, double epsilon=0.)
   {
+  MR_assert(epsilon>=0., "epsilon must not be negative");
+  double maxskip=0.;
+  py::array res;
   if (isPyarr<float>(map))
-    return Py2_adjoint_synthesis<float>(alm, lmax, mstart, lstride, map, theta,
-      phi0, nphi, ringstart, spin, pixstride, nthreads, mmax_, mode, theta_interpol);
+    res = Py2_adjoint_synthesis<float>(alm, lmax, mstart, lstride, map, theta,
+      phi0, nphi, ringstart, spin, pixstride, nthreads, mmax_, mode,
+      theta_interpol, epsilon, maxskip);
   else if (isPyarr<double>(map))
-    return Py2_adjoint_synthesis<double>(alm, lmax, mstart, lstride, map, theta,
-      phi0, nphi, ringstart, spin, pixstride, nthreads, mmax_, mode, theta_interpol);
+    res = Py2_adjoint_synthesis<double>(alm, lmax, mstart, lstride, map, theta,
+      phi0, nphi, ringstart, spin, pixstride, nthreads, mmax_, mode,
+      theta_interpol, epsilon, maxskip);
+  else
+    MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
+  if (epsilon>0.)
+    return py::make_tuple(res, maxskip);
+  return res;
+  }
+// accepts the int64 range arrays returned by e.g. Healpix_Base.query_disc()
+// as well as uint64 arrays
+cmav<size_t,2> get_pixranges(const py::array &pixranges_)
+  {
+  if (isPyarr<size_t>(pixranges_))
+    return to_cmav<size_t,2>(pixranges_);
+  auto tmp = to_cmav<int64_t,2>(pixranges_);
+  vmav<size_t,2> res({tmp.shape(0), tmp.shape(1)}, UNINITIALIZED);
+  for (size_t i=0; i<tmp.shape(0); ++i)
+    for (size_t j=0; j<tmp.shape(1); ++j)
+      {
+      MR_assert(tmp(i,j)>=0, "negative pixel index");
+      res(i,j) = size_t(tmp(i,j));
+      }
+  return res;
+  }
+
+template<typename T> py::array Py2_synthesis_partial(const py::array &alm_,
+  py::object &map__, size_t spin, size_t lmax,
+  const py::object &mstart_, ptrdiff_t lstride, const py::array &theta_,
+  const py::array &nphi_, const py::array &phi0_, const py::array &ringstart_,
+  ptrdiff_t pixstride, const py::array &pixranges_, size_t nthreads,
+  const py::object &mmax_, const string &mode_)
+  {
+  auto mode = get_mode(mode_);
+  auto mstart = get_mstart(lmax, mmax_, mstart_);
+  auto theta = to_cmav<double,1>(theta_);
+  auto phi0 = to_cmav<double,1>(phi0_);
+  auto nphi = to_cmav<size_t,1>(nphi_);
+  auto ringstart = to_cmav<size_t,1>(ringstart_);
+  auto pixranges = get_pixranges(pixranges_);
+  auto alm = to_cmav<complex<T>,2>(alm_);
+  vector<size_t> mapshp{(mode==STANDARD) ? alm.shape(0) : 2*alm.shape(0),
+                        min_mapdim(nphi, ringstart, pixstride)};
+  // unselected pixels are not written, so a new map must be zeroed
+  auto map_ = map__.is_none() ? make_Pyarr<T>(mapshp, true)
+                              : get_optional_Pyarr_minshape<T>(map__, mapshp);
+  auto map = to_vmav<T,2>(map_);
+  {
+  py::gil_scoped_release release;
+  synthesis_partial(alm, map, spin, lmax, mstart, lstride, theta, nphi, phi0,
+    ringstart, pixstride, pixranges, nthreads, mode);
+  }
+  return map_;
+  }
+py::array Py_synthesis_partial(const py::array &alm, const py::array &theta,
+  size_t lmax, const py::object &mstart, const py::array &nphi,
+  const py::array &phi0, const py::array &ringstart,
+  const py::array &pixranges, size_t spin, ptrdiff_t lstride,
+  ptrdiff_t pixstride, size_t nthreads, py::object &map,
+  const py::object &mmax_, const string &mode)
+  {
+  if (isPyarr<complex<float>>(alm))
+    return Py2_synthesis_partial<float>(alm, map, spin, lmax, mstart, lstride,
+      theta, nphi, phi0, ringstart, pixstride, pixranges, nthreads, mmax_, mode);
+  else if (isPyarr<complex<double>>(alm))
+    return Py2_synthesis_partial<double>(alm, map, spin, lmax, mstart, lstride,
+      theta, nphi, phi0, ringstart, pixstride, pixranges, nthreads, mmax_, mode);
   MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
   }
+template<typename T> py::array Py2_adjoint_synthesis_partial(py::object &alm__,
+  size_t lmax, const py::object &mstart_, ptrdiff_t lstride,
+  const py::array &map_, const py::array &theta_, const py::array &phi0_,
+  const py::array &nphi_, const py::array &ringstart_, size_t spin,
+  ptrdiff_t pixstride, const py::array &pixranges_, size_t nthreads,
+  const py::object &mmax_, const string &mode_)
+  {
+  auto mode = get_mode(mode_);
+  auto mstart = get_mstart(lmax, mmax_, mstart_);
+  auto theta = to_cmav<double,1>(theta_);
+  auto phi0 = to_cmav<double,1>(phi0_);
+  auto nphi = to_cmav<size_t,1>(nphi_);
+  auto ringstart = to_cmav<size_t,1>(ringstart_);
+  auto pixranges = get_pixranges(pixranges_);
+  auto map = to_cmav<T,2>(map_);
+  vector<size_t> almshp{(mode==STANDARD) ? map.shape(0) : map.shape(0)/2,
+                        min_almdim(lmax, mstart, lstride)};
+  auto alm_ = get_optional_Pyarr_minshape<complex<T>>(alm__, almshp);
+  auto alm = to_vmav<complex<T>,2>(alm_);
+  {
+  py::gil_scoped_release release;
+  adjoint_synthesis_partial(alm, map, spin, lmax, mstart, lstride, theta, nphi,
+    phi0, ringstart, pixstride, pixranges, nthreads, mode);
+  }
+  return alm_;
+  }
+py::array Py_adjoint_synthesis_partial(const py::array &map,
+  const py::array &theta, size_t lmax, const py::object &mstart,
+  const py::array &nphi, const py::array &phi0, const py::array &ringstart,
+  const py::array &pixranges, size_t spin, ptrdiff_t lstride,
+  ptrdiff_t pixstride, size_t nthreads, py::object &alm,
+  const py::object &mmax_, const string &mode)
+  {
+  if (isPyarr<float>(map))
+    return Py2_adjoint_synthesis_partial<float>(alm, lmax, mstart, lstride, map,
+      theta, phi0, nphi, ringstart, spin, pixstride, pixranges, nthreads, mmax_, mode);
+  else if (isPyarr<double>(map))
+    return Py2_adjoint_synthesis_partial<double>(alm, lmax, mstart, lstride, map,
+      theta, phi0, nphi, ringstart, spin, pixstride, pixranges, nthreads, mmax_, mode);
+  MR_fail("type matching failed: 'map' has neither type 'f4' nor 'f8'");
+  }
 template<typename T> py::object Py2_pseudo_analysis(py::object &alm__,
   size_t lmax, const py::object &mstart_, ptrdiff_t lstride,
   const py::array &map_, const py::array &theta_, const py::array &phi0_,
   const py::array &nphi_, const py::array &ringstart_, size_t spin,
   ptrdiff_t pixstride, size_t nthreads, size_t maxiter, double epsilon,
-  const py::object &mmax_, bool theta_interpol=false)
+  const py::object &mmax_, bool theta_interpol, bool precondition,
+  const py::object &alm0_)
   {
   auto mstart = get_mstart(lmax, mmax_, mstart_);
   auto theta = to_cmav<double,1>(theta_);
@@ -681,6 +953,17 @@ template<typename T> py::object Py2_pseudo_analysis(py::object &alm__,
   auto alm = to_vmav_with_optional_leading_dimensions<complex<T>,3>(alm_);
   MR_assert(map.shape(0)==alm.shape(0), "bad number of components in alm array");
   MR_assert(map.shape(1)==alm.shape(1), "bad number of components in alm array");
+  bool warm_start = !alm0_.is_none();
+  if (warm_start)
+    {
+    auto alm0 = to_cmav_with_optional_leading_dimensions<complex<T>,3>(alm0_);
+    MR_assert((alm0.shape(0)==alm.shape(0)) && (alm0.shape(1)==alm.shape(1))
+      && (alm0.shape(2)>=min_almdim(lmax, mstart, lstride)),
+      "bad shape of alm0 array");
+    auto n = min(alm.shape(2), alm0.shape(2));
+    mav_apply([](complex<T> &v1, const complex<T> &v2) { v1=v2; }, 1,
+      subarray<3>(alm, {{},{},{0,n}}), subarray<3>(alm0, {{},{},{0,n}}));
+    }
   nthreads = adjust_nthreads(nthreads);
   size_t nthreads_outer=1;
   if (map.shape(0)>nthreads)  // parallelize over entire transforms
@@ -697,7 +980,7 @@ template<typename T> py::object Py2_pseudo_analysis(py::object &alm__,
         auto [xistop, xitn, xrnorm, xsqnorm] = pseudo_analysis(
           subarray<2>(alm, {{itrans},{},{}}), subarray<2>(map, {{itrans},{},{}}),
           spin, lmax, mstart, lstride, theta, nphi, phi0, ringstart, pixstride,
-          nthreads, maxiter, epsilon, theta_interpol);
+          nthreads, maxiter, epsilon, theta_interpol, precondition, warm_start);
         itn[itrans] = xitn;
         istop[itrans] = xistop;
         rnorm[itrans] = xrnorm;
@@ -731,14 +1014,16 @@ py::object Py_pseudo_analysis(const py::array &map, const py::array &theta,
   ptrdiff_t lstride, ptrdiff_t pixstride,
   size_t nthreads,
   py::object &alm, size_t maxiter, double epsilon, const py::object &mmax_,
-  bool theta_interpol=false)
+  bool theta_interpol, bool precondition, const py::object &alm0)
   {
   if (isPyarr<float>(map))
     return Py2_pseudo_analysis<float>(alm, lmax, mstart, lstride, map, theta,
-      phi0, nphi, ringstart, spin, pixstride, nthreads, maxiter, epsilon, mmax_, theta_interpol);
+      phi0, nphi, ringstart, spin, pixstride, nthreads, maxiter, epsilon, mmax_,
+      theta_interpol, precondition, alm0);
   else if (isPyarr<double>(map))
     return Py2_pseudo_analysis<double>(alm, lmax, mstart, lstride, map, theta,
-      phi0, nphi, ringstart, spin, pixstride, nthreads, maxiter, epsilon, mmax_, theta_interpol);
+      phi0, nphi, ringstart, spin, pixstride, nthreads, maxiter, epsilon, mmax_,
+      theta_interpol, precondition, alm0);
   MR_fail("type matching failed: 'alm' has neither type 'c8' nor 'c16'");
   }
 
@@ -1207,6 +1492,78 @@ Returns
 numpy.ndarray(same shape and dtype as alm)
 )""";
 
+constexpr const char *alm2cl_DS = R"""(
+Computes the auto- and cross-power spectra of one or several sets of
+spherical harmonic coefficients:
+cl[i, j, l] = 1/(2l+1) * sum_{m=-l}^{l} Re(alm[i, l, m] * conj(alm[j, l, m]))
+
+Parameters
+----------
+alm: numpy.ndarray(([nsets,] nalm), dtype=numpy.complex64 or numpy.complex128)
+    the spherical harmonic coefficients, stored in the standard triangular
+    order (0,0), (1,0), ... (lmax,0), (1,1), ..., (lmax, mmax)
+lmax: int >= 0
+    the maximum l moment of `alm` (inclusive)
+mmax: None or int >= 0 <= lmax
+    the maximum m moment of `alm` (inclusive). If None, `lmax` is assumed.
+nthreads: int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+cl: None or numpy.ndarray(([nsets, nsets,] lmax+1), dtype=numpy.float64)
+    the array for the result. If `None`, a new suitable array is allocated.
+
+Returns
+-------
+numpy.ndarray(([nsets, nsets,] lmax+1), dtype=numpy.float64)
+    the spectra. If `alm` is one-dimensional, this is one-dimensional as well.
+    If `cl` was supplied, this will be the same object.
+)""";
+
+constexpr const char *AlmRotator_DS = R"""(
+Class for rotating many sets of spherical harmonic coefficients, possibly by
+different Euler angles, with the same conventions as `rotate_alm`.
+
+The matrices describing the exchange of the y and z axes for every l are
+computed once and kept if they fit into `max_bytes`; they are applied to all
+a_lm sets of a call simultaneously. For single sets of a_lm, `rotate_alm` is
+usually faster.
+)""";
+
+constexpr const char *AlmRotator_init_DS = R"""(
+Constructor
+
+Parameters
+----------
+lmax : int >= 0
+    Maximum multipole order l of the a_lm sets to be rotated.
+nthreads: int >= 0
+    the number of threads to use for setting up the rotation matrices
+    if 0, use as many threads as there are hardware threads available on the system
+max_bytes : int
+    the rotation matrices are only stored if they need at most this many bytes.
+    Otherwise they are recomputed during every call to `rotate`.
+)""";
+
+constexpr const char *AlmRotator_rotate_DS = R"""(
+Rotates one or several sets of spherical harmonic coefficients.
+
+Parameters
+----------
+alm: numpy.ndarray(([nsets,] (lmax+1)*(lmax+2)/2), dtype=numpy complex64 or numpy.complex128)
+    the spherical harmonic coefficients, in the order
+    (0,0), (1,0), (2,0), ... (lmax,0), (1,1), (2,1), ..., (lmax, lmax)
+angles: numpy.ndarray(([nsets,] 3), dtype=numpy.float64)
+    the Euler angles (psi, theta, phi) in radians, either one triple for all
+    sets or one triple per set. See `rotate_alm` for the conventions.
+nthreads: int >= 0
+    the number of threads to use for the computation
+    if 0, use as many threads as there are hardware threads available on the system
+
+Returns
+-------
+numpy.ndarray(same shape and dtype as alm)
+)""";
+
 constexpr const char *alm2leg_DS = R"""(
 Transforms a set of spherical harmonic coefficients to Legendre coefficients
 dependent on theta and m.
@@ -1255,8 +1612,11 @@ numpy.ndarray((nleg, ntheta, nm), same dtype as `alm`)
 
 Notes
 -----
-nleg = 1 if spin == 0 else 2
-nalm = 1 if spin == 0 else (2 if mode == "STANDARD" else 1)
+Several sets of spherical harmonic coefficients with the same spin can be
+transformed in a single call; the Legendre functions are then computed only
+once for all of them.
+nleg = nset if spin == 0 else 2*nset
+nalm = nset if spin == 0 else (2*nset if mode == "STANDARD" else nset)
 )""";
 
 constexpr const char *alm2leg_deriv1_DS = R"""(
@@ -1339,6 +1699,10 @@ mode: str
 theta_interpol: bool
     if the input grid is irregularly spaced in theta, try to accelerate the
     transform by using an intermediate equidistant theta grid and a 1D NUFFT.
+cl: None or numpy.ndarray((nalm, nalm, lmax+1), dtype=numpy.float64)
+    if supplied, the auto- and cross-spectra of the computed a_lm (as
+    defined in `alm2cl`) are stored here. They are accumulated while the
+    a_lm are produced, which avoids a second pass over the a_lm.
 
 Returns
 -------
@@ -1349,8 +1713,11 @@ numpy.ndarray((nalm, *), same dtype as `leg`)
 
 Notes
 -----
-nleg = 1 if spin == 0 else 2
-nalm = 1 if spin == 0 else (2 if mode == "STANDARD" else 1)
+Several sets of spherical harmonic coefficients with the same spin can be
+transformed in a single call; the Legendre functions are then computed only
+once for all of them.
+nleg = nset if spin == 0 else 2*nset
+nalm = nset if spin == 0 else (2*nset if mode == "STANDARD" else nset)
 )""";
 
 constexpr const char *map2leg_DS = R"""(
@@ -1809,6 +2176,15 @@ mode: str
 theta_interpol: bool
     if the input grid is irregularly spaced in theta, try to accelerate the
     transform by using an intermediate equidistant theta grid and a 1D NUFFT.
+epsilon: float >= 0
+    if > 0, Legendre function values whose magnitude relative to
+    sqrt((2l+1)/(4pi)) lies below `epsilon` are neglected, which allows
+    skipping larger parts of the polar regions. If 0, full accuracy is used.
+    For random `alm`, the resulting relative L2 error of the map is about
+    0.1 to 0.3 times `epsilon`.
+    For single-precision input with lmax<=1024, an `epsilon` of at least
+    8e-7*(lmax+1) additionally allows most of the Legendre recurrence to be
+    evaluated in single precision, which is faster.
 
 Returns
 -------
@@ -1816,11 +2192,71 @@ numpy.ndarray(([ntrans,] nmaps, x), dtype=numpy.float of same accuracy as `alm`)
     the map pixel data.
     If `map` was supplied, this will be the same object
     If newly allocated, the smallest possible last dimension will be chosen.
+    If `epsilon` > 0, a tuple (map, skip) is returned instead, where `skip`
+    (<= `epsilon`) is the largest relative Legendre function value that was
+    neglected.
 
 Notes
 -----
-nmaps = 1 if spin == 0 else 2
-nalm = 1 if spin == 0 else (2 if mode == "STANDARD" else 1)
+nmaps = nset if spin == 0 else 2*nset
+nalm = nset if spin == 0 else (2*nset if mode == "STANDARD" else nset)
+where nset is the number of coefficient sets with the same spin in every
+transform (usually 1). The Legendre functions are computed only once for all
+sets and, if possible, for all `ntrans` transforms.
+)""";
+
+constexpr const char *synthesis_partial_DS = R"""(
+Like `synthesis`, but only computes the map pixels in the given index ranges.
+
+Only rings containing selected pixels are processed, and on rings with few
+selected pixels these are obtained by direct summation instead of an FFT, so
+that the cost scales with the covered area of the sphere.
+
+Parameters
+----------
+alm: numpy.ndarray((nalm, x), dtype=numpy.complex64 or numpy.complex128)
+    the set of spherical harmonic coefficients.
+map: None or numpy.ndarray((nmaps, x), dtype=numpy.float of same accuracy as `alm`
+    the map pixel data. Pixels outside `pixranges` are not modified.
+    If `None`, a new suitable (zero-initialized) array is allocated.
+pixranges: numpy.ndarray((nranges, 2), dtype=numpy.int64 or numpy.uint64)
+    the selected pixel indices (in the last dimension of `map`) are
+    [pixranges[0,0] .. pixranges[0,1]), [pixranges[1,0] .. pixranges[1,1]) etc.
+    This is the format returned by `ducc0.healpix.Healpix_Base.query_disc`
+    and similar functions, if the map is in RING ordering.
+
+All other parameters are as for `synthesis`; `pixstride` must be positive.
+
+Returns
+-------
+numpy.ndarray((nmaps, x), dtype=numpy.float of same accuracy as `alm`)
+    the map pixel data.
+    If `map` was supplied, this will be the same object
+)""";
+
+constexpr const char *adjoint_synthesis_partial_DS = R"""(
+Like `adjoint_synthesis`, but only uses the map pixels in the given index
+ranges; all other pixels are treated as zero.
+This is the adjoint operation of `synthesis_partial`.
+
+Parameters
+----------
+map: numpy.ndarray((nmaps, x), dtype=numpy.float32 or numpy.float64)
+    the map pixel data.
+alm: None or numpy.ndarray((nalm, x), dtype=numpy.complex of same precision as `map`)
+    the set of spherical harmonic coefficients.
+    If `None`, a new suitable array is allocated.
+pixranges: numpy.ndarray((nranges, 2), dtype=numpy.int64 or numpy.uint64)
+    the selected pixel index ranges (see `synthesis_partial`)
+
+All other parameters are as for `adjoint_synthesis`; `pixstride` must be
+positive.
+
+Returns
+-------
+numpy.ndarray((nalm, x), dtype=numpy.complex of same accuracy as `map`)
+    the computed spherical harmonic coefficients
+    If `alm` was supplied, this will be the same object.
 )""";
 
 constexpr const char *adjoint_synthesis_DS = R"""(
@@ -1874,6 +2310,10 @@ mode: str
 theta_interpol: bool
     if the input grid is irregularly spaced in theta, try to accelerate the
     transform by using an intermediate equidistant theta grid and a 1D NUFFT.
+epsilon: float >= 0
+    if > 0, Legendre function values whose magnitude relative to
+    sqrt((2l+1)/(4pi)) lies below `epsilon` are neglected, which allows
+    skipping larger parts of the polar regions. If 0, full accuracy is used.
 
 Returns
 -------
@@ -1881,11 +2321,17 @@ numpy.ndarray(([ntrans,] nalm, x), dtype=numpy.complex of same accuracy as `map`
     the set(s) of spherical harmonic coefficients.
     If `alm` was supplied, this will be the same object
     If newly allocated, the smallest possible last dimension will be chosen.
+    If `epsilon` > 0, a tuple (alm, skip) is returned instead, where `skip`
+    (<= `epsilon`) is the largest relative Legendre function value that was
+    neglected.
 
 Notes
 -----
-nmaps = 1 if spin == 0 else 2
-nalm = 1 if spin == 0 else (2 if mode == "STANDARD" else 1)
+nmaps = nset if spin == 0 else 2*nset
+nalm = nset if spin == 0 else (2*nset if mode == "STANDARD" else nset)
+where nset is the number of coefficient sets with the same spin in every
+transform (usually 1). The Legendre functions are computed only once for all
+sets and, if possible, for all `ntrans` transforms.
 )""";
 
 constexpr const char *pseudo_analysis_DS = R"""(
@@ -1938,6 +2384,18 @@ mmax: int >= 0 <= lmax
 theta_interpol: bool
     if the input grid is irregularly spaced in theta, try to accelerate the
     transform by using an intermediate equidistant theta grid and a 1D NUFFT.
+precondition: bool
+    if True, the residual of every pixel is weighted with the square root of
+    its approximate area, as derived from the ring spacing. This typically
+    reduces the number of iterations drastically for grids with non-uniform
+    pixel sizes (e.g. equiangular grids). For (nearly) band-limited maps the
+    result is the same; otherwise it is the least-squares solution with
+    respect to the L2 norm on the sphere. The returned residual is then also
+    the weighted one.
+alm0: None or numpy.ndarray(same shape as `alm`, same dtype as `alm`)
+    if supplied, the iteration starts from these a_lm instead of from zero,
+    which is much faster if a good approximation (e.g. the solution for a
+    slightly different map) is known.
 
 Returns
 -------
@@ -2273,19 +2731,61 @@ lmax : int>=0
     The maximum l moment that can be safely stored on the specified grid.
 )""";
 
+constexpr const char *set_table_cache_limit_DS = R"""(
+Configures the cache of Legendre recurrence tables and ring data.
+
+The recurrence coefficients for every (lmax, mmax, spin) combination and the
+ring data for every (lmax, spin, theta) combination used by `synthesis`,
+`adjoint_synthesis`, `alm2leg`, `leg2alm` and their relatives are cached
+across calls, so that repeated transforms do not need to recompute them.
+
+Parameters
+----------
+max_bytes : int
+    Maximum estimated memory of all cached objects (default: 256 MiB).
+    Objects exceeding this limit on their own are not cached at all;
+    0 disables the cache.
+)""";
+
+constexpr const char *table_cache_info_DS = R"""(
+Returns statistics of the cache of Legendre recurrence tables and ring data.
+
+Returns
+-------
+dict
+    "hits": number of lookups answered from the cache;
+    "misses": number of lookups which required computing new data;
+    "evictions": number of objects removed to stay within the cache limit;
+    "entries": number of objects currently held by the cache;
+    "bytes": estimated memory held by these objects.
+)""";
+
+constexpr const char *clear_table_cache_DS = R"""(
+Removes all entries from the cache of Legendre recurrence tables and ring data.
+
+The statistics reported by `table_cache_info` are not reset.
+)""";
+
 void add_pythonfuncs(py::module_ &m)
   {
   using namespace pybind11::literals;
 
   m.def("synthesis", &Py_synthesis, synthesis_DS, py::kw_only(), "alm"_a, "theta"_a,
     "lmax"_a, "mstart"_a=None, "nphi"_a, "phi0"_a, "ringstart"_a, "spin"_a,
-    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "map"_a=None, "mmax"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false);
+    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "map"_a=None, "mmax"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false, "epsilon"_a=0.);
   m.def("adjoint_synthesis", &Py_adjoint_synthesis, adjoint_synthesis_DS, py::kw_only(), "map"_a, "theta"_a,
     "lmax"_a, "mstart"_a=None, "nphi"_a, "phi0"_a, "ringstart"_a, "spin"_a,
-    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "alm"_a=None, "mmax"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false);
+    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "alm"_a=None, "mmax"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false, "epsilon"_a=0.);
+  m.def("synthesis_partial", &Py_synthesis_partial, synthesis_partial_DS, py::kw_only(), "alm"_a, "theta"_a,
+    "lmax"_a, "mstart"_a=None, "nphi"_a, "phi0"_a, "ringstart"_a, "pixranges"_a, "spin"_a,
+    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "map"_a=None, "mmax"_a=None, "mode"_a="STANDARD");
+  m.def("adjoint_synthesis_partial", &Py_adjoint_synthesis_partial, adjoint_synthesis_partial_DS, py::kw_only(), "map"_a, "theta"_a,
+    "lmax"_a, "mstart"_a=None, "nphi"_a, "phi0"_a, "ringstart"_a, "pixranges"_a, "spin"_a,
+    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "alm"_a=None, "mmax"_a=None, "mode"_a="STANDARD");
   m.def("pseudo_analysis", &Py_pseudo_analysis, pseudo_analysis_DS, py::kw_only(), "map"_a, "theta"_a,
     "lmax"_a, "mstart"_a=None, "nphi"_a, "phi0"_a, "ringstart"_a, "spin"_a,
-    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "alm"_a=None, "maxiter"_a, "epsilon"_a, "mmax"_a=None,"theta_interpol"_a=false);
+    "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "alm"_a=None, "maxiter"_a, "epsilon"_a, "mmax"_a=None,"theta_interpol"_a=false,
+    "precondition"_a=false, "alm0"_a=None);
   m.def("synthesis_deriv1", &Py_synthesis_deriv1, synthesis_deriv1_DS, py::kw_only(), "alm"_a, "theta"_a,
     "lmax"_a, "mstart"_a=None, "nphi"_a, "phi0"_a, "ringstart"_a,
     "lstride"_a=1, "pixstride"_a=1, "nthreads"_a=1, "map"_a=None, "mmax"_a=None,"theta_interpol"_a=false);
@@ -2304,9 +2804,13 @@ void add_pythonfuncs(py::module_ &m)
 
   m.def("maximum_safe_l", &maximum_safe_l, maximum_safe_l_DS, "geometry"_a, "ntheta"_a);
 
+  m.def("set_table_cache_limit", &set_sht_table_cache_limit, set_table_cache_limit_DS, "max_bytes"_a=size_t(256)<<20);
+  m.def("table_cache_info", &Py_table_cache_info, table_cache_info_DS);
+  m.def("clear_table_cache", &clear_sht_table_cache, clear_table_cache_DS);
+
   m.def("alm2leg", &Py_alm2leg, alm2leg_DS, py::kw_only(), "alm"_a, "lmax"_a, "theta"_a, "spin"_a=0, "mval"_a=None, "mstart"_a=None, "lstride"_a=1, "nthreads"_a=1, "leg"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false);
   m.def("alm2leg_deriv1", &Py_alm2leg_deriv1, alm2leg_deriv1_DS, py::kw_only(), "alm"_a, "lmax"_a, "theta"_a, "mval"_a=None, "mstart"_a=None, "lstride"_a=1, "nthreads"_a=1, "leg"_a=None,"theta_interpol"_a=false);
-  m.def("leg2alm", &Py_leg2alm, leg2alm_DS, py::kw_only(), "leg"_a, "lmax"_a, "theta"_a, "spin"_a=0, "mval"_a=None, "mstart"_a=None, "lstride"_a=1, "nthreads"_a=1, "alm"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false);
+  m.def("leg2alm", &Py_leg2alm, leg2alm_DS, py::kw_only(), "leg"_a, "lmax"_a, "theta"_a, "spin"_a=0, "mval"_a=None, "mstart"_a=None, "lstride"_a=1, "nthreads"_a=1, "alm"_a=None, "mode"_a="STANDARD","theta_interpol"_a=false, "cl"_a=None);
   m.def("map2leg", &Py_map2leg, map2leg_DS, py::kw_only(), "map"_a, "nphi"_a, "phi0"_a, "ringstart"_a, "mmax"_a, "pixstride"_a=1, "nthreads"_a=1, "leg"_a=None);
   m.def("leg2map", &Py_leg2map, leg2map_DS, py::kw_only(), "leg"_a, "nphi"_a, "phi0"_a, "ringstart"_a, "pixstride"_a=1, "nthreads"_a=1, "map"_a=None);
   }
@@ -2324,6 +2828,16 @@ void add_sht(py::module_ &msup)
 
   m.def("rotate_alm", &Py_rotate_alm, rotate_alm_DS, "alm"_a, "lmax"_a, "psi"_a, "theta"_a,
     "phi"_a, "nthreads"_a=1);
+  m.def("alm2cl", &Py_alm2cl, alm2cl_DS, py::kw_only(), "alm"_a, "lmax"_a,
+    "mmax"_a=None, "nthreads"_a=1, "cl"_a=None);
+
+  py::class_<Py_AlmRotator> (m, "AlmRotator", py::module_local(), AlmRotator_DS)
+    .def(py::init<size_t, size_t, size_t>(), AlmRotator_init_DS, "lmax"_a,
+      "nthreads"_a=1, "max_bytes"_a=size_t(1)<<30)
+    .def("rotate", &Py_AlmRotator::rotate, AlmRotator_rotate_DS, "alm"_a,
+      "angles"_a, "nthreads"_a=1)
+    .def("lmax", &Py_AlmRotator::lmax)
+    .def("cached", &Py_AlmRotator::cached);
 
   py::class_<Py_sharpjob<double>> (m, "sharpjob_d", py::module_local(),sharpjob_d_DS)
     .def(py::init<>())
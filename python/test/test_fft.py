@@ -400,3 +400,195 @@ def test_multi_iter_bug():
     a=np.zeros((128000,),dtype=np.complex128)
     # this used to raise an exception
     fft.c2c(a[::2],axes=(0,),nthreads=8)
+
+
+@pmp("dtype", [np.float32, np.float64])
+def test_wisdom(tmp_path, dtype):
+    rng = np.random.default_rng(42)
+    lengths = (64, 1000, 2310, 4096)
+    ref = [rng.random(n).astype(dtype) for n in lengths]
+    res1 = [fft.r2c(a) for a in ref] + [fft.c2c(a+0j) for a in ref]
+    for n in lengths:
+        fft.tune(n, dtype)
+    fname = str(tmp_path / "wisdom.txt")
+    fft.save_wisdom(fname)
+    fft.forget_wisdom()
+    fft.load_wisdom(fname)
+    res2 = [fft.r2c(a) for a in ref] + [fft.c2c(a+0j) for a in ref]
+    fft.forget_wisdom()
+    eps = 1e-5 if dtype == np.float32 else 1e-14
+    for a, b in zip(res1, res2):
+        _assert_close(a, b, eps)
+
+
+@pmp("strategy", ("radix4", "radix16", "narrowvec", "widevec"))
+@pmp("n", (16, 48, 4096, 12288))
+@pmp("dtype", [np.float32, np.float64])
+def test_wisdom_strategy(tmp_path, strategy, n, dtype):
+    # strategies which are never chosen by default can be forced via wisdom
+    rng = np.random.default_rng(42)
+    a = (rng.random(n)-0.5 + 1j*(rng.random(n)-0.5)).astype(ctype[dtype])
+    ref = np.fft.fft(a.astype(np.complex128))
+    fname = tmp_path / "wisdom.txt"
+    prec = np.dtype(dtype).itemsize
+    fname.write_text("".join("c {} {} {} {}\n".format(prec, n, vec, strategy)
+                             for vec in (0, 1)))
+    fft.load_wisdom(str(fname))
+    eps = 1e-5 if dtype == np.float32 else 1e-14
+    _assert_close(fft.c2c(a), ref, eps)
+    _assert_close(fft.c2c(a[None, :].repeat(3, axis=0), axes=(1,)),
+                  ref[None, :].repeat(3, axis=0), eps)
+    fft.forget_wisdom()
+
+
+@pmp("n", (512, 1000, 4096, 12288, 65536))
+@pmp("dtype", [np.float32, np.float64])
+def test_vector_passes(n, dtype):
+    # long 1D transforms are computed with SIMD passes of varying width
+    rng = np.random.default_rng(42)
+    a = (rng.random(n)-0.5 + 1j*(rng.random(n)-0.5)).astype(ctype[dtype])
+    ref = np.fft.fft(a.astype(np.complex128))
+    eps = 1e-5 if dtype == np.float32 else 1e-14
+    _assert_close(fft.c2c(a), ref, eps)
+    _assert_close(fft.c2c(ref.astype(a.dtype), forward=False, inorm=2), a,
+                  eps)
+    fft.tune(n, dtype)
+    _assert_close(fft.c2c(a), ref, eps)
+    fft.forget_wisdom()
+
+
+def test_plan_cache():
+    rng = np.random.default_rng(42)
+    a = rng.random((8, 300)) + 1j*rng.random((8, 300))
+    try:
+        fft.set_plan_cache_limits(max_entries=4, thread_local_entries=2)
+        fft.clear_plan_cache()
+        ref = [fft.c2c(a[:, :n]) for n in range(200, 300)]
+        info = fft.plan_cache_info()
+        assert_(info["entries"] <= 4)
+        assert_(info["bytes"] > 0)
+        h0, m0 = info["hits"], info["misses"]
+        res = [fft.c2c(a[:, :10]) for _ in range(10)]
+        info = fft.plan_cache_info()
+        assert_(info["hits"] >= h0+18)
+        assert_(info["misses"] <= m0+2)
+        fft.set_plan_cache_limits(max_entries=2, max_bytes=1)
+        assert_(fft.plan_cache_info()["entries"] == 0)
+        for n, r in zip(range(200, 300), ref):
+            _assert_close(fft.c2c(a[:, :n]), r, 1e-14)
+    finally:
+        fft.set_plan_cache_limits()
+
+
+@pmp("shp", ([16], [33, 40], [8, 2, 30]))
+@pmp("nthreads", (1, 2))
+def test_plan(shp, nthreads):
+    rng = np.random.default_rng(42)
+    a = rng.random(shp)-0.5 + 1j*(rng.random(shp)-0.5)
+    ar = a.real.copy()
+    p = fft.Plan("c2c", a, nthreads=nthreads)
+    for _ in range(3):
+        _assert_close(p.execute(a, forward=False, inorm=2),
+                      ifftn(a, inorm=2), 1e-15)
+    b = a.copy()
+    p = fft.Plan("c2c", b, out=b, nthreads=nthreads)
+    p.execute(b, out=b)
+    _assert_close(b, fftn(a), 1e-15)
+    pr = fft.Plan("r2c", ar, nthreads=nthreads)
+    ac = pr.execute(ar)
+    _assert_close(ac, rfftn(ar), 1e-15)
+    pc = fft.Plan("c2r", ac, lastsize=shp[-1], nthreads=nthreads)
+    _assert_close(pc.execute(ac, forward=False, inorm=2), ar, 1e-15)
+    with pytest.raises(RuntimeError):
+        p.execute(a)
+    with pytest.raises(RuntimeError):
+        pr.execute(ar.astype(np.float32))
+
+
+@pmp("n", list(range(2, 17)) + [20, 24, 25, 27, 30, 32, 45, 48, 60, 64])
+@pmp("dtype", [np.complex64, np.complex128])
+def test_small_batch(n, dtype):
+    rng = np.random.default_rng(42)
+    a = (rng.random((5, 37, n))-0.5 + 1j*(rng.random((5, 37, n))-0.5))
+    a = a.astype(dtype)
+    eps = 2e-6 if dtype == np.complex64 else 1e-15
+    _assert_close(fft.c2c(a, axes=(2,)), np.fft.fft(a, axis=2), eps)
+    _assert_close(fft.c2c(a, axes=(1, 2), forward=False, inorm=2),
+                  np.fft.ifftn(a, axes=(1, 2)), eps)
+    # strided, non-contiguous batches
+    b = a[:, ::3, :].transpose((2, 0, 1))
+    _assert_close(fft.c2c(b, axes=(0,)), np.fft.fft(b, axis=0), eps)
+
+
+@pmp("shp", [(64, 48, 30), (200, 300), (60000,)])
+@pmp("memory_limit", [8000, 30000, 1 << 30])
+def test_out_of_core(tmp_path, shp, memory_limit):
+    rng = np.random.default_rng(42)
+    a = rng.random(shp)-0.5 + 1j*(rng.random(shp)-0.5)
+    ref = np.fft.fftn(a)
+    fa = np.memmap(tmp_path/"in.dat", dtype=a.dtype, mode="w+", shape=shp)
+    fa[()] = a
+    fo = np.memmap(tmp_path/"out.dat", dtype=a.dtype, mode="w+", shape=shp)
+    fft.c2c_out_of_core(fa, out=fo, memory_limit=memory_limit)
+    _assert_close(fo, ref, 2e-15)
+    if len(shp) > 1:
+        fft.c2c_out_of_core(fa, out=fa, axes=(0,), forward=False, inorm=2,
+                            memory_limit=memory_limit)
+        _assert_close(fa, np.fft.ifft(a, axis=0), 2e-15)
+
+
+@pmp("shp", [(17,), (8, 12), (5, 6, 7)])
+@pmp("dtype", ["float16", "bfloat16"])
+def test_16bit_storage(shp, dtype):
+    if dtype == "bfloat16":
+        dtype = pytest.importorskip("ml_dtypes").bfloat16
+    rng = np.random.default_rng(42)
+    a = (rng.random(shp)-0.5).astype(dtype)
+    a32 = a.astype(np.float32)
+    res = fft.r2c(a)
+    assert_(res.dtype == np.complex64)
+    assert_allclose(res, fft.r2c(a32), atol=0, rtol=0)
+    assert_allclose(fft.c2c(a), fft.c2c(a32), atol=0, rtol=0)
+    out = np.empty(shp, dtype=dtype)
+    fft.c2r(res, lastsize=shp[-1], forward=False, inorm=2, out=out)
+    ref = fft.c2r(res, lastsize=shp[-1], forward=False, inorm=2).astype(dtype)
+    assert_(np.array_equal(out, ref))
+
+
+@pmp("nkernel", [1, 7, 64])
+@pmp("dtype", [np.float64, np.complex128, np.float32])
+@pmp("correlate", [False, True])
+def test_convolver(nkernel, dtype, correlate):
+    rng = np.random.default_rng(42)
+    tol = 1e-5 if dtype == np.float32 else 1e-12
+
+    def rnd(shp):
+        res = rng.random(shp)-0.5
+        if np.issubdtype(dtype, np.complexfloating):
+            res = res + 1j*(rng.random(shp)-0.5)
+        return res.astype(dtype)
+
+    kernel = rnd(nkernel)
+    kref = np.conj(kernel[::-1]) if correlate else kernel
+    conv = fft.Convolver(kernel, correlate=correlate)
+    assert_(conv.fftlen >= nkernel)
+    a = rnd((3, 200))
+    full = np.array([np.convolve(x, kref) for x in a])
+    # "full", "same" and "valid" modes
+    for shift, nout in ((0, 200+nkernel-1), ((nkernel-1)//2, 200),
+                        (nkernel-1, 200-nkernel+1)):
+        out = np.empty((3, nout), dtype=dtype)
+        conv.apply(a, axis=1, shift=shift, out=out, nthreads=2)
+        _assert_close(out, full[:, shift:shift+nout], tol)
+    res = conv.apply(a.T.copy(), axis=0)
+    _assert_close(res, full[:, :200].T, tol)
+    # streaming in chunks of varying length
+    s = rnd(1000)
+    out = np.empty_like(s)
+    pos, chunk = 0, 1
+    while pos < s.size:
+        conv.process(s[pos:pos+chunk], out=out[pos:pos+chunk])
+        pos, chunk = pos+chunk, chunk*3+1
+    _assert_close(out, np.convolve(s, kref)[:1000], tol)
+    conv.reset()
+    _assert_close(conv.process(s[:100]), np.convolve(s, kref)[:100], tol)
@@ -17,7 +17,7 @@
 import ducc0
 import numpy as np
 import pytest
-from numpy.testing import assert_allclose
+from numpy.testing import assert_, assert_allclose
 
 pmp = pytest.mark.parametrize
 
@@ -208,6 +208,56 @@ def test_rotation(lmax, nthreads):
     assert_allclose(ducc0.misc.l2error(alm,alm2), 0, atol=1e-6)
 
 
+@pmp("lmax", (0, 1, 2, 7, 32))
+@pmp("nsets", (1, 3, 10))
+@pmp("max_bytes", (0, 1<<30))
+def test_rotator(lmax, nsets, max_bytes):
+    rng = np.random.default_rng(42)
+    angles = rng.uniform(-2*np.pi, 2*np.pi, (nsets, 3))
+    alm = random_alm(lmax, lmax, 0, nsets, rng)
+
+    rot = ducc0.sht.AlmRotator(lmax, nthreads=2, max_bytes=max_bytes)
+    res = rot.rotate(alm, angles, nthreads=2)
+    for i in range(nsets):
+        ref = ducc0.sht.rotate_alm(alm[i], lmax, *angles[i])
+        assert_allclose(ducc0.misc.l2error(res[i], ref), 0, atol=1e-13)
+    res = rot.rotate(alm.astype(np.complex64), angles[0])
+    for i in range(nsets):
+        ref = ducc0.sht.rotate_alm(alm[i], lmax, *angles[0])
+        assert_allclose(ducc0.misc.l2error(res[i], ref), 0, atol=1e-6)
+
+
+@pmp("lmmax", ((0, 0), (5, 3), (130, 130)))
+@pmp("nsets", (1, 3))
+@pmp("nthreads", (1, 2))
+def test_alm2cl(lmmax, nsets, nthreads):
+    lmax, mmax = lmmax
+    rng = np.random.default_rng(42)
+    alm = random_alm(lmax, mmax, 0, nsets, rng)
+    ref = np.zeros((nsets, nsets, lmax+1))
+    ofs = 0
+    for m in range(mmax+1):
+        a = alm[:, ofs:ofs+lmax+1-m]
+        ref[:, :, m:] += (1 if m == 0 else 2) * \
+            np.einsum("il,jl->ijl", a, a.conj()).real
+        ofs += lmax+1-m
+    ref /= 2*np.arange(lmax+1)+1
+    cl = ducc0.sht.alm2cl(alm=alm, lmax=lmax, mmax=mmax, nthreads=nthreads)
+    assert_allclose(cl, ref, rtol=1e-13, atol=1e-14)
+    cl = ducc0.sht.alm2cl(alm=alm[0], lmax=lmax, mmax=mmax)
+    assert_allclose(cl, ref[0, 0], rtol=1e-13, atol=1e-14)
+
+    # spectra accumulated during leg2alm
+    theta = ducc0.healpix.Healpix_Base(16, "RING").sht_info()["theta"]
+    leg = rng.uniform(-1, 1, (nsets, theta.shape[0], lmax+1)) \
+        + 1j*rng.uniform(-1, 1, (nsets, theta.shape[0], lmax+1))
+    cl = np.empty((nsets, nsets, lmax+1))
+    alm = ducc0.sht.leg2alm(leg=leg, lmax=lmax, theta=theta, nthreads=nthreads,
+                            cl=cl)
+    ref = ducc0.sht.alm2cl(alm=alm, lmax=lmax)
+    assert_allclose(cl, ref, rtol=1e-13, atol=1e-14)
+
+
 @pmp('spin', (0, 2))
 @pmp('nthreads', (1, 4))
 @pmp('nside', (32, 64))
@@ -231,6 +281,162 @@ def test_healpix_inverse(nside, spin, ntrans, nthreads):
     assert_allclose(ducc0.misc.l2error(alm0,alm1), 0, atol=1e-6)
 
 
+@pmp('spin', (0, 2))
+def test_pseudo_analysis_precond(spin):
+    rng = np.random.default_rng(42)
+    lmax = 64
+    ncomp = 1 if spin == 0 else 2
+    alm0 = random_alm(lmax, lmax, spin, ncomp, rng)
+    # equiangular grid including the poles: very non-uniform pixel sizes
+    nrings, nphi = 2*lmax+2, 2*lmax+2
+    geom = dict(theta=np.linspace(0, np.pi, nrings),
+                nphi=np.full(nrings, nphi, dtype=np.uint64),
+                phi0=np.zeros(nrings),
+                ringstart=np.arange(nrings, dtype=np.uint64)*nphi)
+    map = ducc0.sht.synthesis(alm=alm0, lmax=lmax, spin=spin, **geom)
+    alm1, _, itn0, _, _ = ducc0.sht.pseudo_analysis(
+        map=map, lmax=lmax, spin=spin, epsilon=1e-10, maxiter=200, **geom)
+    alm2, _, itn1, _, _ = ducc0.sht.pseudo_analysis(
+        map=map, lmax=lmax, spin=spin, epsilon=1e-10, maxiter=200,
+        precondition=True, **geom)
+    assert_(ducc0.misc.l2error(alm1, alm0) < 1e-8)
+    assert_(ducc0.misc.l2error(alm2, alm0) < 1e-8)
+    assert_(itn1 < itn0/4)
+    # restarting from the solution of a slightly different map
+    map2 = map*(1+1e-6*rng.uniform(-1, 1, map.shape))
+    alm3, _, itn2, _, _ = ducc0.sht.pseudo_analysis(
+        map=map2, lmax=lmax, spin=spin, epsilon=1e-5, maxiter=200, alm0=alm1,
+        **geom)
+    assert_(itn2 <= 2)
+    assert_(ducc0.misc.l2error(alm3, alm1) < 1e-4)
+
+
+@pmp('spin', (0, 1, 2))
+@pmp('mode', ("STANDARD", "GRAD_ONLY"))
+@pmp('nset', (2, 5))
+@pmp('nthreads', (1, 4))
+def test_multiple_sets(spin, mode, nset, nthreads):
+    if spin == 0 and mode != "STANDARD":
+        pytest.skip()
+    rng = np.random.default_rng(42)
+    lmax = mmax = 40
+    ncomp_alm = 2 if (spin > 0 and mode == "STANDARD") else 1
+    ncomp_map = 1 if spin == 0 else 2
+    alm = random_alm(lmax, mmax, spin, nset*ncomp_alm, rng)
+    base = ducc0.healpix.Healpix_Base(16, "RING")
+    geom = base.sht_info()
+
+    # all sets in one call, via extra components
+    map = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin, mode=mode,
+                              nthreads=nthreads, **geom)
+    alm2 = ducc0.sht.adjoint_synthesis(map=map, lmax=lmax, spin=spin,
+                                       mode=mode, nthreads=nthreads, **geom)
+    # one set per transform, via the leading dimension
+    map3 = ducc0.sht.synthesis(alm=alm.reshape((nset, ncomp_alm, -1)),
+                               lmax=lmax, spin=spin, mode=mode,
+                               nthreads=nthreads, **geom)
+    alm3 = ducc0.sht.adjoint_synthesis(map=map3, lmax=lmax, spin=spin,
+                                       mode=mode, nthreads=nthreads, **geom)
+    for i in range(nset):
+        a = alm[i*ncomp_alm:(i+1)*ncomp_alm]
+        m = ducc0.sht.synthesis(alm=a, lmax=lmax, spin=spin, mode=mode,
+                                nthreads=nthreads, **geom)
+        assert_allclose(map[i*ncomp_map:(i+1)*ncomp_map], m, rtol=1e-13, atol=1e-13)
+        assert_allclose(map3[i], m, rtol=1e-13, atol=1e-13)
+        a = ducc0.sht.adjoint_synthesis(map=m, lmax=lmax, spin=spin, mode=mode,
+                                        nthreads=nthreads, **geom)
+        assert_allclose(alm2[i*ncomp_alm:(i+1)*ncomp_alm], a, rtol=1e-13, atol=1e-13)
+        assert_allclose(alm3[i], a, rtol=1e-13, atol=1e-13)
+
+
+@pmp('spin', (0, 2))
+@pmp('nthreads', (1, 4))
+def test_table_cache(spin, nthreads):
+    rng = np.random.default_rng(42)
+    lmax = mmax = 40
+    alm = random_alm(lmax, mmax, spin, 1 if spin == 0 else 2, rng)
+    geom = ducc0.healpix.Healpix_Base(16, "RING").sht_info()
+    try:
+        ducc0.sht.set_table_cache_limit(0)
+        ref = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin,
+                                  nthreads=nthreads, **geom)
+        assert_(ducc0.sht.table_cache_info()["entries"] == 0)
+        ducc0.sht.set_table_cache_limit()
+        ducc0.sht.clear_table_cache()
+        m0 = ducc0.sht.table_cache_info()["misses"]
+        for _ in range(3):
+            map = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin,
+                                      nthreads=nthreads, **geom)
+            assert_(np.array_equal(map, ref))
+        info = ducc0.sht.table_cache_info()
+        assert_(info["misses"] == m0+2)  # recurrence tables and ring data
+        assert_(info["entries"] == 2)
+        assert_(info["bytes"] > 0)
+    finally:
+        ducc0.sht.set_table_cache_limit()
+
+
+@pmp('spin', (0, 1, 2))
+@pmp('radius', (0.05, 0.5))
+def test_partial(spin, radius):
+    rng = np.random.default_rng(42)
+    lmax = mmax = 64
+    ncomp = 1 if spin == 0 else 2
+    alm = random_alm(lmax, mmax, spin, ncomp, rng)
+    base = ducc0.healpix.Healpix_Base(32, "RING")
+    geom = base.sht_info()
+    ranges = base.query_disc(np.array([1.0, 2.0]), radius)
+    mask = np.zeros(base.npix(), dtype=bool)
+    for lo, hi in ranges:
+        mask[lo:hi] = True
+    ref = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin, **geom)
+    map = ducc0.sht.synthesis_partial(alm=alm, lmax=lmax, spin=spin,
+                                      pixranges=ranges, **geom)
+    assert_allclose(map[:, mask], ref[:, mask], rtol=1e-12, atol=1e-12)
+    assert_(np.all(map[:, ~mask] == 0))
+    map = rng.uniform(-1, 1, ref.shape)
+    alm1 = ducc0.sht.adjoint_synthesis_partial(map=map, lmax=lmax, spin=spin,
+                                               pixranges=ranges, **geom)
+    map[:, ~mask] = 0
+    alm2 = ducc0.sht.adjoint_synthesis(map=map, lmax=lmax, spin=spin, **geom)
+    assert_allclose(ducc0.misc.l2error(alm1, alm2), 0, atol=1e-12)
+
+
+@pmp('spin', (0, 1, 2))
+@pmp('lmax', (20, 300))
+def test_float_recurrence(spin, lmax):
+    rng = np.random.default_rng(42)
+    ncomp = 1 if spin == 0 else 2
+    alm = random_alm(lmax, lmax, spin, ncomp, rng).astype(np.complex64)
+    geom = ducc0.healpix.Healpix_Base(128, "RING").sht_info()
+    ref = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin, **geom)
+    # large enough to enable the single-precision recurrence
+    epsilon = 1e-6*(lmax+1)
+    map, _ = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin,
+                                 epsilon=epsilon, **geom)
+    assert_(ducc0.misc.l2error(map, ref) < epsilon)
+
+
+@pmp('spin', (0, 1, 2))
+@pmp('epsilon', (1e-4, 1e-9))
+def test_epsilon(spin, epsilon):
+    rng = np.random.default_rng(42)
+    lmax = 767
+    ncomp = 1 if spin == 0 else 2
+    alm = random_alm(lmax, lmax, spin, ncomp, rng)
+    geom = ducc0.healpix.Healpix_Base(256, "RING").sht_info()
+    ref = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin, **geom)
+    map, skip = ducc0.sht.synthesis(alm=alm, lmax=lmax, spin=spin,
+                                    epsilon=epsilon, **geom)
+    assert_(0 < skip <= epsilon)
+    assert_(ducc0.misc.l2error(map, ref) < epsilon)
+    ref = ducc0.sht.adjoint_synthesis(map=map, lmax=lmax, spin=spin, **geom)
+    alm2, skip = ducc0.sht.adjoint_synthesis(map=map, lmax=lmax, spin=spin,
+                                             epsilon=epsilon, **geom)
+    assert_(0 < skip <= epsilon)
+    assert_(ducc0.misc.l2error(alm2, ref) < epsilon)
+
+
 @pmp('spin', (0, 1, 2))
 @pmp('nthreads', (1, 4))
 @pmp('npix', (33, 200))
@@ -494,3 +494,136 @@ def test_adjointness_ms2dirty_complex(nx, ny, nrow, nchan, epsilon,
           +1j*ng.dirty2ms(uvw, freq, dirty.imag, wgt, pixsizex, pixsizey, nu, nv,
                        epsilon, wstacking, nthreads, 0, mask).astype("c16")
     check(dirty2, ms2)
+
+
+@pmp("nxdirty", (32, 128))
+@pmp("nydirty", (32, 64))
+@pmp("nrow", (1, 27))
+@pmp("nchan", (1, 5))
+@pmp("epsilon", (1e-3, 1e-10))
+@pmp("singleprec", (True, False))
+@pmp("wstacking", (True, False))
+@pmp("use_wgt", (True, False))
+@pmp("use_mask", (False, True))
+def test_plan(nxdirty, nydirty, nrow, nchan, epsilon, singleprec, wstacking,
+              use_wgt, use_mask):
+    if singleprec and epsilon < 1e-6:
+        pytest.skip()
+    rng = np.random.default_rng(42)
+    pixsizex = np.pi/180/60/nxdirty*0.2398
+    pixsizey = np.pi/180/60/nxdirty
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsizey*f0/SPEEDOFLIGHT)
+    wgt = rng.uniform(0.9, 1.1, (nrow, nchan)) if use_wgt else None
+    mask = (rng.uniform(0, 1, (nrow, nchan)) > 0.5).astype(np.uint8) \
+        if use_mask else None
+    ftype, ctype = ("f4", "c8") if singleprec else ("f8", "c16")
+    if wgt is not None:
+        wgt = wgt.astype(ftype)
+    args = dict(uvw=uvw, freq=freq, wgt=wgt, mask=mask, pixsize_x=pixsizex,
+                pixsize_y=pixsizey, epsilon=epsilon, do_wgridding=wstacking)
+    # pass temporary weights and mask, which are freed right after the plan
+    # has been constructed
+    pargs = dict(args, wgt=None if wgt is None else wgt.copy(),
+                 mask=None if mask is None else mask.copy())
+    plan = ng.experimental.Plan(npix_x=nxdirty, npix_y=nydirty,
+                                singleprec=singleprec, **pargs)
+    del pargs
+    # apply the plan repeatedly to make sure that no state leaks between calls
+    for _ in range(2):
+        ms = (rng.random((nrow, nchan))-0.5
+              + 1j*(rng.random((nrow, nchan))-0.5)).astype(ctype)
+        dirty = (rng.random((nxdirty, nydirty))-0.5).astype(ftype)
+        ref = ng.vis2dirty(vis=ms, npix_x=nxdirty, npix_y=nydirty, **args)
+        res = plan.vis2dirty(vis=ms)
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+        ref = ng.dirty2vis(dirty=dirty, **args)
+        res = plan.dirty2vis(dirty=dirty, vis=np.ones_like(ms))
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+        ref = ng.vis2dirty(vis=ref, npix_x=nxdirty, npix_y=nydirty, **args)
+        res = plan.dirty2dirty(dirty=dirty)
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+        ms3 = np.stack([ms, 1j*ms[:, ::-1]]).astype(ctype)
+        taylor = np.stack([np.ones(nchan), (freq-f0)/f0]).astype(ftype)
+        res = plan.vis2dirty_multi(vis=ms3, taylor=taylor)
+        assert res.shape == (4, nxdirty, nydirty)
+        for c in range(2):
+            for t in range(2):
+                ref = plan.vis2dirty(vis=(ms3[c]*taylor[t]).astype(ctype))
+                assert_allclose(ducc0.misc.l2error(res[2*c+t], ref), 0,
+                                atol=epsilon)
+        dirty4 = (rng.random((4, nxdirty, nydirty))-0.5).astype(ftype)
+        res = plan.dirty2vis_multi(dirty=dirty4, taylor=taylor)
+        assert res.shape == (2, nrow, nchan)
+        for c in range(2):
+            ref = sum(plan.dirty2vis(dirty=dirty4[2*c+t])*taylor[t]
+                      for t in range(2))
+            assert_allclose(ducc0.misc.l2error(res[c], ref), 0, atol=epsilon)
+
+
+@pmp("nrow", (1, 100))
+@pmp("nchan", (1, 7))
+@pmp("epsilon", (1e-3, 1e-10))
+@pmp("budget", (1, 3, 100))
+@pmp("center", (0., 0.05))
+def test_plan_grid_memory(nrow, nchan, epsilon, budget, center):
+    nxdirty, nydirty = 64, 48
+    rng = np.random.default_rng(42)
+    pixsize = np.pi/180/60/nxdirty*0.5
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsize*f0/SPEEDOFLIGHT)
+    uvw[:, 2] *= 1e3
+    args = dict(uvw=uvw, freq=freq, npix_x=nxdirty, npix_y=nydirty,
+                pixsize_x=pixsize, pixsize_y=pixsize, epsilon=epsilon,
+                do_wgridding=True, center_x=center, center_y=-center)
+    ms = rng.random((nrow, nchan))-0.5 + 1j*(rng.random((nrow, nchan))-0.5)
+    ref = ng.experimental.Plan(**args).vis2dirty(vis=ms)
+    # budget is given in units of the size of one image-sized grid plane
+    plan = ng.experimental.Plan(max_grid_memory=budget*16*nxdirty*nydirty,
+                                **args)
+    res = plan.vis2dirty(vis=ms)
+    assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=1e-14)
+    res = plan.vis2dirty_multi(vis=np.stack([ms, 2*ms]))
+    assert_allclose(ducc0.misc.l2error(res[1], 2*ref), 0, atol=1e-14)
+
+
+@pmp("nrow", (1, 100))
+@pmp("nchan", (1, 7))
+@pmp("nchunk", (1, 4))
+@pmp("epsilon", (1e-3, 1e-10))
+@pmp("singleprec", (True, False))
+@pmp("wstacking", (True, False))
+@pmp("nvis_estimate", (0, 1000))
+def test_accumulator(nrow, nchan, nchunk, epsilon, singleprec, wstacking,
+                     nvis_estimate):
+    if singleprec and epsilon < 1e-6:
+        pytest.skip()
+    nxdirty, nydirty = 64, 48
+    rng = np.random.default_rng(42)
+    pixsize = np.pi/180/60/nxdirty*0.5
+    f0 = 1e9
+    freq = f0 + np.arange(nchan)*(f0/nchan)
+    uvw = (rng.random((nrow, 3))-0.5)/(pixsize*f0/SPEEDOFLIGHT)
+    uvw[:, 2] *= 100
+    ftype, ctype = ("f4", "c8") if singleprec else ("f8", "c16")
+    ms = (rng.random((nrow, nchan))-0.5
+          + 1j*(rng.random((nrow, nchan))-0.5)).astype(ctype)
+    wgt = rng.uniform(0.9, 1.1, (nrow, nchan)).astype(ftype)
+    args = dict(npix_x=nxdirty, npix_y=nydirty, pixsize_x=pixsize,
+                pixsize_y=pixsize, epsilon=epsilon, do_wgridding=wstacking)
+    ref = ng.vis2dirty(uvw=uvw, freq=freq, vis=ms, wgt=wgt, **args)
+    acc = ng.experimental.Accumulator(freq=freq, wmax=np.max(np.abs(uvw[:, 2])),
+                                      nvis_estimate=nvis_estimate,
+                                      singleprec=singleprec, **args)
+    # use the accumulator twice to make sure that finalize() resets it
+    for _ in range(2):
+        for idx in np.array_split(np.arange(nrow), nchunk):
+            acc.add(uvw=uvw[idx], vis=ms[idx], wgt=wgt[idx])
+        res = acc.finalize()
+        assert_allclose(ducc0.misc.l2error(res, ref), 0, atol=epsilon)
+    if wstacking:
+        uvw[0, 2] = 2*np.max(np.abs(uvw[:, 2]))
+        with pytest.raises(RuntimeError):
+            acc.add(uvw=uvw, vis=ms, wgt=wgt)
@@ -594,6 +594,526 @@ The input arrays should be contiguous and in C memory order.
 Other strides will work, but can degrade performance significantly.
 )""";
 
+class Py_WgridderPlan
+  {
+  private:
+    size_t nrow, nchan, npix_x, npix_y;
+    // the plan accesses weights and mask in every execution, so it needs
+    // private copies which live as long as the plan itself
+    py::array wgt_keep, mask_keep;
+    unique_ptr<Wgridder<float, float, float, float>> pf;
+    unique_ptr<Wgridder<double, double, double, double>> pd;
+
+    template<typename T> void construct(
+      unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &uvw_,
+      const py::array &freq_, const py::object &wgt_, const py::object &mask_,
+      double pixsize_x, double pixsize_y, double epsilon, bool do_wgridding,
+      size_t nthreads, size_t verbosity, bool flip_v, bool divide_by_n,
+      double sigma_min, double sigma_max, double center_x, double center_y,
+      bool allow_nshift, size_t max_grid_memory)
+      {
+      auto uvw = to_cmav<double,2>(uvw_);
+      auto freq = to_cmav<double,1>(freq_);
+      wgt_keep = get_optional_const_Pyarr<T>(wgt_, {nrow,nchan})
+        .attr("copy")();
+      auto wgt2 = to_cmav<T,2>(wgt_keep);
+      mask_keep = get_optional_const_Pyarr<uint8_t>(mask_, {nrow,nchan})
+        .attr("copy")();
+      auto mask2 = to_cmav<uint8_t,2>(mask_keep);
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Wgridder<T,T,T,T>>(uvw, freq, wgt2, mask2, npix_x,
+        npix_y, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads,
+        verbosity, flip_v, divide_by_n, sigma_min, sigma_max, center_x,
+        center_y, allow_nshift);
+      ptr->set_max_grid_memory(max_grid_memory);
+      }
+      }
+    template<typename T> py::array do_vis2dirty(
+      const unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &vis_,
+      py::object &dirty_)
+      {
+      auto vis = to_cmav<complex<T>,2>(vis_);
+      auto dirty = get_optional_Pyarr<T>(dirty_, {npix_x, npix_y});
+      auto dirty2 = to_vmav<T,2>(dirty);
+      {
+      py::gil_scoped_release release;
+      ptr->ms2dirty(vis, dirty2);
+      }
+      return dirty;
+      }
+    template<typename T> py::array do_vis2dirty_multi(
+      const unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &vis_,
+      const py::object &taylor_, py::object &dirty_)
+      {
+      auto vis = to_cmav<complex<T>,3>(vis_);
+      MR_assert(taylor_.is_none() || isPyarr<T>(taylor_), "incorrect data type");
+      auto taylor = taylor_.is_none() ? py::array_t<T>(shape_t{0,0})
+                                      : toPyarr<T>(taylor_);
+      auto taylor2 = to_cmav<T,2>(taylor);
+      size_t nterm = (taylor2.size()==0) ? 1 : taylor2.shape(0);
+      auto dirty = get_optional_Pyarr<T>(dirty_,
+        {vis.shape(0)*nterm, npix_x, npix_y});
+      auto dirty2 = to_vmav<T,3>(dirty);
+      {
+      py::gil_scoped_release release;
+      ptr->ms2dirty_multi(vis, taylor2, dirty2);
+      }
+      return dirty;
+      }
+    template<typename T> py::array do_dirty2vis(
+      const unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &dirty_,
+      py::object &vis_)
+      {
+      auto dirty = to_cmav<T,2>(dirty_);
+      auto vis = get_optional_Pyarr<complex<T>>(vis_, {nrow, nchan});
+      auto vis2 = to_vmav<complex<T>,2>(vis);
+      {
+      py::gil_scoped_release release;
+      ptr->dirty2ms(dirty, vis2);
+      }
+      return vis;
+      }
+    template<typename T> py::array do_dirty2vis_multi(
+      const unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &dirty_,
+      const py::object &taylor_, py::object &vis_)
+      {
+      auto dirty = to_cmav<T,3>(dirty_);
+      MR_assert(taylor_.is_none() || isPyarr<T>(taylor_), "incorrect data type");
+      auto taylor = taylor_.is_none() ? py::array_t<T>(shape_t{0,0})
+                                      : toPyarr<T>(taylor_);
+      auto taylor2 = to_cmav<T,2>(taylor);
+      size_t nterm = (taylor2.size()==0) ? 1 : taylor2.shape(0);
+      MR_assert(dirty.shape(0)%nterm==0,
+        "number of images must be a multiple of the number of Taylor terms");
+      auto vis = get_optional_Pyarr<complex<T>>(vis_,
+        {dirty.shape(0)/nterm, nrow, nchan});
+      auto vis2 = to_vmav<complex<T>,3>(vis);
+      {
+      py::gil_scoped_release release;
+      ptr->dirty2ms_multi(dirty, taylor2, vis2);
+      }
+      return vis;
+      }
+    template<typename T> py::array do_dirty2dirty(
+      const unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &dirty_,
+      py::object &out_)
+      {
+      auto dirty = to_cmav<T,2>(dirty_);
+      auto out = get_optional_Pyarr<T>(out_, {npix_x, npix_y});
+      auto out2 = to_vmav<T,2>(out);
+      {
+      py::gil_scoped_release release;
+      ptr->dirty2dirty(dirty, out2);
+      }
+      return out;
+      }
+
+  public:
+    Py_WgridderPlan(const py::array &uvw, const py::array &freq,
+      size_t npix_x_, size_t npix_y_, double pixsize_x, double pixsize_y,
+      double epsilon, bool do_wgridding, size_t nthreads, size_t verbosity,
+      const py::object &wgt, const py::object &mask, bool flip_v,
+      bool divide_by_n, double sigma_min, double sigma_max, double center_x,
+      double center_y, bool allow_nshift, bool singleprec,
+      size_t max_grid_memory)
+      : nrow(uvw.shape(0)), nchan(freq.shape(0)),
+        npix_x(npix_x_), npix_y(npix_y_)
+      {
+      singleprec ?
+        construct(pf, uvw, freq, wgt, mask, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift, max_grid_memory) :
+        construct(pd, uvw, freq, wgt, mask, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift, max_grid_memory);
+      }
+
+    py::array vis2dirty(const py::array &vis, py::object &dirty)
+      {
+      if (pd) return do_vis2dirty(pd, vis, dirty);
+      if (pf) return do_vis2dirty(pf, vis, dirty);
+      MR_fail("unsupported");
+      }
+    py::array vis2dirty_multi(const py::array &vis, const py::object &taylor,
+      py::object &dirty)
+      {
+      if (pd) return do_vis2dirty_multi(pd, vis, taylor, dirty);
+      if (pf) return do_vis2dirty_multi(pf, vis, taylor, dirty);
+      MR_fail("unsupported");
+      }
+    py::array dirty2vis(const py::array &dirty, py::object &vis)
+      {
+      if (pd) return do_dirty2vis(pd, dirty, vis);
+      if (pf) return do_dirty2vis(pf, dirty, vis);
+      MR_fail("unsupported");
+      }
+    py::array dirty2vis_multi(const py::array &dirty, const py::object &taylor,
+      py::object &vis)
+      {
+      if (pd) return do_dirty2vis_multi(pd, dirty, taylor, vis);
+      if (pf) return do_dirty2vis_multi(pf, dirty, taylor, vis);
+      MR_fail("unsupported");
+      }
+    py::array dirty2dirty(const py::array &dirty, py::object &out)
+      {
+      if (pd) return do_dirty2dirty(pd, dirty, out);
+      if (pf) return do_dirty2dirty(pf, dirty, out);
+      MR_fail("unsupported");
+      }
+  };
+
+class Py_WgridderAccumulator
+  {
+  private:
+    size_t nchan, npix_x, npix_y;
+    unique_ptr<Wgridder<float, float, float, float>> pf;
+    unique_ptr<Wgridder<double, double, double, double>> pd;
+
+    template<typename T> void construct(
+      unique_ptr<Wgridder<T,T,T,T>> &ptr, const py::array &freq_, double wmax,
+      size_t nvis_estimate, double pixsize_x, double pixsize_y, double epsilon,
+      bool do_wgridding, size_t nthreads, size_t verbosity, bool flip_v,
+      bool divide_by_n, double sigma_min, double sigma_max, double center_x,
+      double center_y, bool allow_nshift)
+      {
+      auto freq = to_cmav<double,1>(freq_);
+      {
+      py::gil_scoped_release release;
+      ptr = make_unique<Wgridder<T,T,T,T>>(freq, wmax, nvis_estimate, npix_x,
+        npix_y, pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads,
+        verbosity, flip_v, divide_by_n, sigma_min, sigma_max, center_x,
+        center_y, allow_nshift);
+      }
+      }
+    template<typename T> void do_add(const unique_ptr<Wgridder<T,T,T,T>> &ptr,
+      const py::array &uvw_, const py::array &vis_, const py::object &wgt_,
+      const py::object &mask_)
+      {
+      auto uvw = to_cmav<double,2>(uvw_);
+      auto vis = to_cmav<complex<T>,2>(vis_);
+      size_t nrow = uvw.shape(0);
+      auto wgt = get_optional_const_Pyarr<T>(wgt_, {nrow,nchan});
+      auto wgt2 = to_cmav<T,2>(wgt);
+      auto mask = get_optional_const_Pyarr<uint8_t>(mask_, {nrow,nchan});
+      auto mask2 = to_cmav<uint8_t,2>(mask);
+      {
+      py::gil_scoped_release release;
+      ptr->add(uvw, vis, wgt2, mask2);
+      }
+      }
+    template<typename T> py::array do_finalize(
+      const unique_ptr<Wgridder<T,T,T,T>> &ptr, py::object &dirty_)
+      {
+      auto dirty = get_optional_Pyarr<T>(dirty_, {npix_x, npix_y});
+      auto dirty2 = to_vmav<T,2>(dirty);
+      {
+      py::gil_scoped_release release;
+      ptr->finalize(dirty2);
+      }
+      return dirty;
+      }
+
+  public:
+    Py_WgridderAccumulator(const py::array &freq, double wmax,
+      size_t npix_x_, size_t npix_y_, double pixsize_x, double pixsize_y,
+      double epsilon, bool do_wgridding, size_t nthreads, size_t verbosity,
+      bool flip_v, bool divide_by_n, double sigma_min, double sigma_max,
+      double center_x, double center_y, bool allow_nshift,
+      size_t nvis_estimate, bool singleprec)
+      : nchan(freq.shape(0)), npix_x(npix_x_), npix_y(npix_y_)
+      {
+      singleprec ?
+        construct(pf, freq, wmax, nvis_estimate, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift) :
+        construct(pd, freq, wmax, nvis_estimate, pixsize_x, pixsize_y, epsilon,
+          do_wgridding, nthreads, verbosity, flip_v, divide_by_n, sigma_min,
+          sigma_max, center_x, center_y, allow_nshift);
+      }
+
+    void add(const py::array &uvw, const py::array &vis, const py::object &wgt,
+      const py::object &mask)
+      {
+      if (pd) return do_add(pd, uvw, vis, wgt, mask);
+      if (pf) return do_add(pf, uvw, vis, wgt, mask);
+      MR_fail("unsupported");
+      }
+    py::array finalize(py::object &dirty)
+      {
+      if (pd) return do_finalize(pd, dirty);
+      if (pf) return do_finalize(pf, dirty);
+      MR_fail("unsupported");
+      }
+  };
+
+constexpr const char *WgridderPlan_DS = R"""(
+Reusable gridding plan for a fixed uv coverage and dirty image geometry.
+
+All work which does not depend on the visibility or image values (baseline
+setup, kernel and grid size selection, sorting of the visibilities into tiles)
+is done once at construction; the `vis2dirty` and `dirty2vis` methods then only
+carry out the actual (de)gridding and FFTs. This is useful in iterative
+imaging, where the same operators are applied many times.
+
+Parameters
+----------
+uvw: numpy.ndarray((nrows, 3), dtype=numpy.float64)
+    UVW coordinates from the measurement set
+freq: numpy.ndarray((nchan,), dtype=numpy.float64)
+    channel frequencies
+npix_x, npix_y: int
+    dimensions of the dirty image (must both be even and at least 32)
+pixsize_x, pixsize_y: float
+    angular pixel size (in projected radians) of the dirty image
+epsilon: float
+    accuracy at which the computation should be done. Must be larger than 2e-13.
+    If `singleprec` is True, it must be larger than 1e-5.
+do_wgridding: bool
+    if True, the full w-gridding algorithm is carried out, otherwise
+    the w values are assumed to be zero.
+nthreads: int
+    number of threads to use for the calculation
+verbosity: int
+    0: no output
+    1: some diagnostic output and timings
+wgt: numpy.ndarray((nrows, nchan), dtype=numpy.float32 or numpy.float64), optional
+    If present, the visibilities are multiplied by these weights in every
+    transform. Its data type must match the precision selected by `singleprec`.
+    The plan stores a private copy of this array.
+mask: numpy.ndarray((nrows, nchan), dtype=numpy.uint8), optional
+    If present, only visibilities are processed for which mask!=0
+    The plan stores a private copy of this array.
+flip_v: bool
+    if True, all v coordinates in uvw are multiplied by -1
+divide_by_n: bool
+    if True, the dirty image pixels are divided by n
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+center_x, center_y: float
+    center of the dirty image relative to the phase center
+    (in projected radians)
+allow_nshift: bool
+    if False, never shift the w planes by the mean value of n-1
+singleprec: bool
+    if True, the plan works on numpy.float32/numpy.complex64 data,
+    otherwise on numpy.float64/numpy.complex128.
+max_grid_memory: int
+    maximum number of bytes used for uv grids by `vis2dirty` and
+    `vis2dirty_multi` when w-gridding. As many w planes as fit into this
+    budget are gridded and transformed together, which gives better scaling
+    with many threads. With the default of 0, one plane is processed at a time.
+
+Notes
+-----
+A plan object must not be used by several threads simultaneously.
+)""";
+
+constexpr const char *WgridderPlan_vis2dirty_DS = R"""(
+Converts visibilities to a dirty image, using the pre-computed plan.
+
+Parameters
+----------
+vis: numpy.ndarray((nrows, nchan), dtype=complex of the plan's precision)
+    the input visibilities
+dirty: numpy.ndarray((npix_x, npix_y), dtype=float of the plan's precision), optional
+    If provided, the dirty image will be written to this array and a handle
+    to it will be returned.
+
+Returns
+-------
+numpy.ndarray((npix_x, npix_y), dtype=float of the plan's precision)
+    the dirty image
+)""";
+
+constexpr const char *WgridderPlan_vis2dirty_multi_DS = R"""(
+Converts several sets of visibilities (e.g. correlations) to several dirty
+images (e.g. polarization products or Taylor terms) in a single pass over the
+data, using the pre-computed plan.
+
+Image `c*nterm+t` of the result is the dirty image of `vis[c]`, with every
+channel multiplied by `taylor[t, channel]`. This gives the same result as
+separate `vis2dirty` calls, but the gridding kernel is evaluated only once per
+visibility, and all images share the FFT and correction stages.
+
+Parameters
+----------
+vis: numpy.ndarray((ncorr, nrows, nchan), dtype=complex of the plan's precision)
+    the input visibilities
+taylor: numpy.ndarray((nterm, nchan), dtype=float of the plan's precision), optional
+    per-channel weights of the individual output terms.
+    If not provided, a single term with all weights equal to 1 is used.
+dirty: numpy.ndarray((ncorr*nterm, npix_x, npix_y), dtype=float of the plan's precision), optional
+    If provided, the dirty images will be written to this array and a handle
+    to it will be returned.
+
+Returns
+-------
+numpy.ndarray((ncorr*nterm, npix_x, npix_y), dtype=float of the plan's precision)
+    the dirty images
+
+Notes
+-----
+The memory needed for the uv grid(s) grows linearly with the number of images.
+)""";
+
+constexpr const char *WgridderPlan_dirty2vis_DS = R"""(
+Converts a dirty image to visibilities, using the pre-computed plan.
+
+Parameters
+----------
+dirty: numpy.ndarray((npix_x, npix_y), dtype=float of the plan's precision)
+    the dirty image
+vis: numpy.ndarray((nrows, nchan), dtype=complex of the plan's precision), optional
+    If provided, the visibilities will be written to this array and a handle
+    to it will be returned.
+
+Returns
+-------
+numpy.ndarray((nrows, nchan), dtype=complex of the plan's precision)
+    the computed visibilities. Entries excluded by `wgt` or `mask` are zero.
+)""";
+
+constexpr const char *WgridderPlan_dirty2vis_multi_DS = R"""(
+Converts several dirty images to several sets of visibilities in a single
+pass over the data, using the pre-computed plan. This is the adjoint of
+`vis2dirty_multi`.
+
+`vis[c]` of the result is the sum over `t` of the visibilities of image
+`c*nterm+t`, with every channel multiplied by `taylor[t, channel]`. This gives
+the same result as separate `dirty2vis` calls, but the gridding kernel is
+evaluated only once per visibility.
+
+Parameters
+----------
+dirty: numpy.ndarray((ncorr*nterm, npix_x, npix_y), dtype=float of the plan's precision)
+    the input dirty images
+taylor: numpy.ndarray((nterm, nchan), dtype=float of the plan's precision), optional
+    per-channel weights of the individual input terms.
+    If not provided, a single term with all weights equal to 1 is used.
+vis: numpy.ndarray((ncorr, nrows, nchan), dtype=complex of the plan's precision), optional
+    If provided, the visibilities will be written to this array and a handle
+    to it will be returned.
+
+Returns
+-------
+numpy.ndarray((ncorr, nrows, nchan), dtype=complex of the plan's precision)
+    the computed visibilities. Entries excluded by `wgt` or `mask` are zero.
+
+Notes
+-----
+The memory needed for the uv grid(s) grows linearly with the number of images.
+)""";
+
+constexpr const char *WgridderPlan_dirty2dirty_DS = R"""(
+Applies `dirty2vis` followed by `vis2dirty` to a dirty image, using the
+pre-computed plan. The weights are applied in both steps.
+
+The visibilities are degridded, weighted and gridded again tile by tile, so
+the intermediate visibility array is never stored. This is considerably faster
+than the two separate calls and saves the memory of the visibilities.
+
+Parameters
+----------
+dirty: numpy.ndarray((npix_x, npix_y), dtype=float of the plan's precision)
+    the input image
+out: numpy.ndarray((npix_x, npix_y), dtype=float of the plan's precision), optional
+    If provided, the result will be written to this array and a handle
+    to it will be returned. May be identical to `dirty`.
+
+Returns
+-------
+numpy.ndarray((npix_x, npix_y), dtype=float of the plan's precision)
+    the resulting image
+)""";
+
+constexpr const char *WgridderAccumulator_DS = R"""(
+Accumulator for gridding visibilities which arrive in chunks (e.g. in time
+order) and cannot be held in memory all at once.
+
+Each call of `add` grids a chunk of visibilities onto persistent uv grids (one
+per w plane if `do_wgridding` is True); `finalize` then computes the dirty image
+from them. The memory consumption is therefore determined by the grid size and
+not by the amount of data. The result agrees with a single `vis2dirty` call on
+all data to within `epsilon`.
+
+Parameters
+----------
+freq: numpy.ndarray((nchan,), dtype=numpy.float64)
+    channel frequencies, common to all chunks
+wmax: float
+    maximum absolute w coordinate (in meters) of all visibilities which will
+    be added. Chunks exceeding this value are rejected.
+npix_x, npix_y: int
+    dimensions of the dirty image (must both be even and at least 32)
+pixsize_x, pixsize_y: float
+    angular pixel size (in projected radians) of the dirty image
+epsilon: float
+    accuracy at which the computation should be done. Must be larger than 2e-13.
+    If `singleprec` is True, it must be larger than 1e-5.
+do_wgridding: bool
+    if True, the full w-gridding algorithm is carried out, otherwise
+    the w values are assumed to be zero.
+nthreads: int
+    number of threads to use for the calculation
+verbosity: int
+    0: no output
+    1: some diagnostic output and timings
+flip_v: bool
+    if True, all v coordinates in uvw are multiplied by -1
+divide_by_n: bool
+    if True, the dirty image pixels are divided by n
+sigma_min, sigma_max: float
+    minimum and maximum allowed oversampling factors
+center_x, center_y: float
+    center of the dirty image relative to the phase center
+    (in projected radians)
+allow_nshift: bool
+    if False, never shift the w planes by the mean value of n-1
+nvis_estimate: int
+    expected total number of visibilities, used for choosing the kernel.
+    If 0, the kernel with the smallest grids is used; this minimizes memory,
+    but makes gridding more expensive.
+singleprec: bool
+    if True, the accumulator works on numpy.float32/numpy.complex64 data,
+    otherwise on numpy.float64/numpy.complex128.
+
+Notes
+-----
+An accumulator object must not be used by several threads simultaneously.
+)""";
+
+constexpr const char *WgridderAccumulator_add_DS = R"""(
+Grids a chunk of visibilities onto the accumulator's uv grids.
+
+Parameters
+----------
+uvw: numpy.ndarray((nrows, 3), dtype=numpy.float64)
+    UVW coordinates of the chunk
+vis: numpy.ndarray((nrows, nchan), dtype=complex of the accumulator's precision)
+    the visibilities of the chunk
+wgt: numpy.ndarray((nrows, nchan), dtype=float of the accumulator's precision), optional
+    If present, the visibilities are multiplied by these weights.
+mask: numpy.ndarray((nrows, nchan), dtype=numpy.uint8), optional
+    If present, only visibilities are processed for which mask!=0
+)""";
+
+constexpr const char *WgridderAccumulator_finalize_DS = R"""(
+Computes the dirty image from all visibilities added so far and resets the
+accumulator to its initial (empty) state.
+
+Parameters
+----------
+dirty: numpy.ndarray((npix_x, npix_y), dtype=float of the accumulator's precision), optional
+    If provided, the dirty image will be written to this array and a handle
+    to it will be returned.
+
+Returns
+-------
+numpy.ndarray((npix_x, npix_y), dtype=float of the accumulator's precision)
+    the dirty image
+)""";
+
 constexpr const char *wgridder_experimental_DS = R"""(
 Experimental, more powerful interface to the gridding code
 
@@ -645,6 +1165,45 @@ void add_wgridder(py::module_ &msup)
     "flip_v"_a=false, "divide_by_n"_a=true, "vis"_a=None, "sigma_min"_a=1.1,
     "sigma_max"_a=2.6, "center_x"_a=0., "center_y"_a=0.);
 
+  py::class_<Py_WgridderPlan> (m2, "Plan", py::module_local(), WgridderPlan_DS)
+    .def(py::init<const py::array &, const py::array &, size_t, size_t, double,
+                  double, double, bool, size_t, size_t, const py::object &,
+                  const py::object &, bool, bool, double, double, double,
+                  double, bool, bool, size_t>(),
+      py::kw_only(), "uvw"_a, "freq"_a, "npix_x"_a, "npix_y"_a, "pixsize_x"_a,
+      "pixsize_y"_a, "epsilon"_a, "do_wgridding"_a=false, "nthreads"_a=1,
+      "verbosity"_a=0, "wgt"_a=None, "mask"_a=None, "flip_v"_a=false,
+      "divide_by_n"_a=true, "sigma_min"_a=1.1, "sigma_max"_a=2.6,
+      "center_x"_a=0., "center_y"_a=0., "allow_nshift"_a=true,
+      "singleprec"_a=false, "max_grid_memory"_a=0)
+    .def("vis2dirty", &Py_WgridderPlan::vis2dirty, WgridderPlan_vis2dirty_DS,
+      py::kw_only(), "vis"_a, "dirty"_a=None)
+    .def("vis2dirty_multi", &Py_WgridderPlan::vis2dirty_multi,
+      WgridderPlan_vis2dirty_multi_DS, py::kw_only(), "vis"_a, "taylor"_a=None,
+      "dirty"_a=None)
+    .def("dirty2vis", &Py_WgridderPlan::dirty2vis, WgridderPlan_dirty2vis_DS,
+      py::kw_only(), "dirty"_a, "vis"_a=None)
+    .def("dirty2vis_multi", &Py_WgridderPlan::dirty2vis_multi,
+      WgridderPlan_dirty2vis_multi_DS, py::kw_only(), "dirty"_a,
+      "taylor"_a=None, "vis"_a=None)
+    .def("dirty2dirty", &Py_WgridderPlan::dirty2dirty,
+      WgridderPlan_dirty2dirty_DS, py::kw_only(), "dirty"_a, "out"_a=None);
+
+  py::class_<Py_WgridderAccumulator> (m2, "Accumulator", py::module_local(),
+    WgridderAccumulator_DS)
+    .def(py::init<const py::array &, double, size_t, size_t, double, double,
+                  double, bool, size_t, size_t, bool, bool, double, double,
+                  double, double, bool, size_t, bool>(),
+      py::kw_only(), "freq"_a, "wmax"_a, "npix_x"_a, "npix_y"_a, "pixsize_x"_a,
+      "pixsize_y"_a, "epsilon"_a, "do_wgridding"_a=false, "nthreads"_a=1,
+      "verbosity"_a=0, "flip_v"_a=false, "divide_by_n"_a=true,
+      "sigma_min"_a=1.1, "sigma_max"_a=2.6, "center_x"_a=0., "center_y"_a=0.,
+      "allow_nshift"_a=true, "nvis_estimate"_a=0, "singleprec"_a=false)
+    .def("add", &Py_WgridderAccumulator::add, WgridderAccumulator_add_DS,
+      py::kw_only(), "uvw"_a, "vis"_a, "wgt"_a=None, "mask"_a=None)
+    .def("finalize", &Py_WgridderAccumulator::finalize,
+      WgridderAccumulator_finalize_DS, py::kw_only(), "dirty"_a=None);
+
   m.def("ms2dirty", &Py_ms2dirty, ms2dirty_DS, "uvw"_a, "freq"_a, "ms"_a,
     "wgt"_a=None, "npix_x"_a, "npix_y"_a, "pixsize_x"_a, "pixsize_y"_a, "nu"_a=0, "nv"_a=0,
     "epsilon"_a, "do_wstacking"_a=false, "nthreads"_a=1, "verbosity"_a=0, "mask"_a=None,
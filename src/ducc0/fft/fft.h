@@ -60,10 +60,12 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <memory>
 #include <vector>
 #include <complex>
+#include <string>
 #include "ducc0/infra/error_handling.h"
 #include "ducc0/infra/aligned_array.h"
 #include "ducc0/infra/mav.h"
 #include "ducc0/math/cmplx.h"
+#include "ducc0/math/float16.h"
 #include "ducc0/math/unity_roots.h"
 
 namespace ducc0 {
@@ -225,6 +227,13 @@ template <typename Tfs> class cfftpass
       return make_pass(1,1,ip,make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip),
         vectorize);
       }
+    // builds a pass of length ip using the decomposition strategy "strategy"
+    // (see fft_strategy); returns nullptr if the strategy does not apply
+    static shared_ptr<cfftpass> make_strategy_pass(size_t ip, size_t strategy,
+      bool vectorize=false);
+    // builds a pass of length ip using the strategy stored in the FFT wisdom,
+    // falling back to make_pass() if there is none
+    static shared_ptr<cfftpass> make_tuned_pass(size_t ip, bool vectorize=false);
   };
 
 template <typename Tfs> class rfftpass
@@ -269,6 +278,14 @@ template <typename Tfs> class rfftpass
       return make_pass(1,1,ip,make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip),
         vectorize);
       }
+    static bool use_complexify(size_t ip, bool vectorize);
+    // builds a pass of length ip using the decomposition strategy "strategy"
+    // (see fft_strategy); returns nullptr if the strategy does not apply
+    static shared_ptr<rfftpass> make_strategy_pass(size_t ip, size_t strategy,
+      bool vectorize=false);
+    // builds a pass of length ip using the strategy stored in the FFT wisdom,
+    // falling back to make_pass() if there is none
+    static shared_ptr<rfftpass> make_tuned_pass(size_t ip, bool vectorize=false);
   };
 
 template<typename T> using Tcpass = shared_ptr<cfftpass<T>>;
@@ -284,7 +301,7 @@ template<typename Tfs> class pocketfft_c
   public:
     pocketfft_c(size_t n, bool vectorize=false)
       : N(n), critbuf(((N&1023)==0) ? 16 : 0),
-        plan(cfftpass<Tfs>::make_pass(n,vectorize)) {}
+        plan(cfftpass<Tfs>::make_tuned_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N*plan->needs_copy()+2*critbuf+plan->bufsize(); }
     template<typename Tfd> DUCC0_NOINLINE Cmplx<Tfd> *exec(Cmplx<Tfd> *in, Cmplx<Tfd> *buf,
@@ -331,7 +348,7 @@ template<typename Tfs> class pocketfft_r
 
   public:
     pocketfft_r(size_t n, bool vectorize=false)
-      : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
+      : N(n), plan(rfftpass<Tfs>::make_tuned_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N*plan->needs_copy()+plan->bufsize(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
@@ -379,7 +396,7 @@ template<typename Tfs> class pocketfft_hartley
 
   public:
     pocketfft_hartley(size_t n, bool vectorize=false)
-      : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
+      : N(n), plan(rfftpass<Tfs>::make_tuned_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N+plan->bufsize(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
@@ -424,7 +441,7 @@ template<typename Tfs> class pocketfft_fht
 
   public:
     pocketfft_fht(size_t n, bool vectorize=false)
-      : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
+      : N(n), plan(rfftpass<Tfs>::make_tuned_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N+plan->bufsize(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
@@ -470,7 +487,7 @@ template<typename Tfs> class pocketfft_fftw
 
   public:
     pocketfft_fftw(size_t n, bool vectorize=false)
-      : N(n), plan(rfftpass<Tfs>::make_pass(n,vectorize)) {}
+      : N(n), plan(rfftpass<Tfs>::make_tuned_pass(n,vectorize)) {}
     size_t length() const { return N; }
     size_t bufsize() const { return N+plan->bufsize(); }
     template<typename Tfd> DUCC0_NOINLINE Tfd *exec(Tfd *in, Tfd *buf, Tfs fct,
@@ -849,6 +866,24 @@ template<typename T> DUCC0_NOINLINE void c2c(const cfmav<std::complex<T>> &in,
   const vfmav<std::complex<T>> &out, const shape_t &axes, bool forward,
   T fct, size_t nthreads=1);
 
+/// Complex FFT of arrays which are too large for main memory
+/** This computes the same result as c2c(), but accesses \a in and \a out
+ *  (typically memory-mapped files) only in tiles of at most \a memory_limit
+ *  bytes, which are transformed in an internal buffer. The tiles are visited
+ *  in storage order and consist of long contiguous chunks, so that the
+ *  resulting I/O is mostly sequential.
+ *
+ *  All axes which fit into the buffer together with all axes of smaller
+ *  stride are transformed in one pass over the data; every other axis
+ *  requires an additional pass. One-dimensional arrays which do not fit
+ *  into the buffer are transformed in two passes using Bailey's four-step
+ *  algorithm; in this case \a in and \a out must not be identical.
+ */
+template<typename T> DUCC0_NOINLINE void c2c_out_of_core(
+  const cfmav<std::complex<T>> &in, const vfmav<std::complex<T>> &out,
+  const shape_t &axes, bool forward, T fct, size_t memory_limit,
+  size_t nthreads=1);
+
 /// Fast Discrete Cosine Transform
 /** This executes a DCT on \a in and stores the result in \a out.
  *
@@ -916,6 +951,44 @@ template<typename T> DUCC0_NOINLINE void c2r_mut(const vfmav<std::complex<T>> &i
   const vfmav<T> &out, const shape_t &axes, bool forward, T fct,
   size_t nthreads=1);
 
+/// true if \a T is a 16-bit storage type which can be used for the real-valued
+/// side of r2c() and c2r()
+template<typename T> struct is_fft_storage16: false_type {};
+template<> struct is_fft_storage16<float16>: true_type {};
+template<> struct is_fft_storage16<bfloat16>: true_type {};
+
+/// Real-to-complex FFT reading 16-bit input
+/** The input values are converted to \a T on the fly while being copied into
+ *  the transform buffers, so no temporary full-precision copy of \a in is
+ *  created. Otherwise identical to the r2c() variants above. */
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> r2c(const cfmav<Ts> &in,
+  const vfmav<std::complex<T>> &out, size_t axis, bool forward, T fct,
+  size_t nthreads=1);
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> r2c(const cfmav<Ts> &in,
+  const vfmav<std::complex<T>> &out, const shape_t &axes,
+  bool forward, T fct, size_t nthreads=1);
+
+/// Complex-to-real FFT writing 16-bit output
+/** The results are rounded to \a Ts while being copied out of the transform
+ *  buffers. Otherwise identical to the c2r() and c2r_mut() variants above. */
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> c2r(
+  const cfmav<std::complex<T>> &in, const vfmav<Ts> &out, size_t axis,
+  bool forward, T fct, size_t nthreads=1);
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> c2r(
+  const cfmav<std::complex<T>> &in, const vfmav<Ts> &out,
+  const shape_t &axes, bool forward, T fct, size_t nthreads=1);
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> c2r_mut(
+  const vfmav<std::complex<T>> &in, const vfmav<Ts> &out,
+  const shape_t &axes, bool forward, T fct, size_t nthreads=1);
+
 template<typename T> DUCC0_NOINLINE void r2r_fftpack(const cfmav<T> &in,
   const vfmav<T> &out, const shape_t &axes, bool real2hermitian, bool forward,
   T fct, size_t nthreads=1);
@@ -964,6 +1037,25 @@ template<typename T> DUCC0_NOINLINE void convolve_axis(const cfmav<T> &in,
 template<typename T> DUCC0_NOINLINE void convolve_axis(const cfmav<complex<T>> &in,
   const vfmav<complex<T>> &out, size_t axis, const cmav<complex<T>,1> &kernel,
   size_t nthreads=1);
+
+/// Measures the alternative pass decompositions for 1D transforms of length
+/// \a len in precision \a T and stores the fastest ones in the FFT wisdom.
+/** All complex and real-valued plans of this length created afterwards
+ *  will use the measured decomposition. */
+template<typename T> void tune_fft(size_t len);
+
+/// If \a on is true, every FFT plan for which no wisdom exists will be tuned
+/// on construction (which is expensive). Off by default.
+inline void set_fft_autotuning(bool on);
+
+/// Writes the current FFT wisdom to the text file \a fname.
+inline void save_fft_wisdom(const std::string &fname);
+
+/// Adds the FFT wisdom stored in \a fname to the current wisdom.
+inline void load_fft_wisdom(const std::string &fname);
+
+/// Discards all FFT wisdom.
+inline void forget_fft_wisdom();
 }
 
 using detail_fft::pocketfft_c;
@@ -975,6 +1067,7 @@ using detail_fft::pocketfft_fftw;
 using detail_fft::FORWARD;
 using detail_fft::BACKWARD;
 using detail_fft::c2c;
+using detail_fft::c2c_out_of_core;
 using detail_fft::c2r;
 using detail_fft::c2r_mut;
 using detail_fft::r2c;
@@ -987,6 +1080,11 @@ using detail_fft::r2r_genuine_fht;
 using detail_fft::dct;
 using detail_fft::dst;
 using detail_fft::convolve_axis;
+using detail_fft::tune_fft;
+using detail_fft::set_fft_autotuning;
+using detail_fft::save_fft_wisdom;
+using detail_fft::load_fft_wisdom;
+using detail_fft::forget_fft_wisdom;
 
 inline size_t good_size_complex(size_t n)
   { return detail_fft::util1d::good_size_cmplx(n); }
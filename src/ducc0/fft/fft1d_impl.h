@@ -68,12 +68,19 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <typeinfo>
 #include <typeindex>
+#include <map>
+#include <tuple>
+#include <string>
+#include <atomic>
+#include <fstream>
+#include <sstream>
 #include "ducc0/infra/useful_macros.h"
 #include "ducc0/math/cmplx.h"
 #include "ducc0/infra/error_handling.h"
 #include "ducc0/infra/aligned_array.h"
 #include "ducc0/infra/simd.h"
 #include "ducc0/infra/threading.h"
+#include "ducc0/infra/timers.h"
 #include "ducc0/math/unity_roots.h"
 #include "ducc0/fft/fft.h"
 
@@ -94,6 +101,11 @@ template<> constexpr inline size_t fft1d_simdlen<float>
   = min<size_t>(8, native_simd<float>::size());
 template<typename T> using fft1d_simd = typename simd_select<T,fft1d_simdlen<T>>::type;
 template<typename T> constexpr inline bool fft1d_simd_exists = (fft1d_simdlen<T> > 1);
+// Widest vector length accepted by the passes. Transforms vectorized over
+// several 1D FFTs use at most fft1d_simdlen, but cfftp_vecpass, which
+// vectorizes within a single transform, can profit from wider registers.
+template<typename T> constexpr inline size_t fft1d_maxsimdlen
+  = min<size_t>(2*fft1d_simdlen<T>, native_simd<T>::size());
 
 // Always use std:: for <cmath> functions
 template <typename T> T cos(T) = delete;
@@ -116,10 +128,10 @@ template<bool fwd, typename T> void ROTX90(Cmplx<T> &a)
         return fwd ? exec_<true>(in1, copy1, buf1, nthreads) \
                    : exec_<false>(in1, copy1, buf1, nthreads); \
         } \
-      if constexpr (fft1d_simdlen<Tfs> > 1) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 1) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>>::type; \
           using Tcv = Cmplx<Tfv>; \
           static const auto ticv = tidx<Tcv *>(); \
           if (ti==ticv) \
@@ -131,10 +143,10 @@ template<bool fwd, typename T> void ROTX90(Cmplx<T> &a)
                        : exec_<false>(in1, copy1, buf1, nthreads); \
             } \
           } \
-      if constexpr (fft1d_simdlen<Tfs> > 2) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>/2>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 2) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>/2>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>/2>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>/2>::type; \
           using Tcv = Cmplx<Tfv>; \
           static const auto ticv = tidx<Tcv *>(); \
           if (ti==ticv) \
@@ -146,10 +158,10 @@ template<bool fwd, typename T> void ROTX90(Cmplx<T> &a)
                        : exec_<false>(in1, copy1, buf1, nthreads); \
             } \
           } \
-      if constexpr (fft1d_simdlen<Tfs> > 4) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>/4>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 4) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>/4>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>/4>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>/4>::type; \
           using Tcv = Cmplx<Tfv>; \
           static const auto ticv = tidx<Tcv *>(); \
           if (ti==ticv) \
@@ -161,10 +173,10 @@ template<bool fwd, typename T> void ROTX90(Cmplx<T> &a)
                        : exec_<false>(in1, copy1, buf1, nthreads); \
             } \
           } \
-      if constexpr (fft1d_simdlen<Tfs> > 8) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>/8>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 8) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>/8>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>/8>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>/8>::type; \
           using Tcv = Cmplx<Tfv>; \
           static const auto ticv = tidx<Tcv *>(); \
           if (ti==ticv) \
@@ -822,6 +834,137 @@ template <typename Tfs> class cfftp8: public cfftpass<Tfs>
     POCKETFFT_EXEC_DISPATCH
   };
 
+template <typename Tfs> class cfftp16: public cfftpass<Tfs>
+  {
+  private:
+    using typename cfftpass<Tfs>::Tcs;
+
+    size_t l1, ido;
+    static constexpr size_t ip=16;
+    aligned_array<Tcs> wa;
+
+    auto WA(size_t x, size_t i) const
+      { return wa[x+(i-1)*(ip-1)]; }
+
+    // multiplication by exp(-+2*pi*i*k/16) for k=1, 2, 3, 6 and 9
+    template <bool fwd, typename T> static void ROTX(T &a, Tfs c, Tfs s)
+      {
+      if constexpr (fwd)
+        { auto tmp_=a.r; a.r=c*a.r+s*a.i; a.i=c*a.i-s*tmp_; }
+      else
+        { auto tmp_=a.r; a.r=c*a.r-s*a.i; a.i=c*a.i+s*tmp_; }
+      }
+    template <bool fwd, typename T> static void ROTX22(T &a)
+      {
+      constexpr Tfs c=Tfs(0.923879532511286756128183189396788L),
+                    s=Tfs(0.382683432365089771728459984030399L);
+      ROTX<fwd>(a, c, s);
+      }
+    template <bool fwd, typename T> static void ROTX45(T &a)
+      {
+      constexpr Tfs hsqt2=Tfs(0.707106781186547524400844362104849L);
+      ROTX<fwd>(a, hsqt2, hsqt2);
+      }
+    template <bool fwd, typename T> static void ROTX67(T &a)
+      {
+      constexpr Tfs c=Tfs(0.923879532511286756128183189396788L),
+                    s=Tfs(0.382683432365089771728459984030399L);
+      ROTX<fwd>(a, s, c);
+      }
+    template <bool fwd, typename T> static void ROTX135(T &a)
+      {
+      constexpr Tfs hsqt2=Tfs(0.707106781186547524400844362104849L);
+      ROTX<fwd>(a, -hsqt2, hsqt2);
+      }
+    template <bool fwd, typename T> static void ROTX202(T &a)
+      {
+      constexpr Tfs c=Tfs(0.923879532511286756128183189396788L),
+                    s=Tfs(0.382683432365089771728459984030399L);
+      ROTX<fwd>(a, -c, -s);
+      }
+
+    template <bool fwd, typename T> static void dft4(T &a0, T &a1, T &a2,
+      T &a3)
+      {
+      T t1, t2, t3, t4;
+      PM(t2,t1,a0,a2);
+      PM(t3,t4,a1,a3);
+      ROTX90<fwd>(t4);
+      PM(a0,a2,t2,t3);
+      PM(a1,a3,t1,t4);
+      }
+
+    // in-place length-16 DFT, decomposed as 4x4 with internal twiddles;
+    // output j1+4*j2 ends up in x(4*j1+j2)
+    template <bool fwd, typename T> static void dft16(T &x0, T &x1, T &x2,
+      T &x3, T &x4, T &x5, T &x6, T &x7, T &x8, T &x9, T &x10, T &x11,
+      T &x12, T &x13, T &x14, T &x15)
+      {
+      dft4<fwd>(x0, x4, x8, x12);
+      dft4<fwd>(x1, x5, x9, x13);
+      dft4<fwd>(x2, x6, x10, x14);
+      dft4<fwd>(x3, x7, x11, x15);
+      ROTX22<fwd>(x5); ROTX45<fwd>(x9); ROTX67<fwd>(x13);
+      ROTX45<fwd>(x6); ROTX90<fwd>(x10); ROTX135<fwd>(x14);
+      ROTX67<fwd>(x7); ROTX135<fwd>(x11); ROTX202<fwd>(x15);
+      dft4<fwd>(x0, x1, x2, x3);
+      dft4<fwd>(x4, x5, x6, x7);
+      dft4<fwd>(x8, x9, x10, x11);
+      dft4<fwd>(x12, x13, x14, x15);
+      }
+
+    template<bool fwd, typename Tcd> Tcd *exec_
+      (const Tcd * DUCC0_RESTRICT cc, Tcd * DUCC0_RESTRICT ch, Tcd * /*buf*/,
+      size_t /*nthreads*/) const
+      {
+      auto CH = [ch,this](size_t a, size_t b, size_t c) -> Tcd&
+        { return ch[a+ido*(b+l1*c)]; };
+      auto CC = [cc,this](size_t a, size_t b, size_t c) -> const Tcd&
+        { return cc[a+ido*(b+ip*c)]; };
+      for (size_t k=0; k<l1; ++k)
+        for (size_t i=0; i<ido; ++i)
+          {
+          Tcd x0=CC(i,0,k), x1=CC(i,1,k), x2=CC(i,2,k), x3=CC(i,3,k),
+              x4=CC(i,4,k), x5=CC(i,5,k), x6=CC(i,6,k), x7=CC(i,7,k),
+              x8=CC(i,8,k), x9=CC(i,9,k), x10=CC(i,10,k), x11=CC(i,11,k),
+              x12=CC(i,12,k), x13=CC(i,13,k), x14=CC(i,14,k),
+              x15=CC(i,15,k);
+          dft16<fwd>(x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12,
+            x13, x14, x15);
+          CH(i,k,0) = x0;
+          auto put = [&](size_t j, const Tcd &v)
+            {
+            if (i==0)
+              CH(0,k,j) = v;
+            else
+              special_mul<fwd>(v,WA(j-1,i),CH(i,k,j));
+            };
+          put( 1, x4); put( 2, x8); put( 3,x12); put( 4, x1);
+          put( 5, x5); put( 6, x9); put( 7,x13); put( 8, x2);
+          put( 9, x6); put(10,x10); put(11,x14); put(12, x3);
+          put(13, x7); put(14,x11); put(15,x15);
+          }
+      return ch;
+      }
+
+  public:
+    cfftp16(size_t l1_, size_t ido_, const Troots<Tfs> &roots)
+      : l1(l1_), ido(ido_), wa((ip-1)*(ido-1))
+      {
+      size_t N=ip*l1*ido;
+      auto rfct = roots->size()/N;
+      MR_assert(roots->size()==N*rfct, "mismatch");
+      for (size_t i=1; i<ido; ++i)
+        for (size_t j=1; j<ip; ++j)
+          wa[(j-1)+(i-1)*(ip-1)] = (*roots)[rfct*j*l1*i];
+      }
+
+    virtual size_t bufsize() const { return 0; }
+    virtual bool needs_copy() const { return true; }
+
+    POCKETFFT_EXEC_DISPATCH
+  };
+
 template <typename Tfs> class cfftp11: public cfftpass<Tfs>
   {
   private:
@@ -1590,8 +1733,28 @@ MR_fail("must not get here");
       }
 
   public:
+    // splits ip into two factors of similar size
+    static vector<size_t> packets(size_t ip)
+      {
+      vector<size_t> res(2,1);
+      auto factors = util1d::prime_factors(ip);
+      sort(factors.begin(), factors.end(), std::greater<size_t>());
+      for (auto fct: factors)
+        (res[0]>res[1]) ? res[1]*=fct : res[0]*=fct;
+      return res;
+      }
+
     cfft_multipass(size_t l1_, size_t ido_, size_t ip_,
       const Troots<Tfs> &roots, bool /*vectorize*/=false)
+      // FIXME TBD
+      // do we need the vectorize flag at all?
+      : cfft_multipass(l1_, ido_, ip_, roots,
+          (ip_<=10000) ? cfftpass<Tfs>::factorize(ip_) : packets(ip_)) {}
+
+    // uses the passes in "factors" (in this order) instead of the default
+    // decomposition
+    cfft_multipass(size_t l1_, size_t ido_, size_t ip_,
+      const Troots<Tfs> &roots, const vector<size_t> &factors)
       : l1(l1_), ido(ido_), ip(ip_), bufsz(0), need_cpy(false),
         myroots(roots)
       {
@@ -1599,33 +1762,17 @@ MR_fail("must not get here");
       rfct = roots->size()/N;
       MR_assert(roots->size()==N*rfct, "mismatch");
 
-      // FIXME TBD
-// do we need the vectorize flag at all?
-      size_t lim = 10000; //vectorize ? 10000 : 10000;
-      if (ip<=lim)
+      size_t l1l=1;
+      for (auto fct: factors)
         {
-        auto factors = cfftpass<Tfs>::factorize(ip);
-        size_t l1l=1;
-        for (auto fct: factors)
-          {
+        // radix-16 passes are only used on request (fft_strategy::radix16)
+        if (fct==16)
+          passes.push_back(make_shared<cfftp16<Tfs>>(l1l, ip/(fct*l1l), roots));
+        else
           passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots, false));
-          l1l*=fct;
-          }
-        }
-      else
-        {
-        vector<size_t> packets(2,1);
-        auto factors = util1d::prime_factors(ip);
-        sort(factors.begin(), factors.end(), std::greater<size_t>());
-        for (auto fct: factors)
-          (packets[0]>packets[1]) ? packets[1]*=fct : packets[0]*=fct;
-        size_t l1l=1;
-        for (auto pkt: packets)
-          {
-          passes.push_back(cfftpass<Tfs>::make_pass(l1l, ip/(pkt*l1l), pkt, roots, false));
-          l1l*=pkt;
-          }
+        l1l*=fct;
         }
+      MR_assert(l1l==ip, "bad factorization");
       for (const auto &pass: passes)
         {
         bufsz = max(bufsz, pass->bufsize());
@@ -1701,9 +1848,18 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
       return cc;
       }
 
+    // 16 lanes are only used on request (fft_strategy::widevec)
+    static Tcpass<Tfs> make_spass(size_t ip, const Troots<Tfs> &roots)
+      {
+      if constexpr (vlen==16)
+        return make_shared<cfftp16<Tfs>>(1, ip/vlen, roots);
+      else
+        return cfftpass<Tfs>::make_pass(1, ip/vlen, vlen, roots);
+      }
+
   public:
     cfftp_vecpass(size_t ip_, const Troots<Tfs> &roots)
-      : ip(ip_), spass(cfftpass<Tfs>::make_pass(1, ip/vlen, vlen, roots)),
+      : ip(ip_), spass(make_spass(ip_, roots)),
         vpass(cfftpass<Tfs>::make_pass(1, 1, ip/vlen, roots)), bufsz(0)
       {
       MR_assert((ip/vlen)*vlen==ip, "cannot vectorize this size");
@@ -1727,6 +1883,155 @@ template <size_t vlen, typename Tfs> class cfftp_vecpass: public cfftpass<Tfs>
       }
   };
 
+/// Complex FFT of the compile-time length \a N, used for large batches of
+/// very short transforms.
+/** The transform is decomposed recursively (decimation in time) into
+ *  radix-4, 2, 3 and 5 butterflies, so only lengths of the form
+ *  2^a*3^b*5^c are supported. exec() reads its input from \a in with a
+ *  stride of \a S and writes to the contiguous array \a out.
+ *  \a tw[k*R] must hold exp(-+2*pi*i*k/N), with the sign given by \a fwd. */
+template<size_t N, bool fwd, size_t S=1, size_t R=1> struct small_cfft
+  {
+  static constexpr size_t radix()
+    { return (N%4==0) ? 4 : ((N%2==0) ? 2 : ((N%3==0) ? 3 : 5)); }
+  static constexpr bool supported()
+    {
+    if constexpr (N<=5) return N>=2;
+    else
+      return (N%radix()==0) && small_cfft<N/radix(), fwd>::supported();
+    }
+
+  template<typename T, typename Tw> DUCC0_NOINLINE static void exec
+    (const Cmplx<T> * DUCC0_RESTRICT in, Cmplx<T> * DUCC0_RESTRICT out,
+    const Cmplx<Tw> * DUCC0_RESTRICT tw)
+    { pass(in, out, tw); }
+
+  template<typename T, typename Tw> static inline void pass
+    (const Cmplx<T> * DUCC0_RESTRICT in, Cmplx<T> * DUCC0_RESTRICT out,
+    const Cmplx<Tw> * DUCC0_RESTRICT tw)
+    {
+    static_assert(supported(), "unsupported length");
+    constexpr size_t ip=radix(), M=N/ip;
+    if constexpr (M==1)
+      {
+      if constexpr (ip==2)
+        bfly2(in[0], in[S], out[0], out[1]);
+      else if constexpr (ip==3)
+        bfly3(in[0], in[S], in[2*S], out[0], out[1], out[2], tw[R]);
+      else if constexpr (ip==4)
+        bfly4(in[0], in[S], in[2*S], in[3*S], out[0], out[1], out[2], out[3]);
+      else
+        bfly5(in[0], in[S], in[2*S], in[3*S], in[4*S],
+              out[0], out[1], out[2], out[3], out[4], tw[R], tw[2*R]);
+      }
+    else
+      {
+      for (size_t j=0; j<ip; ++j)
+        small_cfft<M, fwd, S*ip, R*ip>::pass(in+j*S, out+j*M, tw);
+      // the first butterfly does not need twiddle factors
+      if constexpr (ip==2)
+        bfly2(out[0], out[M], out[0], out[M]);
+      else if constexpr (ip==3)
+        bfly3(out[0], out[M], out[2*M], out[0], out[M], out[2*M], tw[M*R]);
+      else if constexpr (ip==4)
+        bfly4(out[0], out[M], out[2*M], out[3*M],
+              out[0], out[M], out[2*M], out[3*M]);
+      else
+        bfly5(out[0], out[M], out[2*M], out[3*M], out[4*M],
+              out[0], out[M], out[2*M], out[3*M], out[4*M],
+              tw[M*R], tw[2*M*R]);
+      for (size_t k=1; k<M; ++k)
+        {
+        auto o = out+k;
+        if constexpr (ip==2)
+          bfly2(o[0], o[M]*tw[k*R], o[0], o[M]);
+        else if constexpr (ip==3)
+          bfly3(o[0], o[M]*tw[k*R], o[2*M]*tw[2*k*R],
+                o[0], o[M], o[2*M], tw[M*R]);
+        else if constexpr (ip==4)
+          bfly4(o[0], o[M]*tw[k*R], o[2*M]*tw[2*k*R], o[3*M]*tw[3*k*R],
+                o[0], o[M], o[2*M], o[3*M]);
+        else
+          bfly5(o[0], o[M]*tw[k*R], o[2*M]*tw[2*k*R], o[3*M]*tw[3*k*R],
+                o[4*M]*tw[4*k*R], o[0], o[M], o[2*M], o[3*M], o[4*M],
+                tw[M*R], tw[2*M*R]);
+        }
+      }
+    }
+
+  // The butterflies take their inputs by value, so they can work in place.
+  // w, w1 and w2 are the first (and second) p-th roots of unity.
+  template<typename T> static inline void bfly2(Cmplx<T> a0, Cmplx<T> a1,
+    Cmplx<T> &b0, Cmplx<T> &b1)
+    { PM(b0, b1, a0, a1); }
+  template<typename T, typename Tw> static inline void bfly3(Cmplx<T> a0,
+    Cmplx<T> a1, Cmplx<T> a2, Cmplx<T> &b0, Cmplx<T> &b1, Cmplx<T> &b2,
+    const Cmplx<Tw> &w)
+    {
+    auto s = a1+a2, d = (a1-a2)*w.i;
+    auto c = a0+s*w.r;
+    b0 = a0+s;
+    b1 = Cmplx<T>(c.r-d.i, c.i+d.r);
+    b2 = Cmplx<T>(c.r+d.i, c.i-d.r);
+    }
+  template<typename T> static inline void bfly4(Cmplx<T> a0, Cmplx<T> a1,
+    Cmplx<T> a2, Cmplx<T> a3,
+    Cmplx<T> &b0, Cmplx<T> &b1, Cmplx<T> &b2, Cmplx<T> &b3)
+    {
+    Cmplx<T> t0, t1, t2, t3;
+    PM(t0, t1, a0, a2);
+    PM(t2, t3, a1, a3);
+    ROTX90<fwd>(t3);
+    PM(b0, b2, t0, t2);
+    PM(b1, b3, t1, t3);
+    }
+  template<typename T, typename Tw> static inline void bfly5(Cmplx<T> a0,
+    Cmplx<T> a1, Cmplx<T> a2, Cmplx<T> a3, Cmplx<T> a4,
+    Cmplx<T> &b0, Cmplx<T> &b1, Cmplx<T> &b2, Cmplx<T> &b3, Cmplx<T> &b4,
+    const Cmplx<Tw> &w1, const Cmplx<Tw> &w2)
+    {
+    auto s1 = a1+a4, d1 = a1-a4, s2 = a2+a3, d2 = a2-a3;
+    auto c1 = a0+s1*w1.r+s2*w2.r, c2 = a0+s1*w2.r+s2*w1.r;
+    auto e1 = d1*w1.i+d2*w2.i, e2 = d1*w2.i-d2*w1.i;
+    b0 = a0+s1+s2;
+    b1 = Cmplx<T>(c1.r-e1.i, c1.i+e1.r);
+    b4 = Cmplx<T>(c1.r+e1.i, c1.i-e1.r);
+    b2 = Cmplx<T>(c2.r-e2.i, c2.i+e2.r);
+    b3 = Cmplx<T>(c2.r+e2.i, c2.i-e2.r);
+    }
+  };
+
+/* Returns the widest vector length (at least 4) for a cfftp_vecpass of
+   length ip, which divides ip and whose registers are not wider than
+   maxbytes and supported by the CPU; returns 0 if there is none. */
+template<size_t vlen, typename Tfs> size_t cfft_vecpass_len(size_t ip,
+  size_t maxbytes)
+  {
+  if constexpr (vlen<4)
+    return 0;
+  else
+    {
+    if constexpr(simd_exists<Tfs,vlen>)
+      if (((ip%vlen)==0) && (vlen*sizeof(Tfs)<=maxbytes)
+        && (vlen*sizeof(Tfs)<=simd_cpu_features().max_vector_bytes))
+        return vlen;
+    return cfft_vecpass_len<vlen/2,Tfs>(ip, maxbytes);
+    }
+  }
+template<size_t vlen, typename Tfs> Tcpass<Tfs> make_cfft_vecpass(size_t ip,
+  const Troots<Tfs> &roots, size_t len)
+  {
+  if constexpr (vlen<4)
+    return nullptr;
+  else
+    {
+    if constexpr(simd_exists<Tfs,vlen>)
+      if (len==vlen)
+        return make_shared<cfftp_vecpass<vlen,Tfs>>(ip, roots);
+    return make_cfft_vecpass<vlen/2,Tfs>(ip, roots, len);
+    }
+  }
+
 template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
   size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
   {
@@ -1734,12 +2039,12 @@ template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
   // do we have an 1D vectorizable FFT?
   if (vectorize && (ip>300)&& (ip<=100000) && (l1==1) && (ido==1))
     {
-//    constexpr auto vlen = native_simd<Tfs>::size();
-//    if constexpr(vlen>=4)
-    constexpr auto vlen = 4;
-    if constexpr(simd_exists<Tfs,vlen>)
-      if ((ip&(vlen-1))==0)
-        return make_shared<cfftp_vecpass<vlen,Tfs>>(ip, roots);
+    // More than 8 lanes would require radix-16 scalar passes, which are
+    // not faster on the hardware we measured; fft_strategy::widevec can
+    // select them via tuning.
+    constexpr auto maxlen = min<size_t>(fft1d_maxsimdlen<Tfs>, 8);
+    auto vlen = cfft_vecpass_len<maxlen,Tfs>(ip, ~size_t(0));
+    if (vlen>0) return make_cfft_vecpass<maxlen,Tfs>(ip, roots, vlen);
     }
 
   if (ip==1) return make_shared<cfftp1<Tfs>>();
@@ -1786,10 +2091,10 @@ template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
         return fwd ? exec_<true>(in1, copy1, buf1, nthreads) \
                    : exec_<false>(in1, copy1, buf1, nthreads); \
         } \
-      if constexpr (fft1d_simdlen<Tfs> > 1) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 1) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>>::type; \
           static const auto tifv=tidx<Tfv *>(); \
           if (ti==tifv) \
             {  \
@@ -1800,10 +2105,10 @@ template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
                        : exec_<false>(in1, copy1, buf1, nthreads); \
             } \
           } \
-      if constexpr (fft1d_simdlen<Tfs> > 2) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>/2>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 2) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>/2>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>/2>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>/2>::type; \
           static const auto tifv=tidx<Tfv *>(); \
           if (ti==tifv) \
             {  \
@@ -1814,10 +2119,10 @@ template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
                        : exec_<false>(in1, copy1, buf1, nthreads); \
             } \
           } \
-      if constexpr (fft1d_simdlen<Tfs> > 4) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>/4>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 4) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>/4>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>/4>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>/4>::type; \
           static const auto tifv=tidx<Tfv *>(); \
           if (ti==tifv) \
             {  \
@@ -1828,10 +2133,10 @@ template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_pass(size_t l1,
                        : exec_<false>(in1, copy1, buf1, nthreads); \
             } \
           } \
-      if constexpr (fft1d_simdlen<Tfs> > 8) \
-        if constexpr (simd_exists<Tfs, fft1d_simdlen<Tfs>/8>) \
+      if constexpr (fft1d_maxsimdlen<Tfs> > 8) \
+        if constexpr (simd_exists<Tfs, fft1d_maxsimdlen<Tfs>/8>) \
           { \
-          using Tfv = typename simd_select<Tfs, fft1d_simdlen<Tfs>/8>::type; \
+          using Tfv = typename simd_select<Tfs, fft1d_maxsimdlen<Tfs>/8>::type; \
           static const auto tifv=tidx<Tfv *>(); \
           if (ti==tifv) \
             {  \
@@ -2829,6 +3134,12 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
   public:
     rfft_multipass(size_t l1_, size_t ido_, size_t ip_,
       const Troots<Tfs> &roots, bool /*vectorize*/=false)
+      : rfft_multipass(l1_, ido_, ip_, roots, rfftpass<Tfs>::factorize(ip_)) {}
+
+    // uses the passes in "factors" (in this order) instead of the default
+    // decomposition
+    rfft_multipass(size_t l1_, size_t ido_, size_t ip_,
+      const Troots<Tfs> &roots, const vector<size_t> &factors)
       : l1(l1_), ido(ido_), ip(ip_), bufsz(0), need_cpy(false),
         wa((ip-1)*(ido-1))
       {
@@ -2843,14 +3154,13 @@ template <typename Tfs> class rfft_multipass: public rfftpass<Tfs>
           wa[(j-1)*(ido-1)+2*i-1] = val.i;
           }
 
-      auto factors = rfftpass<Tfs>::factorize(ip);
-
       size_t l1l=1;
       for (auto fct: factors)
         {
         passes.push_back(rfftpass<Tfs>::make_pass(l1l, ip/(fct*l1l), fct, roots));
         l1l*=fct;
         }
+      MR_assert(l1l==ip, "bad factorization");
       for (const auto &pass: passes)
         {
         bufsz = max(bufsz, pass->bufsize());
@@ -2942,25 +3252,27 @@ template <typename Tfs> class rfftp_complexify: public rfftpass<Tfs>
   };
 #undef POCKETFFT_EXEC_DISPATCH
 
+template<typename Tfs> bool rfftpass<Tfs>::use_complexify(size_t ip,
+  bool vectorize)
+  {
+  if ((ip<=1000) || ((ip&1)!=0)) return false;
+  // use complex transform
+  if (vectorize&&((ip&7)==0)) return true;  // vecpass might be beneficial
+  if (ip>10000) return true;  // complex multipass might be beneficial
+  auto factors = rfftpass<Tfs>::factorize(ip);
+  for (auto factor: factors)
+    // complex Bluestein or larger prime factor functions might be beneficial
+    if (factor>5) return true;
+  return false;
+  }
+
 template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_pass(size_t l1,
   size_t ido, size_t ip, const Troots<Tfs> &roots, bool vectorize)
   {
   MR_assert(ip>=1, "no zero-sized FFTs");
   if (ip==1) return make_shared<rfftp1<Tfs>>();
-  if ((ip>1000) && ((ip&1)==0))  // use complex transform
-    {
-    bool doit = vectorize&&((ip&7)==0);  // vecpass might be beneficial
-    doit |= ip>10000;  // complex multipass might be beneficial
-    if (!doit)
-      {
-      auto factors = rfftpass<Tfs>::factorize(ip);
-      for (auto factor: factors)
-        // complex Bluestein or larger prime factor functions might be beneficial
-        if (factor>5) { doit=true; break; }
-      }
-    if (doit)
-      return make_shared<rfftp_complexify<Tfs>>(ip, roots, vectorize);
-    }
+  if (use_complexify(ip, vectorize))
+    return make_shared<rfftp_complexify<Tfs>>(ip, roots, vectorize);
   auto factors=rfftpass<Tfs>::factorize(ip);
   if (factors.size()==1)
     {
@@ -2985,6 +3297,374 @@ template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_pass(size_t l1,
     return make_shared<rfft_multipass<Tfs>>(l1, ido, ip, roots, vectorize);
   }
 
+//
+// FFT wisdom: measured choice of the top-level pass decomposition
+//
+
+/// Alternative decompositions of a 1D FFT that can be selected by tuning.
+struct fft_strategy
+  {
+  static constexpr size_t
+    heuristic = 0,  // whatever make_pass() picks
+    novec = 1,      // c: no intra-transform vectorization (cfftp_vecpass)
+    radix4 = 2,     // c: powers of 2 as radix-4 passes instead of radix-8
+    reversed = 3,   // c, r: default factors in reverse order
+    packets = 4,    // c: two passes of similar length
+    bluestein = 5,  // c: Bluestein's algorithm
+    complexify = 6, // r: complex FFT of half length
+    realpasses = 7, // r: real-valued passes only
+    viacomplex = 8, // r: complex FFT of full length (odd lengths)
+    narrowvec = 9,  // c: cfftp_vecpass with at most 256-bit registers
+    widevec = 10,   // c: cfftp_vecpass with the widest supported registers
+    radix16 = 11,   // c: powers of 2 as radix-16 passes instead of radix-8
+    nstrategies = 12;
+
+  static const char *name(size_t strategy)
+    {
+    static const char *names[nstrategies] = { "heuristic", "novec", "radix4",
+      "reversed", "packets", "bluestein", "complexify", "realpasses",
+      "viacomplex", "narrowvec", "widevec", "radix16" };
+    MR_assert(strategy<nstrategies, "bad FFT strategy");
+    return names[strategy];
+    }
+  static size_t from_name(const string &nm)
+    {
+    for (size_t i=0; i<nstrategies; ++i)
+      if (nm==name(i)) return i;
+    MR_fail("unknown FFT strategy '", nm, "'");
+    }
+  };
+
+template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_strategy_pass(size_t ip,
+  size_t strategy, bool vectorize)
+  {
+  MR_assert(ip>=1, "no zero-sized FFTs");
+  auto roots = make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip);
+  switch(strategy)
+    {
+    case fft_strategy::heuristic:
+      return make_pass(1, 1, ip, roots, vectorize);
+    case fft_strategy::novec:
+      if ((!vectorize) || (ip<=300) || (ip>100000) || ((ip&3)!=0))
+        return nullptr;
+      return make_pass(1, 1, ip, roots, false);
+    case fft_strategy::narrowvec:
+    case fft_strategy::widevec:
+      {
+      if ((!vectorize) || (ip<=300) || (ip>100000)) return nullptr;
+      constexpr auto maxlen = fft1d_maxsimdlen<Tfs>;
+      // vector length chosen by make_pass()
+      auto vdef = cfft_vecpass_len<min<size_t>(maxlen,8),Tfs>(ip, ~size_t(0));
+      auto vlen = (strategy==fft_strategy::narrowvec) ?
+        cfft_vecpass_len<maxlen,Tfs>(ip, 32) :
+        cfft_vecpass_len<maxlen,Tfs>(ip, ~size_t(0));
+      // only useful if different from the default
+      if ((vlen==0) || (vlen==vdef)) return nullptr;
+      return make_cfft_vecpass<maxlen,Tfs>(ip, roots, vlen);
+      }
+    case fft_strategy::radix4:
+      {
+      if ((ip&7)!=0) return nullptr;
+      // rfftpass::factorize() does not produce radix-8 passes
+      auto factors = rfftpass<Tfs>::factorize(ip);
+      return make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots, factors);
+      }
+    case fft_strategy::radix16:
+      {
+      if ((ip&15)!=0) return nullptr;
+      size_t n2=0, rest=ip;
+      for (; (rest&1)==0; rest>>=1) ++n2;
+      // the leftover power of 2 comes first, as in factorize()
+      vector<size_t> factors;
+      if ((n2&3)!=0) factors.push_back(size_t(1)<<(n2&3));
+      factors.insert(factors.end(), n2>>2, 16);
+      if (rest>1)
+        {
+        auto odd = factorize(rest);
+        factors.insert(factors.end(), odd.begin(), odd.end());
+        }
+      return make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots, factors);
+      }
+    case fft_strategy::reversed:
+      {
+      auto factors = factorize(ip);
+      auto rfactors = factors;
+      reverse(rfactors.begin(), rfactors.end());
+      if ((ip<=10000) && (rfactors==factors)) return nullptr;
+      return make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots, rfactors);
+      }
+    case fft_strategy::packets:
+      if ((ip>10000) || (util1d::prime_factors(ip).size()<2)) return nullptr;
+      return make_shared<cfft_multipass<Tfs>>(1, 1, ip, roots,
+        cfft_multipass<Tfs>::packets(ip));
+    case fft_strategy::bluestein:
+      if (ip<8) return nullptr;
+      return make_shared<cfftpblue<Tfs>>(1, 1, ip, roots, vectorize);
+    default:
+      return nullptr;
+    }
+  }
+
+template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_strategy_pass(size_t ip,
+  size_t strategy, bool vectorize)
+  {
+  MR_assert(ip>=1, "no zero-sized FFTs");
+  auto roots = make_shared<UnityRoots<Tfs,Cmplx<Tfs>>>(ip);
+  switch(strategy)
+    {
+    case fft_strategy::heuristic:
+      return make_pass(1, 1, ip, roots, vectorize);
+    case fft_strategy::reversed:
+      {
+      if (use_complexify(ip, vectorize)) return nullptr;
+      // passes with odd factors require an odd ido, so the even factors
+      // must stay in front of the odd ones
+      auto factors = factorize(ip);
+      auto rfactors = factors;
+      auto firstodd = find_if(rfactors.begin(), rfactors.end(),
+        [](size_t f) { return (f&1)!=0; });
+      reverse(rfactors.begin(), firstodd);
+      reverse(firstodd, rfactors.end());
+      if (rfactors==factors) return nullptr;
+      return make_shared<rfft_multipass<Tfs>>(1, 1, ip, roots, rfactors);
+      }
+    case fft_strategy::complexify:
+      if ((ip<16) || ((ip&1)!=0) || use_complexify(ip, vectorize))
+        return nullptr;
+      return make_shared<rfftp_complexify<Tfs>>(ip, roots, vectorize);
+    case fft_strategy::realpasses:
+      // if complexify is the default, ip is even and larger than 1000,
+      // so there are always several factors
+      if (!use_complexify(ip, vectorize)) return nullptr;
+      return make_shared<rfft_multipass<Tfs>>(1, 1, ip, roots, factorize(ip));
+    case fft_strategy::viacomplex:
+      if ((ip<8) || ((ip&1)==0) || ((ip>=135) && (factorize(ip).size()==1)))
+        return nullptr;
+      return make_shared<rfftpblue<Tfs>>(1, 1, ip, roots, vectorize);
+    default:
+      return nullptr;
+    }
+  }
+
+class fft_wisdom
+  {
+  private:
+    // (real, sizeof(Tfs), length, vectorize)
+    using Tkey = tuple<bool, size_t, size_t, bool>;
+
+    mutable Mutex mut;
+    map<Tkey, size_t> entries;
+    atomic<size_t> gen{0};
+    atomic<bool> autotune{false};
+
+    fft_wisdom() {}
+
+  public:
+    static fft_wisdom &get()
+      {
+      static fft_wisdom wisdom;
+      return wisdom;
+      }
+
+    /// Is incremented whenever the stored wisdom changes, so that plan caches
+    /// can detect stale entries.
+    size_t generation() const { return gen; }
+
+    bool autotuning() const { return autotune; }
+    void set_autotuning(bool on) { autotune = on; }
+
+    bool lookup(bool real, size_t prec, size_t len, bool vectorize,
+      size_t &strategy) const
+      {
+      LockGuard lock(mut);
+      auto it = entries.find(Tkey(real, prec, len, vectorize));
+      if (it==entries.end()) return false;
+      strategy = it->second;
+      return true;
+      }
+    void set(bool real, size_t prec, size_t len, bool vectorize, size_t strategy)
+      {
+      MR_assert(strategy<fft_strategy::nstrategies, "bad FFT strategy");
+      {
+      LockGuard lock(mut);
+      entries[Tkey(real, prec, len, vectorize)] = strategy;
+      }
+      ++gen;
+      }
+    void clear()
+      {
+      {
+      LockGuard lock(mut);
+      entries.clear();
+      }
+      ++gen;
+      }
+
+    void save(const string &fname) const
+      {
+      ofstream out(fname);
+      MR_assert(out, "could not open '", fname, "' for writing");
+      out << "# ducc0 FFT wisdom\n"
+             "# kind (c/r) | precision (bytes) | length | vectorize | strategy\n";
+      LockGuard lock(mut);
+      for (const auto &[key, strategy]: entries)
+        out << (std::get<0>(key) ? 'r' : 'c') << ' ' << std::get<1>(key) << ' '
+            << std::get<2>(key) << ' ' << int(std::get<3>(key)) << ' '
+            << fft_strategy::name(strategy) << '\n';
+      MR_assert(out, "error while writing '", fname, "'");
+      }
+    /// Adds the entries in \a fname to the wisdom, overriding existing
+    /// entries for the same transforms.
+    void load(const string &fname)
+      {
+      ifstream in(fname);
+      MR_assert(in, "could not open '", fname, "' for reading");
+      map<Tkey, size_t> tmp;
+      string line;
+      while (getline(in, line))
+        {
+        if (line.empty() || (line[0]=='#')) continue;
+        istringstream is(line);
+        char kind;
+        size_t prec, len;
+        int vectorize;
+        string strategy;
+        is >> kind >> prec >> len >> vectorize >> strategy;
+        MR_assert(is && ((kind=='c') || (kind=='r')) && (len>0),
+          "malformed FFT wisdom entry: '", line, "'");
+        tmp[Tkey(kind=='r', prec, len, vectorize!=0)]
+          = fft_strategy::from_name(strategy);
+        }
+      {
+      LockGuard lock(mut);
+      for (const auto &[key, strategy]: tmp)
+        entries[key] = strategy;
+      }
+      ++gen;
+      }
+  };
+
+// Runs "pass" repeatedly on data of type T and returns the best time per call.
+template<typename T, typename Tpass> double fft_time_pass(const Tpass &pass,
+  size_t len, const T &val)
+  {
+  static const auto ti = tidx<T *>();
+  aligned_array<T> orig(len), data(len), copy(len), buf(pass.bufsize());
+  for (size_t i=0; i<len; ++i)
+    orig[i] = val;
+  auto run = [&](size_t nrep)
+    {
+    for (size_t i=0; i<nrep; ++i)
+      {
+      // start from fresh data to avoid overflows in float transforms
+      copy_n(orig.data(), len, data.data());
+      pass.exec(ti, data.data(), copy.data(), buf.data(), (i&1)==0, 1);
+      }
+    };
+  run(1);  // warm-up
+  size_t nrep=1;
+  SimpleTimer timer;
+  run(nrep);
+  while (timer()<1e-3)
+    {
+    nrep*=2;
+    timer.reset();
+    run(nrep);
+    }
+  double best = timer()/double(nrep);
+  for (size_t i=0; i<4; ++i)
+    {
+    timer.reset();
+    run(nrep);
+    best = min(best, timer()/double(nrep));
+    }
+  return best;
+  }
+
+// Times all applicable strategies for the given transform, stores the fastest
+// one in the FFT wisdom and returns it.
+template<typename Tfs> size_t tune_pass(bool real, size_t len, bool vectorize)
+  {
+  size_t best_strategy = fft_strategy::heuristic;
+  double best_time = 1e300;
+  for (size_t strategy=0; strategy<fft_strategy::nstrategies; ++strategy)
+    {
+    double t=0;
+    if (real)
+      {
+      auto pass = rfftpass<Tfs>::make_strategy_pass(len, strategy, vectorize);
+      if (!pass) continue;
+      // plans without intra-transform vectorization are mostly used on
+      // SIMD vectors of data by the multi-dimensional transforms
+      if constexpr (fft1d_simd_exists<Tfs>)
+        t = vectorize ? fft_time_pass(*pass, len, Tfs(1))
+                      : fft_time_pass(*pass, len, fft1d_simd<Tfs>(Tfs(1)));
+      else
+        t = fft_time_pass(*pass, len, Tfs(1));
+      }
+    else
+      {
+      auto pass = cfftpass<Tfs>::make_strategy_pass(len, strategy, vectorize);
+      if (!pass) continue;
+      if constexpr (fft1d_simd_exists<Tfs>)
+        t = vectorize ? fft_time_pass(*pass, len, Cmplx<Tfs>(Tfs(1), Tfs(0)))
+                      : fft_time_pass(*pass, len,
+                        Cmplx<fft1d_simd<Tfs>>(Tfs(1), Tfs(0)));
+      else
+        t = fft_time_pass(*pass, len, Cmplx<Tfs>(Tfs(1), Tfs(0)));
+      }
+    if (t<best_time)
+      { best_time=t; best_strategy=strategy; }
+    }
+  fft_wisdom::get().set(real, sizeof(Tfs), len, vectorize, best_strategy);
+  return best_strategy;
+  }
+
+template<typename Tfs> Tcpass<Tfs> cfftpass<Tfs>::make_tuned_pass(size_t ip,
+  bool vectorize)
+  {
+  auto &wisdom(fft_wisdom::get());
+  size_t strategy;
+  if (!wisdom.lookup(false, sizeof(Tfs), ip, vectorize, strategy))
+    {
+    if (!wisdom.autotuning()) return make_pass(ip, vectorize);
+    strategy = tune_pass<Tfs>(false, ip, vectorize);
+    }
+  auto pass = make_strategy_pass(ip, strategy, vectorize);
+  return pass ? pass : make_pass(ip, vectorize);
+  }
+
+template<typename Tfs> Trpass<Tfs> rfftpass<Tfs>::make_tuned_pass(size_t ip,
+  bool vectorize)
+  {
+  auto &wisdom(fft_wisdom::get());
+  size_t strategy;
+  if (!wisdom.lookup(true, sizeof(Tfs), ip, vectorize, strategy))
+    {
+    if (!wisdom.autotuning()) return make_pass(ip, vectorize);
+    strategy = tune_pass<Tfs>(true, ip, vectorize);
+    }
+  auto pass = make_strategy_pass(ip, strategy, vectorize);
+  return pass ? pass : make_pass(ip, vectorize);
+  }
+
+template<typename T> void tune_fft(size_t len)
+  {
+  MR_assert(len>0, "need a positive length");
+  for (bool real: {false, true})
+    for (bool vectorize: {false, true})
+      tune_pass<T>(real, len, vectorize);
+  }
+
+inline void set_fft_autotuning(bool on)
+  { fft_wisdom::get().set_autotuning(on); }
+inline void save_fft_wisdom(const string &fname)
+  { fft_wisdom::get().save(fname); }
+inline void load_fft_wisdom(const string &fname)
+  { fft_wisdom::get().load(fname); }
+inline void forget_fft_wisdom()
+  { fft_wisdom::get().clear(); }
+
 }}
 
 #endif
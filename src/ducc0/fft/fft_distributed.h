@@ -0,0 +1,304 @@
+/*
+This file is part of the ducc FFT library
+
+Copyright (C) 2023 Max-Planck-Society
+
+Author: Martin Reinecke
+*/
+
+/* SPDX-License-Identifier: BSD-3-Clause OR GPL-2.0-or-later */
+
+/*
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its contributors may
+  be used to endorse or promote products derived from this software without
+  specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/** \file fft_distributed.h
+ *  Multi-dimensional FFTs of arrays which are distributed over several tasks.
+ *
+ *  The local parts of the transforms are carried out by c2c(), r2c() and
+ *  c2r(), the global transpositions by Communicator::redistribute().
+ *  Without DUCC0_USE_MPI, Communicator describes a single task, and all
+ *  functions below reduce to the corresponding local transforms.
+ *
+ *  Two decompositions are supported:
+ *  - <b>slab</b>: in the standard layout, axis 0 is distributed over the
+ *    tasks of a communicator, all other axes are local. In the transposed
+ *    layout, axis 1 is distributed and all other axes are local.
+ *  - <b>pencil</b>: in the standard layout, axis 0 is distributed over
+ *    \a comm0, axis 1 over \a comm1, and all other axes are local. In the
+ *    transposed layout, axis 1 is distributed over \a comm0, axis 2 over
+ *    \a comm1, and all other axes are local.
+ *
+ *  Transforms starting from the standard layout produce the transposed one
+ *  and vice versa; this saves one global transposition per call.
+ *  The split of distributed axes among the tasks is taken from the shapes
+ *  of the local input and output arrays, which may be chosen freely as long
+ *  as they are consistent; dist_range() returns the customary even split.
+ *
+ *  All functions need temporary storage of the size of the local input
+ *  (plus the size of the local output for the pencil variants and c2r).
+ *
+ *  \note For pencil decompositions, \a comm0 and \a comm1 are typically
+ *  obtained by splitting a common communicator of P0*P1 tasks into P0 groups
+ *  of P1 tasks (for \a comm1) and P1 groups of P0 tasks (for \a comm0).
+ */
+
+#ifndef DUCC0_FFT_DISTRIBUTED_H
+#define DUCC0_FFT_DISTRIBUTED_H
+
+#include <cstddef>
+#include <complex>
+#include <tuple>
+#include "ducc0/infra/error_handling.h"
+#include "ducc0/infra/mav.h"
+#include "ducc0/infra/misc_utils.h"
+#include "ducc0/infra/communication.h"
+#include "ducc0/fft/fft.h"
+
+namespace ducc0 {
+
+namespace detail_fft {
+
+using namespace std;
+
+/// Returns the index range [lo; hi) of an axis of length \a n which belongs
+/// to the calling task, if the axis is distributed evenly over \a comm.
+inline tuple<size_t, size_t> dist_range(size_t n, const Communicator &comm)
+  { return calcShare(size_t(comm.num_ranks()), size_t(comm.rank()), n); }
+
+namespace util_distributed {
+
+inline size_t global_length(size_t nlocal, const Communicator &comm)
+  { return size_t(comm.allreduce(long(nlocal), Communicator::Sum)); }
+
+inline shape_t axes_from(size_t first, size_t ndim)
+  {
+  shape_t res;
+  for (size_t i=first; i<ndim; ++i) res.push_back(i);
+  return res;
+  }
+
+inline void sanity_check(const fmav_info &in, const fmav_info &out,
+  size_t mindim)
+  {
+  MR_assert(in.ndim()>=mindim, "not enough dimensions");
+  MR_assert(in.ndim()==out.ndim(), "dimensionality mismatch");
+  }
+
+// uninitialized temporary array; it may be empty on tasks which own no part
+// of a distributed axis, which build_noncritical() does not support
+template<typename T> vfmav<T> tmp_array(const shape_t &shape)
+  {
+  size_t sz=1;
+  for (auto s: shape) sz*=s;
+  if (sz==0) return vfmav<T>(shape);
+  return vfmav<T>::build_noncritical(shape, UNINITIALIZED);
+  }
+
+// \a in has the standard pencil layout, and its axes 2 and above have
+// already been transformed; transforms axes 0 and 1 into \a out, which has
+// the transposed pencil layout.
+template<typename T> void pencil_std2trans(const Communicator &comm0,
+  const Communicator &comm1, const cfmav<complex<T>> &in,
+  const vfmav<complex<T>> &out, bool forward, size_t nthreads)
+  {
+  auto shp = in.shape();
+  shp[1] = global_length(in.shape(1), comm1);
+  shp[2] = out.shape(2);
+  auto tmp = tmp_array<complex<T>>(shp);
+  comm1.redistribute(in, tmp, 1, 2);
+  c2c(tmp, tmp, {1}, forward, T(1), nthreads);
+  comm0.redistribute(tmp, out, 0, 1);
+  c2c(out, out, {0}, forward, T(1), nthreads);
+  }
+
+// \a in has the transposed pencil layout; transforms axes 0 and 1 into
+// \a out, which has the standard pencil layout. Axes 2 and above are left
+// to the caller.
+template<typename T> void pencil_trans2std(const Communicator &comm0,
+  const Communicator &comm1, const cfmav<complex<T>> &in,
+  const vfmav<complex<T>> &out, bool forward, T fct, size_t nthreads)
+  {
+  auto tmp1 = tmp_array<complex<T>>(in.shape());
+  c2c(in, tmp1, {0}, forward, fct, nthreads);
+  auto shp = in.shape();
+  shp[0] = out.shape(0);
+  shp[1] = global_length(in.shape(1), comm0);
+  auto tmp2 = tmp_array<complex<T>>(shp);
+  comm0.redistribute(tmp1, tmp2, 1, 0);
+  c2c(tmp2, tmp2, {1}, forward, T(1), nthreads);
+  comm1.redistribute(tmp2, out, 2, 1);
+  }
+
+}
+
+/// Complex FFT over all axes of a slab-decomposed array.
+/** If \a transposed_in is false, \a in has the standard and \a out the
+ *  transposed slab layout, otherwise it is the other way round.
+ *  \a in and \a out must not overlap. */
+template<typename T> void c2c_slab(const Communicator &comm,
+  const cfmav<complex<T>> &in, const vfmav<complex<T>> &out, bool forward,
+  T fct, size_t nthreads=1, bool transposed_in=false)
+  {
+  using namespace util_distributed;
+  sanity_check(in, out, 2);
+  size_t axin = transposed_in ? 1 : 0, axout = transposed_in ? 0 : 1;
+  shape_t axes;
+  for (size_t i=0; i<in.ndim(); ++i)
+    if (i!=axin) axes.push_back(i);
+  auto tmp = tmp_array<complex<T>>(in.shape());
+  c2c(in, tmp, axes, forward, fct, nthreads);
+  comm.redistribute(tmp, out, axin, axout);
+  c2c(out, out, {axin}, forward, T(1), nthreads);
+  }
+
+/// Real-to-complex FFT over all axes of a slab-decomposed array.
+/** \a in has the standard and \a out the transposed slab layout. The last
+ *  axis of \a out has the length \a in.shape(ndim-1)/2+1; for
+ *  two-dimensional arrays, this is also the distributed axis of \a out. */
+template<typename T> void r2c_slab(const Communicator &comm,
+  const cfmav<T> &in, const vfmav<complex<T>> &out, bool forward,
+  T fct, size_t nthreads=1)
+  {
+  using namespace util_distributed;
+  sanity_check(in, out, 2);
+  auto shp = in.shape();
+  shp.back() = shp.back()/2+1;
+  auto tmp = tmp_array<complex<T>>(shp);
+  r2c(in, tmp, axes_from(1, in.ndim()), forward, fct, nthreads);
+  comm.redistribute(tmp, out, 0, 1);
+  c2c(out, out, {0}, forward, T(1), nthreads);
+  }
+
+/// Complex-to-real FFT over all axes of a slab-decomposed array.
+/** This is the adjoint of r2c_slab(): \a in has the transposed and \a out
+ *  the standard slab layout. */
+template<typename T> void c2r_slab(const Communicator &comm,
+  const cfmav<complex<T>> &in, const vfmav<T> &out, bool forward,
+  T fct, size_t nthreads=1)
+  {
+  using namespace util_distributed;
+  sanity_check(in, out, 2);
+  auto tmp1 = tmp_array<complex<T>>(in.shape());
+  c2c(in, tmp1, {0}, forward, fct, nthreads);
+  auto shp = in.shape();
+  shp[0] = out.shape(0);
+  shp[1] = global_length(in.shape(1), comm);
+  auto tmp2 = tmp_array<complex<T>>(shp);
+  comm.redistribute(tmp1, tmp2, 1, 0);
+  c2r_mut(tmp2, out, axes_from(1, in.ndim()), forward, T(1), nthreads);
+  }
+
+/// Complex FFT over all axes of a pencil-decomposed array.
+/** If \a transposed_in is false, \a in has the standard and \a out the
+ *  transposed pencil layout, otherwise it is the other way round.
+ *  \a in and \a out must not overlap. */
+template<typename T> void c2c_pencil(const Communicator &comm0,
+  const Communicator &comm1, const cfmav<complex<T>> &in,
+  const vfmav<complex<T>> &out, bool forward, T fct, size_t nthreads=1,
+  bool transposed_in=false)
+  {
+  using namespace util_distributed;
+  sanity_check(in, out, 3);
+  auto axes = axes_from(2, in.ndim());
+  if (transposed_in)
+    {
+    pencil_trans2std(comm0, comm1, in, out, forward, fct, nthreads);
+    c2c(out, out, axes, forward, T(1), nthreads);
+    }
+  else
+    {
+    auto tmp = tmp_array<complex<T>>(in.shape());
+    c2c(in, tmp, axes, forward, fct, nthreads);
+    pencil_std2trans(comm0, comm1, tmp, out, forward, nthreads);
+    }
+  }
+
+/// Real-to-complex FFT over all axes of a pencil-decomposed array.
+/** \a in has the standard and \a out the transposed pencil layout. The last
+ *  axis of \a out has the length \a in.shape(ndim-1)/2+1; for
+ *  three-dimensional arrays, this is also the axis of \a out which is
+ *  distributed over \a comm1. */
+template<typename T> void r2c_pencil(const Communicator &comm0,
+  const Communicator &comm1, const cfmav<T> &in,
+  const vfmav<complex<T>> &out, bool forward, T fct, size_t nthreads=1)
+  {
+  using namespace util_distributed;
+  sanity_check(in, out, 3);
+  auto shp = in.shape();
+  shp.back() = shp.back()/2+1;
+  auto tmp = tmp_array<complex<T>>(shp);
+  r2c(in, tmp, axes_from(2, in.ndim()), forward, fct, nthreads);
+  pencil_std2trans(comm0, comm1, tmp, out, forward, nthreads);
+  }
+
+/// Complex-to-real FFT over all axes of a pencil-decomposed array.
+/** This is the adjoint of r2c_pencil(): \a in has the transposed and \a out
+ *  the standard pencil layout. */
+template<typename T> void c2r_pencil(const Communicator &comm0,
+  const Communicator &comm1, const cfmav<complex<T>> &in,
+  const vfmav<T> &out, bool forward, T fct, size_t nthreads=1)
+  {
+  using namespace util_distributed;
+  sanity_check(in, out, 3);
+  auto shp = in.shape();
+  shp[0] = out.shape(0);
+  shp[1] = out.shape(1);
+  shp[2] = global_length(in.shape(2), comm1);
+  auto tmp = tmp_array<complex<T>>(shp);
+  pencil_trans2std(comm0, comm1, in, tmp, forward, fct, nthreads);
+  c2r_mut(tmp, out, axes_from(2, in.ndim()), forward, T(1), nthreads);
+  }
+
+} // namespace detail_fft
+
+using detail_fft::dist_range;
+using detail_fft::c2c_slab;
+using detail_fft::r2c_slab;
+using detail_fft::c2r_slab;
+using detail_fft::c2c_pencil;
+using detail_fft::r2c_pencil;
+using detail_fft::c2r_pencil;
+
+} // namespace ducc0
+
+#endif
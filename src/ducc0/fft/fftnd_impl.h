@@ -64,6 +64,11 @@ SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 #include <vector>
 #include <complex>
 #include <algorithm>
+#include <array>
+#include <list>
+#include <unordered_map>
+#include <typeindex>
+#include <atomic>
 #include "ducc0/infra/useful_macros.h"
 #include "ducc0/infra/error_handling.h"
 #include "ducc0/infra/threading.h"
@@ -148,6 +153,28 @@ struct util // hack to avoid duplicate symbols
         "axis length mismatch");
     }
 
+  static void check_layout(const fmav_info &ref, const fmav_info &arr)
+    {
+    MR_assert((arr.shape()==ref.shape()) && (arr.stride()==ref.stride()),
+      "array layout does not match the plan");
+    }
+  // for multi-axis transforms, try to start with an axis of unit input stride
+  static shape_t c2c_axis_order(const fmav_info &in, const fmav_info &out,
+    const shape_t &axes, bool inplace)
+    {
+    shape_t res(axes);
+    if ((axes.size()>1) && (!inplace)) // optimize axis order
+      {
+      if ((in.stride(axes[0])!=1)&&(out.stride(axes[0])==1))
+        swap(res[0], res.back());
+      else
+        for (size_t i=1; i<axes.size(); ++i)
+          if (in.stride(axes[i])==1)
+            { swap(res[0], res[i]); break; }
+      }
+    return res;
+    }
+
   static size_t thread_count (size_t nthreads, const fmav_info &info,
     size_t axis, size_t /*vlen*/)
     {
@@ -164,61 +191,215 @@ struct util // hack to avoid duplicate symbols
 // multi-D infrastructure
 //
 
-template<typename T> std::shared_ptr<T> get_plan(size_t length, bool vectorize=false)
+/// Statistics of the FFT plan cache.
+struct fft_plan_cache_info
   {
-#ifdef DUCC0_NO_FFT_CACHE
-  return std::make_shared<T>(length, vectorize);
-#else
-  constexpr size_t nmax=10;
-  struct entry { size_t n; bool vectorize; std::shared_ptr<T> ptr; };
-  static std::array<entry, nmax> cache{{{0,0,nullptr}}};
-  static std::array<size_t, nmax> last_access{{0}};
-  static size_t access_counter = 0;
-  static Mutex mut;
-
-  auto find_in_cache = [&]() -> std::shared_ptr<T>
-    {
-    for (size_t i=0; i<nmax; ++i)
-      if (cache[i].ptr && (cache[i].n==length) && (cache[i].vectorize==vectorize))
+  size_t hits,      ///< lookups served from the cache
+         misses,    ///< lookups that required building a new plan
+         evictions, ///< plans removed to stay within the limits
+         entries,   ///< plans currently held by the shared cache
+         bytes;     ///< estimated memory held by these plans
+  };
+
+// Process-wide LRU cache of FFT plans of all types, bounded by a number of
+// entries and (optionally) by the estimated memory of the cached plans.
+// An optional thread-local front layer remembers the last few plans used by
+// each thread and answers repeated lookups without taking the lock.
+class fft_plan_cache
+  {
+  private:
+    struct Tkey
+      {
+      type_index type;
+      size_t n;
+      bool vectorize;
+
+      bool operator==(const Tkey &other) const
+        { return (type==other.type) && (n==other.n) && (vectorize==other.vectorize); }
+      };
+    struct Thash
+      {
+      size_t operator()(const Tkey &key) const
+        { return key.type.hash_code() ^ (key.n<<1) ^ size_t(key.vectorize); }
+      };
+    struct entry
+      {
+      Tkey key;
+      shared_ptr<void> ptr;
+      size_t bytes;
+      };
+    struct local_entry
+      {
+      Tkey key;
+      size_t epoch, wgen;
+      shared_ptr<void> ptr;
+      };
+
+    mutable Mutex mut;
+    list<entry> lru;  // most recently used plan first
+    unordered_map<Tkey, list<entry>::iterator, Thash> index;
+    size_t max_entries=64, max_bytes=0, bytes=0, wgen=0;
+    atomic<size_t> nlocal{0}, epoch{0};
+    atomic<size_t> hits{0}, misses{0}, evictions{0};
+
+    fft_plan_cache() {}
+
+    // rough estimate of the memory held by a plan: twiddle factors for
+    // about two complex values per point
+    template<typename Tplan> struct plan_scalar {};
+    template<template<typename> class Tplan, typename T0>
+      struct plan_scalar<Tplan<T0>> { using type=T0; };
+    template<typename Tplan> static size_t estimated_bytes(size_t length)
+      { return sizeof(Tplan) + 4*length*sizeof(typename plan_scalar<Tplan>::type); }
+
+    static vector<local_entry> &local_entries()
+      {
+      static thread_local vector<local_entry> local;
+      return local;
+      }
+
+    // must be called with the lock held
+    void evict()
+      {
+      while ((!lru.empty()) && ((lru.size()>max_entries)
+             || ((max_bytes>0) && (bytes>max_bytes))))
         {
-        // no need to update if this is already the most recent entry
-        if (last_access[i]!=access_counter)
+        bytes -= lru.back().bytes;
+        index.erase(lru.back().key);
+        lru.pop_back();
+        ++evictions;
+        }
+      }
+    // must be called with the lock held
+    void drop_all()
+      {
+      lru.clear();
+      index.clear();
+      bytes = 0;
+      ++epoch;
+      }
+    // must be called with the lock held
+    shared_ptr<void> find(const Tkey &key, size_t wgen_now)
+      {
+      if (wgen_now!=wgen)  // plans built before a change of the FFT wisdom
+        {
+        drop_all();
+        wgen = wgen_now;
+        }
+      auto it = index.find(key);
+      if (it==index.end()) return nullptr;
+      if (it->second!=lru.begin())
+        lru.splice(lru.begin(), lru, it->second);
+      return it->second->ptr;
+      }
+
+  public:
+    static fft_plan_cache &get()
+      {
+      static fft_plan_cache cache;
+      return cache;
+      }
+
+    template<typename T> shared_ptr<T> get_plan(size_t length, bool vectorize)
+      {
+      Tkey key{type_index(typeid(T)), length, vectorize};
+      size_t wgen_now = fft_wisdom::get().generation();
+      size_t epoch_now = epoch;
+      size_t nloc = nlocal;
+      auto &local(local_entries());
+      if (nloc>0)
+        for (const auto &e: local)
+          if ((e.key==key) && (e.epoch==epoch_now) && (e.wgen==wgen_now))
+            {
+            hits.fetch_add(1, memory_order_relaxed);
+            return static_pointer_cast<T>(e.ptr);
+            }
+
+      shared_ptr<void> res;
+      {
+      LockGuard lock(mut);
+      res = find(key, wgen_now);
+      }
+      if (res)
+        hits.fetch_add(1, memory_order_relaxed);
+      else
+        {
+        misses.fetch_add(1, memory_order_relaxed);
+        auto plan = make_shared<T>(length, vectorize);
+        LockGuard lock(mut);
+        res = find(key, wgen_now);  // maybe another thread was quicker
+        if (!res)
           {
-          last_access[i] = ++access_counter;
-          // Guard against overflow
-          if (access_counter == 0)
-            last_access.fill(0);
+          res = plan;
+          auto nbytes = estimated_bytes<T>(length);
+          lru.push_front({key, res, nbytes});
+          index[key] = lru.begin();
+          bytes += nbytes;
+          evict();
           }
-        return cache[i].ptr;
         }
 
-    return nullptr;
-    };
+      if (nloc>0)
+        {
+        // drop stale entries, then the oldest ones
+        local.erase(remove_if(local.begin(), local.end(), [&](const local_entry &e)
+          { return (e.epoch!=epoch_now) || (e.wgen!=wgen_now); }), local.end());
+        while (local.size()>=nloc)
+          local.erase(local.begin());
+        local.push_back({key, epoch_now, wgen_now, res});
+        }
+      else if (!local.empty())
+        local.clear();
+      return static_pointer_cast<T>(res);
+      }
+
+    void set_limits(size_t max_entries_, size_t max_bytes_, size_t nlocal_)
+      {
+      LockGuard lock(mut);
+      max_entries = max_entries_;
+      max_bytes = max_bytes_;
+      nlocal = nlocal_;
+      ++epoch;  // invalidate the thread-local layers
+      evict();
+      }
+    void clear()
+      {
+      LockGuard lock(mut);
+      drop_all();
+      }
+    fft_plan_cache_info info() const
+      {
+      LockGuard lock(mut);
+      return {hits, misses, evictions, lru.size(), bytes};
+      }
+  };
 
+template<typename T> std::shared_ptr<T> get_plan(size_t length, bool vectorize=false)
   {
-  LockGuard lock(mut);
-
-  auto p = find_in_cache();
-  if (p) return p;
+#ifdef DUCC0_NO_FFT_CACHE
+  return std::make_shared<T>(length, vectorize);
+#else
+  return fft_plan_cache::get().get_plan<T>(length, vectorize);
+#endif
   }
-  auto plan = std::make_shared<T>(length, vectorize);
-  {
-  LockGuard lock(mut);
 
-  auto p = find_in_cache();
-  if (p) return p;
+/// Sets the limits of the FFT plan cache.
+/** At most \a max_entries plans will be kept; if \a max_bytes is nonzero,
+ *  plans will also be evicted when their estimated memory exceeds this value.
+ *  If \a thread_local_entries is nonzero, each thread additionally remembers
+ *  this many recently used plans, which can be retrieved without locking.
+ *  Defaults are 64, 0, and 0. */
+inline void set_fft_plan_cache_limits(size_t max_entries, size_t max_bytes=0,
+  size_t thread_local_entries=0)
+  { fft_plan_cache::get().set_limits(max_entries, max_bytes, thread_local_entries); }
 
-  size_t lru = 0;
-  for (size_t i=1; i<nmax; ++i)
-    if (last_access[i] < last_access[lru])
-      lru = i;
+/// Returns hit/miss statistics and the current size of the FFT plan cache.
+inline fft_plan_cache_info get_fft_plan_cache_info()
+  { return fft_plan_cache::get().info(); }
 
-  cache[lru] = {length,vectorize, plan};
-  last_access[lru] = ++access_counter;
-  }
-  return plan;
-#endif
-  }
+/// Removes all plans from the FFT plan cache. The statistics are kept.
+inline void clear_fft_plan_cache()
+  { fft_plan_cache::get().clear(); }
 
 template<size_t N> class multi_iter
   {
@@ -350,6 +531,9 @@ template<size_t N> class multi_iter
     ptrdiff_t stride_in() const { return cstr_i; }
     ptrdiff_t stride_out() const { return cstr_o; }
     size_t remaining() const { return rem; }
+    /// Returns true if all remaining transforms are equidistant in input and
+    /// output (with distances unistride_i() and unistride_o()).
+    bool linear() const { return pos.size()<=1; }
     bool critical_stride_trans(size_t tsz) const
       {
       return ((abs<ptrdiff_t>(stride_in() *tsz)&4095)==0)
@@ -366,18 +550,16 @@ template<size_t N> class multi_iter
 template<typename T, typename T0> class TmpStorage
   {
   private:
-    aligned_array<T> d;
+    aligned_array<T> own;
+    T *d;
     size_t dofs, dstride;
 
-  public:
-    TmpStorage(size_t n_trafo, size_t bufsize_data, size_t bufsize_trafo,
-               size_t n_simultaneous, bool inplace)
+    static size_t layout(size_t n_trafo, size_t bufsize_data,
+      size_t bufsize_trafo, size_t n_simultaneous, bool inplace,
+      size_t &dofs, size_t &dstride)
       {
-      if (inplace)
-        {
-        d.resize(bufsize_trafo);
-        return;
-        }
+      dofs = dstride = 0;
+      if (inplace) return bufsize_trafo;
       constexpr auto vlen = fft_simdlen<T0>;
       // FIXME: when switching to C++20, use bit_floor(othersize)
       size_t buffct = std::min(vlen, n_trafo);
@@ -388,13 +570,36 @@ template<typename T, typename T0> class TmpStorage
       // critical stride avoidance
       if ((dstride&256)==0) dstride+=16;
       if ((dofs&256)==0) dofs += 16;
-      d.resize(buffct*dofs + datafct*dstride);
+      return buffct*dofs + datafct*dstride;
+      }
+
+  public:
+    /// Returns the number of elements of type \a T required for the given
+    /// parameters.
+    static size_t size(size_t n_trafo, size_t bufsize_data,
+      size_t bufsize_trafo, size_t n_simultaneous, bool inplace)
+      {
+      size_t dummy1, dummy2;
+      return layout(n_trafo, bufsize_data, bufsize_trafo, n_simultaneous,
+        inplace, dummy1, dummy2);
+      }
+
+    /// If \a ext is provided, its memory is used (and grown if necessary)
+    /// instead of allocating a fresh buffer.
+    TmpStorage(size_t n_trafo, size_t bufsize_data, size_t bufsize_trafo,
+               size_t n_simultaneous, bool inplace, aligned_array<T> *ext=nullptr)
+      {
+      auto sz = layout(n_trafo, bufsize_data, bufsize_trafo, n_simultaneous,
+        inplace, dofs, dstride);
+      auto &buf(ext ? *ext : own);
+      if (buf.size()<sz) buf.resize(sz);
+      d = buf.data();
       }
 
     template<typename T2> T2 *transformBuf()
-      { return reinterpret_cast<T2 *>(d.data()); }
+      { return reinterpret_cast<T2 *>(d); }
     template<typename T2> T2 *dataBuf()
-      { return reinterpret_cast<T2 *>(d.data()) + dofs; }
+      { return reinterpret_cast<T2 *>(d) + dofs; }
     size_t data_stride() const
       { return dstride; }
   };
@@ -582,6 +787,46 @@ template<typename T, typename Titer> DUCC0_NOINLINE void copy_output(const Titer
       ptr[it.oofs(j0,i)] = src[j0*vstr+i];
   }
 
+// variants for 16-bit storage types, converting on the fly
+template <typename Tv, typename Ts, typename Titer> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> copy_input(const Titer &it,
+  const cfmav<Ts> &src, Tv *DUCC0_RESTRICT dst)
+  {
+  const Ts * DUCC0_RESTRICT ptr = src.data();
+  if constexpr (is_floating_point_v<Tv>)
+    for (size_t i=0; i<it.length_in(); ++i)
+      dst[i] = Tv(float(ptr[it.iofs(i)]));
+  else
+    {
+    constexpr auto vlen=Tv::size();
+    for (size_t i=0; i<it.length_in(); ++i)
+      {
+      typename Tv::value_type tmp[vlen];
+      for (size_t j=0; j<vlen; ++j)
+        tmp[j] = float(ptr[it.iofs(j,i)]);
+      dst[i] = Tv(&tmp[0], element_aligned_tag());
+      }
+    }
+  }
+template<typename Tv, typename Ts, typename Titer> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> copy_output(const Titer &it,
+  const Tv *DUCC0_RESTRICT src, const vfmav<Ts> &dst)
+  {
+  Ts * DUCC0_RESTRICT ptr = dst.data();
+  if constexpr (is_floating_point_v<Tv>)
+    for (size_t i=0; i<it.length_out(); ++i)
+      ptr[it.oofs(i)] = Ts(float(src[i]));
+  else
+    {
+    constexpr auto vlen=Tv::size();
+    for (size_t i=0; i<it.length_out(); ++i)
+      {
+      Tv tmp = src[i];
+      for (size_t j=0; j<vlen; ++j)
+        ptr[it.oofs(j,i)] = Ts(float(tmp[j]));
+      }
+    }
+  }
 
 template <typename T, size_t vlen> struct add_vec
   { using type = typename simd_select<T, vlen>::type; };
@@ -589,12 +834,126 @@ template <typename T, size_t vlen> struct add_vec<Cmplx<T>, vlen>
   { using type = Cmplx<typename simd_select<T, vlen>::type>; };
 template <typename T, size_t vlen> using add_vec_t = typename add_vec<T, vlen>::type;
 
+/// 1D plans and per-thread scratch memory for repeated n-D transforms of
+/// arrays with identical layout.
+template<typename Tplan, typename T> struct nd_workspace
+  {
+  std::vector<std::shared_ptr<Tplan>> plan, vplan; // one per transformed axis
+  std::vector<aligned_array<T>> scratch;  // one per thread
+  };
+
+template<typename Tplan> void get_nd_plans(size_t len, size_t ndim,
+  std::shared_ptr<Tplan> &plan, std::shared_ptr<Tplan> &vplan)
+  {
+  plan = get_plan<Tplan>(len, ndim==1);
+  vplan = ((ndim==1)||(len<300)||((len&3)!=0)) ?
+    plan : get_plan<Tplan>(len, true);
+  }
+
+/// Determines how many 1D transforms along \a axis are carried out
+/// simultaneously (\a n_simul, the SIMD width) and how many are copied into
+/// the scratch buffer at once (\a n_bunch), and whether the transforms can
+/// be done directly in the output array (\a inplace).
+template<size_t nmax, typename T, typename T0> void nd_bunching(
+  const fmav_info &in, const fmav_info &out, size_t axis, size_t bufsize,
+  size_t &n_simul, size_t &n_bunch, bool &inplace)
+  {
+  constexpr auto vlen = fft_simdlen<T0>;
+  size_t len = in.shape(axis);
+  n_simul = n_bunch = 1;
+  bool critstride = (((in.stride(axis)*sizeof(T))&4095)==0)
+                 || (((out.stride(axis)*sizeof(T))&4095)==0);
+  bool nostride = (in.stride(axis)==1) && (out.stride(axis)==1);
+
+  constexpr size_t l2cache=262144*2;
+  constexpr size_t cacheline=64;
+
+  // working set size
+  auto wss = [&](size_t vl) { return sizeof(T)*(2*len*vl + bufsize); };
+  // is the FFT small enough to fit into L2 vectorized?
+  if (wss(1)>l2cache) // "long" FFT, don't execute more than one at the same time
+    {
+    n_simul=1;
+    if (critstride)  // make bunch large to reduce overall copy cost
+      {
+      n_bunch=n_simul;
+      while ((n_bunch<nmax) && (sizeof(T)*n_bunch<2*cacheline)) n_bunch*=2;
+      }
+    else if (nostride)  // simple scalar "in-place" transform
+      n_bunch=n_simul;
+    else  // we have some strides, use a medium-sized bunch
+      {
+      n_bunch=n_simul;
+      while ((n_bunch<nmax) && (sizeof(T)*n_bunch<cacheline)) n_bunch*=2;
+      }
+    }
+  else  // fairly small individual FFT, vectorizing probably beneficial
+    {
+    // if no stride, only vectorize if vectorized FFT fits into cache
+    // if strided, always vectorize (TBC)
+    n_simul = nostride ? ((wss(vlen)<=l2cache) ? vlen:1) : vlen;
+    if (critstride)  // make bunch large to reduce overall copy cost
+      {
+      n_bunch=n_simul;
+      while ((n_bunch<nmax) /*&& (sizeof(T)*n_bunch<2*cacheline)*/) n_bunch*=2;
+      }
+    else if (nostride)
+      n_bunch=n_simul;
+    else
+      {
+      n_bunch=n_simul;
+      if (n_simul==1)
+        while ((n_bunch<nmax) && (sizeof(T)*n_bunch<cacheline)) n_bunch*=2;
+      }
+    }
+
+  inplace = (in.stride(axis)==1) && (out.stride(axis)==1) && (n_bunch==1);
+  MR_assert(n_bunch<=nmax, "must not happen");
+  }
+
+/// Hook for Exec types which provide a dedicated code path for batches of
+/// very short transforms; returns false if the transform was not done.
+template<typename Exec, typename T, typename T0> bool exec_small_batch(
+  const Exec &, const cfmav<T> &, const vfmav<T> &, size_t, T0, size_t)
+  { return false; }
+
+/// Fills \a ws with everything general_nd() needs for transforming
+/// \a in into \a out along \a axes.
+template<typename Tplan, typename T, typename T0> void prepare_nd_workspace(
+  const fmav_info &in, const fmav_info &out, const shape_t &axes,
+  size_t nthreads, nd_workspace<Tplan,T> &ws)
+  {
+  constexpr auto vlen = fft_simdlen<T0>;
+  constexpr size_t nmax = 16;
+  ws.plan.resize(axes.size());
+  ws.vplan.resize(axes.size());
+  size_t nthr=1, bufsz=0;
+  for (size_t iax=0; iax<axes.size(); ++iax)
+    {
+    size_t len=in.shape(axes[iax]);
+    auto &plan(ws.plan[iax]), &vplan(ws.vplan[iax]);
+    get_nd_plans(len, in.ndim(), plan, vplan);
+    nthr = max(nthr, util::thread_count(nthreads, in, axes[iax], vlen));
+    size_t n_simul, n_bunch;
+    bool inplace;
+    nd_bunching<nmax, T, T0>(in, out, axes[iax], plan->bufsize(),
+      n_simul, n_bunch, inplace);
+    bufsz = max(bufsz, TmpStorage<T,T0>::size(in.size()/len, len,
+      max(plan->bufsize(),vplan->bufsize()), (n_bunch+vlen-1)/vlen, inplace));
+    }
+  ws.scratch.resize(nthr);
+  for (auto &buf: ws.scratch)
+    buf.resize(bufsz);
+  }
+
+/// If \a ws is provided, its plans and scratch buffers are used (see
+/// prepare_nd_workspace()); otherwise they are obtained on the fly.
 template<typename Tplan, typename T, typename T0, typename Exec>
 DUCC0_NOINLINE void general_nd(const cfmav<T> &in, const vfmav<T> &out,
   const shape_t &axes, T0 fct, size_t nthreads, const Exec &exec,
-  const bool /*allow_inplace*/=true)
+  const bool /*allow_inplace*/=true, nd_workspace<Tplan,T> *ws=nullptr)
   {
-  if ((in.ndim()==1)&&(in.stride(0)==1)&&(out.stride(0)==1))
+  if ((!ws)&&(in.ndim()==1)&&(in.stride(0)==1)&&(out.stride(0)==1))
     {
     auto plan = get_plan<Tplan>(in.shape(0), true);
     exec.exec_simple(in.data(), out.data(), *plan, fct, nthreads);
@@ -606,15 +965,22 @@ DUCC0_NOINLINE void general_nd(const cfmav<T> &in, const vfmav<T> &out,
   for (size_t iax=0; iax<axes.size(); ++iax)
     {
     size_t len=in.shape(axes[iax]);
-    if ((!plan) || (len!=plan->length()))
+    if (exec_small_batch(exec, (iax==0) ? in : out, out, axes[iax], fct, nthreads))
+      {
+      fct = T0(1);
+      continue;
+      }
+    if (ws)
       {
-      plan = get_plan<Tplan>(len, in.ndim()==1);
-      vplan = ((in.ndim()==1)||(len<300)||((len&3)!=0)) ?
-        plan : get_plan<Tplan>(len, true);
+      plan = ws->plan[iax];
+      vplan = ws->vplan[iax];
       }
+    else if ((!plan) || (len!=plan->length()))
+      get_nd_plans(len, in.ndim(), plan, vplan);
 
-    execParallel(util::thread_count(nthreads, in, axes[iax], fft_simdlen<T0>),
-      [&](Scheduler &sched)
+    size_t nthr = util::thread_count(nthreads, in, axes[iax], fft_simdlen<T0>);
+    MR_assert((!ws) || (ws->scratch.size()>=nthr), "workspace too small");
+    execParallel(nthr, [&](Scheduler &sched)
       {
       constexpr auto vlen = fft_simdlen<T0>;
       constexpr size_t nmax = 16;
@@ -623,56 +989,12 @@ DUCC0_NOINLINE void general_nd(const cfmav<T> &in, const vfmav<T> &out,
 
       // n_simul: vector size
       // n_bunch: total size of bunch (multiple of n_simul)
-      size_t n_simul=1, n_bunch=1;
-      bool critstride = (((in.stride(axes[iax])*sizeof(T))&4095)==0)
-                     || (((out.stride(axes[iax])*sizeof(T))&4095)==0);
-      bool nostride = (in.stride(axes[iax])==1) && (out.stride(axes[iax])==1);
-
-      constexpr size_t l2cache=262144*2;
-      constexpr size_t cacheline=64;
-
-      // working set size
-      auto wss = [&](size_t vl) { return sizeof(T)*(2*len*vl + plan->bufsize()); };
-      // is the FFT small enough to fit into L2 vectorized?
-      if (wss(1)>l2cache) // "long" FFT, don't execute more than one at the same time
-        {
-        n_simul=1;
-        if (critstride)  // make bunch large to reduce overall copy cost
-          {
-          n_bunch=n_simul;
-          while ((n_bunch<nmax) && (sizeof(T)*n_bunch<2*cacheline)) n_bunch*=2;
-          }
-        else if (nostride)  // simple scalar "in-place" transform
-          n_bunch=n_simul;
-        else  // we have some strides, use a medium-sized bunch
-          {
-          n_bunch=n_simul;
-          while ((n_bunch<nmax) && (sizeof(T)*n_bunch<cacheline)) n_bunch*=2;
-          }
-        }
-      else  // fairly small individual FFT, vectorizing probably beneficial
-        {
-        // if no stride, only vectorize if vectorized FFT fits into cache
-        // if strided, always vectorize (TBC)
-        n_simul = nostride ? ((wss(vlen)<=l2cache) ? vlen:1) : vlen;
-        if (critstride)  // make bunch large to reduce overall copy cost
-          {
-          n_bunch=n_simul;
-          while ((n_bunch<nmax) /*&& (sizeof(T)*n_bunch<2*cacheline)*/) n_bunch*=2;
-          }
-        else if (nostride)
-          n_bunch=n_simul;
-        else
-          {
-          n_bunch=n_simul;
-          if (n_simul==1)
-            while ((n_bunch<nmax) && (sizeof(T)*n_bunch<cacheline)) n_bunch*=2;
-          }
-        }
-
-      bool inplace = (in.stride(axes[iax])==1) && (out.stride(axes[iax])==1) && (n_bunch==1);
-      MR_assert(n_bunch<=nmax, "must not happen");
-      TmpStorage<T,T0> storage(in.size()/len, len, max(plan->bufsize(),vplan->bufsize()), (n_bunch+vlen-1)/vlen, inplace);
+      size_t n_simul, n_bunch;
+      bool inplace;
+      nd_bunching<nmax, T, T0>(in, out, axes[iax], plan->bufsize(),
+        n_simul, n_bunch, inplace);
+      TmpStorage<T,T0> storage(in.size()/len, len, max(plan->bufsize(),vplan->bufsize()),
+        (n_bunch+vlen-1)/vlen, inplace, ws ? &ws->scratch[sched.thread_num()] : nullptr);
 
       // first, do all possible steps of size n_bunch, then n_simul
       if (n_bunch>1)
@@ -830,6 +1152,153 @@ struct ExecC2C
     }
   };
 
+constexpr size_t small_cfft_maxlen = 64;
+
+// copies vlen equidistant transforms into SIMD layout and back
+template<size_t N, typename Tsimd> inline void load_small_tile(
+  const Cmplx<typename Tsimd::value_type> * DUCC0_RESTRICT src,
+  ptrdiff_t str, ptrdiff_t cstr, Cmplx<Tsimd> * DUCC0_RESTRICT dst)
+  {
+  constexpr auto vlen=Tsimd::size();
+  for (size_t i=0; i<N; ++i)
+    {
+    Cmplx<Tsimd> tmp;
+    for (size_t j=0; j<vlen; ++j)
+      {
+      const auto &v(src[ptrdiff_t(j)*str+ptrdiff_t(i)*cstr]);
+      tmp.r[j] = v.r;
+      tmp.i[j] = v.i;
+      }
+    dst[i] = tmp;
+    }
+  }
+template<size_t N, typename Tsimd> inline void store_small_tile(
+  const Cmplx<Tsimd> * DUCC0_RESTRICT src,
+  Cmplx<typename Tsimd::value_type> * DUCC0_RESTRICT dst,
+  ptrdiff_t str, ptrdiff_t cstr)
+  {
+  constexpr auto vlen=Tsimd::size();
+  for (size_t i=0; i<N; ++i)
+    {
+    Cmplx<Tsimd> tmp(src[i]);
+    for (size_t j=0; j<vlen; ++j)
+      dst[ptrdiff_t(j)*str+ptrdiff_t(i)*cstr].Set(tmp.r[j], tmp.i[j]);
+    }
+  }
+
+template<size_t N, bool fwd, typename T0> DUCC0_NOINLINE void small_c2c_batch(
+  const cfmav<Cmplx<T0>> &in, const vfmav<Cmplx<T0>> &out, size_t axis,
+  T0 fct, size_t nthreads)
+  {
+  UnityRoots<T0,Cmplx<T0>> roots(N);
+  std::array<Cmplx<T0>,N> tw;
+  for (size_t i=0; i<N; ++i)
+    tw[i] = fwd ? roots[i].conj() : roots[i];
+  execParallel(util::thread_count(nthreads, in, axis, fft_simdlen<T0>),
+    [&](Scheduler &sched)
+    {
+    constexpr auto vlen = fft_simdlen<T0>;
+    multi_iter<vlen> it(in, out, axis, sched.num_threads(), sched.thread_num());
+    Cmplx<T0> sbuf[N], sres[N];
+    auto scalar_trafo = [&](const Cmplx<T0> *pin, Cmplx<T0> *pout)
+      {
+      for (size_t i=0; i<N; ++i)
+        sbuf[i] = pin[ptrdiff_t(i)*it.stride_in()];
+      small_cfft<N,fwd>::exec(sbuf, sres, tw.data());
+      for (size_t i=0; i<N; ++i)
+        pout[ptrdiff_t(i)*it.stride_out()] = sres[i]*fct;
+      };
+#ifndef DUCC0_NO_SIMD
+    if constexpr (vlen>1)
+      {
+      using Tsimd = fft_simd<T0>;
+      Cmplx<Tsimd> buf[N], res[N];
+      auto simd_trafo = [&](const Cmplx<T0> *pin, ptrdiff_t istr,
+        Cmplx<T0> *pout, ptrdiff_t ostr)
+        {
+        load_small_tile<N>(pin, istr, it.stride_in(), buf);
+        small_cfft<N,fwd>::exec(buf, res, tw.data());
+        if (fct!=T0(1))
+          for (auto &v: res) v*=fct;
+        store_small_tile<N>(res, pout, ostr, it.stride_out());
+        };
+      if (it.linear() && (it.remaining()>0))
+        {
+        // walk through the equidistant transforms without further help
+        // from the iterator
+        size_t ntrafo = it.remaining();
+        it.advance(1);
+        auto pin = in.data()+it.iofs(0);
+        auto pout = out.data()+it.oofs(0);
+        auto istr = it.unistride_i(), ostr = it.unistride_o();
+        size_t i=0;
+        for (; i+vlen<=ntrafo; i+=vlen)
+          simd_trafo(pin+ptrdiff_t(i)*istr, istr, pout+ptrdiff_t(i)*ostr, ostr);
+        for (; i<ntrafo; ++i)
+          scalar_trafo(pin+ptrdiff_t(i)*istr, pout+ptrdiff_t(i)*ostr);
+        return;
+        }
+      while (it.remaining()>=vlen)
+        {
+        it.advance(vlen);
+        if (it.uniform_i() && it.uniform_o())
+          simd_trafo(in.data()+it.iofs(0), it.unistride_i(),
+                     out.data()+it.oofs(0), it.unistride_o());
+        else
+          {
+          copy_input(it, in, buf);
+          small_cfft<N,fwd>::exec(buf, res, tw.data());
+          if (fct!=T0(1))
+            for (auto &v: res) v*=fct;
+          copy_output(it, res, out);
+          }
+        }
+      }
+#endif
+    while (it.remaining()>0)
+      {
+      it.advance(1);
+      scalar_trafo(in.data()+it.iofs(0), out.data()+it.oofs(0));
+      }
+    });
+  }
+
+template<typename T0, size_t N=2> bool small_c2c(const cfmav<Cmplx<T0>> &in,
+  const vfmav<Cmplx<T0>> &out, size_t axis, bool forward, T0 fct,
+  size_t nthreads)
+  {
+  if constexpr (N>small_cfft_maxlen)
+    return false;
+  else
+    {
+    if constexpr (small_cfft<N,true>::supported())
+      if (in.shape(axis)==N)
+        {
+        forward ? small_c2c_batch<N,true>(in, out, axis, fct, nthreads)
+                : small_c2c_batch<N,false>(in, out, axis, fct, nthreads);
+        return true;
+        }
+    return small_c2c<T0,N+1>(in, out, axis, forward, fct, nthreads);
+    }
+  }
+
+/// Batches of short complex transforms are carried out by compile-time
+/// specialized codelets, which work on vlen transforms at once.
+template<typename T0> bool exec_small_batch(const ExecC2C &exec,
+  const cfmav<Cmplx<T0>> &in, const vfmav<Cmplx<T0>> &out, size_t axis,
+  T0 fct, size_t nthreads)
+  {
+  if constexpr (fft_simd_exists<T0>)
+    {
+    size_t len = in.shape(axis);
+    if ((len<2) || (len>small_cfft_maxlen) || (in.size()/len<fft_simdlen<T0>))
+      return false;
+    return small_c2c(in, out, axis, exec.forward, fct, nthreads);
+    }
+  else
+    return false;
+  }
+
 struct ExecHartley
   {
   template <typename T0, typename Tstorage, typename Titer> DUCC0_NOINLINE void operator() (
@@ -1008,18 +1477,35 @@ struct ExecDcst
     }
   };
 
-template<typename T> DUCC0_NOINLINE void general_r2c(
-  const cfmav<T> &in, const vfmav<Cmplx<T>> &out, size_t axis, bool forward, T fct,
-  size_t nthreads)
+/// Fills \a ws with everything general_r2c() and general_c2r() need for
+/// a transform along \a axis; \a len is the length of the real data.
+template<typename T> void prepare_r2c_workspace(const fmav_info &in,
+  size_t axis, size_t len, size_t nthreads,
+  nd_workspace<pocketfft_r<T>,T> &ws)
+  {
+  ws.plan.assign(1, get_plan<pocketfft_r<T>>(len));
+  ws.vplan.clear();
+  auto bufsz = TmpStorage<T,T>::size(in.size()/in.shape(axis), len,
+    ws.plan[0]->bufsize(), 1, false);
+  ws.scratch.resize(util::thread_count(nthreads, in, axis, fft_simdlen<T>));
+  for (auto &buf: ws.scratch)
+    buf.resize(bufsz);
+  }
+
+template<typename T, typename Ts=T> DUCC0_NOINLINE void general_r2c(
+  const cfmav<Ts> &in, const vfmav<Cmplx<T>> &out, size_t axis, bool forward, T fct,
+  size_t nthreads, nd_workspace<pocketfft_r<T>,T> *ws=nullptr)
   {
   size_t nth1d = (in.ndim()==1) ? nthreads : 1;
-  auto plan = std::make_unique<pocketfft_r<T>>(in.shape(axis));
   size_t len=in.shape(axis);
-  execParallel(
-    util::thread_count(nthreads, in, axis, fft_simdlen<T>),
-    [&](Scheduler &sched) {
+  std::shared_ptr<pocketfft_r<T>> plan = ws ? ws->plan[0] :
+    std::make_shared<pocketfft_r<T>>(len);
+  size_t nthr = util::thread_count(nthreads, in, axis, fft_simdlen<T>);
+  MR_assert((!ws) || (ws->scratch.size()>=nthr), "workspace too small");
+  execParallel(nthr, [&](Scheduler &sched) {
     constexpr auto vlen = fft_simdlen<T>;
-    TmpStorage<T,T> storage(in.size()/len, len, plan->bufsize(), 1, false);
+    TmpStorage<T,T> storage(in.size()/len, len, plan->bufsize(), 1, false,
+      ws ? &ws->scratch[sched.thread_num()] : nullptr);
     multi_iter<vlen> it(in, out, axis, sched.num_threads(), sched.thread_num());
 #ifndef DUCC0_NO_SIMD
     if constexpr (vlen>1)
@@ -1126,18 +1612,20 @@ template<typename T> DUCC0_NOINLINE void general_r2c(
     }
     });  // end of parallel region
   }
-template<typename T> DUCC0_NOINLINE void general_c2r(
-  const cfmav<Cmplx<T>> &in, const vfmav<T> &out, size_t axis, bool forward, T fct,
-  size_t nthreads)
+template<typename T, typename Ts=T> DUCC0_NOINLINE void general_c2r(
+  const cfmav<Cmplx<T>> &in, const vfmav<Ts> &out, size_t axis, bool forward, T fct,
+  size_t nthreads, nd_workspace<pocketfft_r<T>,T> *ws=nullptr)
   {
   size_t nth1d = (in.ndim()==1) ? nthreads : 1;
-  auto plan = std::make_unique<pocketfft_r<T>>(out.shape(axis));
   size_t len=out.shape(axis);
-  execParallel(
-    util::thread_count(nthreads, in, axis, fft_simdlen<T>),
-    [&](Scheduler &sched) {
+  std::shared_ptr<pocketfft_r<T>> plan = ws ? ws->plan[0] :
+    std::make_shared<pocketfft_r<T>>(len);
+  size_t nthr = util::thread_count(nthreads, in, axis, fft_simdlen<T>);
+  MR_assert((!ws) || (ws->scratch.size()>=nthr), "workspace too small");
+  execParallel(nthr, [&](Scheduler &sched) {
       constexpr auto vlen = fft_simdlen<T>;
-      TmpStorage<T,T> storage(out.size()/len, len, plan->bufsize(), 1, false);
+      TmpStorage<T,T> storage(out.size()/len, len, plan->bufsize(), 1, false,
+        ws ? &ws->scratch[sched.thread_num()] : nullptr);
       multi_iter<vlen> it(in, out, axis, sched.num_threads(), sched.thread_num());
 #ifndef DUCC0_NO_SIMD
       if constexpr (vlen>1)
@@ -1406,25 +1894,156 @@ template<typename T> DUCC0_NOINLINE void c2c(const cfmav<std::complex<T>> &in,
  
   const auto &in2(reinterpret_cast<const cfmav<Cmplx<T> >&>(in));
   const auto &out2(reinterpret_cast<const vfmav<Cmplx<T> >&>(out));
-  if ((axes.size()>1) && (in.data()!=out.data())) // optimize axis order
+  general_nd<pocketfft_c<T>>(in2, out2,
+    util::c2c_axis_order(in, out, axes, in.data()==out.data()), fct, nthreads,
+    ExecC2C{forward});
+  }
+
+// Processes \a in in tiles of at most \a bufsize elements: every tile is
+// copied into a buffer, \a func is applied to the buffer, and the result is
+// copied to the corresponding part of \a out.
+// Every tile spans the full extent of all \a axes; the remaining axes are
+// added in the order of increasing stride of \a in as long as the buffer
+// allows, and the next one is split into blocks. All other axes are looped
+// over, so that the tiles are visited in the order in which they are stored.
+// \a func is called with the buffered tile and the index of its first
+// element within \a in.
+template<typename T, typename Func> void ooc_tiled_pass(const cfmav<T> &in,
+  const vfmav<T> &out, const shape_t &axes, size_t bufsize, size_t nthreads,
+  Func &&func)
+  {
+  auto ndim = in.ndim();
+  auto by_stride = [&](size_t a, size_t b)
+    { return abs(in.stride(a))<abs(in.stride(b)); };
+  vector<bool> full(ndim, false);
+  size_t tilesize=1;
+  for (auto ax: axes)
+    { full[ax]=true; tilesize*=in.shape(ax); }
+  MR_assert(tilesize<=bufsize,
+    "memory limit is too small for the requested transform");
+  shape_t rest;
+  for (size_t i=0; i<ndim; ++i)
+    if (!full[i]) rest.push_back(i);
+  sort(rest.begin(), rest.end(), by_stride);
+  size_t nfull=0;
+  while ((nfull<rest.size()) && (tilesize*in.shape(rest[nfull])<=bufsize))
+    tilesize *= in.shape(rest[nfull++]);
+  size_t blen = (nfull<rest.size()) ? bufsize/tilesize : 1;
+
+  // the buffer has the same axis ordering as \a in
+  shape_t order(ndim);
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), by_stride);
+  aligned_array<T> buf(tilesize*blen);
+
+  vector<slice> slc(ndim);
+  shape_t idx(ndim, 0);
+  while (true)
     {
-    if ((in.stride(axes[0])!=1)&&(out.stride(axes[0])==1))
+    for (size_t i=nfull; i<rest.size(); ++i)
       {
-      shape_t axes2(axes);
-      swap(axes2[0],axes2.back());
-      general_nd<pocketfft_c<T>>(in2, out2, axes2, fct, nthreads, ExecC2C{forward});
-      return;
+      auto ax = rest[i];
+      auto len = (i==nfull) ? min(blen, in.shape(ax)-idx[ax]) : 1;
+      slc[ax] = slice(idx[ax], idx[ax]+len);
+      }
+    auto tin = in.subarray(slc);
+    auto tout = out.subarray(slc);
+    stride_t str(ndim);
+    ptrdiff_t sz=1;
+    for (auto ax: order)
+      { str[ax]=sz; sz*=ptrdiff_t(tin.shape(ax)); }
+    vfmav<T> tbuf(buf.data(), tin.shape(), str);
+    mav_apply([](const T &a, T &b) { b=a; }, nthreads, tin, tbuf);
+    func(tbuf, idx);
+    mav_apply([](const T &a, T &b) { b=a; }, nthreads, tbuf, tout);
+
+    size_t i=nfull;
+    for (; i<rest.size(); ++i)
+      {
+      auto ax = rest[i];
+      idx[ax] += (i==nfull) ? blen : 1;
+      if (idx[ax]<in.shape(ax)) break;
+      idx[ax] = 0;
       }
-    for (size_t i=1; i<axes.size(); ++i)
-      if (in.stride(axes[i])==1)
+    if (i==rest.size()) break;
+    }
+  }
+
+template<typename T> DUCC0_NOINLINE void c2c_out_of_core(
+  const cfmav<std::complex<T>> &in, const vfmav<std::complex<T>> &out,
+  const shape_t &axes, bool forward, T fct, size_t memory_limit,
+  size_t nthreads)
+  {
+  util::sanity_check_onetype(in, out, in.data()==out.data(), axes);
+  if (in.size()==0) return;
+  size_t bufsize = max<size_t>(1, memory_limit/sizeof(std::complex<T>));
+
+  // long 1D transform: Bailey's four-step algorithm, with the transposition
+  // folded into the first pass
+  if ((in.ndim()==1) && (in.size()>bufsize))
+    {
+    MR_assert(in.data()!=out.data(),
+      "out-of-core 1D transforms cannot be done in-place");
+    size_t ip = in.shape(0);
+    auto factors = util1d::prime_factors(ip);
+    sort(factors.begin(), factors.end(), std::greater<size_t>());
+    size_t f1=1, f2=1;
+    for (auto fct: factors)
+      (f2>f1) ? f1*=fct : f2*=fct;
+    auto istr=in.stride(0);
+    auto ostr=out.stride(0);
+    cfmav<std::complex<T>> in2(in.data(), {f1,f2}, {ptrdiff_t(f2)*istr, istr});
+    vfmav<std::complex<T>> out2(out.data(), {f1,f2}, {ostr, ptrdiff_t(f1)*ostr});
+    auto roots_p = get_plan<Long1dPlan<T>>(ip);
+    const auto &roots(*roots_p);
+    ooc_tiled_pass(in2, out2, {0}, bufsize, nthreads,
+      [&](const vfmav<std::complex<T>> &tile, const shape_t &idx)
+      {
+      c2c(tile, tile, {0}, forward, T(1), nthreads);
+      vmav<std::complex<T>,2> tile2(tile);
+      execStatic(tile2.shape(0), nthreads, 0, [&](Scheduler &sched)
         {
-        shape_t axes2(axes);
-        swap(axes2[0],axes2[i]);
-        general_nd<pocketfft_c<T>>(in2, out2, axes2, fct, nthreads, ExecC2C{forward});
-        return;
-        }
+        while (auto rng=sched.getNext())
+          for (auto i=rng.lo; i<rng.hi; ++i)
+            for (size_t j=0; j<tile2.shape(1); ++j)
+              tile2(i,j) *= forward ? conj(roots[i*(j+idx[1])])
+                                    : roots[i*(j+idx[1])];
+        });
+      });
+    ooc_tiled_pass<std::complex<T>>(out2, out2, {1}, bufsize, nthreads,
+      [&](const vfmav<std::complex<T>> &tile, const shape_t &)
+      { c2c(tile, tile, {1}, forward, fct, nthreads); });
+    return;
+    }
+
+  // All requested axes that fit into memory together with all axes of
+  // smaller stride are transformed in a single pass; every other axis needs
+  // a pass of its own.
+  shape_t order(in.ndim());
+  iota(order.begin(), order.end(), 0);
+  sort(order.begin(), order.end(), [&](size_t a, size_t b)
+    { return abs(in.stride(a))<abs(in.stride(b)); });
+  shape_t first_axes, other_axes;
+  size_t sz=1;
+  bool fits=true;
+  for (auto ax: order)
+    {
+    fits = fits && (sz*in.shape(ax)<=bufsize);
+    if (fits) sz*=in.shape(ax);
+    if (find(axes.begin(), axes.end(), ax)!=axes.end())
+      (fits ? first_axes : other_axes).push_back(ax);
+    }
+  vector<shape_t> passes;
+  if (!first_axes.empty()) passes.push_back(first_axes);
+  for (auto ax: other_axes) passes.push_back({ax});
+  bool first=true;
+  for (const auto &pax: passes)
+    {
+    ooc_tiled_pass(first ? in : out, out, pax, bufsize, nthreads,
+      [&](const vfmav<std::complex<T>> &tile, const shape_t &)
+      { c2c(tile, tile, pax, forward, first ? fct : T(1), nthreads); });
+    first=false;
     }
-  general_nd<pocketfft_c<T>>(in2, out2, axes, fct, nthreads, ExecC2C{forward});
   }
 
 template<typename T> DUCC0_NOINLINE void dct(const cfmav<T> &in, const vfmav<T> &out,
@@ -1516,6 +2135,215 @@ template<typename T> DUCC0_NOINLINE void c2r_mut(const vfmav<std::complex<T>> &i
   c2r(in, out, axes.back(), forward, fct, nthreads);
   }
 
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> r2c(const cfmav<Ts> &in,
+  const vfmav<std::complex<T>> &out, size_t axis, bool forward, T fct,
+  size_t nthreads)
+  {
+  util::sanity_check_cr(out, in, axis);
+  if (in.size()==0) return;
+  const auto &out2(reinterpret_cast<const vfmav<Cmplx<T>>&>(out));
+  general_r2c<T,Ts>(in, out2, axis, forward, fct, nthreads);
+  }
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> r2c(const cfmav<Ts> &in,
+  const vfmav<std::complex<T>> &out, const shape_t &axes,
+  bool forward, T fct, size_t nthreads)
+  {
+  util::sanity_check_cr(out, in, axes);
+  if (in.size()==0) return;
+  r2c(in, out, axes.back(), forward, fct, nthreads);
+  if (axes.size()==1) return;
+
+  auto newaxes = shape_t{axes.begin(), --axes.end()};
+  c2c(out, out, newaxes, forward, T(1), nthreads);
+  }
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> c2r(
+  const cfmav<std::complex<T>> &in, const vfmav<Ts> &out, size_t axis,
+  bool forward, T fct, size_t nthreads)
+  {
+  util::sanity_check_cr(in, out, axis);
+  if (in.size()==0) return;
+  const auto &in2(reinterpret_cast<const cfmav<Cmplx<T>>&>(in));
+  general_c2r<T,Ts>(in2, out, axis, forward, fct, nthreads);
+  }
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> c2r(
+  const cfmav<std::complex<T>> &in, const vfmav<Ts> &out,
+  const shape_t &axes, bool forward, T fct, size_t nthreads)
+  {
+  if (axes.size()==1)
+    return c2r(in, out, axes[0], forward, fct, nthreads);
+  util::sanity_check_cr(in, out, axes);
+  if (in.size()==0) return;
+  auto atmp(vfmav<std::complex<T>>::build_noncritical(in.shape(), UNINITIALIZED));
+  auto newaxes = shape_t{axes.begin(), --axes.end()};
+  c2c(in, atmp, newaxes, forward, T(1), nthreads);
+  c2r(atmp, out, axes.back(), forward, fct, nthreads);
+  }
+
+template<typename T, typename Ts> DUCC0_NOINLINE
+  enable_if_t<is_fft_storage16<Ts>::value> c2r_mut(
+  const vfmav<std::complex<T>> &in, const vfmav<Ts> &out,
+  const shape_t &axes, bool forward, T fct, size_t nthreads)
+  {
+  if (axes.size()==1)
+    return c2r(in, out, axes[0], forward, fct, nthreads);
+  util::sanity_check_cr(in, out, axes);
+  if (in.size()==0) return;
+  auto newaxes = shape_t{axes.begin(), --axes.end()};
+  c2c(in, in, newaxes, forward, T(1), nthreads);
+  c2r(in, out, axes.back(), forward, fct, nthreads);
+  }
+
+/// Reusable n-D complex FFT for arrays of a fixed layout
+/** All 1D plans and scratch buffers are set up on construction, so that
+ *  exec() can be called repeatedly on new data without memory allocation.
+ *  The arrays passed to exec() must have the shapes and strides of \a in
+ *  and \a out used at construction; \a inplace specifies whether they will
+ *  share the same memory.
+ *
+ *  In contrast to c2c(), very long 1D transforms are not decomposed into
+ *  2D ones. A plan object must not be executed by several threads at once. */
+template<typename T> class c2c_plan
+  {
+  private:
+    fmav_info iinfo, oinfo;
+    shape_t axes;
+    bool inplace;
+    size_t nthreads;
+    nd_workspace<pocketfft_c<T>,Cmplx<T>> ws;
+
+  public:
+    c2c_plan(const fmav_info &in, const fmav_info &out, const shape_t &axes_,
+      bool inplace_, size_t nthreads_=1)
+      : iinfo(in), oinfo(out), axes(axes_), inplace(inplace_),
+        nthreads(nthreads_)
+      {
+      util::sanity_check_onetype(in, out, inplace, axes);
+      axes = util::c2c_axis_order(in, out, axes, inplace);
+      if (in.size()==0) return;
+      prepare_nd_workspace<pocketfft_c<T>,Cmplx<T>,T>(in, out, axes,
+        nthreads, ws);
+      }
+
+    /// Transforms \a in into \a out, multiplying the result by \a fct.
+    void exec(const cfmav<std::complex<T>> &in,
+      const vfmav<std::complex<T>> &out, bool forward, T fct=T(1))
+      {
+      util::check_layout(iinfo, in);
+      util::check_layout(oinfo, out);
+      MR_assert((in.data()==out.data())==inplace, "in-place setting mismatch");
+      if (in.size()==0) return;
+      const auto &in2(reinterpret_cast<const cfmav<Cmplx<T> >&>(in));
+      const auto &out2(reinterpret_cast<const vfmav<Cmplx<T> >&>(out));
+      general_nd<pocketfft_c<T>>(in2, out2, axes, fct, nthreads,
+        ExecC2C{forward}, true, &ws);
+      }
+  };
+
+/// Reusable n-D real-to-complex FFT for arrays of a fixed layout
+/** The real-valued transform is done along the last entry of \a axes, which
+ *  must have length \a in.shape(axes.back())/2+1 in \a out.
+ *  See c2c_plan for the general properties of plan objects. */
+template<typename T> class r2c_plan
+  {
+  private:
+    fmav_info iinfo, oinfo;
+    shape_t axes;
+    size_t nthreads;
+    nd_workspace<pocketfft_r<T>,T> wsr;
+    nd_workspace<pocketfft_c<T>,Cmplx<T>> wsc;
+
+  public:
+    r2c_plan(const fmav_info &in, const fmav_info &out, const shape_t &axes_,
+      size_t nthreads_=1)
+      : iinfo(in), oinfo(out), axes(axes_), nthreads(nthreads_)
+      {
+      util::sanity_check_cr(out, in, axes);
+      if (in.size()==0) return;
+      prepare_r2c_workspace<T>(in, axes.back(), in.shape(axes.back()),
+        nthreads, wsr);
+      if (axes.size()>1)
+        prepare_nd_workspace<pocketfft_c<T>,Cmplx<T>,T>(out, out,
+          shape_t(axes.begin(), --axes.end()), nthreads, wsc);
+      }
+
+    /// Transforms \a in into \a out, multiplying the result by \a fct.
+    void exec(const cfmav<T> &in, const vfmav<std::complex<T>> &out,
+      bool forward, T fct=T(1))
+      {
+      util::check_layout(iinfo, in);
+      util::check_layout(oinfo, out);
+      if (in.size()==0) return;
+      const auto &out2(reinterpret_cast<const vfmav<Cmplx<T>>&>(out));
+      general_r2c(in, out2, axes.back(), forward, fct, nthreads, &wsr);
+      if (axes.size()==1) return;
+      general_nd<pocketfft_c<T>>(out2, out2,
+        shape_t(axes.begin(), --axes.end()), T(1), nthreads,
+        ExecC2C{forward}, true, &wsc);
+      }
+  };
+
+/// Reusable n-D complex-to-real FFT for arrays of a fixed layout
+/** The real-valued transform is done along the last entry of \a axes; the
+ *  input must have length \a out.shape(axes.back())/2+1 along this axis.
+ *  For multi-axis transforms the plan owns a complex temporary array, so
+ *  that the input is never overwritten.
+ *  See c2c_plan for the general properties of plan objects. */
+template<typename T> class c2r_plan
+  {
+  private:
+    fmav_info iinfo, oinfo;
+    shape_t axes, caxes;
+    size_t nthreads;
+    vfmav<Cmplx<T>> tmp;
+    nd_workspace<pocketfft_r<T>,T> wsr;
+    nd_workspace<pocketfft_c<T>,Cmplx<T>> wsc;
+
+  public:
+    c2r_plan(const fmav_info &in, const fmav_info &out, const shape_t &axes_,
+      size_t nthreads_=1)
+      : iinfo(in), oinfo(out), axes(axes_), nthreads(nthreads_),
+        tmp((axes.size()>1) ?
+          vfmav<Cmplx<T>>::build_noncritical(in.shape(), UNINITIALIZED)
+          : vfmav<Cmplx<T>>())
+      {
+      util::sanity_check_cr(in, out, axes);
+      if (in.size()==0) return;
+      if (axes.size()==1)
+        {
+        prepare_r2c_workspace<T>(in, axes[0], out.shape(axes[0]), nthreads, wsr);
+        return;
+        }
+      caxes = util::c2c_axis_order(in, tmp,
+        shape_t(axes.begin(), --axes.end()), false);
+      prepare_nd_workspace<pocketfft_c<T>,Cmplx<T>,T>(in, tmp, caxes,
+        nthreads, wsc);
+      prepare_r2c_workspace<T>(tmp, axes.back(), out.shape(axes.back()),
+        nthreads, wsr);
+      }
+
+    /// Transforms \a in into \a out, multiplying the result by \a fct.
+    void exec(const cfmav<std::complex<T>> &in, const vfmav<T> &out,
+      bool forward, T fct=T(1))
+      {
+      util::check_layout(iinfo, in);
+      util::check_layout(oinfo, out);
+      if (in.size()==0) return;
+      const auto &in2(reinterpret_cast<const cfmav<Cmplx<T>>&>(in));
+      if (axes.size()==1)
+        return general_c2r(in2, out, axes[0], forward, fct, nthreads, &wsr);
+      general_nd<pocketfft_c<T>>(in2, tmp, caxes, T(1), nthreads,
+        ExecC2C{forward}, true, &wsc);
+      general_c2r(tmp, out, axes.back(), forward, fct, nthreads, &wsr);
+      }
+  };
+
 template<typename T> DUCC0_NOINLINE void r2r_fftpack(const cfmav<T> &in,
   const vfmav<T> &out, const shape_t &axes, bool real2hermitian, bool forward,
   T fct, size_t nthreads)
@@ -1876,8 +2704,251 @@ template<typename T> DUCC0_NOINLINE void convolve_axis(const cfmav<complex<T>> &
     ExecConv1C());
   }
 
+/// Fast linear convolution or correlation with a fixed kernel
+/** The kernel spectrum is computed once on construction. apply() filters
+ *  every 1D line of an n-D array along a given axis with the overlap-save
+ *  method: the line is copied into the per-thread scratch buffers, and each
+ *  block of length fftlen() is transformed, multiplied with the kernel
+ *  spectrum and transformed back without leaving these buffers, so no
+ *  complex intermediate array is ever created.
+ *  process() does the same for a single long stream arriving in chunks; the
+ *  last kernel_length()-1 samples of the stream are kept inside the object.
+ *
+ *  For convolution, output sample \a i along the axis is
+ *  sum_j kernel(j)*in(i+shift-j). Correlation is carried out as convolution
+ *  with the reversed and conjugated kernel, i.e. output sample \a i is
+ *  sum_j conj(kernel(j))*in(i+shift+j-kernel_length()+1). Input samples
+ *  outside the array (or before the start of a stream) are treated as zero.
+ *
+ *  \a T can be float, double, long double or their complex counterparts.
+ *  A convolver object must not be used by several threads at once. */
+template<typename T> class fft_convolver
+  {
+  private:
+    template<typename T2> struct realtype { using type=T2; };
+    template<typename T2> struct realtype<complex<T2>> { using type=T2; };
+    using T0 = typename realtype<T>::type;
+    static constexpr bool is_cmplx = !is_same<T,T0>::value;
+    using Td = conditional_t<is_cmplx, Cmplx<T0>, T0>;
+    using Tplan = conditional_t<is_cmplx, pocketfft_c<T0>, pocketfft_r<T0>>;
+
+    size_t klen, N, M;
+    unique_ptr<Tplan> plan;
+    aligned_array<Td> kspec, hist, sbuf;
+
+    static size_t good_len(size_t n)
+      {
+      return is_cmplx ? util1d::good_size_cmplx(n) : util1d::good_size_real(n);
+      }
+    /* returns the transform length with the lowest estimated cost per output
+       sample for a kernel of length klen */
+    static size_t best_len(size_t klen)
+      {
+      size_t res=0;
+      double bestcost=1e300;
+      for (size_t n=good_len(max<size_t>(2*klen,64)); n<=max<size_t>(32*klen,1024);
+           n=good_len(n+1))
+        {
+        double cost = n*log2(double(n))/double(n-klen+1);
+        if (cost<bestcost) { bestcost=cost; res=n; }
+        }
+      return res;
+      }
+
+    /* replaces the N-point block x by its circular convolution with the
+       kernel; buf must hold plan->bufsize() elements. */
+    template<typename Tv> void convolve_block(Tv *x, Tv *buf) const
+      {
+      plan->exec_copyback(x, buf, T0(1), true);
+      if constexpr (is_cmplx)
+        for (size_t i=0; i<N; ++i)
+          x[i] = x[i]*kspec[i];
+      else
+        {
+        x[0] *= kspec[0];
+        size_t i=1;
+        for (; i+1<N; i+=2)
+          {
+          Cmplx<Tv> t1(x[i], x[i+1]);
+          auto t3 = t1*Cmplx<T0>(kspec[i], kspec[i+1]);
+          x[i] = t3.r;
+          x[i+1] = t3.i;
+          }
+        if (i<N)
+          x[i] *= kspec[i];
+        }
+      plan->exec_copyback(x, buf, T0(1), false);
+      }
+
+    /* convolves one batch of lines; the line data is in lin, results go to
+       lout */
+    template<typename Tv> void convolve_lines(const Tv *lin, size_t n_in,
+      Tv *lout, size_t n_out, ptrdiff_t shift, Tv *x, Tv *buf) const
+      {
+      for (size_t o=0; o<n_out; o+=M)
+        {
+        ptrdiff_t start = ptrdiff_t(o)+shift-ptrdiff_t(klen-1);
+        for (size_t t=0; t<N; ++t)
+          {
+          ptrdiff_t idx = start+ptrdiff_t(t);
+          x[t] = ((idx>=0) && (idx<ptrdiff_t(n_in))) ? lin[idx] : Tv(T0(0));
+          }
+        convolve_block(x, buf);
+        size_t nout = min(M, n_out-o);
+        for (size_t m=0; m<nout; ++m)
+          lout[o+m] = x[klen-1+m];
+        }
+      }
+
+  public:
+    /// Sets up the convolver for \a kernel. If \a fftlen is 0, a suitable
+    /// block length is chosen automatically; otherwise it must be at least
+    /// the kernel length.
+    fft_convolver(const cmav<T,1> &kernel, bool correlate=false, size_t fftlen=0)
+      : klen(kernel.shape(0)), N((fftlen==0) ? best_len(klen) : fftlen),
+        M(N+1-klen),
+        plan(make_unique<Tplan>(N)), kspec(N), hist(klen-1),
+        sbuf(N+plan->bufsize())
+      {
+      MR_assert(klen>0, "empty kernel");
+      MR_assert(N>=klen, "fftlen must not be smaller than the kernel");
+      for (size_t i=0; i<N; ++i) kspec[i] = Td(T0(0));
+      for (size_t i=0; i<klen; ++i)
+        {
+        const auto &k(correlate ? kernel(klen-1-i) : kernel(i));
+        if constexpr (is_cmplx)
+          kspec[i] = correlate ? Td(k.real(), -k.imag()) : Td(k.real(), k.imag());
+        else
+          kspec[i] = k;
+        }
+      plan->exec(kspec.data(), T0(1)/T0(N), true);
+      reset();
+      }
+
+    size_t kernel_length() const { return klen; }
+    size_t fftlen() const { return N; }
+
+    /// Filters all 1D lines of \a in along \a axis and stores the results in
+    /// \a out, which may have a different length along \a axis.
+    /** \a in and \a out may share memory, in which case they must have
+     *  identical strides. */
+    void apply(const cfmav<T> &in, const vfmav<T> &out, size_t axis,
+      ptrdiff_t shift=0, size_t nthreads=1) const
+      {
+      MR_assert(axis<in.ndim(), "bad axis number");
+      MR_assert(in.ndim()==out.ndim(), "dimensionality mismatch");
+      if (in.data()==out.data())
+        MR_assert(in.stride()==out.stride(), "strides mismatch");
+      for (size_t i=0; i<in.ndim(); ++i)
+        if (i!=axis)
+          MR_assert(in.shape(i)==out.shape(i), "shape mismatch");
+      if ((in.size()==0) || (out.size()==0)) return;
+      const auto &in2(reinterpret_cast<const cfmav<Td>&>(in));
+      const auto &out2(reinterpret_cast<const vfmav<Td>&>(out));
+      size_t n_in=in.shape(axis), n_out=out.shape(axis);
+      size_t bufsz = plan->bufsize();
+      execParallel(
+        util::thread_count(nthreads, in, axis, fft_simdlen<T0>),
+        [&](Scheduler &sched) {
+          constexpr auto vlen = fft_simdlen<T0>;
+          TmpStorage<Td,T0> storage(in.size()/n_in, n_in+n_out+N, bufsz, 1, false);
+          multi_iter<vlen> it(in2, out2, axis, sched.num_threads(), sched.thread_num());
+          auto work = [&](auto &storage2)
+            {
+            auto lin = storage2.dataBuf(),
+                 lout = lin+n_in,
+                 x = lout+n_out;
+            copy_input(it, in2, lin);
+            convolve_lines(lin, n_in, lout, n_out, shift, x,
+              storage2.transformBuf());
+            copy_output(it, lout, out2);
+            };
+#ifndef DUCC0_NO_SIMD
+          if constexpr (vlen>1)
+            {
+            TmpStorage2<add_vec_t<Td, vlen>,Td,T0> storage2(storage);
+            while (it.remaining()>=vlen)
+              {
+              it.advance(vlen);
+              work(storage2);
+              }
+            }
+          if constexpr (vlen>2)
+            if constexpr (simd_exists<T0,vlen/2>)
+              if (it.remaining()>=vlen/2)
+                {
+                TmpStorage2<add_vec_t<Td, vlen/2>,Td,T0> storage2(storage);
+                it.advance(vlen/2);
+                work(storage2);
+                }
+          if constexpr (vlen>4)
+            if constexpr (simd_exists<T0,vlen/4>)
+              if (it.remaining()>=vlen/4)
+                {
+                TmpStorage2<add_vec_t<Td, vlen/4>,Td,T0> storage2(storage);
+                it.advance(vlen/4);
+                work(storage2);
+                }
+#endif
+          {
+          TmpStorage2<Td,Td,T0> storage2(storage);
+          while (it.remaining()>0)
+            {
+            it.advance(1);
+            work(storage2);
+            }
+          }
+        });  // end of parallel region
+      }
+
+    /// Filters the next chunk \a in of a stream and stores the results in
+    /// \a out, which must have the same length and must not overlap with
+    /// \a in.
+    /** This is equivalent to apply() with shift 0 on the concatenation of
+     *  all chunks since construction or the last call to reset(). */
+    void process(const cmav<T,1> &in, const vmav<T,1> &out)
+      {
+      size_t n=in.shape(0);
+      MR_assert(out.shape(0)==n, "shape mismatch");
+      MR_assert((n==0) || (in.data()!=out.data()), "in and out must not overlap");
+      const auto &in2(reinterpret_cast<const cmav<Td,1>&>(in));
+      auto &out2(reinterpret_cast<const vmav<Td,1>&>(out));
+      // the virtual input is hist followed by in
+      auto sample = [&](size_t p)
+        { return (p<klen-1) ? hist[p] : ((p-(klen-1)<n) ? in2(p-(klen-1)) : Td(T0(0))); };
+      Td *x = sbuf.data(), *buf = x+N;
+      for (size_t o=0; o<n; o+=M)
+        {
+        for (size_t t=0; t<N; ++t)
+          x[t] = sample(o+t);
+        convolve_block(x, buf);
+        size_t nout = min(M, n-o);
+        for (size_t m=0; m<nout; ++m)
+          out2(o+m) = x[klen-1+m];
+        }
+      // keep the last klen-1 samples of the virtual input
+      for (size_t p=0; p+1<klen; ++p)
+        hist[p] = sample(p+n);
+      }
+
+    /// Starts a new stream.
+    void reset()
+      {
+      for (size_t i=0; i+1<klen; ++i) hist[i] = Td(T0(0));
+      }
+  };
+
 } // namespace detail_fft
 
+using detail_fft::fft_plan_cache_info;
+using detail_fft::set_fft_plan_cache_limits;
+using detail_fft::get_fft_plan_cache_info;
+using detail_fft::clear_fft_plan_cache;
+using detail_fft::c2c_plan;
+using detail_fft::r2c_plan;
+using detail_fft::c2r_plan;
+using detail_fft::fft_convolver;
+
 } // namespace ducc0
 
 #endif // POCKETFFT_HDRONLY_H
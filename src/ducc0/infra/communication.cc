@@ -21,6 +21,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <complex>
 #include <numeric>
 #include <unordered_map>
 #include "ducc0/infra/communication.h"
@@ -48,6 +49,8 @@ class Typemap: public TypeMapper<MPI_Datatype>
       add<long>(MPI_LONG);
       add<char>(MPI_CHAR);
       add<unsigned char>(MPI_BYTE);
+      add<complex<float>>(MPI_CXX_FLOAT_COMPLEX);
+      add<complex<double>>(MPI_CXX_DOUBLE_COMPLEX);
       // etc.
       }
    };
@@ -231,23 +234,35 @@ void Communicator::redistributeRawVoid(const fmav_info &iin, const void *in,
   auto s_out = allgatherVec(int(iout.shape(axout)));
   MR_assert(int(iin.shape(axout))==reduce(s_out.begin(), s_out.end()), "inconsistency");
 
+  // The byte offsets of the individual blocks can exceed the range of int
+  // for large local arrays, so they are stored in the data types, and all
+  // displacements passed to MPI_Alltoallw are zero.
+  auto with_offset = [](MPI_Datatype tp, MPI_Aint ofs)
+    {
+    MPI_Datatype res;
+    int one=1;
+    MPI_Type_create_hindexed(1, &one, &ofs, tp, &res);
+    MPI_Type_commit(&res);
+    MPI_Type_free(&tp);
+    return res;
+    };
   vector<MPI_Datatype> v_in(nranks), v_out(nranks);
+  MPI_Aint ofs_in=0, ofs_out=0;
   for (size_t i=0; i<nranks; ++i)
     {
     auto tmp = iin.shape();
     tmp[axout] = s_out[i];
-    v_in[i] = fmav2mpidt(fmav_info(tmp, iin.stride()), type);
+    v_in[i] = with_offset(fmav2mpidt(fmav_info(tmp, iin.stride()), type),
+                          ofs_in);
     tmp = iout.shape();
     tmp[axin] = s_in[i];
-    v_out[i] = fmav2mpidt(fmav_info(tmp, iout.stride()), type);
+    v_out[i] = with_offset(fmav2mpidt(fmav_info(tmp, iout.stride()), type),
+                           ofs_out);
+    ofs_in += MPI_Aint(s_out[i])*iin.stride(axout)*MPI_Aint(typesize(type));
+    ofs_out += MPI_Aint(s_in[i])*iout.stride(axin)*MPI_Aint(typesize(type));
     }
 
-  vector<int> disp_in(nranks), disp_out(nranks);
-  for (size_t i=0; i<nranks; ++i)
-    {
-    disp_in[i] = (i==0) ? 0 : disp_in[i-1]+s_out[i-1]*iin.stride(axout)*typesize(type);
-    disp_out[i] = (i==0) ? 0 : disp_out[i-1]+s_in[i-1]*iout.stride(axin)*typesize(type);
-    }
+  vector<int> disp_in(nranks, 0), disp_out(nranks, 0);
   vector<int> num(nranks, 1);
 
   MPI_Alltoallw(in, num.data(), disp_in.data(), v_in.data(),
@@ -861,4 +861,65 @@ using detail_simd::vectorizable;
 
 }
 #endif
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <sys/prctl.h>
+#endif
+
+namespace ducc0 {
+
+namespace detail_simd {
+
+/// SIMD capabilities of the CPU the program is running on
+/** In contrast to native_simd, which reflects the compiler flags, this is
+ *  determined at run time, so that code can choose between the SIMD widths
+ *  it was compiled for. */
+struct simd_cpu_info
+  {
+  bool avx=false, avx2=false, fma=false, avx512f=false, neon=false, sve=false;
+  /// width (in bytes) of the widest vector registers supported by the CPU
+  size_t max_vector_bytes=0;
+  };
+
+inline const simd_cpu_info &simd_cpu_features()
+  {
+  static const simd_cpu_info info = []
+    {
+    simd_cpu_info res;
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+    __builtin_cpu_init();
+    res.avx = __builtin_cpu_supports("avx");
+    res.avx2 = __builtin_cpu_supports("avx2");
+    res.fma = __builtin_cpu_supports("fma");
+    res.avx512f = __builtin_cpu_supports("avx512f");
+    res.max_vector_bytes = res.avx512f ? 64 : (res.avx ? 32 : 16);
+#elif defined(__aarch64__)
+    res.neon = true;
+    res.max_vector_bytes = 16;
+#if defined(__linux__) && defined(HWCAP_SVE) && defined(PR_SVE_GET_VL)
+    res.sve = (getauxval(AT_HWCAP)&HWCAP_SVE)!=0;
+    if (res.sve)
+      {
+      int vl = prctl(PR_SVE_GET_VL);
+      if (vl>0)
+        res.max_vector_bytes = size_t(vl&PR_SVE_VL_LEN_MASK);
+      }
+#endif
+#endif
+    // unknown platform: trust the compiler flags
+    if (res.max_vector_bytes==0)
+      res.max_vector_bytes = native_simd<double>::size()*sizeof(double);
+    return res;
+    }();
+  return info;
+  }
+
+}
+
+using detail_simd::simd_cpu_info;
+using detail_simd::simd_cpu_features;
+
+}
+
 #endif
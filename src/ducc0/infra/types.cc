@@ -20,6 +20,7 @@
    Author: Martin Reinecke */
 
 #include <cstdint>
+#include <complex>
 
 #include "ducc0/infra/types.h"
 
@@ -44,7 +45,8 @@ class Sizemap: public TypeMapper<size_t>
     Sizemap()
       {
       addTypes<double, float, int, long, size_t, ptrdiff_t,
-               int32_t, int64_t, uint32_t, uint64_t>();
+               int32_t, int64_t, uint32_t, uint64_t,
+               complex<float>, complex<double>>();
       }
    };
 
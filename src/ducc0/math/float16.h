@@ -0,0 +1,174 @@
+/** \file ducc0/math/float16.h
+ *  16-bit floating-point types for compact data storage
+ *
+ *  \copyright Copyright (C) 2023 Max-Planck-Society
+ *  \author Martin Reinecke
+ */
+
+/* SPDX-License-Identifier: BSD-3-Clause OR GPL-2.0-or-later */
+
+/*
+All rights reserved.
+
+Redistribution and use in source and binary forms, with or without modification,
+are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this
+  list of conditions and the following disclaimer.
+* Redistributions in binary form must reproduce the above copyright notice, this
+  list of conditions and the following disclaimer in the documentation and/or
+  other materials provided with the distribution.
+* Neither the name of the copyright holder nor the names of its contributors may
+  be used to endorse or promote products derived from this software without
+  specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR
+ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+(INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON
+ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+(INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef DUCC0_FLOAT16_H
+#define DUCC0_FLOAT16_H
+
+#include <cstdint>
+#include <cstring>
+#if defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace ducc0 {
+
+namespace detail_float16 {
+
+using namespace std;
+
+/// IEEE 754 half-precision number
+/** Only meant for storage: there is no arithmetic, just conversion from and
+ *  to float (with rounding to nearest even). */
+struct float16
+  {
+  uint16_t bits;
+
+  float16() = default;
+  explicit float16(float v) : bits(from_float(v)) {}
+  operator float() const { return to_float(bits); }
+
+  static uint16_t from_float(float v)
+    {
+#if defined(__F16C__)
+    return uint16_t(_cvtss_sh(v, _MM_FROUND_TO_NEAREST_INT));
+#else
+    uint32_t x;
+    memcpy(&x, &v, 4);
+    uint32_t sign = (x>>16)&0x8000u;
+    x &= 0x7fffffffu;
+    if (x>=0x47800000u)  // overflow, Inf or NaN
+      return uint16_t(sign | ((x>0x7f800000u) ? 0x7e00u : 0x7c00u));
+    if (x<0x38800000u)  // result is subnormal or zero
+      {
+      // let the FPU do the rounding by adding a suitable power of two
+      constexpr uint32_t magic_bits = 0x3f000000u;  // 0.5f
+      float magic, tmp;
+      memcpy(&magic, &magic_bits, 4);
+      memcpy(&tmp, &x, 4);
+      tmp += magic;
+      memcpy(&x, &tmp, 4);
+      return uint16_t(sign | (x-magic_bits));
+      }
+    uint32_t odd = (x>>13)&1u;
+    x += 0xc8000fffu + odd;  // rebias exponent and round
+    return uint16_t(sign | (x>>13));
+#endif
+    }
+  static float to_float(uint16_t h)
+    {
+#if defined(__F16C__)
+    return _cvtsh_ss(h);
+#else
+    constexpr uint32_t expmask = 0x7c00u<<13;
+    uint32_t x = uint32_t(h&0x7fffu)<<13;
+    uint32_t exp = x&expmask;
+    x += (127-15)<<23;
+    float res;
+    if (exp==expmask)  // Inf or NaN
+      x += (128-16)<<23;
+    else if (exp==0)  // zero or subnormal: renormalize
+      {
+      constexpr uint32_t magic_bits = 113u<<23;
+      float magic;
+      memcpy(&magic, &magic_bits, 4);
+      x += 1u<<23;
+      memcpy(&res, &x, 4);
+      res -= magic;
+      memcpy(&x, &res, 4);
+      }
+    x |= uint32_t(h&0x8000u)<<16;
+    memcpy(&res, &x, 4);
+    return res;
+#endif
+    }
+  };
+
+/// "Brain floating point" number (the upper half of an IEEE float)
+/** Only meant for storage: there is no arithmetic, just conversion from and
+ *  to float (with rounding to nearest even). */
+struct bfloat16
+  {
+  uint16_t bits;
+
+  bfloat16() = default;
+  explicit bfloat16(float v) : bits(from_float(v)) {}
+  operator float() const { return to_float(bits); }
+
+  static uint16_t from_float(float v)
+    {
+    uint32_t x;
+    memcpy(&x, &v, 4);
+    if ((x&0x7fffffffu)>0x7f800000u)  // NaN: keep it quiet
+      return uint16_t((x>>16)|0x40u);
+    x += 0x7fffu + ((x>>16)&1u);
+    return uint16_t(x>>16);
+    }
+  static float to_float(uint16_t h)
+    {
+    uint32_t x = uint32_t(h)<<16;
+    float res;
+    memcpy(&res, &x, 4);
+    return res;
+    }
+  };
+
+static_assert(sizeof(float16)==2, "unexpected size of float16");
+static_assert(sizeof(bfloat16)==2, "unexpected size of bfloat16");
+
+}
+
+using detail_float16::float16;
+using detail_float16::bfloat16;
+
+}
+
+#endif
@@ -33,6 +33,7 @@
 #include <array>
 #include <cstddef>
 #include <vector>
+#include <memory>
 #include "ducc0/infra/simd.h"
 #include "ducc0/infra/threading.h"
 #include "ducc0/infra/mav.h"
@@ -119,6 +120,8 @@ class Alm_Base
     size_t Lmax() const { return lmax; }
     /*! Returns the maximum \a m */
     size_t Mmax() const { return mval.back(); }
+    /*! Returns the (ascending) \a m values present in the set. */
+    const vector<size_t> &Mval() const { return mval; }
 
     size_t n_entries() const { return arrsize; }
 
@@ -139,6 +142,63 @@ class Alm_Base
       { return mval.size() == lmax+1; }
   };
 
+/*! Computes the auto- and cross-power spectra of the a_lm sets in \a alm
+    (shape (nsets, base.Num_Alms())):
+      cl(i,j,l) = 1/(2l+1) * sum_{m=-l}^{l} Re(a^i_lm conj(a^j_lm)),
+    i.e. coefficients with m>0 are counted twice. Only the m values present
+    in \a base contribute. \a cl must have shape (nsets, nsets, lmax+1).
+    The work is distributed over blocks of l; within a block all m are
+    visited in storage order, so every a_lm is read exactly once. */
+template<typename T> void alm2cl(const cmav<complex<T>,2> &alm,
+  const Alm_Base &base, const vmav<double,3> &cl, size_t nthreads)
+  {
+  constexpr size_t lblock=64;
+  auto lmax=base.Lmax();
+  auto nsets=alm.shape(0);
+  MR_assert(alm.shape(1)>=base.Num_Alms(), "bad size of a_lm array");
+  MR_assert((cl.shape(0)==nsets) && (cl.shape(1)==nsets)
+    && (cl.shape(2)==lmax+1), "bad shape of cl array");
+  const auto &mval(base.Mval());
+  size_t npairs = (nsets*(nsets+1))/2;
+  execDynamic((lmax+lblock)/lblock, nthreads, 1, [&](Scheduler &sched)
+    {
+    vector<double> acc(npairs*lblock);
+    vector<double> re(nsets*lblock), im(nsets*lblock);
+    while (auto rng=sched.getNext()) for(auto ib=rng.lo; ib<rng.hi; ++ib)
+      {
+      size_t llo=ib*lblock, lhi=min(lmax+1, llo+lblock);
+      fill(acc.begin(), acc.end(), 0.);
+      for (auto m: mval)
+        {
+        if (m>=lhi) break;
+        double wgt = (m==0) ? 1. : 2.;
+        size_t l0=max(m,llo), nl=lhi-l0;
+        auto idx0 = base.index(l0,m);
+        for (size_t i=0; i<nsets; ++i)
+          for (size_t l=0; l<nl; ++l)
+            {
+            auto v = alm(i,idx0+l);
+            re[i*lblock+l] = double(v.real());
+            im[i*lblock+l] = double(v.imag());
+            }
+        for (size_t i=0, ip=0; i<nsets; ++i)
+          for (size_t j=i; j<nsets; ++j, ++ip)
+            {
+            double * DUCC0_RESTRICT ptr = acc.data()+ip*lblock+(l0-llo);
+            const double *ri=re.data()+i*lblock, *ii=im.data()+i*lblock;
+            const double *rj=re.data()+j*lblock, *ij=im.data()+j*lblock;
+            for (size_t l=0; l<nl; ++l)
+              ptr[l] += wgt*(ri[l]*rj[l]+ii[l]*ij[l]);
+            }
+        }
+      for (size_t i=0, ip=0; i<nsets; ++i)
+        for (size_t j=i; j<nsets; ++j, ++ip)
+          for (size_t l=llo; l<lhi; ++l)
+            cl(i,j,l) = cl(j,i,l) = acc[ip*lblock+l-llo]/(2*l+1);
+      }
+    });
+  }
+
 
 // the following struct is an adaptation of the algorithms found in
 // https://github.com/MikaelSlevinsky/FastTransforms
@@ -308,6 +368,51 @@ struct ft_partial_sph_isometry_plan
         return j;
         }
 
+      template<typename Tv> DUCC0_NOINLINE int matrix_helper
+        (int jmin, vector<double> &res) const
+        {
+        constexpr double eps = 0x1p-52;
+        constexpr double floatmin = 0x1p-300;
+        constexpr size_t vlen=Tv::size();
+
+        vector<Tv> col(size_t(max(n,0)));
+        int j=jmin;
+        for (; j+int(vlen)<=n; j+=int(vlen))
+          {
+          Tv vk(1), vkp1(0), nrm(1), X(&lambda[j], element_aligned_tag());
+          col[n-1] = vk;
+          for (int k=n-1; k>0; --k)
+            {
+            Tv vkm1;
+            if constexpr(high_accuracy)
+              vkm1 = Tv(A[k])*((X+Tv(B[k]))*vk - Tv(C[k])*vkp1);
+            else
+              vkm1 = (Tv(A[k])*X+Tv(B[k]))*vk - Tv(C[k])*vkp1;
+            vkp1 = vk;
+            vk = vkm1;
+            nrm += vkm1*vkm1;
+            col[k-1] = vkm1;
+            if (any_of(nrm > Tv(eps/floatmin)))
+              {
+              nrm = Tv(1.0)/sqrt(nrm);
+              vkp1 *= nrm;
+              vk *= nrm;
+              for (int i=k-1; i<n; ++i)
+                col[i] *= nrm;
+              nrm = Tv(1.0);
+              }
+            }
+          for (size_t q=0; q<vlen; ++q)
+            {
+            double fct = copysign(1.0/sqrt(nrm[q]), sign*vk[q]);
+            double *row = res.data()+size_t(j+q)*size_t(n);
+            for (int i=0; i<n; ++i)
+              row[i] = col[i][q]*fct;
+            }
+          }
+        return j;
+        }
+
     public:
       ft_symmetric_tridiagonal_symmetric_eigen() {}
       ft_symmetric_tridiagonal_symmetric_eigen(size_t nmax)
@@ -361,6 +466,17 @@ struct ft_partial_sph_isometry_plan
           }
         eval_helper<typename simd_select<double,1>::type,1>(j, x, y);
         }
+
+      /*! Computes the (n x n, row-major) matrix \a res that satisfies
+          eval(x)[j] == sum_k res[j*n+k]*x[k]. */
+      void matrix (vector<double> &res) const
+        {
+        res.resize(size_t(max(n,0))*size_t(max(n,0)));
+        int j=0;
+        if constexpr (vectorizable<double>)
+          j = matrix_helper<native_simd<double>>(j, res);
+        matrix_helper<typename simd_select<double,1>::type>(j, res);
+        }
     };
 
   ft_symmetric_tridiagonal T;
@@ -515,10 +631,299 @@ template<typename T> void rotate_alm (const Alm_Base &base, const vmav<complex<T
   else
     rot_azimuth(phi+psi);
   }
+
+/*! Class for rotating batches of a_lm sets (with lmax==mmax, stored in the
+    standard triangular order) by one or several sets of Euler angles.
+
+    The y-z exchange used by rotate_alm() is expressed, for every l, by four
+    real matrices (the Wigner d matrices at pi/2, split by parity).
+    These are computed once at construction time if their total size does not
+    exceed \a max_bytes, otherwise they are recomputed per l during every
+    call. In both cases they are applied to all a_lm sets of a batch at once,
+    which replaces the per-set eigenvector recurrences of rotate_alm() by
+    dense matrix products. */
+class Alm_Rotator
+  {
+  private:
+    struct ymatrices
+      {
+      size_t n11, n22, n21, n12;
+      vector<double> m11, m22, m21, m12;
+      };
+
+    size_t lmax;
+    Alm_Base base;
+    vector<ymatrices> mats; // indexed by l; empty if not cached
+
+    static void compute_matrices(ft_partial_sph_isometry_plan &F, size_t l,
+      ymatrices &res)
+      {
+      F.Set(int(l));
+      res.n11 = size_t(F.F11.n);
+      res.n22 = size_t(F.F22.n);
+      res.n21 = size_t(F.F21.n);
+      res.n12 = size_t(F.F12.n);
+      F.F11.matrix(res.m11);
+      F.F22.matrix(res.m22);
+      F.F21.matrix(res.m21);
+      F.F12.matrix(res.m12);
+      // absorb the normalization of the m=0 coefficients
+      const double sq2 = sqrt(2.);
+      if (l%2==0)
+        for (size_t j=0; j<res.n22; ++j)
+          {
+          res.m22[j*res.n22] /= sq2;
+          res.m22[j] *= sq2;
+          }
+      else
+        {
+        for (size_t k=0; k<res.n21; ++k)
+          res.m21[k] *= sq2;
+        for (size_t j=0; j<res.n12; ++j)
+          res.m12[j*res.n12] /= sq2;
+        }
+      }
+
+    static size_t matrix_bytes(size_t lmax)
+      {
+      size_t res=0;
+      for (size_t l=2; l<=lmax; ++l)
+        {
+        size_t n11=l/2, n21=(l+1)/2, n22=(l+2)/2;
+        res += (n11*n11 + 2*n21*n21 + n22*n22)*sizeof(double);
+        }
+      return res;
+      }
+
+    // out(j,v) = sum_k mat(j,k)*in(k,v), with n rows/columns and a row
+    // stride of nvp (1 or a multiple of the SIMD length) in "in" and "out"
+    static void apply_matrix(const vector<double> &mat, size_t n,
+      const vector<double> &in, vector<double> &out, size_t nvp)
+      {
+      if (nvp==1)
+        {
+        for (size_t j=0; j<n; ++j)
+          {
+          const double *DUCC0_RESTRICT row = mat.data()+j*n;
+          double res=0;
+          for (size_t k=0; k<n; ++k)
+            res += row[k]*in[k];
+          out[j] = res;
+          }
+        return;
+        }
+      using Tv = native_simd<double>;
+      constexpr size_t vlen = Tv::size();
+      size_t j=0;
+      for (; j+4<=n; j+=4)
+        {
+        const double *DUCC0_RESTRICT r0 = mat.data()+j*n;
+        const double *DUCC0_RESTRICT r1 = r0+n, *DUCC0_RESTRICT r2 = r1+n,
+                     *DUCC0_RESTRICT r3 = r2+n;
+        for (size_t v=0; v<nvp; v+=vlen)
+          {
+          Tv a0=0, a1=0, a2=0, a3=0;
+          for (size_t k=0; k<n; ++k)
+            {
+            Tv x(&in[k*nvp+v], element_aligned_tag());
+            a0 += r0[k]*x;
+            a1 += r1[k]*x;
+            a2 += r2[k]*x;
+            a3 += r3[k]*x;
+            }
+          a0.copy_to(&out[j*nvp+v], element_aligned_tag());
+          a1.copy_to(&out[(j+1)*nvp+v], element_aligned_tag());
+          a2.copy_to(&out[(j+2)*nvp+v], element_aligned_tag());
+          a3.copy_to(&out[(j+3)*nvp+v], element_aligned_tag());
+          }
+        }
+      for (; j<n; ++j)
+        {
+        const double *DUCC0_RESTRICT r0 = mat.data()+j*n;
+        for (size_t v=0; v<nvp; v+=vlen)
+          {
+          Tv a0=0;
+          for (size_t k=0; k<n; ++k)
+            a0 += r0[k]*Tv(&in[k*nvp+v], element_aligned_tag());
+          a0.copy_to(&out[j*nvp+v], element_aligned_tag());
+          }
+        }
+      }
+
+    // operates on a_lm sets stored in the transposed layout alm(index, set)
+    template<typename T> void xchg_yz(const vmav<complex<T>,2> &alm,
+      size_t nthreads) const
+      {
+      size_t nvec = alm.shape(1);
+      if (lmax>0) // deal with l==1
+        for (size_t v=0; v<nvec; ++v)
+          {
+          auto t = T(-alm(base.index(1,0),v).real()/sqrt(2.));
+          alm(base.index(1,0),v).real(T(-alm(base.index(1,1),v).imag()*sqrt(2.)));
+          alm(base.index(1,1),v).imag(t);
+          }
+      if (lmax<=1) return;
+      execDynamic(lmax-1,nthreads,1,[&](ducc0::Scheduler &sched)
+        {
+        constexpr size_t vlen = native_simd<double>::size();
+        size_t nvp = (nvec==1) ? 1 : ((nvec+vlen-1)/vlen)*vlen;
+        size_t bufsz = ((lmax+2)/2)*nvp;
+        vector<double> in(bufsz), out(bufsz), in2(bufsz);
+        unique_ptr<ft_partial_sph_isometry_plan> F;
+        ymatrices tmp;
+        if (mats.empty())
+          F = make_unique<ft_partial_sph_isometry_plan>(int(lmax));
+        auto gather = [&](size_t l, size_t mstart, size_t n, bool imag,
+          vector<double> &buf)
+          {
+          for (size_t i=0; i<n; ++i)
+            for (size_t v=0; v<nvec; ++v)
+              {
+              auto val = alm(base.index(l,mstart+2*i),v);
+              buf[i*nvp+v] = imag ? val.imag() : val.real();
+              }
+          };
+        auto scatter = [&](size_t l, size_t mstart, size_t n, bool imag,
+          const vector<double> &buf)
+          {
+          for (size_t i=0; i<n; ++i)
+            for (size_t v=0; v<nvec; ++v)
+              {
+              auto &val = alm(base.index(l,mstart+2*i),v);
+              if (imag)
+                val.imag(T(buf[i*nvp+v]));
+              else
+                val.real(T(buf[i*nvp+v]));
+              }
+          };
+        // iterate downwards in l to get the smaller work packages at the end
+        while (auto rng=sched.getNext()) for(auto l=lmax-rng.lo; l+rng.hi>lmax; --l)
+          {
+          if (mats.empty())
+            compute_matrices(*F, l, tmp);
+          const auto &M(mats.empty() ? tmp : mats[l]);
+
+          size_t mstart = 1+(l%2);
+          gather(l, mstart, M.n11, true, in);
+          apply_matrix(M.m11, M.n11, in, out, nvp);
+          scatter(l, mstart, M.n11, true, out);
+
+          mstart = l%2;
+          gather(l, mstart, M.n22, false, in);
+          apply_matrix(M.m22, M.n22, in, out, nvp);
+          scatter(l, mstart, M.n22, false, out);
+
+          gather(l, 2-(l%2), M.n21, true, in);
+          gather(l, 1-(l%2), M.n12, false, in2);
+          apply_matrix(M.m21, M.n21, in, out, nvp);
+          scatter(l, 1-(l%2), M.n12, false, out);
+          apply_matrix(M.m12, M.n12, in2, out, nvp);
+          scatter(l, 2-(l%2), M.n21, true, out);
+          }
+        });
+      }
+
+    template<typename T> void rot_azimuth(const vmav<complex<T>,2> &alm,
+      const vector<double> &ang) const
+      {
+      size_t nvec = alm.shape(1);
+      vector<complex<T>> expang(nvec);
+      for (size_t m=0; m<=lmax; ++m)
+        {
+        for (size_t v=0; v<nvec; ++v)
+          expang[v] = complex<T>(polar(1.,-ang[v]*m));
+        for (size_t l=m; l<=lmax; ++l)
+          for (size_t v=0; v<nvec; ++v)
+            alm(base.index(l,m),v)*=expang[v];
+        }
+      }
+
+  public:
+    /*! Prepares rotations of a_lm sets with maximum multipole \a lmax.
+        The y-z exchange matrices are kept if they need at most
+        \a max_bytes of memory. */
+    Alm_Rotator(size_t lmax_, size_t nthreads=1,
+      size_t max_bytes=size_t(1)<<30)
+      : lmax(lmax_), base(lmax_, lmax_)
+      {
+      if ((lmax<2) || (matrix_bytes(lmax)>max_bytes)) return;
+      mats.resize(lmax+1);
+      execDynamic(lmax-1,nthreads,1,[&](ducc0::Scheduler &sched)
+        {
+        ft_partial_sph_isometry_plan F(static_cast<int>(lmax));
+        while (auto rng=sched.getNext()) for(auto l=lmax-rng.lo; l+rng.hi>lmax; --l)
+          compute_matrices(F, l, mats[l]);
+        });
+      }
+
+    size_t Lmax() const { return lmax; }
+    /*! Returns true if the y-z exchange matrices are kept between calls. */
+    bool cached() const { return !mats.empty(); }
+
+    /*! Rotates every a_lm set \a alm(i,:) in place by the Euler angles
+        \a angles(i,0) (psi), \a angles(i,1) (theta) and \a angles(i,2)
+        (phi), following the conventions of rotate_alm(). */
+    template<typename T> void rotate(const vmav<complex<T>,2> &alm,
+      const cmav<double,2> &angles, size_t nthreads) const
+      {
+      MR_assert(alm.shape(1)==base.Num_Alms(), "bad size of a_lm array");
+      MR_assert((angles.shape(0)==alm.shape(0)) && (angles.shape(1)==3),
+        "angles must have shape (nalm_sets, 3)");
+      size_t nvec=alm.shape(0), nalm=alm.shape(1);
+      bool need_xchg = false;
+      for (size_t v=0; v<nvec; ++v)
+        if (angles(v,1)!=0) need_xchg = true;
+      vector<double> ang(nvec);
+      if (!need_xchg)
+        {
+        for (size_t v=0; v<nvec; ++v)
+          ang[v] = angles(v,0)+angles(v,2);
+        auto work = alm.transpose();
+        rot_azimuth(work, ang);
+        return;
+        }
+      // work on a transposed copy, so that the coefficients of all sets
+      // belonging to the same (l,m) are adjacent in memory
+      vmav<complex<T>,2> work({nalm, nvec}, UNINITIALIZED);
+      constexpr size_t blk=64;
+      for (size_t i0=0; i0<nalm; i0+=blk)
+        for (size_t v=0; v<nvec; ++v)
+          for (size_t i=i0; i<min(nalm,i0+blk); ++i)
+            work(i,v) = alm(v,i);
+      for (size_t iang=0; iang<3; ++iang)
+        {
+        for (size_t v=0; v<nvec; ++v)
+          ang[v] = angles(v,iang);
+        rot_azimuth(work, ang);
+        if (iang<2) xchg_yz(work, nthreads);
+        }
+      for (size_t i0=0; i0<nalm; i0+=blk)
+        for (size_t v=0; v<nvec; ++v)
+          for (size_t i=i0; i<min(nalm,i0+blk); ++i)
+            alm(v,i) = work(i,v);
+      }
+
+    /*! Rotates all a_lm sets \a alm(i,:) in place by the same Euler angles. */
+    template<typename T> void rotate(const vmav<complex<T>,2> &alm,
+      double psi, double theta, double phi, size_t nthreads) const
+      {
+      vmav<double,2> angles({alm.shape(0),3});
+      for (size_t v=0; v<alm.shape(0); ++v)
+        {
+        angles(v,0) = psi;
+        angles(v,1) = theta;
+        angles(v,2) = phi;
+        }
+      rotate(alm, angles, nthreads);
+      }
+  };
+
 }
 
 using detail_alm::Alm_Base;
+using detail_alm::alm2cl;
 using detail_alm::rotate_alm;
+using detail_alm::Alm_Rotator;
 }
 
 #endif
@@ -22,6 +22,12 @@
  */
 
 #include <vector>
+#include <list>
+#include <algorithm>
+#include <unordered_map>
+#include <atomic>
+#include <mutex>
+#include <memory>
 #include <cmath>
 #include <cstring>
 #if ((!defined(DUCC0_NO_SIMD)) && defined(__AVX__) && (!defined(__AVX512F__)))
@@ -55,6 +61,26 @@ struct ringdata
   {
   size_t mlim, idx, midx;
   double cth, sth;
+  double dskip;  // largest neglected |d^l_{m,-s}| for m>mlim (0 if unknown)
+  };
+
+// recurrence coefficients for a single m, as computed by
+// YlmBase::prepare_mdata()
+struct Ylm_mdata
+  {
+  struct dbl2 { double a, b; };
+
+  vector<double> alpha;
+  vector<dbl2> coef;
+
+  /* used if s==0 */
+  vector<double> eps;
+
+  /* used if s!=0 */
+  size_t sinPow=0, cosPow=0;
+  bool preMinus_p=false, preMinus_m=false;
+
+  size_t mlo=~size_t(0), mhi=~size_t(0);
   };
 
 class YlmBase
@@ -167,71 +193,48 @@ class YlmBase
           }
         }
       }
-  };
-
-class Ylmgen: public YlmBase
-  {
-  public:
-    struct dbl2 { double a, b; };
-
-    size_t m;
-
-    vector<double> alpha;
-    vector<dbl2> coef;
-
-    /* used if s==0 */
-    vector<double> eps;
 
-    /* used if s!=0 */
-    size_t sinPow, cosPow;
-    bool preMinus_p, preMinus_m;
-
-    size_t mlo, mhi;
-
-    Ylmgen(const YlmBase &base)
-      : YlmBase(base),
-        m(~size_t(0)),
-        alpha((s==0) ? (lmax/2+2) : (lmax+3), 0.),
-        coef((s==0) ? (lmax/2+2) : (lmax+3), {0.,0.}),
-        eps((s==0) ? (lmax+4) : 0),
-        mlo(~size_t(0)),
-        mhi(~size_t(0))
-      {}
-
-    void prepare (size_t m_)
+    // computes the recurrence coefficients for a given m; if d already
+    // contains the data for an m with identical mlo and mhi, part of the work
+    // is skipped
+    void prepare_mdata (size_t m, Ylm_mdata &d) const
       {
-      if (m_==m) return;
-      m = m_;
+      if (d.coef.empty())
+        {
+        d.alpha.assign((s==0) ? (lmax/2+2) : (lmax+3), 0.);
+        d.coef.assign((s==0) ? (lmax/2+2) : (lmax+3), {0.,0.});
+        d.eps.assign((s==0) ? (lmax+4) : 0, 0.);
+        }
 
       if (s==0)
         {
-        eps[m] = 0.;
+        d.eps[m] = 0.;
         for (size_t l=m+1; l<lmax+4; ++l)
-          eps[l] = sqrt((double(l+m)*(l-m))/(double(2*l+1)*(2*l-1)));
-        alpha[0] = 1./eps[m+1];
-        alpha[1] = eps[m+1]/(eps[m+2]*eps[m+3]);
+          d.eps[l] = sqrt((double(l+m)*(l-m))/(double(2*l+1)*(2*l-1)));
+        d.alpha[0] = 1./d.eps[m+1];
+        d.alpha[1] = d.eps[m+1]/(d.eps[m+2]*d.eps[m+3]);
         for (size_t il=1, l=m+2; l<lmax+1; ++il, l+=2)
-          alpha[il+1]= ((il&1) ? -1 : 1) / (eps[l+2]*eps[l+3]*alpha[il]);
+          d.alpha[il+1]= ((il&1) ? -1 : 1) / (d.eps[l+2]*d.eps[l+3]*d.alpha[il]);
         for (size_t il=0, l=m; l<lmax+2; ++il, l+=2)
           {
-          coef[il].a = ((il&1) ? -1 : 1)*alpha[il]*alpha[il];
-          double t1 = eps[l+2], t2 = eps[l+1];
-          coef[il].b = -coef[il].a*(t1*t1+t2*t2);
+          d.coef[il].a = ((il&1) ? -1 : 1)*d.alpha[il]*d.alpha[il];
+          double t1 = d.eps[l+2], t2 = d.eps[l+1];
+          d.coef[il].b = -d.coef[il].a*(t1*t1+t2*t2);
           }
         }
       else
         {
         size_t mlo_=m, mhi_=s;
         if (mhi_<mlo_) swap(mhi_,mlo_);
-        bool ms_similar = ((mhi==mhi_) && (mlo==mlo_));
+        bool ms_similar = ((d.mhi==mhi_) && (d.mlo==mlo_));
 
-        mlo = mlo_; mhi = mhi_;
+        d.mlo = mlo_; d.mhi = mhi_;
 
         if (!ms_similar)
           {
-          alpha[mhi] = 1.;
-          coef[mhi].a = coef[mhi].b = 0.;
-          for (size_t l=mhi; l<=lmax; ++l)
+          d.alpha[d.mhi] = 1.;
+          d.coef[d.mhi].a = d.coef[d.mhi].b = 0.;
+          for (size_t l=d.mhi; l<=lmax; ++l)
             {
             double t = flm1[l+m]*flm1[l-m]*flm1[l+s]*flm1[l-s];
             double lt = 2*l+1;
@@ -240,30 +243,123 @@ class Ylmgen: public YlmBase
             double flp11=m*s*inv[l]*inv[l+1];
             t = flm2[l+m]*flm2[l-m]*flm2[l+s]*flm2[l-s];
             double flp12=t*l1*inv[l];
-            if (l>mhi)
-              alpha[l+1] = alpha[l-1]*flp12;
+            if (l>d.mhi)
+              d.alpha[l+1] = d.alpha[l-1]*flp12;
             else
-              alpha[l+1] = 1.;
-            coef[l+1].a = flp10*alpha[l]/alpha[l+1];
-            coef[l+1].b = flp11*coef[l+1].a;
+              d.alpha[l+1] = 1.;
+            d.coef[l+1].a = flp10*d.alpha[l]/d.alpha[l+1];
+            d.coef[l+1].b = flp11*d.coef[l+1].a;
             }
           }
 
-        preMinus_p = preMinus_m = false;
-        if (mhi==m)
+        d.preMinus_p = d.preMinus_m = false;
+        if (d.mhi==m)
           {
-          cosPow = mhi+s; sinPow = mhi-s;
-          preMinus_p = preMinus_m = ((mhi-s)&1);
+          d.cosPow = d.mhi+s; d.sinPow = d.mhi-s;
+          d.preMinus_p = d.preMinus_m = ((d.mhi-s)&1);
           }
         else
           {
-          cosPow = mhi+m; sinPow = mhi-m;
-          preMinus_m = ((mhi+m)&1);
+          d.cosPow = d.mhi+m; d.sinPow = d.mhi-m;
+          d.preMinus_m = ((d.mhi+m)&1);
           }
         }
       }
   };
 
+// Legendre recurrence tables for all m<=mmax of a given (lmax, mmax, spin),
+// which can be shared between threads and transforms. The coefficients for
+// an individual m are computed when they are requested for the first time.
+// If "store" is false, only the m-independent data are kept, and Ylmgen
+// computes the coefficients for every m itself.
+class YlmTables
+  {
+  private:
+    mutable vector<Ylm_mdata> mdata;
+    mutable vector<once_flag> done;
+
+  public:
+    YlmBase base;
+    vector<double> norm, d1norm;
+
+    YlmTables(size_t lmax, size_t mmax, size_t spin, bool store)
+      : mdata(store ? mmax+1 : 0), done(store ? mmax+1 : 0),
+        base(lmax, mmax, spin),
+        norm(YlmBase::get_norm(lmax, spin)),
+        d1norm((spin==1) ? YlmBase::get_d1norm(lmax) : vector<double>()) {}
+
+    bool stored() const { return !mdata.empty(); }
+    const Ylm_mdata &get(size_t m) const
+      {
+      call_once(done[m], [&]{ base.prepare_mdata(m, mdata[m]); });
+      return mdata[m];
+      }
+
+    // memory required when the coefficients for all m have been computed
+    static size_t bytes(size_t lmax, size_t mmax, size_t spin)
+      {
+      size_t nl = (spin==0) ? (lmax/2+2) : (lmax+3);
+      size_t neps = (spin==0) ? (lmax+4) : 0;
+      size_t per_m = sizeof(Ylm_mdata) + sizeof(once_flag)
+        + nl*(sizeof(double)+sizeof(Ylm_mdata::dbl2)) + neps*sizeof(double);
+      return sizeof(YlmTables) + (mmax+1)*per_m + 12*(lmax+2)*sizeof(double);
+      }
+  };
+
+class Ylmgen: public YlmBase
+  {
+  public:
+    using dbl2 = Ylm_mdata::dbl2;
+
+    size_t m;
+
+    // coefficients for the current m; they either point into the local
+    // buffer or into shared tables
+    const double *alpha;
+    const dbl2 *coef;
+
+    /* used if s==0 */
+    const double *eps;
+
+    /* used if s!=0 */
+    size_t sinPow, cosPow;
+    bool preMinus_p, preMinus_m;
+
+    size_t mlo, mhi;
+
+  private:
+    shared_ptr<const YlmTables> tables;
+    Ylm_mdata loc;
+
+  public:
+    Ylmgen(const YlmBase &base)
+      : YlmBase(base),
+        m(~size_t(0)),
+        alpha(nullptr), coef(nullptr), eps(nullptr),
+        mlo(~size_t(0)),
+        mhi(~size_t(0))
+      {}
+    Ylmgen(const shared_ptr<const YlmTables> &tables_)
+      : Ylmgen(tables_->base)
+      { tables = tables_; }
+
+    void prepare (size_t m_)
+      {
+      if (m_==m) return;
+      m = m_;
+
+      bool shared = tables && tables->stored();
+      if (!shared) prepare_mdata(m, loc);
+      const Ylm_mdata &d(shared ? tables->get(m) : loc);
+      alpha = d.alpha.data();
+      coef = d.coef.data();
+      eps = d.eps.data();
+      sinPow = d.sinPow; cosPow = d.cosPow;
+      preMinus_p = d.preMinus_p; preMinus_m = d.preMinus_m;
+      mlo = d.mlo; mhi = d.mhi;
+      }
+  };
+
 struct ringhelper
   {
   using dcmplx = complex<double>;
@@ -275,6 +371,15 @@ struct ringhelper
   size_t length;
   bool norot;
   ringhelper() : phi0_(0), s_shift(0), length(0), norot(false) {}
+  void update_plan(size_t nph)
+    {
+    if (nph!=length)
+      {
+      plan=make_unique<pocketfft_r<double>>(nph);
+      buf.resize(plan->bufsize());
+      length=nph;
+      }
+    }
   void update(size_t nph, size_t mmax, double phi0)
     {
     norot = (abs(phi0)<1e-14);
@@ -288,13 +393,54 @@ struct ringhelper
       for (size_t m=0; m<=mmax; ++m)
         shiftarr[m] = mexp[m];
       }
-    if (nph!=length)
+    update_plan(nph);
+    }
+  // Adds the contributions of phase(m-m0) for m0<=m<m0+phase.shape(0) to
+  // the Fourier coefficients of a ring with nph pixels, which are stored in
+  // pixels 0 to nph-1 of the ring in the order expected by
+  // fourier2ring(). This is equivalent to phase2ring() for all m at once,
+  // but allows to process the m values in several chunks.
+  template<typename T, typename Tmap> static void add_phase (size_t nph,
+    double phi0, size_t mmax, size_t m0, const cmav<complex<T>,1> &phase,
+    Tmap *ring, ptrdiff_t pixstride)
+    {
+    // adds to the real and imaginary part of Fourier coefficient k
+    auto add = [&](size_t k, double re, double im)
       {
-      plan=make_unique<pocketfft_r<double>>(nph);
-      buf.resize(plan->bufsize());
-      length=nph;
+      if (k==0)
+        ring[0] += Tmap(re);
+      else
+        {
+        ring[(2*k-1)*pixstride] += Tmap(re);
+        if (2*k<nph) ring[2*k*pixstride] += Tmap(im);
+        }
+      };
+    bool rot = (abs(phi0)>=1e-14);
+    MultiExp<double, dcmplx> mexp(phi0, rot ? mmax+1 : 0);
+    for (size_t i=0, m=m0, idx1=m0%nph; i<phase.shape(0);
+         ++i, ++m, idx1=(idx1+1==nph) ? 0 : idx1+1)
+      {
+      dcmplx tmp = phase(i);
+      if (m==0)
+        { add(0, tmp.real(), 0.); continue; }
+      if (rot) tmp*=mexp[m];
+      size_t idx2 = (idx1==0) ? 0 : nph-idx1;
+      if (idx1<(nph+2)/2) add(idx1, tmp.real(), tmp.imag());
+      if (idx2<(nph+2)/2) add(idx2, tmp.real(), -tmp.imag());
       }
     }
+  // transforms the Fourier coefficients accumulated by add_phase() into the
+  // pixel values of the ring
+  template<typename Tmap> void fourier2ring (size_t nph, Tmap *ring,
+    ptrdiff_t pixstride, const vmav<double,1> &data)
+    {
+    update_plan(nph);
+    for (size_t j=0; j<nph; ++j)
+      data(j+1) = double(ring[j*pixstride]);
+    plan->exec_copyback(&(data(1)), buf.data(), 1., false);
+    for (size_t j=0; j<nph; ++j)
+      ring[j*pixstride] = Tmap(data(j+1));
+    }
   template<typename T> DUCC0_NOINLINE void phase2ring (size_t nph,
     double phi0, const vmav<double,1> &data, size_t mmax, const cmav<complex<T>,1> &phase)
     {
@@ -385,22 +531,22 @@ static constexpr size_t VLEN=Tv::size();
 #if ((!defined(DUCC0_NO_SIMD)) && defined(__AVX__) && (!defined(__AVX512F__)))
 static_assert(Tv::size()==4, "must not happen");
 static inline void vhsum_cmplx_special (Tv a, Tv b, Tv c, Tv d,
-  complex<double> * DUCC0_RESTRICT cc)
+  complex<double> * DUCC0_RESTRICT cc, size_t str=1)
   {
   auto tmp1=_mm256_hadd_pd(__m256d(a),__m256d(b)),
        tmp2=_mm256_hadd_pd(__m256d(c),__m256d(d));
   auto tmp3=_mm256_permute2f128_pd(tmp1,tmp2,49),
        tmp4=_mm256_permute2f128_pd(tmp1,tmp2,32);
   tmp1=tmp3+tmp4;
-  cc[0]+=complex<double>(tmp1[0], tmp1[1]);
-  cc[1]+=complex<double>(tmp1[2], tmp1[3]);
+  cc[0  ]+=complex<double>(tmp1[0], tmp1[1]);
+  cc[str]+=complex<double>(tmp1[2], tmp1[3]);
   }
 #else
 static inline void vhsum_cmplx_special (Tv a, Tv b, Tv c, Tv d,
-  complex<double> * DUCC0_RESTRICT cc)
+  complex<double> * DUCC0_RESTRICT cc, size_t str=1)
   {
-  cc[0] += complex<double>(reduce(a,std::plus<>()),reduce(b,std::plus<>()));
-  cc[1] += complex<double>(reduce(c,std::plus<>()),reduce(d,std::plus<>()));
+  cc[0  ] += complex<double>(reduce(a,std::plus<>()),reduce(b,std::plus<>()));
+  cc[str] += complex<double>(reduce(c,std::plus<>()),reduce(d,std::plus<>()));
   }
 #endif
 
@@ -414,16 +560,28 @@ constexpr size_t nvx = 64/VLEN;
 using Tbv0 = std::array<Tv,nv0>;
 using Tbs0 = std::array<double,nv0*VLEN>;
 
-struct s0data_v
-  { Tbv0 sth, corfac, scale, lam1, lam2, csq, p1r, p1i, p2r, p2i; };
+// The recurrence state is shared by nmap sets of a_lm with identical spin;
+// only the accumulators exist once per set.
+// Tf=float is only used for the final part of the synthesis recurrence (see
+// use_float_recurrence()); the vectors then hold the same number of
+// values in half as many registers.
+template<size_t nmap, typename Tf=double> struct s0data_v
+  {
+  using Tbv = std::array<native_simd<Tf>, nv0*VLEN/native_simd<Tf>::size()>;
+  Tbv sth, corfac, scale, lam1, lam2, csq;
+  std::array<Tbv,nmap> p1r, p1i, p2r, p2i;
+  };
 
-struct s0data_s
-  { Tbs0 sth, corfac, scale, lam1, lam2, csq, p1r, p1i, p2r, p2i; };
+template<size_t nmap> struct s0data_s
+  {
+  Tbs0 sth, corfac, scale, lam1, lam2, csq;
+  std::array<Tbs0,nmap> p1r, p1i, p2r, p2i;
+  };
 
-union s0data_u
+template<size_t nmap> union s0data_u
   {
-  s0data_v v;
-  s0data_s s;
+  s0data_v<nmap> v;
+  s0data_s<nmap> s;
 #if defined(_MSC_VER)
   s0data_u() {}
 #endif
@@ -432,22 +590,23 @@ union s0data_u
 using Tbvx = std::array<Tv,nvx>;
 using Tbsx = std::array<double,nvx*VLEN>;
 
-struct sxdata_v
+template<size_t nmap, typename Tf=double> struct sxdata_v
   {
-  Tbvx sth, cfp, cfm, scp, scm, l1p, l2p, l1m, l2m, cth,
-       p1pr, p1pi, p2pr, p2pi, p1mr, p1mi, p2mr, p2mi;
+  using Tbv = std::array<native_simd<Tf>, nvx*VLEN/native_simd<Tf>::size()>;
+  Tbv sth, cfp, cfm, scp, scm, l1p, l2p, l1m, l2m, cth;
+  std::array<Tbv,nmap> p1pr, p1pi, p2pr, p2pi, p1mr, p1mi, p2mr, p2mi;
   };
 
-struct sxdata_s
+template<size_t nmap> struct sxdata_s
   {
-  Tbsx sth, cfp, cfm, scp, scm, l1p, l2p, l1m, l2m, cth,
-       p1pr, p1pi, p2pr, p2pi, p1mr, p1mi, p2mr, p2mi;
+  Tbsx sth, cfp, cfm, scp, scm, l1p, l2p, l1m, l2m, cth;
+  std::array<Tbsx,nmap> p1pr, p1pi, p2pr, p2pi, p1mr, p1mi, p2mr, p2mi;
   };
 
-union sxdata_u
+template<size_t nmap> union sxdata_u
   {
-  sxdata_v v;
-  sxdata_s s;
+  sxdata_v<nmap> v;
+  sxdata_s<nmap> s;
 #if defined(_MSC_VER)
   sxdata_u() {}
 #endif
@@ -545,32 +704,146 @@ static inline bool rescale(Tv &v1, Tv &v2, Tv &s, Tv eps)
   return false;
   }
 
-DUCC0_NOINLINE static void iter_to_ieee(const Ylmgen &gen,
-  s0data_v & DUCC0_RESTRICT d, size_t & DUCC0_RESTRICT l_, size_t & DUCC0_RESTRICT il_, size_t nv2)
+// Recurrence in single precision (for float syntheses with sufficiently
+// large epsilon): the part of the recurrence which needs exponent scaling,
+// and all l until every recurrence value lies safely within single precision
+// range, are processed in double precision. The remaining l are then handled
+// by the same kernels, working on twice as many values per vector register.
+// The adjoint kernels always work in double precision, since the additional
+// horizontal reductions of the wider vectors cost more than is gained.
+constexpr double sht_float_min=0x1p-100, sht_float_max=0x1p+100;
+
+// Maximum lmax for which the single-precision recurrence is used.
+constexpr size_t sht_float_recurrence_lmax = 1024;
+
+// Upper limit for the relative L2 error of a synthesis with single-precision
+// recurrence. Measured errors for random a_lm on Gauss-Legendre grids are
+// 4e-6 (spin 0) and 6e-6 (spin 2) at lmax=127, and 9e-5 and 2.7e-4 at
+// lmax=1023.
+inline double float_recurrence_error(size_t lmax)
+  { return 4e-7*(lmax+1); }
+
+// The single-precision recurrence is only used if the caller's epsilon
+// permits errors of twice this size, leaving the other half to the
+// truncation of the recurrence controlled by epsilon.
+template<typename T> static bool use_float_recurrence(size_t lmax,
+  double epsilon)
+  {
+  return is_same<T,float>::value && (lmax<=sht_float_recurrence_lmax)
+      && (epsilon>=2*float_recurrence_error(lmax));
+  }
+
+template<typename Tb> static inline bool float_safe(const Tb &v1, const Tb &v2,
+  size_t nv2)
+  {
+  for (size_t i=0; i<nv2; ++i)
+    {
+    auto a1=abs(v1[i]), a2=abs(v2[i]);
+    if (any_of(((a1<sht_float_min)&(a1!=0)) | (a1>sht_float_max)
+             | ((a2<sht_float_min)&(a2!=0)) | (a2>sht_float_max)))
+      return false;
+    }
+  return true;
+  }
+
+// Calls kernel(lend) for blocks of 16 l until safe() is true; returns
+// false if lmax is reached before that.
+template<typename Tkernel, typename Tsafe> static bool advance_to_float
+  (size_t &l, size_t lmax, Tkernel &&kernel, Tsafe &&safe)
+  {
+  while (l<=lmax)
+    {
+    if (safe()) return true;
+    size_t lend=min(lmax, l+15);
+    kernel(lend);
+    l += 2*((lend-l)/2+1);
+    }
+  return false;
+  }
+
+// copies the first nval values of src to dst and zeroes the rest of dst
+template<typename Tbd, typename Tbs> static inline void copy_lanes(Tbd &dst,
+  const Tbs &src, size_t nval)
+  {
+  constexpr size_t vd=Tbd::value_type::size(), vs=Tbs::value_type::size();
+  using Td = typename Tbd::value_type::value_type;
+  for (size_t i=0; i<dst.size()*vd; ++i)
+    dst[i/vd][i%vd] = (i<nval) ? Td(src[i/vs][i%vs]) : Td(0);
+  }
+template<typename Tbd, typename Tbs> static inline void add_lanes(Tbd &dst,
+  const Tbs &src, size_t nval)
+  {
+  constexpr size_t vd=Tbd::value_type::size(), vs=Tbs::value_type::size();
+  using Td = typename Tbd::value_type::value_type;
+  for (size_t i=0; i<nval; ++i)
+    dst[i/vd][i%vd] = dst[i/vd][i%vd] + Td(src[i/vs][i%vs]);
+  }
+
+// Accuracy control for the Legendre recurrences: Wigner d values
+// |d^l_{m,-s}(theta)| below epsilon are not accumulated. maxskip records the
+// largest such value which was actually neglected.
+// The recurrence values are converted to d values by the factor fct: for
+// spin 0 they are alpha*lambda_lm, i.e. fct=|alpha|/sqrt((2l+1)/(4pi)); the
+// spin recurrence works with alpha*d directly (its sqrt((2l+1)/(4pi)) is part
+// of the a_lm normalization), i.e. fct=|alpha|.
+struct leg_truncation
+  {
+  double epsilon=0, maxskip=0;
+
+  static double fct0(size_t l, double alpha)
+    { return abs(alpha)/sqrt((2*l+1)/(4*pi)); }
+  static double fctx(double alpha)
+    { return abs(alpha); }
+
+  // threshold for the recurrence values
+  double tol(double fct) const
+    {
+    if ((epsilon<=0) || (fct==0)) return sharp_ftol;
+    return max(sharp_ftol, epsilon/fct);
+    }
+  // records the lanes of val (in normal range) as neglected
+  void skip(const Tv &val, const Tv &scale, double fct)
+    {
+    auto v = abs(val);
+    where(scale<-0.5, v) = 0.;
+    maxskip = max(maxskip, reduce(v, [](double a, double b)
+      { return max(a,b); })*fct);
+    }
+  };
+
+template<size_t nmap> DUCC0_NOINLINE static void iter_to_ieee(const Ylmgen &gen,
+  s0data_v<nmap> & DUCC0_RESTRICT d, size_t & DUCC0_RESTRICT l_, size_t & DUCC0_RESTRICT il_, size_t nv2,
+  leg_truncation &trunc)
   {
   size_t l=gen.m, il=0;
   Tv mfac = (gen.m&1) ? -gen.mfac[gen.m]:gen.mfac[gen.m];
   bool below_limit = true;
+  double tol = trunc.tol(trunc.fct0(l, gen.alpha[il]));
   for (size_t i=0; i<nv2; ++i)
     {
     d.lam1[i]=0;
     mypow(d.sth[i],gen.m,gen.powlimit,d.lam2[i],d.scale[i]);
     d.lam2[i] *= mfac;
-    Tvnormalize(d.lam2[i],d.scale[i],sharp_ftol);
+    Tvnormalize(d.lam2[i],d.scale[i],tol);
     below_limit &= all_of(d.scale[i]<1);
     }
+  bool track = trunc.epsilon>0;
 
   while (below_limit)
     {
+    if (track)
+      for (size_t i=0; i<nv2; ++i)
+        trunc.skip(d.lam2[i], d.scale[i], trunc.fct0(l, gen.alpha[il]));
     if (l+4>gen.lmax) {l_=gen.lmax+1;return;}
     below_limit=1;
     Tv a1=gen.coef[il  ].a, b1=gen.coef[il  ].b;
     Tv a2=gen.coef[il+1].a, b2=gen.coef[il+1].b;
+    tol = trunc.tol(trunc.fct0(l+4, gen.alpha[il+2]));
     for (size_t i=0; i<nv2; ++i)
       {
       d.lam1[i] = (a1*d.csq[i] + b1)*d.lam2[i] + d.lam1[i];
       d.lam2[i] = (a2*d.csq[i] + b2)*d.lam1[i] + d.lam2[i];
-      if (rescale(d.lam1[i], d.lam2[i], d.scale[i], sharp_ftol))
+      if (rescale(d.lam1[i], d.lam2[i], d.scale[i], tol))
         below_limit &= all_of(d.scale[i]<1);
       }
     l+=4; il+=2;
@@ -578,83 +851,63 @@ DUCC0_NOINLINE static void iter_to_ieee(const Ylmgen &gen,
   l_=l; il_=il;
   }
 
-DUCC0_NOINLINE static void alm2map_kernel(s0data_v & DUCC0_RESTRICT d,
-  const vector<Ylmgen::dbl2> &coef, const dcmplx * DUCC0_RESTRICT alm,
-  size_t l, size_t il, size_t lmax, size_t nv2)
+// alm[l*astr+j] holds the coefficient (l,m) of the j-th set.
+template<size_t nmap, typename Tf> DUCC0_NOINLINE static void alm2map_kernel(s0data_v<nmap,Tf> & DUCC0_RESTRICT d,
+  const Ylmgen::dbl2 * DUCC0_RESTRICT coef, const dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, size_t l, size_t il, size_t lmax, size_t nv2)
   {
-#if 0
-  for (; l+6<=lmax; il+=4, l+=8)
-    {
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag();
-    Tv ar2=alm[l+1].real(), ai2=alm[l+1].imag();
-    Tv ar3=alm[l+2].real(), ai3=alm[l+2].imag();
-    Tv ar4=alm[l+3].real(), ai4=alm[l+3].imag();
-    Tv ar5=alm[l+4].real(), ai5=alm[l+4].imag();
-    Tv ar6=alm[l+5].real(), ai6=alm[l+5].imag();
-    Tv ar7=alm[l+6].real(), ai7=alm[l+6].imag();
-    Tv ar8=alm[l+7].real(), ai8=alm[l+7].imag();
-    Tv a1=coef[il  ].a, b1=coef[il  ].b;
-    Tv a2=coef[il+1].a, b2=coef[il+1].b;
-    Tv a3=coef[il+2].a, b3=coef[il+2].b;
-    Tv a4=coef[il+3].a, b4=coef[il+3].b;
-    for (size_t i=0; i<nv2; ++i)
-      {
-      d.p1r[i] += d.lam2[i]*ar1;
-      d.p1i[i] += d.lam2[i]*ai1;
-      d.p2r[i] += d.lam2[i]*ar2;
-      d.p2i[i] += d.lam2[i]*ai2;
-      d.lam1[i] = (a1*d.csq[i] + b1)*d.lam2[i] + d.lam1[i];
-      d.p1r[i] += d.lam1[i]*ar3;
-      d.p1i[i] += d.lam1[i]*ai3;
-      d.p2r[i] += d.lam1[i]*ar4;
-      d.p2i[i] += d.lam1[i]*ai4;
-      d.lam2[i] = (a2*d.csq[i] + b2)*d.lam1[i] + d.lam2[i];
-      d.p1r[i] += d.lam2[i]*ar5;
-      d.p1i[i] += d.lam2[i]*ai5;
-      d.p2r[i] += d.lam2[i]*ar6;
-      d.p2i[i] += d.lam2[i]*ai6;
-      d.lam1[i] = (a3*d.csq[i] + b3)*d.lam2[i] + d.lam1[i];
-      d.p1r[i] += d.lam1[i]*ar7;
-      d.p1i[i] += d.lam1[i]*ai7;
-      d.p2r[i] += d.lam1[i]*ar8;
-      d.p2i[i] += d.lam1[i]*ai8;
-      d.lam2[i] = (a4*d.csq[i] + b4)*d.lam1[i] + d.lam2[i];
-      }
-    }
-#endif
+  using Tv = native_simd<Tf>;
   for (; l+2<=lmax; il+=2, l+=4)
     {
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag();
-    Tv ar2=alm[l+1].real(), ai2=alm[l+1].imag();
-    Tv ar3=alm[l+2].real(), ai3=alm[l+2].imag();
-    Tv ar4=alm[l+3].real(), ai4=alm[l+3].imag();
-    Tv a1=coef[il  ].a, b1=coef[il  ].b;
-    Tv a2=coef[il+1].a, b2=coef[il+1].b;
+    Tv ar1[nmap], ai1[nmap], ar2[nmap], ai2[nmap],
+       ar3[nmap], ai3[nmap], ar4[nmap], ai4[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      ar1[j]=Tf(alm[(l  )*astr+j].real()); ai1[j]=Tf(alm[(l  )*astr+j].imag());
+      ar2[j]=Tf(alm[(l+1)*astr+j].real()); ai2[j]=Tf(alm[(l+1)*astr+j].imag());
+      ar3[j]=Tf(alm[(l+2)*astr+j].real()); ai3[j]=Tf(alm[(l+2)*astr+j].imag());
+      ar4[j]=Tf(alm[(l+3)*astr+j].real()); ai4[j]=Tf(alm[(l+3)*astr+j].imag());
+      }
+    Tv a1=Tf(coef[il  ].a), b1=Tf(coef[il  ].b);
+    Tv a2=Tf(coef[il+1].a), b2=Tf(coef[il+1].b);
     for (size_t i=0; i<nv2; ++i)
       {
-      d.p1r[i] += d.lam2[i]*ar1;
-      d.p1i[i] += d.lam2[i]*ai1;
-      d.p2r[i] += d.lam2[i]*ar2;
-      d.p2i[i] += d.lam2[i]*ai2;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1r[j][i] += d.lam2[i]*ar1[j];
+        d.p1i[j][i] += d.lam2[i]*ai1[j];
+        d.p2r[j][i] += d.lam2[i]*ar2[j];
+        d.p2i[j][i] += d.lam2[i]*ai2[j];
+        }
       d.lam1[i] = (a1*d.csq[i] + b1)*d.lam2[i] + d.lam1[i];
-      d.p1r[i] += d.lam1[i]*ar3;
-      d.p1i[i] += d.lam1[i]*ai3;
-      d.p2r[i] += d.lam1[i]*ar4;
-      d.p2i[i] += d.lam1[i]*ai4;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1r[j][i] += d.lam1[i]*ar3[j];
+        d.p1i[j][i] += d.lam1[i]*ai3[j];
+        d.p2r[j][i] += d.lam1[i]*ar4[j];
+        d.p2i[j][i] += d.lam1[i]*ai4[j];
+        }
       d.lam2[i] = (a2*d.csq[i] + b2)*d.lam1[i] + d.lam2[i];
       }
     }
   for (; l<=lmax; ++il, l+=2)
     {
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag();
-    Tv ar2=alm[l+1].real(), ai2=alm[l+1].imag();
-    Tv a=coef[il].a, b=coef[il].b;
+    Tv ar1[nmap], ai1[nmap], ar2[nmap], ai2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      ar1[j]=Tf(alm[(l  )*astr+j].real()); ai1[j]=Tf(alm[(l  )*astr+j].imag());
+      ar2[j]=Tf(alm[(l+1)*astr+j].real()); ai2[j]=Tf(alm[(l+1)*astr+j].imag());
+      }
+    Tv a=Tf(coef[il].a), b=Tf(coef[il].b);
     for (size_t i=0; i<nv2; ++i)
       {
-      d.p1r[i] += d.lam2[i]*ar1;
-      d.p1i[i] += d.lam2[i]*ai1;
-      d.p2r[i] += d.lam2[i]*ar2;
-      d.p2i[i] += d.lam2[i]*ai2;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1r[j][i] += d.lam2[i]*ar1[j];
+        d.p1i[j][i] += d.lam2[i]*ai1[j];
+        d.p2r[j][i] += d.lam2[i]*ar2[j];
+        d.p2i[j][i] += d.lam2[i]*ai2[j];
+        }
       Tv tmp = (a*d.csq[i] + b)*d.lam2[i] + d.lam1[i];
       d.lam1[i] = d.lam2[i];
       d.lam2[i] = tmp;
@@ -662,12 +915,13 @@ DUCC0_NOINLINE static void alm2map_kernel(s0data_v & DUCC0_RESTRICT d,
     }
   }
 
-DUCC0_NOINLINE static void calc_alm2map (const dcmplx * DUCC0_RESTRICT alm,
-  const Ylmgen &gen, s0data_v & DUCC0_RESTRICT d, size_t nth)
+template<size_t nmap> DUCC0_NOINLINE static void calc_alm2map (const dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, const Ylmgen &gen, s0data_v<nmap> & DUCC0_RESTRICT d, size_t nth,
+  bool use_float, leg_truncation &trunc)
   {
   size_t l,il=0,lmax=gen.lmax;
   size_t nv2 = (nth+VLEN-1)/VLEN;
-  iter_to_ieee(gen, d, l, il, nv2);
+  iter_to_ieee(gen, d, l, il, nv2, trunc);
   if (l>lmax) return;
 
   auto &coef = gen.coef;
@@ -680,16 +934,23 @@ DUCC0_NOINLINE static void calc_alm2map (const dcmplx * DUCC0_RESTRICT alm,
 
   while((!full_ieee) && (l<=lmax))
     {
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag();
-    Tv ar2=alm[l+1].real(), ai2=alm[l+1].imag();
+    Tv ar1[nmap], ai1[nmap], ar2[nmap], ai2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      ar1[j]=alm[(l  )*astr+j].real(); ai1[j]=alm[(l  )*astr+j].imag();
+      ar2[j]=alm[(l+1)*astr+j].real(); ai2[j]=alm[(l+1)*astr+j].imag();
+      }
     Tv a=coef[il].a, b=coef[il].b;
     full_ieee=1;
     for (size_t i=0; i<nv2; ++i)
       {
-      d.p1r[i] += d.lam2[i]*d.corfac[i]*ar1;
-      d.p1i[i] += d.lam2[i]*d.corfac[i]*ai1;
-      d.p2r[i] += d.lam2[i]*d.corfac[i]*ar2;
-      d.p2i[i] += d.lam2[i]*d.corfac[i]*ai2;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1r[j][i] += d.lam2[i]*d.corfac[i]*ar1[j];
+        d.p1i[j][i] += d.lam2[i]*d.corfac[i]*ai1[j];
+        d.p2r[j][i] += d.lam2[i]*d.corfac[i]*ar2[j];
+        d.p2i[j][i] += d.lam2[i]*d.corfac[i]*ai2[j];
+        }
       Tv tmp = (a*d.csq[i] + b)*d.lam2[i] + d.lam1[i];
       d.lam1[i] = d.lam2[i];
       d.lam2[i] = tmp;
@@ -706,59 +967,111 @@ DUCC0_NOINLINE static void calc_alm2map (const dcmplx * DUCC0_RESTRICT alm,
     d.lam1[i] *= d.corfac[i];
     d.lam2[i] *= d.corfac[i];
     }
-  alm2map_kernel(d, coef, alm, l, il, lmax, nv2);
+  if (use_float)
+    {
+    size_t l0=l, il0=il;
+    bool ok = advance_to_float(l, lmax,
+      [&](size_t lend) { alm2map_kernel(d, coef, alm, astr, l, il0+(l-l0)/2, lend, nv2); },
+      [&]() { return float_safe(d.lam1, d.lam2, nv2); });
+    if (!ok) return;
+    il = il0+(l-l0)/2;
+    s0data_v<nmap,float> f;
+    size_t nval=nv2*VLEN, nvf=(nval+f.lam1[0].size()-1)/f.lam1[0].size();
+    copy_lanes(f.lam1, d.lam1, nval);
+    copy_lanes(f.lam2, d.lam2, nval);
+    copy_lanes(f.csq, d.csq, nval);
+    for (size_t j=0; j<nmap; ++j)
+      {
+      copy_lanes(f.p1r[j], d.p1r[j], 0);
+      copy_lanes(f.p1i[j], d.p1i[j], 0);
+      copy_lanes(f.p2r[j], d.p2r[j], 0);
+      copy_lanes(f.p2i[j], d.p2i[j], 0);
+      }
+    alm2map_kernel(f, coef, alm, astr, l, il, lmax, nvf);
+    for (size_t j=0; j<nmap; ++j)
+      {
+      add_lanes(d.p1r[j], f.p1r[j], nval);
+      add_lanes(d.p1i[j], f.p1i[j], nval);
+      add_lanes(d.p2r[j], f.p2r[j], nval);
+      add_lanes(d.p2i[j], f.p2i[j], nval);
+      }
+    return;
+    }
+  alm2map_kernel(d, coef, alm, astr, l, il, lmax, nv2);
   }
 
-DUCC0_NOINLINE static void map2alm_kernel(s0data_v & DUCC0_RESTRICT d,
-  const vector<Ylmgen::dbl2> &coef, dcmplx * DUCC0_RESTRICT alm, size_t l,
-  size_t il, size_t lmax, size_t nv2)
+template<size_t nmap> DUCC0_NOINLINE static void map2alm_kernel(s0data_v<nmap> & DUCC0_RESTRICT d,
+  const Ylmgen::dbl2 * DUCC0_RESTRICT coef, dcmplx * DUCC0_RESTRICT alm, size_t astr,
+  size_t l, size_t il, size_t lmax, size_t nv2)
   {
   for (; l+2<=lmax; il+=2, l+=4)
     {
     Tv a1=coef[il  ].a, b1=coef[il  ].b;
     Tv a2=coef[il+1].a, b2=coef[il+1].b;
-    Tv atmp1[4] = {0,0,0,0};
-    Tv atmp2[4] = {0,0,0,0};
+    Tv atmp1[nmap][4], atmp2[nmap][4];
+    for (size_t j=0; j<nmap; ++j)
+      for (size_t k=0; k<4; ++k)
+        atmp1[j][k] = atmp2[j][k] = 0;
     for (size_t i=0; i<nv2; ++i)
       {
-      atmp1[0] += d.lam2[i]*d.p1r[i];
-      atmp1[1] += d.lam2[i]*d.p1i[i];
-      atmp1[2] += d.lam2[i]*d.p2r[i];
-      atmp1[3] += d.lam2[i]*d.p2i[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        atmp1[j][0] += d.lam2[i]*d.p1r[j][i];
+        atmp1[j][1] += d.lam2[i]*d.p1i[j][i];
+        atmp1[j][2] += d.lam2[i]*d.p2r[j][i];
+        atmp1[j][3] += d.lam2[i]*d.p2i[j][i];
+        }
       d.lam1[i] = (a1*d.csq[i] + b1)*d.lam2[i] + d.lam1[i];
-      atmp2[0] += d.lam1[i]*d.p1r[i];
-      atmp2[1] += d.lam1[i]*d.p1i[i];
-      atmp2[2] += d.lam1[i]*d.p2r[i];
-      atmp2[3] += d.lam1[i]*d.p2i[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        atmp2[j][0] += d.lam1[i]*d.p1r[j][i];
+        atmp2[j][1] += d.lam1[i]*d.p1i[j][i];
+        atmp2[j][2] += d.lam1[i]*d.p2r[j][i];
+        atmp2[j][3] += d.lam1[i]*d.p2i[j][i];
+        }
       d.lam2[i] = (a2*d.csq[i] + b2)*d.lam1[i] + d.lam2[i];
       }
-    vhsum_cmplx_special (atmp1[0], atmp1[1], atmp1[2], atmp1[3], &alm[l  ]);
-    vhsum_cmplx_special (atmp2[0], atmp2[1], atmp2[2], atmp2[3], &alm[l+2]);
+    for (size_t j=0; j<nmap; ++j)
+      {
+      vhsum_cmplx_special (atmp1[j][0], atmp1[j][1], atmp1[j][2], atmp1[j][3],
+        &alm[(l  )*astr+j], astr);
+      vhsum_cmplx_special (atmp2[j][0], atmp2[j][1], atmp2[j][2], atmp2[j][3],
+        &alm[(l+2)*astr+j], astr);
+      }
     }
   for (; l<=lmax; ++il, l+=2)
     {
     Tv a=coef[il].a, b=coef[il].b;
-    Tv atmp[4] = {0,0,0,0};
+    Tv atmp[nmap][4];
+    for (size_t j=0; j<nmap; ++j)
+      for (size_t k=0; k<4; ++k)
+        atmp[j][k] = 0;
     for (size_t i=0; i<nv2; ++i)
       {
-      atmp[0] += d.lam2[i]*d.p1r[i];
-      atmp[1] += d.lam2[i]*d.p1i[i];
-      atmp[2] += d.lam2[i]*d.p2r[i];
-      atmp[3] += d.lam2[i]*d.p2i[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        atmp[j][0] += d.lam2[i]*d.p1r[j][i];
+        atmp[j][1] += d.lam2[i]*d.p1i[j][i];
+        atmp[j][2] += d.lam2[i]*d.p2r[j][i];
+        atmp[j][3] += d.lam2[i]*d.p2i[j][i];
+        }
       Tv tmp = (a*d.csq[i] + b)*d.lam2[i] + d.lam1[i];
       d.lam1[i] = d.lam2[i];
       d.lam2[i] = tmp;
       }
-    vhsum_cmplx_special (atmp[0], atmp[1], atmp[2], atmp[3], &alm[l]);
+    for (size_t j=0; j<nmap; ++j)
+      vhsum_cmplx_special (atmp[j][0], atmp[j][1], atmp[j][2], atmp[j][3],
+        &alm[l*astr+j], astr);
     }
   }
 
-DUCC0_NOINLINE static void calc_map2alm (dcmplx * DUCC0_RESTRICT alm,
-  const Ylmgen &gen, s0data_v & DUCC0_RESTRICT d, size_t nth)
+template<size_t nmap> DUCC0_NOINLINE static void calc_map2alm (dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, const Ylmgen &gen, s0data_v<nmap> & DUCC0_RESTRICT d, size_t nth,
+  leg_truncation &trunc)
   {
   size_t l,il=0,lmax=gen.lmax;
   size_t nv2 = (nth+VLEN-1)/VLEN;
-  iter_to_ieee(gen, d, l, il, nv2);
+  iter_to_ieee(gen, d, l, il, nv2, trunc);
   if (l>lmax) return;
 
   auto &coef = gen.coef;
@@ -772,14 +1085,20 @@ DUCC0_NOINLINE static void calc_map2alm (dcmplx * DUCC0_RESTRICT alm,
   while((!full_ieee) && (l<=lmax))
     {
     Tv a=coef[il].a, b=coef[il].b;
-    Tv atmp[4] = {0,0,0,0};
+    Tv atmp[nmap][4];
+    for (size_t j=0; j<nmap; ++j)
+      for (size_t k=0; k<4; ++k)
+        atmp[j][k] = 0;
     full_ieee=1;
     for (size_t i=0; i<nv2; ++i)
       {
-      atmp[0] += d.lam2[i]*d.corfac[i]*d.p1r[i];
-      atmp[1] += d.lam2[i]*d.corfac[i]*d.p1i[i];
-      atmp[2] += d.lam2[i]*d.corfac[i]*d.p2r[i];
-      atmp[3] += d.lam2[i]*d.corfac[i]*d.p2i[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        atmp[j][0] += d.lam2[i]*d.corfac[i]*d.p1r[j][i];
+        atmp[j][1] += d.lam2[i]*d.corfac[i]*d.p1i[j][i];
+        atmp[j][2] += d.lam2[i]*d.corfac[i]*d.p2r[j][i];
+        atmp[j][3] += d.lam2[i]*d.corfac[i]*d.p2i[j][i];
+        }
       Tv tmp = (a*d.csq[i] + b)*d.lam2[i] + d.lam1[i];
       d.lam1[i] = d.lam2[i];
       d.lam2[i] = tmp;
@@ -787,7 +1106,9 @@ DUCC0_NOINLINE static void calc_map2alm (dcmplx * DUCC0_RESTRICT alm,
         getCorfac(d.scale[i], d.corfac[i]);
       full_ieee &= all_of(d.scale[i]>=0);
       }
-    vhsum_cmplx_special (atmp[0], atmp[1], atmp[2], atmp[3], &alm[l]);
+    for (size_t j=0; j<nmap; ++j)
+      vhsum_cmplx_special (atmp[j][0], atmp[j][1], atmp[j][2], atmp[j][3],
+        &alm[l*astr+j], astr);
     l+=2; ++il;
     }
   if (l>lmax) return;
@@ -797,16 +1118,19 @@ DUCC0_NOINLINE static void calc_map2alm (dcmplx * DUCC0_RESTRICT alm,
     d.lam1[i] *= d.corfac[i];
     d.lam2[i] *= d.corfac[i];
     }
-  map2alm_kernel(d, coef, alm, l, il, lmax, nv2);
+  map2alm_kernel(d, coef, alm, astr, l, il, lmax, nv2);
   }
 
-DUCC0_NOINLINE static void iter_to_ieee_spin (const Ylmgen &gen,
-  sxdata_v & DUCC0_RESTRICT d, size_t & DUCC0_RESTRICT l_, size_t nv2)
+template<size_t nmap> DUCC0_NOINLINE static void iter_to_ieee_spin (const Ylmgen &gen,
+  sxdata_v<nmap> & DUCC0_RESTRICT d, size_t & DUCC0_RESTRICT l_, size_t nv2,
+  leg_truncation &trunc)
   {
   const auto &fx = gen.coef;
   Tv prefac=gen.prefac[gen.m],
      prescale=gen.fscale[gen.m];
   bool below_limit=true;
+  size_t l=gen.mhi;
+  double tol = trunc.tol(trunc.fctx(gen.alpha[l]));
   for (size_t i=0; i<nv2; ++i)
     {
 // FIXME: can we do this better?
@@ -841,21 +1165,27 @@ DUCC0_NOINLINE static void iter_to_ieee_spin (const Ylmgen &gen,
     if (gen.s&1)
       d.l2p[i] = -d.l2p[i];
 
-    Tvnormalize(d.l2m[i],d.scm[i],sharp_ftol);
-    Tvnormalize(d.l2p[i],d.scp[i],sharp_ftol);
+    Tvnormalize(d.l2m[i],d.scm[i],tol);
+    Tvnormalize(d.l2p[i],d.scp[i],tol);
 
     below_limit &= all_of(d.scm[i]<1) &&
                    all_of(d.scp[i]<1);
     }
-
-  size_t l=gen.mhi;
+  bool track = trunc.epsilon>0;
 
   while (below_limit)
     {
+    if (track)
+      for (size_t i=0; i<nv2; ++i)
+        {
+        trunc.skip(d.l2p[i], d.scp[i], trunc.fctx(gen.alpha[l]));
+        trunc.skip(d.l2m[i], d.scm[i], trunc.fctx(gen.alpha[l]));
+        }
     if (l+2>gen.lmax) {l_=gen.lmax+1;return;}
     below_limit=1;
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
+    tol = trunc.tol(trunc.fctx(gen.alpha[l+2]));
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1p[i] = (d.cth[i]*fx10 - fx11)*d.l2p[i] - d.l1p[i];
@@ -864,8 +1194,8 @@ DUCC0_NOINLINE static void iter_to_ieee_spin (const Ylmgen &gen,
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
       // The bitwise or operator is deliberate!
       // Silencing clang compiler warning by casting to int...
-      if (int(rescale(d.l1p[i],d.l2p[i],d.scp[i],sharp_ftol)) |
-          rescale(d.l1m[i],d.l2m[i],d.scm[i],sharp_ftol))
+      if (int(rescale(d.l1p[i],d.l2p[i],d.scp[i],tol)) |
+          rescale(d.l1m[i],d.l2m[i],d.scm[i],tol))
         below_limit &= all_of(d.scp[i]<1) &&
                        all_of(d.scm[i]<1);
       }
@@ -875,31 +1205,42 @@ DUCC0_NOINLINE static void iter_to_ieee_spin (const Ylmgen &gen,
   l_=l;
   }
 
-DUCC0_NOINLINE static void alm2map_spin_kernel(sxdata_v & DUCC0_RESTRICT d,
-  const vector<Ylmgen::dbl2> &fx, const dcmplx * DUCC0_RESTRICT alm,
-  size_t l, size_t lmax, size_t nv2)
+// Gradient and curl coefficients (l,m) of the j-th set are stored in
+// alm[l*astr+2*j] and alm[l*astr+2*j+1].
+template<size_t nmap, typename Tf> DUCC0_NOINLINE static void alm2map_spin_kernel(sxdata_v<nmap,Tf> & DUCC0_RESTRICT d,
+  const Ylmgen::dbl2 * DUCC0_RESTRICT fx, const dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, size_t l, size_t lmax, size_t nv2)
   {
+  using Tv = native_simd<Tf>;
   size_t lsave = l;
   while (l<=lmax)
     {
-    Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
-    Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=alm[2*l  ].real(), agi1=alm[2*l  ].imag(),
-       acr1=alm[2*l+1].real(), aci1=alm[2*l+1].imag();
-    Tv agr2=alm[2*l+2].real(), agi2=alm[2*l+2].imag(),
-       acr2=alm[2*l+3].real(), aci2=alm[2*l+3].imag();
+    Tv fx10=Tf(fx[l+1].a),fx11=Tf(fx[l+1].b);
+    Tv fx20=Tf(fx[l+2].a),fx21=Tf(fx[l+2].b);
+    Tv agr1[nmap], agi1[nmap], acr1[nmap], aci1[nmap],
+       agr2[nmap], agi2[nmap], acr2[nmap], aci2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      agr1[j]=Tf(alm[(l  )*astr+2*j  ].real()); agi1[j]=Tf(alm[(l  )*astr+2*j  ].imag());
+      acr1[j]=Tf(alm[(l  )*astr+2*j+1].real()); aci1[j]=Tf(alm[(l  )*astr+2*j+1].imag());
+      agr2[j]=Tf(alm[(l+1)*astr+2*j  ].real()); agi2[j]=Tf(alm[(l+1)*astr+2*j  ].imag());
+      acr2[j]=Tf(alm[(l+1)*astr+2*j+1].real()); aci2[j]=Tf(alm[(l+1)*astr+2*j+1].imag());
+      }
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1p[i] = (d.cth[i]*fx10 - fx11)*d.l2p[i] - d.l1p[i];
-      d.p1pr[i] += agr1*d.l2p[i];
-      d.p1pi[i] += agi1*d.l2p[i];
-      d.p1mr[i] += acr1*d.l2p[i];
-      d.p1mi[i] += aci1*d.l2p[i];
-
-      d.p1pr[i] += aci2*d.l1p[i];
-      d.p1pi[i] -= acr2*d.l1p[i];
-      d.p1mr[i] -= agi2*d.l1p[i];
-      d.p1mi[i] += agr2*d.l1p[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1pr[j][i] += agr1[j]*d.l2p[i];
+        d.p1pi[j][i] += agi1[j]*d.l2p[i];
+        d.p1mr[j][i] += acr1[j]*d.l2p[i];
+        d.p1mi[j][i] += aci1[j]*d.l2p[i];
+
+        d.p1pr[j][i] += aci2[j]*d.l1p[i];
+        d.p1pi[j][i] -= acr2[j]*d.l1p[i];
+        d.p1mr[j][i] -= agi2[j]*d.l1p[i];
+        d.p1mi[j][i] += agr2[j]*d.l1p[i];
+        }
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       }
     l+=2;
@@ -907,36 +1248,59 @@ DUCC0_NOINLINE static void alm2map_spin_kernel(sxdata_v & DUCC0_RESTRICT d,
   l=lsave;
   while (l<=lmax)
     {
-    Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
-    Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=alm[2*l  ].real(), agi1=alm[2*l  ].imag(),
-       acr1=alm[2*l+1].real(), aci1=alm[2*l+1].imag();
-    Tv agr2=alm[2*l+2].real(), agi2=alm[2*l+2].imag(),
-       acr2=alm[2*l+3].real(), aci2=alm[2*l+3].imag();
+    Tv fx10=Tf(fx[l+1].a),fx11=Tf(fx[l+1].b);
+    Tv fx20=Tf(fx[l+2].a),fx21=Tf(fx[l+2].b);
+    Tv agr1[nmap], agi1[nmap], acr1[nmap], aci1[nmap],
+       agr2[nmap], agi2[nmap], acr2[nmap], aci2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      agr1[j]=Tf(alm[(l  )*astr+2*j  ].real()); agi1[j]=Tf(alm[(l  )*astr+2*j  ].imag());
+      acr1[j]=Tf(alm[(l  )*astr+2*j+1].real()); aci1[j]=Tf(alm[(l  )*astr+2*j+1].imag());
+      agr2[j]=Tf(alm[(l+1)*astr+2*j  ].real()); agi2[j]=Tf(alm[(l+1)*astr+2*j  ].imag());
+      acr2[j]=Tf(alm[(l+1)*astr+2*j+1].real()); aci2[j]=Tf(alm[(l+1)*astr+2*j+1].imag());
+      }
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1m[i] = (d.cth[i]*fx10 + fx11)*d.l2m[i] - d.l1m[i];
-      d.p2pr[i] -= aci1*d.l2m[i];
-      d.p2pi[i] += acr1*d.l2m[i];
-      d.p2mr[i] += agi1*d.l2m[i];
-      d.p2mi[i] -= agr1*d.l2m[i];
-
-      d.p2pr[i] += agr2*d.l1m[i];
-      d.p2pi[i] += agi2*d.l1m[i];
-      d.p2mr[i] += acr2*d.l1m[i];
-      d.p2mi[i] += aci2*d.l1m[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p2pr[j][i] -= aci1[j]*d.l2m[i];
+        d.p2pi[j][i] += acr1[j]*d.l2m[i];
+        d.p2mr[j][i] += agi1[j]*d.l2m[i];
+        d.p2mi[j][i] -= agr1[j]*d.l2m[i];
+
+        d.p2pr[j][i] += agr2[j]*d.l1m[i];
+        d.p2pi[j][i] += agi2[j]*d.l1m[i];
+        d.p2mr[j][i] += acr2[j]*d.l1m[i];
+        d.p2mi[j][i] += aci2[j]*d.l1m[i];
+        }
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
       }
     l+=2;
     }
   }
 
-DUCC0_NOINLINE static void calc_alm2map_spin (const dcmplx * DUCC0_RESTRICT alm,
-  const Ylmgen &gen, sxdata_v & DUCC0_RESTRICT d, size_t nth)
+template<size_t nmap> static inline void combine_spin_accumulators
+  (sxdata_v<nmap> & DUCC0_RESTRICT d, size_t nv2)
+  {
+  for (size_t j=0; j<nmap; ++j)
+    for (size_t i=0; i<nv2; ++i)
+      {
+      Tv tmp;
+      tmp = d.p1pr[j][i]; d.p1pr[j][i] -= d.p2mi[j][i]; d.p2mi[j][i] += tmp;
+      tmp = d.p1pi[j][i]; d.p1pi[j][i] += d.p2mr[j][i]; d.p2mr[j][i] -= tmp;
+      tmp = d.p1mr[j][i]; d.p1mr[j][i] += d.p2pi[j][i]; d.p2pi[j][i] -= tmp;
+      tmp = d.p1mi[j][i]; d.p1mi[j][i] -= d.p2pr[j][i]; d.p2pr[j][i] += tmp;
+      }
+  }
+
+template<size_t nmap> DUCC0_NOINLINE static void calc_alm2map_spin (const dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, const Ylmgen &gen, sxdata_v<nmap> & DUCC0_RESTRICT d, size_t nth,
+  bool use_float, leg_truncation &trunc)
   {
   size_t l,lmax=gen.lmax;
   size_t nv2 = (nth+VLEN-1)/VLEN;
-  iter_to_ieee_spin(gen, d, l, nv2);
+  iter_to_ieee_spin(gen, d, l, nv2, trunc);
   if (l>lmax) return;
 
   const auto &fx = gen.coef;
@@ -953,10 +1317,15 @@ DUCC0_NOINLINE static void calc_alm2map_spin (const dcmplx * DUCC0_RESTRICT alm,
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=alm[2*l  ].real(), agi1=alm[2*l  ].imag(),
-       acr1=alm[2*l+1].real(), aci1=alm[2*l+1].imag();
-    Tv agr2=alm[2*l+2].real(), agi2=alm[2*l+2].imag(),
-       acr2=alm[2*l+3].real(), aci2=alm[2*l+3].imag();
+    Tv agr1[nmap], agi1[nmap], acr1[nmap], aci1[nmap],
+       agr2[nmap], agi2[nmap], acr2[nmap], aci2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      agr1[j]=alm[(l  )*astr+2*j  ].real(); agi1[j]=alm[(l  )*astr+2*j  ].imag();
+      acr1[j]=alm[(l  )*astr+2*j+1].real(); aci1[j]=alm[(l  )*astr+2*j+1].imag();
+      agr2[j]=alm[(l+1)*astr+2*j  ].real(); agi2[j]=alm[(l+1)*astr+2*j  ].imag();
+      acr2[j]=alm[(l+1)*astr+2*j+1].real(); aci2[j]=alm[(l+1)*astr+2*j+1].imag();
+      }
     full_ieee=true;
     for (size_t i=0; i<nv2; ++i)
       {
@@ -966,15 +1335,18 @@ DUCC0_NOINLINE static void calc_alm2map_spin (const dcmplx * DUCC0_RESTRICT alm,
       Tv l2p=d.l2p[i]*d.cfp[i], l2m=d.l2m[i]*d.cfm[i];
       Tv l1m=d.l1m[i]*d.cfm[i], l1p=d.l1p[i]*d.cfp[i];
 
-      d.p1pr[i] += agr1*l2p + aci2*l1p;
-      d.p1pi[i] += agi1*l2p - acr2*l1p;
-      d.p1mr[i] += acr1*l2p - agi2*l1p;
-      d.p1mi[i] += aci1*l2p + agr2*l1p;
-
-      d.p2pr[i] += agr2*l1m - aci1*l2m;
-      d.p2pi[i] += agi2*l1m + acr1*l2m;
-      d.p2mr[i] += acr2*l1m + agi1*l2m;
-      d.p2mi[i] += aci2*l1m - agr1*l2m;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1pr[j][i] += agr1[j]*l2p + aci2[j]*l1p;
+        d.p1pi[j][i] += agi1[j]*l2p - acr2[j]*l1p;
+        d.p1mr[j][i] += acr1[j]*l2p - agi2[j]*l1p;
+        d.p1mi[j][i] += aci1[j]*l2p + agr2[j]*l1p;
+
+        d.p2pr[j][i] += agr2[j]*l1m - aci1[j]*l2m;
+        d.p2pi[j][i] += agi2[j]*l1m + acr1[j]*l2m;
+        d.p2mr[j][i] += acr2[j]*l1m + agi1[j]*l2m;
+        d.p2mi[j][i] += aci2[j]*l1m - agr1[j]*l2m;
+        }
 
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
@@ -996,44 +1368,85 @@ DUCC0_NOINLINE static void calc_alm2map_spin (const dcmplx * DUCC0_RESTRICT alm,
     d.l1m[i] *= d.cfm[i];
     d.l2m[i] *= d.cfm[i];
     }
-  alm2map_spin_kernel(d, fx, alm, l, lmax, nv2);
-
-  for (size_t i=0; i<nv2; ++i)
+  if (use_float)
     {
-    Tv tmp;
-    tmp = d.p1pr[i]; d.p1pr[i] -= d.p2mi[i]; d.p2mi[i] += tmp;
-    tmp = d.p1pi[i]; d.p1pi[i] += d.p2mr[i]; d.p2mr[i] -= tmp;
-    tmp = d.p1mr[i]; d.p1mr[i] += d.p2pi[i]; d.p2pi[i] -= tmp;
-    tmp = d.p1mi[i]; d.p1mi[i] -= d.p2pr[i]; d.p2pr[i] += tmp;
+    bool ok = advance_to_float(l, lmax,
+      [&](size_t lend) { alm2map_spin_kernel(d, fx, alm, astr, l, lend, nv2); },
+      [&]() { return float_safe(d.l1p, d.l2p, nv2) && float_safe(d.l1m, d.l2m, nv2); });
+    if (ok)
+      {
+      sxdata_v<nmap,float> f;
+      size_t nval=nv2*VLEN, nvf=(nval+f.l1p[0].size()-1)/f.l1p[0].size();
+      copy_lanes(f.cth, d.cth, nval);
+      copy_lanes(f.l1p, d.l1p, nval);
+      copy_lanes(f.l2p, d.l2p, nval);
+      copy_lanes(f.l1m, d.l1m, nval);
+      copy_lanes(f.l2m, d.l2m, nval);
+      for (size_t j=0; j<nmap; ++j)
+        {
+        copy_lanes(f.p1pr[j], d.p1pr[j], 0);
+        copy_lanes(f.p1pi[j], d.p1pi[j], 0);
+        copy_lanes(f.p2pr[j], d.p2pr[j], 0);
+        copy_lanes(f.p2pi[j], d.p2pi[j], 0);
+        copy_lanes(f.p1mr[j], d.p1mr[j], 0);
+        copy_lanes(f.p1mi[j], d.p1mi[j], 0);
+        copy_lanes(f.p2mr[j], d.p2mr[j], 0);
+        copy_lanes(f.p2mi[j], d.p2mi[j], 0);
+        }
+      alm2map_spin_kernel(f, fx, alm, astr, l, lmax, nvf);
+      for (size_t j=0; j<nmap; ++j)
+        {
+        add_lanes(d.p1pr[j], f.p1pr[j], nval);
+        add_lanes(d.p1pi[j], f.p1pi[j], nval);
+        add_lanes(d.p2pr[j], f.p2pr[j], nval);
+        add_lanes(d.p2pi[j], f.p2pi[j], nval);
+        add_lanes(d.p1mr[j], f.p1mr[j], nval);
+        add_lanes(d.p1mi[j], f.p1mi[j], nval);
+        add_lanes(d.p2mr[j], f.p2mr[j], nval);
+        add_lanes(d.p2mi[j], f.p2mi[j], nval);
+        }
+      }
     }
+  else
+    alm2map_spin_kernel(d, fx, alm, astr, l, lmax, nv2);
+
+  combine_spin_accumulators(d, nv2);
   }
 
-DUCC0_NOINLINE static void map2alm_spin_kernel(sxdata_v & DUCC0_RESTRICT d,
-  const vector<Ylmgen::dbl2> &fx, dcmplx * DUCC0_RESTRICT alm,
-  size_t l, size_t lmax, size_t nv2)
+template<size_t nmap> DUCC0_NOINLINE static void map2alm_spin_kernel(sxdata_v<nmap> & DUCC0_RESTRICT d,
+  const Ylmgen::dbl2 * DUCC0_RESTRICT fx, dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, size_t l, size_t lmax, size_t nv2)
   {
   size_t lsave=l;
   while (l<=lmax)
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=0, agi1=0, acr1=0, aci1=0;
-    Tv agr2=0, agi2=0, acr2=0, aci2=0;
+    Tv agr1[nmap], agi1[nmap], acr1[nmap], aci1[nmap],
+       agr2[nmap], agi2[nmap], acr2[nmap], aci2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      agr1[j]=agi1[j]=acr1[j]=aci1[j]=agr2[j]=agi2[j]=acr2[j]=aci2[j]=0;
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1p[i] = (d.cth[i]*fx10 - fx11)*d.l2p[i] - d.l1p[i];
-      agr1 += d.p2mi[i]*d.l2p[i];
-      agi1 -= d.p2mr[i]*d.l2p[i];
-      acr1 -= d.p2pi[i]*d.l2p[i];
-      aci1 += d.p2pr[i]*d.l2p[i];
-      agr2 += d.p2pr[i]*d.l1p[i];
-      agi2 += d.p2pi[i]*d.l1p[i];
-      acr2 += d.p2mr[i]*d.l1p[i];
-      aci2 += d.p2mi[i]*d.l1p[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        agr1[j] += d.p2mi[j][i]*d.l2p[i];
+        agi1[j] -= d.p2mr[j][i]*d.l2p[i];
+        acr1[j] -= d.p2pi[j][i]*d.l2p[i];
+        aci1[j] += d.p2pr[j][i]*d.l2p[i];
+        agr2[j] += d.p2pr[j][i]*d.l1p[i];
+        agi2[j] += d.p2pi[j][i]*d.l1p[i];
+        acr2[j] += d.p2mr[j][i]*d.l1p[i];
+        aci2[j] += d.p2mi[j][i]*d.l1p[i];
+        }
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       }
-    vhsum_cmplx_special (agr1,agi1,acr1,aci1,&alm[2*l]);
-    vhsum_cmplx_special (agr2,agi2,acr2,aci2,&alm[2*l+2]);
+    for (size_t j=0; j<nmap; ++j)
+      {
+      vhsum_cmplx_special (agr1[j],agi1[j],acr1[j],aci1[j],&alm[(l  )*astr+2*j]);
+      vhsum_cmplx_special (agr2[j],agi2[j],acr2[j],aci2[j],&alm[(l+1)*astr+2*j]);
+      }
     l+=2;
     }
   l=lsave;
@@ -1041,33 +1454,42 @@ DUCC0_NOINLINE static void map2alm_spin_kernel(sxdata_v & DUCC0_RESTRICT d,
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=0, agi1=0, acr1=0, aci1=0;
-    Tv agr2=0, agi2=0, acr2=0, aci2=0;
+    Tv agr1[nmap], agi1[nmap], acr1[nmap], aci1[nmap],
+       agr2[nmap], agi2[nmap], acr2[nmap], aci2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      agr1[j]=agi1[j]=acr1[j]=aci1[j]=agr2[j]=agi2[j]=acr2[j]=aci2[j]=0;
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1m[i] = (d.cth[i]*fx10 + fx11)*d.l2m[i] - d.l1m[i];
-      agr1 += d.p1pr[i]*d.l2m[i];
-      agi1 += d.p1pi[i]*d.l2m[i];
-      acr1 += d.p1mr[i]*d.l2m[i];
-      aci1 += d.p1mi[i]*d.l2m[i];
-      agr2 -= d.p1mi[i]*d.l1m[i];
-      agi2 += d.p1mr[i]*d.l1m[i];
-      acr2 += d.p1pi[i]*d.l1m[i];
-      aci2 -= d.p1pr[i]*d.l1m[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        agr1[j] += d.p1pr[j][i]*d.l2m[i];
+        agi1[j] += d.p1pi[j][i]*d.l2m[i];
+        acr1[j] += d.p1mr[j][i]*d.l2m[i];
+        aci1[j] += d.p1mi[j][i]*d.l2m[i];
+        agr2[j] -= d.p1mi[j][i]*d.l1m[i];
+        agi2[j] += d.p1mr[j][i]*d.l1m[i];
+        acr2[j] += d.p1pi[j][i]*d.l1m[i];
+        aci2[j] -= d.p1pr[j][i]*d.l1m[i];
+        }
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
       }
-    vhsum_cmplx_special (agr1,agi1,acr1,aci1,&alm[2*l]);
-    vhsum_cmplx_special (agr2,agi2,acr2,aci2,&alm[2*l+2]);
+    for (size_t j=0; j<nmap; ++j)
+      {
+      vhsum_cmplx_special (agr1[j],agi1[j],acr1[j],aci1[j],&alm[(l  )*astr+2*j]);
+      vhsum_cmplx_special (agr2[j],agi2[j],acr2[j],aci2[j],&alm[(l+1)*astr+2*j]);
+      }
     l+=2;
     }
   }
 
-DUCC0_NOINLINE static void calc_map2alm_spin (dcmplx * DUCC0_RESTRICT alm,
-  const Ylmgen &gen, sxdata_v & DUCC0_RESTRICT d, size_t nth)
+template<size_t nmap> DUCC0_NOINLINE static void calc_map2alm_spin (dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, const Ylmgen &gen, sxdata_v<nmap> & DUCC0_RESTRICT d, size_t nth,
+  leg_truncation &trunc)
   {
   size_t l,lmax=gen.lmax;
   size_t nv2 = (nth+VLEN-1)/VLEN;
-  iter_to_ieee_spin(gen, d, l, nv2);
+  iter_to_ieee_spin(gen, d, l, nv2, trunc);
   if (l>lmax) return;
 
   const auto &fx = gen.coef;
@@ -1079,21 +1501,16 @@ DUCC0_NOINLINE static void calc_map2alm_spin (dcmplx * DUCC0_RESTRICT alm,
     full_ieee &= all_of(d.scp[i]>=0) &&
                  all_of(d.scm[i]>=0);
     }
-  for (size_t i=0; i<nv2; ++i)
-    {
-    Tv tmp;
-    tmp = d.p1pr[i]; d.p1pr[i] -= d.p2mi[i]; d.p2mi[i] += tmp;
-    tmp = d.p1pi[i]; d.p1pi[i] += d.p2mr[i]; d.p2mr[i] -= tmp;
-    tmp = d.p1mr[i]; d.p1mr[i] += d.p2pi[i]; d.p2pi[i] -= tmp;
-    tmp = d.p1mi[i]; d.p1mi[i] -= d.p2pr[i]; d.p2pr[i] += tmp;
-    }
+  combine_spin_accumulators(d, nv2);
 
   while((!full_ieee) && (l<=lmax))
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=0, agi1=0, acr1=0, aci1=0;
-    Tv agr2=0, agi2=0, acr2=0, aci2=0;
+    Tv agr1[nmap], agi1[nmap], acr1[nmap], aci1[nmap],
+       agr2[nmap], agi2[nmap], acr2[nmap], aci2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      agr1[j]=agi1[j]=acr1[j]=aci1[j]=agr2[j]=agi2[j]=acr2[j]=aci2[j]=0;
     full_ieee=1;
     for (size_t i=0; i<nv2; ++i)
       {
@@ -1101,14 +1518,17 @@ DUCC0_NOINLINE static void calc_map2alm_spin (dcmplx * DUCC0_RESTRICT alm,
       d.l1m[i] = (d.cth[i]*fx10 + fx11)*d.l2m[i] - d.l1m[i];
       Tv l2p = d.l2p[i]*d.cfp[i], l2m = d.l2m[i]*d.cfm[i];
       Tv l1p = d.l1p[i]*d.cfp[i], l1m = d.l1m[i]*d.cfm[i];
-      agr1 += d.p1pr[i]*l2m + d.p2mi[i]*l2p;
-      agi1 += d.p1pi[i]*l2m - d.p2mr[i]*l2p;
-      acr1 += d.p1mr[i]*l2m - d.p2pi[i]*l2p;
-      aci1 += d.p1mi[i]*l2m + d.p2pr[i]*l2p;
-      agr2 += d.p2pr[i]*l1p - d.p1mi[i]*l1m;
-      agi2 += d.p2pi[i]*l1p + d.p1mr[i]*l1m;
-      acr2 += d.p2mr[i]*l1p + d.p1pi[i]*l1m;
-      aci2 += d.p2mi[i]*l1p - d.p1pr[i]*l1m;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        agr1[j] += d.p1pr[j][i]*l2m + d.p2mi[j][i]*l2p;
+        agi1[j] += d.p1pi[j][i]*l2m - d.p2mr[j][i]*l2p;
+        acr1[j] += d.p1mr[j][i]*l2m - d.p2pi[j][i]*l2p;
+        aci1[j] += d.p1mi[j][i]*l2m + d.p2pr[j][i]*l2p;
+        agr2[j] += d.p2pr[j][i]*l1p - d.p1mi[j][i]*l1m;
+        agi2[j] += d.p2pi[j][i]*l1p + d.p1mr[j][i]*l1m;
+        acr2[j] += d.p2mr[j][i]*l1p + d.p1pi[j][i]*l1m;
+        aci2[j] += d.p2mi[j][i]*l1p - d.p1pr[j][i]*l1m;
+        }
 
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
@@ -1119,8 +1539,11 @@ DUCC0_NOINLINE static void calc_map2alm_spin (dcmplx * DUCC0_RESTRICT alm,
         getCorfac(d.scm[i], d.cfm[i]);
       full_ieee &= all_of(d.scm[i]>=0);
       }
-    vhsum_cmplx_special (agr1,agi1,acr1,aci1,&alm[2*l]);
-    vhsum_cmplx_special (agr2,agi2,acr2,aci2,&alm[2*l+2]);
+    for (size_t j=0; j<nmap; ++j)
+      {
+      vhsum_cmplx_special (agr1[j],agi1[j],acr1[j],aci1[j],&alm[(l  )*astr+2*j]);
+      vhsum_cmplx_special (agr2[j],agi2[j],acr2[j],aci2[j],&alm[(l+1)*astr+2*j]);
+      }
     l+=2;
     }
   if (l>lmax) return;
@@ -1132,29 +1555,39 @@ DUCC0_NOINLINE static void calc_map2alm_spin (dcmplx * DUCC0_RESTRICT alm,
     d.l1m[i] *= d.cfm[i];
     d.l2m[i] *= d.cfm[i];
     }
-  map2alm_spin_kernel(d, fx, alm, l, lmax, nv2);
+  map2alm_spin_kernel(d, fx, alm, astr, l, lmax, nv2);
   }
 
 
-DUCC0_NOINLINE static void alm2map_spin_gradonly_kernel(sxdata_v & DUCC0_RESTRICT d,
-  const vector<Ylmgen::dbl2> &fx, const dcmplx * DUCC0_RESTRICT alm,
-  size_t l, size_t lmax, size_t nv2)
+// In GRAD_ONLY and DERIV1 mode, alm[l*astr+j] holds the gradient coefficient
+// (l,m) of the j-th set.
+template<size_t nmap, typename Tf> DUCC0_NOINLINE static void alm2map_spin_gradonly_kernel(sxdata_v<nmap,Tf> & DUCC0_RESTRICT d,
+  const Ylmgen::dbl2 * DUCC0_RESTRICT fx, const dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, size_t l, size_t lmax, size_t nv2)
   {
+  using Tv = native_simd<Tf>;
   size_t lsave=l;
   while (l<=lmax)
     {
-    Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
-    Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag(),
-       ar2=alm[l+1].real(), ai2=alm[l+1].imag();
+    Tv fx10=Tf(fx[l+1].a),fx11=Tf(fx[l+1].b);
+    Tv fx20=Tf(fx[l+2].a),fx21=Tf(fx[l+2].b);
+    Tv ar1[nmap], ai1[nmap], ar2[nmap], ai2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      ar1[j]=Tf(alm[(l  )*astr+j].real()); ai1[j]=Tf(alm[(l  )*astr+j].imag());
+      ar2[j]=Tf(alm[(l+1)*astr+j].real()); ai2[j]=Tf(alm[(l+1)*astr+j].imag());
+      }
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1p[i] = (d.cth[i]*fx10 - fx11)*d.l2p[i] - d.l1p[i];
-      d.p1pr[i] += ar1*d.l2p[i];
-      d.p1pi[i] += ai1*d.l2p[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1pr[j][i] += ar1[j]*d.l2p[i];
+        d.p1pi[j][i] += ai1[j]*d.l2p[i];
 
-      d.p1mr[i] -= ai2*d.l1p[i];
-      d.p1mi[i] += ar2*d.l1p[i];
+        d.p1mr[j][i] -= ai2[j]*d.l1p[i];
+        d.p1mi[j][i] += ar2[j]*d.l1p[i];
+        }
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       }
     l+=2;
@@ -1162,30 +1595,38 @@ DUCC0_NOINLINE static void alm2map_spin_gradonly_kernel(sxdata_v & DUCC0_RESTRIC
   l=lsave;
   while (l<=lmax)
     {
-    Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
-    Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag(),
-       ar2=alm[l+1].real(), ai2=alm[l+1].imag();
+    Tv fx10=Tf(fx[l+1].a),fx11=Tf(fx[l+1].b);
+    Tv fx20=Tf(fx[l+2].a),fx21=Tf(fx[l+2].b);
+    Tv ar1[nmap], ai1[nmap], ar2[nmap], ai2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      ar1[j]=Tf(alm[(l  )*astr+j].real()); ai1[j]=Tf(alm[(l  )*astr+j].imag());
+      ar2[j]=Tf(alm[(l+1)*astr+j].real()); ai2[j]=Tf(alm[(l+1)*astr+j].imag());
+      }
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1m[i] = (d.cth[i]*fx10 + fx11)*d.l2m[i] - d.l1m[i];
-      d.p2mr[i] += ai1*d.l2m[i];
-      d.p2mi[i] -= ar1*d.l2m[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p2mr[j][i] += ai1[j]*d.l2m[i];
+        d.p2mi[j][i] -= ar1[j]*d.l2m[i];
 
-      d.p2pr[i] += ar2*d.l1m[i];
-      d.p2pi[i] += ai2*d.l1m[i];
+        d.p2pr[j][i] += ar2[j]*d.l1m[i];
+        d.p2pi[j][i] += ai2[j]*d.l1m[i];
+        }
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
       }
     l+=2;
     }
   }
 
-DUCC0_NOINLINE static void calc_alm2map_spin_gradonly(const dcmplx * DUCC0_RESTRICT alm,
-  const Ylmgen &gen, sxdata_v & DUCC0_RESTRICT d, size_t nth)
+template<size_t nmap> DUCC0_NOINLINE static void calc_alm2map_spin_gradonly(const dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, const Ylmgen &gen, sxdata_v<nmap> & DUCC0_RESTRICT d, size_t nth,
+  bool use_float, leg_truncation &trunc)
   {
   size_t l,lmax=gen.lmax;
   size_t nv2 = (nth+VLEN-1)/VLEN;
-  iter_to_ieee_spin(gen, d, l, nv2);
+  iter_to_ieee_spin(gen, d, l, nv2, trunc);
   if (l>lmax) return;
 
   const auto &fx = gen.coef;
@@ -1202,8 +1643,12 @@ DUCC0_NOINLINE static void calc_alm2map_spin_gradonly(const dcmplx * DUCC0_RESTR
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv ar1=alm[l  ].real(), ai1=alm[l  ].imag(),
-       ar2=alm[l+1].real(), ai2=alm[l+1].imag();
+    Tv ar1[nmap], ai1[nmap], ar2[nmap], ai2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      {
+      ar1[j]=alm[(l  )*astr+j].real(); ai1[j]=alm[(l  )*astr+j].imag();
+      ar2[j]=alm[(l+1)*astr+j].real(); ai2[j]=alm[(l+1)*astr+j].imag();
+      }
     full_ieee=true;
     for (size_t i=0; i<nv2; ++i)
       {
@@ -1213,15 +1658,18 @@ DUCC0_NOINLINE static void calc_alm2map_spin_gradonly(const dcmplx * DUCC0_RESTR
       Tv l2p=d.l2p[i]*d.cfp[i], l2m=d.l2m[i]*d.cfm[i];
       Tv l1m=d.l1m[i]*d.cfm[i], l1p=d.l1p[i]*d.cfp[i];
 
-      d.p1pr[i] += ar1*l2p;
-      d.p1pi[i] += ai1*l2p;
-      d.p1mr[i] -= ai2*l1p;
-      d.p1mi[i] += ar2*l1p;
-
-      d.p2pr[i] += ar2*l1m;
-      d.p2pi[i] += ai2*l1m;
-      d.p2mr[i] += ai1*l2m;
-      d.p2mi[i] -= ar1*l2m;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        d.p1pr[j][i] += ar1[j]*l2p;
+        d.p1pi[j][i] += ai1[j]*l2p;
+        d.p1mr[j][i] -= ai2[j]*l1p;
+        d.p1mi[j][i] += ar2[j]*l1p;
+
+        d.p2pr[j][i] += ar2[j]*l1m;
+        d.p2pi[j][i] += ai2[j]*l1m;
+        d.p2mr[j][i] += ai1[j]*l2m;
+        d.p2mi[j][i] -= ar1[j]*l2m;
+        }
 
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
@@ -1243,39 +1691,77 @@ DUCC0_NOINLINE static void calc_alm2map_spin_gradonly(const dcmplx * DUCC0_RESTR
     d.l1m[i] *= d.cfm[i];
     d.l2m[i] *= d.cfm[i];
     }
-  alm2map_spin_gradonly_kernel(d, fx, alm, l, lmax, nv2);
-
-  for (size_t i=0; i<nv2; ++i)
+  if (use_float)
     {
-    Tv tmp;
-    tmp = d.p1pr[i]; d.p1pr[i] -= d.p2mi[i]; d.p2mi[i] += tmp;
-    tmp = d.p1pi[i]; d.p1pi[i] += d.p2mr[i]; d.p2mr[i] -= tmp;
-    tmp = d.p1mr[i]; d.p1mr[i] += d.p2pi[i]; d.p2pi[i] -= tmp;
-    tmp = d.p1mi[i]; d.p1mi[i] -= d.p2pr[i]; d.p2pr[i] += tmp;
+    bool ok = advance_to_float(l, lmax,
+      [&](size_t lend) { alm2map_spin_gradonly_kernel(d, fx, alm, astr, l, lend, nv2); },
+      [&]() { return float_safe(d.l1p, d.l2p, nv2) && float_safe(d.l1m, d.l2m, nv2); });
+    if (ok)
+      {
+      sxdata_v<nmap,float> f;
+      size_t nval=nv2*VLEN, nvf=(nval+f.l1p[0].size()-1)/f.l1p[0].size();
+      copy_lanes(f.cth, d.cth, nval);
+      copy_lanes(f.l1p, d.l1p, nval);
+      copy_lanes(f.l2p, d.l2p, nval);
+      copy_lanes(f.l1m, d.l1m, nval);
+      copy_lanes(f.l2m, d.l2m, nval);
+      for (size_t j=0; j<nmap; ++j)
+        {
+        copy_lanes(f.p1pr[j], d.p1pr[j], 0);
+        copy_lanes(f.p1pi[j], d.p1pi[j], 0);
+        copy_lanes(f.p2pr[j], d.p2pr[j], 0);
+        copy_lanes(f.p2pi[j], d.p2pi[j], 0);
+        copy_lanes(f.p1mr[j], d.p1mr[j], 0);
+        copy_lanes(f.p1mi[j], d.p1mi[j], 0);
+        copy_lanes(f.p2mr[j], d.p2mr[j], 0);
+        copy_lanes(f.p2mi[j], d.p2mi[j], 0);
+        }
+      alm2map_spin_gradonly_kernel(f, fx, alm, astr, l, lmax, nvf);
+      for (size_t j=0; j<nmap; ++j)
+        {
+        add_lanes(d.p1pr[j], f.p1pr[j], nval);
+        add_lanes(d.p1pi[j], f.p1pi[j], nval);
+        add_lanes(d.p2pr[j], f.p2pr[j], nval);
+        add_lanes(d.p2pi[j], f.p2pi[j], nval);
+        add_lanes(d.p1mr[j], f.p1mr[j], nval);
+        add_lanes(d.p1mi[j], f.p1mi[j], nval);
+        add_lanes(d.p2mr[j], f.p2mr[j], nval);
+        add_lanes(d.p2mi[j], f.p2mi[j], nval);
+        }
+      }
     }
+  else
+    alm2map_spin_gradonly_kernel(d, fx, alm, astr, l, lmax, nv2);
+
+  combine_spin_accumulators(d, nv2);
   }
 
-DUCC0_NOINLINE static void map2alm_spin_gradonly_kernel(sxdata_v & DUCC0_RESTRICT d,
-  const vector<Ylmgen::dbl2> &fx, dcmplx * DUCC0_RESTRICT alm,
-  size_t l, size_t lmax, size_t nv2)
+template<size_t nmap> DUCC0_NOINLINE static void map2alm_spin_gradonly_kernel(sxdata_v<nmap> & DUCC0_RESTRICT d,
+  const Ylmgen::dbl2 * DUCC0_RESTRICT fx, dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, size_t l, size_t lmax, size_t nv2)
   {
   size_t lsave=l;
   while (l<=lmax)
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=0, agi1=0;
-    Tv agr2=0, agi2=0;
+    Tv agr1[nmap], agi1[nmap], agr2[nmap], agi2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      agr1[j]=agi1[j]=agr2[j]=agi2[j]=0;
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1p[i] = (d.cth[i]*fx10 - fx11)*d.l2p[i] - d.l1p[i];
-      agr1 += d.p2mi[i]*d.l2p[i];
-      agi1 -= d.p2mr[i]*d.l2p[i];
-      agr2 += d.p2pr[i]*d.l1p[i];
-      agi2 += d.p2pi[i]*d.l1p[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        agr1[j] += d.p2mi[j][i]*d.l2p[i];
+        agi1[j] -= d.p2mr[j][i]*d.l2p[i];
+        agr2[j] += d.p2pr[j][i]*d.l1p[i];
+        agi2[j] += d.p2pi[j][i]*d.l1p[i];
+        }
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       }
-    vhsum_cmplx_special (agr1,agi1,agr2,agi2,&alm[l]);
+    for (size_t j=0; j<nmap; ++j)
+      vhsum_cmplx_special (agr1[j],agi1[j],agr2[j],agi2[j],&alm[l*astr+j],astr);
     l+=2;
     }
   l=lsave;
@@ -1283,28 +1769,34 @@ DUCC0_NOINLINE static void map2alm_spin_gradonly_kernel(sxdata_v & DUCC0_RESTRIC
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=0, agi1=0;
-    Tv agr2=0, agi2=0;
+    Tv agr1[nmap], agi1[nmap], agr2[nmap], agi2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      agr1[j]=agi1[j]=agr2[j]=agi2[j]=0;
     for (size_t i=0; i<nv2; ++i)
       {
       d.l1m[i] = (d.cth[i]*fx10 + fx11)*d.l2m[i] - d.l1m[i];
-      agr1 += d.p1pr[i]*d.l2m[i];
-      agi1 += d.p1pi[i]*d.l2m[i];
-      agr2 -= d.p1mi[i]*d.l1m[i];
-      agi2 += d.p1mr[i]*d.l1m[i];
+      for (size_t j=0; j<nmap; ++j)
+        {
+        agr1[j] += d.p1pr[j][i]*d.l2m[i];
+        agi1[j] += d.p1pi[j][i]*d.l2m[i];
+        agr2[j] -= d.p1mi[j][i]*d.l1m[i];
+        agi2[j] += d.p1mr[j][i]*d.l1m[i];
+        }
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
       }
-    vhsum_cmplx_special (agr1,agi1,agr2,agi2,&alm[l]);
+    for (size_t j=0; j<nmap; ++j)
+      vhsum_cmplx_special (agr1[j],agi1[j],agr2[j],agi2[j],&alm[l*astr+j],astr);
     l+=2;
     }
   }
 
-DUCC0_NOINLINE static void calc_map2alm_spin_gradonly (dcmplx * DUCC0_RESTRICT alm,
-  const Ylmgen &gen, sxdata_v & DUCC0_RESTRICT d, size_t nth)
+template<size_t nmap> DUCC0_NOINLINE static void calc_map2alm_spin_gradonly (dcmplx * DUCC0_RESTRICT alm,
+  size_t astr, const Ylmgen &gen, sxdata_v<nmap> & DUCC0_RESTRICT d, size_t nth,
+  leg_truncation &trunc)
   {
   size_t l,lmax=gen.lmax;
   size_t nv2 = (nth+VLEN-1)/VLEN;
-  iter_to_ieee_spin(gen, d, l, nv2);
+  iter_to_ieee_spin(gen, d, l, nv2, trunc);
   if (l>lmax) return;
 
   const auto &fx = gen.coef;
@@ -1316,21 +1808,15 @@ DUCC0_NOINLINE static void calc_map2alm_spin_gradonly (dcmplx * DUCC0_RESTRICT a
     full_ieee &= all_of(d.scp[i]>=0) &&
                  all_of(d.scm[i]>=0);
     }
-  for (size_t i=0; i<nv2; ++i)
-    {
-    Tv tmp;
-    tmp = d.p1pr[i]; d.p1pr[i] -= d.p2mi[i]; d.p2mi[i] += tmp;
-    tmp = d.p1pi[i]; d.p1pi[i] += d.p2mr[i]; d.p2mr[i] -= tmp;
-    tmp = d.p1mr[i]; d.p1mr[i] += d.p2pi[i]; d.p2pi[i] -= tmp;
-    tmp = d.p1mi[i]; d.p1mi[i] -= d.p2pr[i]; d.p2pr[i] += tmp;
-    }
+  combine_spin_accumulators(d, nv2);
 
   while((!full_ieee) && (l<=lmax))
     {
     Tv fx10=fx[l+1].a,fx11=fx[l+1].b;
     Tv fx20=fx[l+2].a,fx21=fx[l+2].b;
-    Tv agr1=0, agi1=0;
-    Tv agr2=0, agi2=0;
+    Tv agr1[nmap], agi1[nmap], agr2[nmap], agi2[nmap];
+    for (size_t j=0; j<nmap; ++j)
+      agr1[j]=agi1[j]=agr2[j]=agi2[j]=0;
     full_ieee=1;
     for (size_t i=0; i<nv2; ++i)
       {
@@ -1338,10 +1824,13 @@ DUCC0_NOINLINE static void calc_map2alm_spin_gradonly (dcmplx * DUCC0_RESTRICT a
       d.l1m[i] = (d.cth[i]*fx10 + fx11)*d.l2m[i] - d.l1m[i];
       Tv l2p = d.l2p[i]*d.cfp[i], l2m = d.l2m[i]*d.cfm[i];
       Tv l1p = d.l1p[i]*d.cfp[i], l1m = d.l1m[i]*d.cfm[i];
-      agr1 += d.p1pr[i]*l2m + d.p2mi[i]*l2p;
-      agi1 += d.p1pi[i]*l2m - d.p2mr[i]*l2p;
-      agr2 += d.p2pr[i]*l1p - d.p1mi[i]*l1m;
-      agi2 += d.p2pi[i]*l1p + d.p1mr[i]*l1m;
+      for (size_t j=0; j<nmap; ++j)
+        {
+        agr1[j] += d.p1pr[j][i]*l2m + d.p2mi[j][i]*l2p;
+        agi1[j] += d.p1pi[j][i]*l2m - d.p2mr[j][i]*l2p;
+        agr2[j] += d.p2pr[j][i]*l1p - d.p1mi[j][i]*l1m;
+        agi2[j] += d.p2pi[j][i]*l1p + d.p1mr[j][i]*l1m;
+        }
 
       d.l2p[i] = (d.cth[i]*fx20 - fx21)*d.l1p[i] - d.l2p[i];
       d.l2m[i] = (d.cth[i]*fx20 + fx21)*d.l1m[i] - d.l2m[i];
@@ -1352,7 +1841,8 @@ DUCC0_NOINLINE static void calc_map2alm_spin_gradonly (dcmplx * DUCC0_RESTRICT a
         getCorfac(d.scm[i], d.cfm[i]);
       full_ieee &= all_of(d.scm[i]>=0);
       }
-    vhsum_cmplx_special (agr1,agi1,agr2,agi2,&alm[l]);
+    for (size_t j=0; j<nmap; ++j)
+      vhsum_cmplx_special (agr1[j],agi1[j],agr2[j],agi2[j],&alm[l*astr+j],astr);
     l+=2;
     }
   if (l>lmax) return;
@@ -1364,30 +1854,23 @@ DUCC0_NOINLINE static void calc_map2alm_spin_gradonly (dcmplx * DUCC0_RESTRICT a
     d.l1m[i] *= d.cfm[i];
     d.l2m[i] *= d.cfm[i];
     }
-  map2alm_spin_gradonly_kernel(d, fx, alm, l, lmax, nv2);
+  map2alm_spin_gradonly_kernel(d, fx, alm, astr, l, lmax, nv2);
   }
 
-template<typename T> DUCC0_NOINLINE static void inner_loop_a2m(SHT_mode mode,
-  const vmav<complex<double>,2> &almtmp,
-  const vmav<complex<T>,3> &phase, const vector<ringdata> &rdata,
-  Ylmgen &gen, size_t mi)
+// Synthesis for nmap a_lm sets starting at column ialm0 of almtmp, which
+// produce the Legendre components starting at ileg0.
+template<size_t nmap, typename T> DUCC0_NOINLINE static void inner_loop_a2m_sets(
+  SHT_mode mode, const vmav<complex<double>,2> &almtmp, size_t ialm0,
+  const vmav<complex<T>,3> &phase, size_t ileg0, const vector<ringdata> &rdata,
+  const Ylmgen &gen, size_t mi, leg_truncation &trunc)
   {
+  const dcmplx * DUCC0_RESTRICT alm=almtmp.data()+ialm0;
+  size_t astr=almtmp.stride(0);
+  bool use_float = use_float_recurrence<T>(gen.lmax, trunc.epsilon);
   if (gen.s==0)
     {
-    // adjust the a_lm for the new algorithm
-    MR_assert(almtmp.stride(1)==1, "bad stride");
-    dcmplx * DUCC0_RESTRICT alm=almtmp.data();
-    for (size_t il=0, l=gen.m; l<=gen.lmax; ++il,l+=2)
-      {
-      dcmplx al = alm[l];
-      dcmplx al1 = (l+1>gen.lmax) ? 0. : alm[l+1];
-      dcmplx al2 = (l+2>gen.lmax) ? 0. : alm[l+2];
-      alm[l  ] = gen.alpha[il]*(gen.eps[l+1]*al + gen.eps[l+2]*al2);
-      alm[l+1] = gen.alpha[il]*al1;
-      }
-
     constexpr size_t nval=nv0*VLEN;
-    s0data_u d;
+    s0data_u<nmap> d;
     array<size_t, nval> idx, midx;
     Tbv0 cth;
     size_t ith=0;
@@ -1410,7 +1893,8 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_a2m(SHT_mode mode,
           ++nth;
           }
         else
-          phase(0, rdata[ith].idx, mi) = phase(0, rdata[ith].midx, mi) = 0;
+          for (size_t j=0; j<nmap; ++j)
+            phase(ileg0+j, rdata[ith].idx, mi) = phase(ileg0+j, rdata[ith].midx, mi) = 0;
         ++ith;
         }
       if (nth>0)
@@ -1422,39 +1906,37 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_a2m(SHT_mode mode,
           d.s.csq[i]=d.s.csq[nth-1];
           d.s.sth[i]=d.s.sth[nth-1];
           }
-        for (size_t i=0; i<nvec; ++i)
-          d.v.p1r[i] = d.v.p1i[i] = d.v.p2r[i] = d.v.p2i[i] = 0;
-        calc_alm2map (almtmp.data(), gen, d.v, nth);
-        for (size_t i=0; i<nvec; ++i)
-          {
-          auto t1r = d.v.p1r[i];
-          auto t2r = d.v.p2r[i]*cth[i];
-          auto t1i = d.v.p1i[i];
-          auto t2i = d.v.p2i[i]*cth[i];
-          d.v.p1r[i] = t1r+t2r;
-          d.v.p1i[i] = t1i+t2i;
-          d.v.p2r[i] = t1r-t2r;
-          d.v.p2i[i] = t1i-t2i;
-          }
-        for (size_t i=0; i<nth; ++i)
-          {
-          //adjust for new algorithm
-          phase(0, idx[i], mi) = complex<T>(T(d.s.p1r[i]),T(d.s.p1i[i]));
-          if (idx[i]!=midx[i])
-            phase(0, midx[i], mi) = complex<T>(T(d.s.p2r[i]),T(d.s.p2i[i]));
-          }
+        for (size_t j=0; j<nmap; ++j)
+          for (size_t i=0; i<nvec; ++i)
+            d.v.p1r[j][i] = d.v.p1i[j][i] = d.v.p2r[j][i] = d.v.p2i[j][i] = 0;
+        calc_alm2map (alm, astr, gen, d.v, nth, use_float, trunc);
+        for (size_t j=0; j<nmap; ++j)
+          for (size_t i=0; i<nvec; ++i)
+            {
+            auto t1r = d.v.p1r[j][i];
+            auto t2r = d.v.p2r[j][i]*cth[i];
+            auto t1i = d.v.p1i[j][i];
+            auto t2i = d.v.p2i[j][i]*cth[i];
+            d.v.p1r[j][i] = t1r+t2r;
+            d.v.p1i[j][i] = t1i+t2i;
+            d.v.p2r[j][i] = t1r-t2r;
+            d.v.p2i[j][i] = t1i-t2i;
+            }
+        for (size_t j=0; j<nmap; ++j)
+          for (size_t i=0; i<nth; ++i)
+            {
+            //adjust for new algorithm
+            phase(ileg0+j, idx[i], mi) = complex<T>(T(d.s.p1r[j][i]),T(d.s.p1i[j][i]));
+            if (idx[i]!=midx[i])
+              phase(ileg0+j, midx[i], mi) = complex<T>(T(d.s.p2r[j][i]),T(d.s.p2i[j][i]));
+            }
         }
       }
     }
   else
     {
-    //adjust the a_lm for the new algorithm
-    for (size_t l=gen.mhi; l<=gen.lmax+1; ++l)
-      for (size_t i=0; i<almtmp.shape(1); ++i)
-        almtmp(l,i)*=gen.alpha[l];
-
     constexpr size_t nval=nvx*VLEN;
-    sxdata_u d;
+    sxdata_u<nmap> d;
     array<size_t, nval> idx, midx;
     size_t ith=0;
     while (ith<rdata.size())
@@ -1470,10 +1952,8 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_a2m(SHT_mode mode,
           ++nth;
           }
         else
-          {
-          phase(0, rdata[ith].idx, mi) = phase(0, rdata[ith].midx, mi) = 0;
-          phase(1, rdata[ith].idx, mi) = phase(1, rdata[ith].midx, mi) = 0;
-          }
+          for (size_t j=0; j<2*nmap; ++j)
+            phase(ileg0+j, rdata[ith].idx, mi) = phase(ileg0+j, rdata[ith].midx, mi) = 0;
         ++ith;
         }
       if (nth>0)
@@ -1485,60 +1965,113 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_a2m(SHT_mode mode,
           d.s.cth[i]=d.s.cth[nth-1];
           d.s.sth[i]=d.s.sth[nth-1];
           }
-        for (size_t i=0; i<nvec; ++i)
-          d.v.p1pr[i] = d.v.p1pi[i] = d.v.p2pr[i] = d.v.p2pi[i] =
-          d.v.p1mr[i] = d.v.p1mi[i] = d.v.p2mr[i] = d.v.p2mi[i] = 0;
+        for (size_t j=0; j<nmap; ++j)
+          for (size_t i=0; i<nvec; ++i)
+            d.v.p1pr[j][i] = d.v.p1pi[j][i] = d.v.p2pr[j][i] = d.v.p2pi[j][i] =
+            d.v.p1mr[j][i] = d.v.p1mi[j][i] = d.v.p2mr[j][i] = d.v.p2mi[j][i] = 0;
         if (mode==STANDARD)
-          calc_alm2map_spin(almtmp.data(), gen, d.v, nth);
+          calc_alm2map_spin(alm, astr, gen, d.v, nth, use_float, trunc);
         else // GRAD_ONLY or DERIV1
-          calc_alm2map_spin_gradonly(almtmp.data(), gen, d.v, nth);
+          calc_alm2map_spin_gradonly(alm, astr, gen, d.v, nth, use_float, trunc);
         double fct = ((gen.mhi-gen.m+gen.s)&1) ? -1.: 1.;
-        for (size_t i=0; i<nvec; ++i)
-          {
-          auto p1pr=d.v.p1pr[i], p1pi=d.v.p1pi[i],
-               p2pr=d.v.p2pr[i], p2pi=d.v.p2pi[i],
-               p1mr=d.v.p1mr[i], p1mi=d.v.p1mi[i],
-               p2mr=d.v.p2mr[i], p2mi=d.v.p2mi[i];
-          d.v.p1pr[i] = p1pr+p2pr;
-          d.v.p1pi[i] = p1pi+p2pi;
-          d.v.p1mr[i] = p1mr+p2mr;
-          d.v.p1mi[i] = p1mi+p2mi;
-          d.v.p2pr[i] = fct*(p1pr-p2pr);
-          d.v.p2pi[i] = fct*(p1pi-p2pi);
-          d.v.p2mr[i] = fct*(p1mr-p2mr);
-          d.v.p2mi[i] = fct*(p1mi-p2mi);
-          }
-        for (size_t i=0; i<nth; ++i)
-          {
-          dcmplx q1(d.s.p1pr[i], d.s.p1pi[i]),
-                 q2(d.s.p2pr[i], d.s.p2pi[i]),
-                 u1(d.s.p1mr[i], d.s.p1mi[i]),
-                 u2(d.s.p2mr[i], d.s.p2mi[i]);
-          phase(0, idx[i], mi) = complex<T>(T(d.s.p1pr[i]), T(d.s.p1pi[i]));
-          phase(1, idx[i], mi) = complex<T>(T(d.s.p1mr[i]), T(d.s.p1mi[i]));
-          if (idx[i]!=midx[i])
+        for (size_t j=0; j<nmap; ++j)
+          for (size_t i=0; i<nvec; ++i)
             {
-            phase(0, midx[i], mi) = complex<T>(T(d.s.p2pr[i]), T(d.s.p2pi[i]));
-            phase(1, midx[i], mi) = complex<T>(T(d.s.p2mr[i]), T(d.s.p2mi[i]));
+            auto p1pr=d.v.p1pr[j][i], p1pi=d.v.p1pi[j][i],
+                 p2pr=d.v.p2pr[j][i], p2pi=d.v.p2pi[j][i],
+                 p1mr=d.v.p1mr[j][i], p1mi=d.v.p1mi[j][i],
+                 p2mr=d.v.p2mr[j][i], p2mi=d.v.p2mi[j][i];
+            d.v.p1pr[j][i] = p1pr+p2pr;
+            d.v.p1pi[j][i] = p1pi+p2pi;
+            d.v.p1mr[j][i] = p1mr+p2mr;
+            d.v.p1mi[j][i] = p1mi+p2mi;
+            d.v.p2pr[j][i] = fct*(p1pr-p2pr);
+            d.v.p2pi[j][i] = fct*(p1pi-p2pi);
+            d.v.p2mr[j][i] = fct*(p1mr-p2mr);
+            d.v.p2mi[j][i] = fct*(p1mi-p2mi);
+            }
+        for (size_t j=0; j<nmap; ++j)
+          for (size_t i=0; i<nth; ++i)
+            {
+            phase(ileg0+2*j  , idx[i], mi) = complex<T>(T(d.s.p1pr[j][i]), T(d.s.p1pi[j][i]));
+            phase(ileg0+2*j+1, idx[i], mi) = complex<T>(T(d.s.p1mr[j][i]), T(d.s.p1mi[j][i]));
+            if (idx[i]!=midx[i])
+              {
+              phase(ileg0+2*j  , midx[i], mi) = complex<T>(T(d.s.p2pr[j][i]), T(d.s.p2pi[j][i]));
+              phase(ileg0+2*j+1, midx[i], mi) = complex<T>(T(d.s.p2mr[j][i]), T(d.s.p2mi[j][i]));
+              }
             }
-          }
         }
       }
     }
   }
 
-template<typename T> DUCC0_NOINLINE static void inner_loop_m2a(SHT_mode mode,
+// Maximum number of a_lm sets processed together by the kernels; larger
+// values cause register spills and were slower in benchmarks.
+constexpr size_t sht_max_nmap = 2;
+
+// almtmp can hold several a_lm sets of the same spin (one column per set
+// for spin 0 and GRAD_ONLY/DERIV1, two columns per set for spin>0 in STANDARD
+// mode); every Legendre coefficient is computed once and applied to all sets
+// in a chunk of up to sht_max_nmap.
+template<typename T> DUCC0_NOINLINE static void inner_loop_a2m(SHT_mode mode,
   const vmav<complex<double>,2> &almtmp,
-  const cmav<complex<T>,3> &phase, const vector<ringdata> &rdata,
-  Ylmgen &gen, size_t mi)
+  const vmav<complex<T>,3> &phase, const vector<ringdata> &rdata,
+  Ylmgen &gen, size_t mi, leg_truncation &trunc)
   {
+  MR_assert(almtmp.stride(1)==1, "bad stride");
+  size_t nalm = almtmp.shape(1);
+  if (gen.s==0)
+    {
+    // adjust the a_lm for the new algorithm
+    for (size_t il=0, l=gen.m; l<=gen.lmax; ++il,l+=2)
+      for (size_t i=0; i<nalm; ++i)
+        {
+        dcmplx al = almtmp(l,i);
+        dcmplx al1 = (l+1>gen.lmax) ? 0. : almtmp(l+1,i);
+        dcmplx al2 = (l+2>gen.lmax) ? 0. : almtmp(l+2,i);
+        almtmp(l  ,i) = gen.alpha[il]*(gen.eps[l+1]*al + gen.eps[l+2]*al2);
+        almtmp(l+1,i) = gen.alpha[il]*al1;
+        }
+    }
+  else
+    {
+    //adjust the a_lm for the new algorithm
+    for (size_t l=gen.mhi; l<=gen.lmax+1; ++l)
+      for (size_t i=0; i<nalm; ++i)
+        almtmp(l,i)*=gen.alpha[l];
+    }
+
+  size_t nalm_set = ((gen.s>0) && (mode==STANDARD)) ? 2 : 1;
+  size_t nleg_set = (gen.s>0) ? 2 : 1;
+  size_t nset = nalm/nalm_set;
+  size_t j=0;
+  for (; j+sht_max_nmap<=nset; j+=sht_max_nmap)
+    inner_loop_a2m_sets<sht_max_nmap>(mode, almtmp, j*nalm_set, phase,
+      j*nleg_set, rdata, gen, mi, trunc);
+  for (; j+2<=nset; j+=2)
+    inner_loop_a2m_sets<2>(mode, almtmp, j*nalm_set, phase, j*nleg_set, rdata,
+      gen, mi, trunc);
+  for (; j<nset; ++j)
+    inner_loop_a2m_sets<1>(mode, almtmp, j*nalm_set, phase, j*nleg_set, rdata,
+      gen, mi, trunc);
+  }
+
+// Adjoint of inner_loop_a2m_sets
+template<size_t nmap, typename T> DUCC0_NOINLINE static void inner_loop_m2a_sets(
+  SHT_mode mode, const vmav<complex<double>,2> &almtmp, size_t ialm0,
+  const cmav<complex<T>,3> &phase, size_t ileg0, const vector<ringdata> &rdata,
+  const Ylmgen &gen, size_t mi, leg_truncation &trunc)
+  {
+  dcmplx * DUCC0_RESTRICT alm=almtmp.data()+ialm0;
+  size_t astr=almtmp.stride(0);
   if (gen.s==0)
     {
     constexpr size_t nval=nv0*VLEN;
     size_t ith=0;
     while (ith<rdata.size())
       {
-      s0data_u d;
+      s0data_u<nmap> d;
       size_t nth=0;
       while ((nth<nval)&&(ith<rdata.size()))
         {
@@ -1549,13 +2082,16 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_m2a(SHT_mode mode,
           else
             d.s.csq[nth]=rdata[ith].cth*rdata[ith].cth;
           d.s.sth[nth]=rdata[ith].sth;
-          dcmplx ph1=phase(0, rdata[ith].idx, mi);
-          dcmplx ph2=(rdata[ith].idx==rdata[ith].midx) ? 0 : phase(0, rdata[ith].midx, mi);
-          d.s.p1r[nth]=(ph1+ph2).real(); d.s.p1i[nth]=(ph1+ph2).imag();
-          d.s.p2r[nth]=(ph1-ph2).real(); d.s.p2i[nth]=(ph1-ph2).imag();
-          //adjust for new algorithm
-          d.s.p2r[nth]*=rdata[ith].cth;
-          d.s.p2i[nth]*=rdata[ith].cth;
+          for (size_t j=0; j<nmap; ++j)
+            {
+            dcmplx ph1=phase(ileg0+j, rdata[ith].idx, mi);
+            dcmplx ph2=(rdata[ith].idx==rdata[ith].midx) ? 0 : phase(ileg0+j, rdata[ith].midx, mi);
+            d.s.p1r[j][nth]=(ph1+ph2).real(); d.s.p1i[j][nth]=(ph1+ph2).imag();
+            d.s.p2r[j][nth]=(ph1-ph2).real(); d.s.p2i[j][nth]=(ph1-ph2).imag();
+            //adjust for new algorithm
+            d.s.p2r[j][nth]*=rdata[ith].cth;
+            d.s.p2i[j][nth]*=rdata[ith].cth;
+            }
           ++nth;
           }
         ++ith;
@@ -1567,24 +2103,12 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_m2a(SHT_mode mode,
           {
           d.s.csq[i]=d.s.csq[nth-1];
           d.s.sth[i]=d.s.sth[nth-1];
-          d.s.p1r[i]=d.s.p1i[i]=d.s.p2r[i]=d.s.p2i[i]=0.;
+          for (size_t j=0; j<nmap; ++j)
+            d.s.p1r[j][i]=d.s.p1i[j][i]=d.s.p2r[j][i]=d.s.p2i[j][i]=0.;
           }
-        calc_map2alm (almtmp.data(), gen, d.v, nth);
+        calc_map2alm (alm, astr, gen, d.v, nth, trunc);
         }
       }
-    //adjust the a_lm for the new algorithm
-    dcmplx * DUCC0_RESTRICT alm=almtmp.data();
-    dcmplx alm2 = 0.;
-    double alold=0;
-    for (size_t il=0, l=gen.m; l<=gen.lmax; ++il,l+=2)
-      {
-      dcmplx al = alm[l];
-      dcmplx al1 = (l+1>gen.lmax) ? 0. : alm[l+1];
-      alm[l  ] = gen.alpha[il]*gen.eps[l+1]*al + alold*gen.eps[l]*alm2;
-      alm[l+1] = gen.alpha[il]*al1;
-      alm2=al;
-      alold=gen.alpha[il];
-      }
     }
   else
     {
@@ -1592,23 +2116,26 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_m2a(SHT_mode mode,
     size_t ith=0;
     while (ith<rdata.size())
       {
-      sxdata_u d;
+      sxdata_u<nmap> d;
       size_t nth=0;
       while ((nth<nval)&&(ith<rdata.size()))
         {
         if (rdata[ith].mlim>=gen.m)
           {
           d.s.cth[nth]=rdata[ith].cth; d.s.sth[nth]=rdata[ith].sth;
-          dcmplx p1Q=phase(0, rdata[ith].idx, mi),
-                 p1U=phase(1, rdata[ith].idx, mi),
-                 p2Q=(rdata[ith].idx!=rdata[ith].midx) ? phase(0, rdata[ith].midx, mi):0.,
-                 p2U=(rdata[ith].idx!=rdata[ith].midx) ? phase(1, rdata[ith].midx, mi):0.;
-          if ((gen.mhi-gen.m+gen.s)&1)
-            { p2Q=-p2Q; p2U=-p2U; }
-          d.s.p1pr[nth]=(p1Q+p2Q).real(); d.s.p1pi[nth]=(p1Q+p2Q).imag();
-          d.s.p1mr[nth]=(p1U+p2U).real(); d.s.p1mi[nth]=(p1U+p2U).imag();
-          d.s.p2pr[nth]=(p1Q-p2Q).real(); d.s.p2pi[nth]=(p1Q-p2Q).imag();
-          d.s.p2mr[nth]=(p1U-p2U).real(); d.s.p2mi[nth]=(p1U-p2U).imag();
+          for (size_t j=0; j<nmap; ++j)
+            {
+            dcmplx p1Q=phase(ileg0+2*j, rdata[ith].idx, mi),
+                   p1U=phase(ileg0+2*j+1, rdata[ith].idx, mi),
+                   p2Q=(rdata[ith].idx!=rdata[ith].midx) ? phase(ileg0+2*j, rdata[ith].midx, mi):0.,
+                   p2U=(rdata[ith].idx!=rdata[ith].midx) ? phase(ileg0+2*j+1, rdata[ith].midx, mi):0.;
+            if ((gen.mhi-gen.m+gen.s)&1)
+              { p2Q=-p2Q; p2U=-p2U; }
+            d.s.p1pr[j][nth]=(p1Q+p2Q).real(); d.s.p1pi[j][nth]=(p1Q+p2Q).imag();
+            d.s.p1mr[j][nth]=(p1U+p2U).real(); d.s.p1mi[j][nth]=(p1U+p2U).imag();
+            d.s.p2pr[j][nth]=(p1Q-p2Q).real(); d.s.p2pi[j][nth]=(p1Q-p2Q).imag();
+            d.s.p2mr[j][nth]=(p1U-p2U).real(); d.s.p2mi[j][nth]=(p1U-p2U).imag();
+            }
           ++nth;
           }
         ++ith;
@@ -1620,18 +2147,65 @@ template<typename T> DUCC0_NOINLINE static void inner_loop_m2a(SHT_mode mode,
           {
           d.s.cth[i]=d.s.cth[nth-1];
           d.s.sth[i]=d.s.sth[nth-1];
-          d.s.p1pr[i]=d.s.p1pi[i]=d.s.p2pr[i]=d.s.p2pi[i]=0.;
-          d.s.p1mr[i]=d.s.p1mi[i]=d.s.p2mr[i]=d.s.p2mi[i]=0.;
+          for (size_t j=0; j<nmap; ++j)
+            {
+            d.s.p1pr[j][i]=d.s.p1pi[j][i]=d.s.p2pr[j][i]=d.s.p2pi[j][i]=0.;
+            d.s.p1mr[j][i]=d.s.p1mi[j][i]=d.s.p2mr[j][i]=d.s.p2mi[j][i]=0.;
+            }
           }
         if (mode==STANDARD)
-          calc_map2alm_spin(almtmp.data(), gen, d.v, nth);
+          calc_map2alm_spin(alm, astr, gen, d.v, nth, trunc);
         else
-          calc_map2alm_spin_gradonly(almtmp.data(), gen, d.v, nth);
+          calc_map2alm_spin_gradonly(alm, astr, gen, d.v, nth, trunc);
         }
       }
+    }
+  }
+
+template<typename T> DUCC0_NOINLINE static void inner_loop_m2a(SHT_mode mode,
+  const vmav<complex<double>,2> &almtmp,
+  const cmav<complex<T>,3> &phase, const vector<ringdata> &rdata,
+  Ylmgen &gen, size_t mi, leg_truncation &trunc)
+  {
+  MR_assert(almtmp.stride(1)==1, "bad stride");
+  size_t nalm = almtmp.shape(1);
+  size_t nalm_set = ((gen.s>0) && (mode==STANDARD)) ? 2 : 1;
+  size_t nleg_set = (gen.s>0) ? 2 : 1;
+  size_t nset = nalm/nalm_set;
+  size_t j=0;
+  for (; j+sht_max_nmap<=nset; j+=sht_max_nmap)
+    inner_loop_m2a_sets<sht_max_nmap>(mode, almtmp, j*nalm_set, phase,
+      j*nleg_set, rdata, gen, mi, trunc);
+  for (; j+2<=nset; j+=2)
+    inner_loop_m2a_sets<2>(mode, almtmp, j*nalm_set, phase, j*nleg_set, rdata,
+      gen, mi, trunc);
+  for (; j<nset; ++j)
+    inner_loop_m2a_sets<1>(mode, almtmp, j*nalm_set, phase, j*nleg_set, rdata,
+      gen, mi, trunc);
+
+  if (gen.s==0)
+    {
+    //adjust the a_lm for the new algorithm
+    for (size_t i=0; i<nalm; ++i)
+      {
+      dcmplx alm2 = 0.;
+      double alold=0;
+      for (size_t il=0, l=gen.m; l<=gen.lmax; ++il,l+=2)
+        {
+        dcmplx al = almtmp(l,i);
+        dcmplx al1 = (l+1>gen.lmax) ? 0. : almtmp(l+1,i);
+        almtmp(l  ,i) = gen.alpha[il]*gen.eps[l+1]*al + alold*gen.eps[l]*alm2;
+        almtmp(l+1,i) = gen.alpha[il]*al1;
+        alm2=al;
+        alold=gen.alpha[il];
+        }
+      }
+    }
+  else
+    {
     //adjust the a_lm for the new algorithm
     for (size_t l=gen.mhi; l<=gen.lmax; ++l)
-      for (size_t i=0; i<almtmp.shape(1); ++i)
+      for (size_t i=0; i<nalm; ++i)
         almtmp(l,i)*=gen.alpha[l];
     }
   }
@@ -1666,8 +2240,46 @@ DUCC0_NOINLINE size_t get_mlim (size_t lmax, size_t spin, double sth, double cth
   return size_t(res+0.5);
   }
 
+// Variant of get_mlim for a given accuracy epsilon: returns the largest m
+// (plus spin) for which |d^lmax_{m0}(theta)| reaches epsilon, and stores
+// the value at the next larger m in dskip. Beyond the turning point
+// m=lmax*sin(theta) these values decrease monotonically with m and increase
+// with l, so they are obtained from the downward recurrence in m at l=lmax,
+// which is stable there.
+DUCC0_NOINLINE size_t get_mlim (size_t lmax, size_t spin, double sth,
+  double cth, double epsilon, double &dskip)
+  {
+  dskip = 0.;
+  if (sth<=0) return min(lmax, spin);
+  double l = double(lmax), cot = abs(cth)/sth;
+  // |d^l_{ll}| = sqrt((2l)!)/(2^l l!) * sin^l(theta), stored as exp(lognrm)*dm
+  double lognrm = 0.5*lgamma(2*l+1) - l*log(2.) - lgamma(l+1) + l*log(sth);
+  double logeps = log(epsilon);
+  double dm=1., dmp1=0.;
+  size_t m=lmax;
+  while ((m>0) && (m>l*sth))
+    {
+    if (lognrm+log(abs(dm))>=logeps) break;
+    dskip = exp(lognrm)*abs(dm);
+    double mm = double(m);
+    double dmm1 = -(2*mm*cot*dm + sqrt((l+mm+1)*(l-mm))*dmp1)
+                  / sqrt((l+mm)*(l-mm+1));
+    dmp1 = dm;
+    dm = dmm1;
+    if (abs(dm)>1e100)
+      {
+      lognrm += log(abs(dm));
+      dmp1 /= abs(dm);
+      dm /= abs(dm);
+      }
+    --m;
+    }
+  if (m==lmax) dskip=0.;
+  return min(lmax, m+spin);
+  }
+
 vector<ringdata> make_ringdata(const cmav<double,1> &theta, size_t lmax,
-  size_t spin)
+  size_t spin, double epsilon=0.)
   {
   size_t nrings = theta.shape(0);
   struct ringinfo
@@ -1682,29 +2294,185 @@ vector<ringdata> make_ringdata(const cmav<double,1> &theta, size_t lmax,
     { return (a.sth<b.sth); });
 
   vector<ringdata> res;
+  auto add = [&](const ringinfo &r, size_t midx)
+    {
+    double dskip=0.;
+    size_t mlim = (epsilon>0) ? get_mlim(lmax, spin, r.sth, r.cth, epsilon, dskip)
+                              : get_mlim(lmax, spin, r.sth, r.cth);
+    res.push_back({mlim, r.idx, midx, r.cth, r.sth, dskip});
+    };
   size_t pos=0;
   while (pos<nrings)
     {
     if ((pos+1<nrings) && (fabs(tmp[pos].theta+tmp[pos+1].theta-pi)<=5e-15))
       {
       if (tmp[pos].theta<tmp[pos+1].theta)
-        res.push_back({get_mlim(lmax, spin, tmp[pos].sth, tmp[pos].cth),
-          tmp[pos].idx, tmp[pos+1].idx, tmp[pos].cth, tmp[pos].sth});
+        add(tmp[pos], tmp[pos+1].idx);
       else
-        res.push_back({get_mlim(lmax, spin, tmp[pos+1].sth, tmp[pos+1].cth),
-          tmp[pos+1].idx, tmp[pos].idx, tmp[pos+1].cth, tmp[pos+1].sth});
+        add(tmp[pos+1], tmp[pos].idx);
       pos += 2;
       }
     else
       {
-      res.push_back({get_mlim(lmax, spin, tmp[pos].sth, tmp[pos].cth),
-        tmp[pos].idx, tmp[pos].idx, tmp[pos].cth, tmp[pos].sth});
+      add(tmp[pos], tmp[pos].idx);
       ++pos;
       }
     }
   return res;
   }
 
+// Process-wide LRU cache of Legendre recurrence tables (keyed on lmax, mmax
+// and spin) and of ring data (keyed on lmax, spin and the ring colatitudes),
+// bounded by the estimated memory of the cached objects. Objects which are
+// larger than the limit on their own are built, but not cached.
+class sht_table_cache
+  {
+  private:
+    struct Tkey
+      {
+      bool rings;
+      size_t lmax, mmax, spin;
+      vector<double> theta;  // only used for ring data
+      double epsilon=0;      // only used for ring data
+
+      bool operator==(const Tkey &other) const
+        {
+        return (rings==other.rings) && (lmax==other.lmax)
+            && (mmax==other.mmax) && (spin==other.spin)
+            && (theta==other.theta) && (epsilon==other.epsilon);
+        }
+      };
+    struct Thash
+      {
+      size_t operator()(const Tkey &key) const
+        {
+        size_t res = size_t(key.rings) ^ (key.lmax<<1) ^ (key.mmax<<21)
+                   ^ (key.spin<<41);
+        for (auto th: key.theta)
+          res = res*31 + hash<double>()(th);
+        return res ^ hash<double>()(key.epsilon);
+        }
+      };
+    struct entry
+      {
+      Tkey key;
+      shared_ptr<const void> ptr;
+      size_t bytes;
+      };
+
+    mutable Mutex mut;
+    list<entry> lru;  // most recently used object first
+    unordered_map<Tkey, list<entry>::iterator, Thash> index;
+    size_t max_bytes=size_t(256)<<20, bytes=0;
+    atomic<size_t> hits{0}, misses{0}, evictions{0};
+
+    sht_table_cache() {}
+
+    // must be called with the lock held
+    void evict()
+      {
+      while ((!lru.empty()) && (bytes>max_bytes))
+        {
+        bytes -= lru.back().bytes;
+        index.erase(lru.back().key);
+        lru.pop_back();
+        ++evictions;
+        }
+      }
+    // must be called with the lock held
+    shared_ptr<const void> find(const Tkey &key)
+      {
+      auto it = index.find(key);
+      if (it==index.end()) return nullptr;
+      if (it->second!=lru.begin())
+        lru.splice(lru.begin(), lru, it->second);
+      return it->second->ptr;
+      }
+
+    template<typename T, typename Func> shared_ptr<const T> get(Tkey &&key,
+      size_t nbytes, Func &&build)
+      {
+      shared_ptr<const void> res;
+      bool cacheable;
+      {
+      LockGuard lock(mut);
+      cacheable = (nbytes<=max_bytes);
+      if (cacheable)
+        res = find(key);
+      }
+      if (res)
+        {
+        hits.fetch_add(1, memory_order_relaxed);
+        return static_pointer_cast<const T>(res);
+        }
+      misses.fetch_add(1, memory_order_relaxed);
+      shared_ptr<const T> obj = build(cacheable);
+      if (!cacheable) return obj;
+      LockGuard lock(mut);
+      res = find(key);  // maybe another thread was quicker
+      if (res) return static_pointer_cast<const T>(res);
+      lru.push_front({std::move(key), obj, nbytes});
+      index[lru.front().key] = lru.begin();
+      bytes += nbytes;
+      evict();
+      return obj;
+      }
+
+  public:
+    static sht_table_cache &get()
+      {
+      static sht_table_cache cache;
+      return cache;
+      }
+
+    shared_ptr<const YlmTables> get_tables(size_t lmax, size_t mmax,
+      size_t spin)
+      {
+      return get<YlmTables>({false, lmax, mmax, spin, {}},
+        YlmTables::bytes(lmax, mmax, spin),
+        [&](bool cacheable)
+          { return make_shared<const YlmTables>(lmax, mmax, spin, cacheable); });
+      }
+    shared_ptr<const vector<ringdata>> get_ringdata(
+      const cmav<double,1> &theta, size_t lmax, size_t spin,
+      double epsilon=0.)
+      {
+      vector<double> th(theta.shape(0));
+      for (size_t i=0; i<th.size(); ++i)
+        th[i] = theta(i);
+      size_t nbytes = th.size()*(2*sizeof(double)+sizeof(ringdata));
+      return get<vector<ringdata>>({true, lmax, 0, spin, std::move(th), epsilon},
+        nbytes, [&](bool){ return make_shared<const vector<ringdata>>(
+          make_ringdata(theta, lmax, spin, epsilon)); });
+      }
+
+    void set_limit(size_t max_bytes_)
+      {
+      LockGuard lock(mut);
+      max_bytes = max_bytes_;
+      evict();
+      }
+    void clear()
+      {
+      LockGuard lock(mut);
+      lru.clear();
+      index.clear();
+      bytes = 0;
+      }
+    sht_table_cache_info info() const
+      {
+      LockGuard lock(mut);
+      return {hits, misses, evictions, lru.size(), bytes};
+      }
+  };
+
+void set_sht_table_cache_limit(size_t max_bytes)
+  { sht_table_cache::get().set_limit(max_bytes); }
+sht_table_cache_info get_sht_table_cache_info()
+  { return sht_table_cache::get().info(); }
+void clear_sht_table_cache()
+  { sht_table_cache::get().clear(); }
+
 /* Weights from Waldvogel 2006: BIT Numerical Mathematics 46, p. 195 */
 static vector<double> get_dh_weights(size_t nrings)
   {
@@ -1833,7 +2601,33 @@ bool downsampling_ok(const cmav<double,1> &theta, size_t lmax,
   return true;
   }
 
-template<typename T> void alm2leg(  // associated Legendre transform
+// copies the a_lm with a given m into almtmp and normalizes them
+template<typename T> static void fill_almtmp(const cmav<complex<T>,2> &alm,
+  const vmav<complex<double>,2> &almtmp, size_t m, size_t mstart,
+  ptrdiff_t lstride, size_t lmax, size_t spin, const vector<double> &norm_l)
+  {
+  auto lmin=max(spin,m);
+  for (size_t ialm=0; ialm<alm.shape(0); ++ialm)
+    {
+    for (size_t l=m; l<lmin; ++l)
+      almtmp(l,ialm) = 0;
+    for (size_t l=lmin; l<=lmax; ++l)
+      almtmp(l,ialm) = alm(ialm,mstart+l*lstride)*T(norm_l[l]);
+    almtmp(lmax+1,ialm) = 0;
+    }
+  }
+
+// largest value neglected by skipping the m>mlim of the rings
+static double max_ring_skip(const vector<ringdata> &rdata, size_t mmax)
+  {
+  double res=0;
+  for (const auto &rd: rdata)
+    if (rd.mlim<mmax)
+      res = max(res, rd.dskip);
+  return res;
+  }
+
+template<typename T> double alm2leg(  // associated Legendre transform
   const cmav<complex<T>,2> &alm, // (ncomp, lmidx)
   const vmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
   size_t spin,
@@ -1844,7 +2638,8 @@ template<typename T> void alm2leg(  // associated Legendre transform
   const cmav<double,1> &theta, // (nrings)
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol)
+  bool theta_interpol,
+  double epsilon)
   {
   // sanity checks
   auto nrings=theta.shape(0);
@@ -1854,23 +2649,22 @@ template<typename T> void alm2leg(  // associated Legendre transform
   MR_assert(nm==leg.shape(2), "nm mismatch");
   auto nalm=alm.shape(0);
   auto mmax = get_mmax(mval, lmax);
+  MR_assert(nalm>0, "need at least one a_lm component");
   if (mode==DERIV1)
     {
     spin=1;
-    MR_assert(nalm==1, "need one a_lm component");
-    MR_assert(leg.shape(0)==2, "need two Legendre components");
+    MR_assert(leg.shape(0)==2*nalm, "need two Legendre components per a_lm set");
     }
   else if (mode==GRAD_ONLY)
     {
     MR_assert(spin>0, "spin must be positive for grad-only SHTs");
-    MR_assert(nalm==1, "need one a_lm component");
-    MR_assert(leg.shape(0)==2, "need two Legendre components");
+    MR_assert(leg.shape(0)==2*nalm, "need two Legendre components per a_lm set");
     }
   else
     {
     size_t ncomp = (spin==0) ? 1 : 2;
-    MR_assert(nalm==ncomp, "incorrect number of a_lm components");
-    MR_assert(leg.shape(0)==ncomp, "incorrect number of Legendre components");
+    MR_assert(nalm%ncomp==0, "incorrect number of a_lm components");
+    MR_assert(leg.shape(0)==nalm, "incorrect number of Legendre components");
     }
 
   if (even_odd_m(mval))
@@ -1882,19 +2676,20 @@ template<typename T> void alm2leg(  // associated Legendre transform
       vmav<double,1> theta_tmp({ntheta_tmp}, UNINITIALIZED);
       for (size_t i=0; i<ntheta_tmp; ++i)
         theta_tmp(i) = i*pi/(ntheta_tmp-1);
+      double res;
       if (ntheta_tmp<=nrings)
         {
         auto leg_tmp(subarray<3>(leg, {{},{0,ntheta_tmp},{}}));
-        alm2leg(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode);
+        res = alm2leg(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, false, epsilon);
         resample_theta(leg_tmp, true, true, leg, npi, spi, spin, nthreads, false);
         }
       else
         {
         auto leg_tmp(vmav<complex<T>,3>::build_noncritical({leg.shape(0),ntheta_tmp,leg.shape(2)}, UNINITIALIZED));
-        alm2leg(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode);
+        res = alm2leg(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, false, epsilon);
         resample_theta(leg_tmp, true, true, leg, npi, spi, spin, nthreads, false);
         }
-      return;
+      return res;
       }
   
     if (theta_interpol && (nrings>500) && (nrings>1.5*lmax)) // irregular and worth resampling
@@ -1904,41 +2699,43 @@ template<typename T> void alm2leg(  // associated Legendre transform
       for (size_t i=0; i<ntheta_tmp; ++i)
         theta_tmp(i) = i*pi/(ntheta_tmp-1);
       vmav<complex<T>,3> leg_tmp({leg.shape(0), ntheta_tmp, leg.shape(2)},UNINITIALIZED);
-      alm2leg(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode);
+      double res = alm2leg(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, false, epsilon);
       resample_leg_CC_to_irregular(leg_tmp, leg, theta, spin, mval, nthreads);
-      return;
+      return res;
       } 
     }
 
-  auto norm_l = (mode==DERIV1) ? Ylmgen::get_d1norm (lmax) :
-                                 Ylmgen::get_norm (lmax, spin);
-  auto rdata = make_ringdata(theta, lmax, spin);
-  YlmBase base(lmax, mmax, spin);
+  auto &cache(sht_table_cache::get());
+  auto tables = cache.get_tables(lmax, mmax, spin);
+  const auto &norm_l((mode==DERIV1) ? tables->d1norm : tables->norm);
+  auto rdata_ptr = cache.get_ringdata(theta, lmax, spin, epsilon);
+  const auto &rdata(*rdata_ptr);
+  double maxskip = max_ring_skip(rdata, mmax);
+  Mutex mut;
 
   ducc0::execDynamic(nm, nthreads, 1, [&](ducc0::Scheduler &sched)
     {
-    Ylmgen gen(base);
+    Ylmgen gen(tables);
     vmav<complex<double>,2> almtmp({lmax+2,nalm}, UNINITIALIZED);
+    leg_truncation trunc;
+    trunc.epsilon = epsilon;
 
     while (auto rng=sched.getNext()) for(auto mi=rng.lo; mi<rng.hi; ++mi)
       {
       auto m=mval(mi);
-      auto lmin=max(spin,m);
-      for (size_t ialm=0; ialm<nalm; ++ialm)
-        {
-        for (size_t l=m; l<lmin; ++l)
-          almtmp(l,ialm) = 0;
-        for (size_t l=lmin; l<=lmax; ++l)
-          almtmp(l,ialm) = alm(ialm,mstart(mi)+l*lstride)*T(norm_l[l]);
-        almtmp(lmax+1,ialm) = 0;
-        }
+      fill_almtmp(alm, almtmp, m, mstart(mi), lstride, lmax, spin, norm_l);
       gen.prepare(m);
-      inner_loop_a2m (mode, almtmp, leg, rdata, gen, mi);
+      inner_loop_a2m (mode, almtmp, leg, rdata, gen, mi, trunc);
       }
+    LockGuard lock(mut);
+    maxskip = max(maxskip, trunc.maxskip);
     }); /* end of parallel region */
+  return maxskip;
   }
 
-template<typename T> void leg2alm(  // associated Legendre transform
+// if cl is not null, the (not yet normalized) upper triangle of the spectra
+// of the result is added to it
+template<typename T> static double leg2alm_internal(
   const vmav<complex<T>,2> &alm, // (ncomp, lmidx)
   const cmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
   size_t spin,
@@ -1949,7 +2746,9 @@ template<typename T> void leg2alm(  // associated Legendre transform
   const cmav<double,1> &theta, // (nrings)
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol)
+  bool theta_interpol,
+  double epsilon,
+  const vmav<double,3> *cl)
   {
   // sanity checks
   auto nrings=theta.shape(0);
@@ -1959,23 +2758,22 @@ template<typename T> void leg2alm(  // associated Legendre transform
   MR_assert(nm==leg.shape(2), "nm mismatch");
   auto mmax = get_mmax(mval, lmax);
   auto nalm = alm.shape(0);
+  MR_assert(nalm>0, "need at least one a_lm component");
   if (mode==DERIV1)
     {
     spin=1;
-    MR_assert(nalm==1, "need one a_lm component");
-    MR_assert(leg.shape(0)==2, "need two Legendre components");
+    MR_assert(leg.shape(0)==2*nalm, "need two Legendre components per a_lm set");
     }
   else if (mode==GRAD_ONLY)
     {
     MR_assert(spin>0, "spin must be positive for grad-only SHTs");
-    MR_assert(nalm==1, "need one a_lm component");
-    MR_assert(leg.shape(0)==2, "need two Legendre components");
+    MR_assert(leg.shape(0)==2*nalm, "need two Legendre components per a_lm set");
     }
   else
     {
     size_t ncomp = (spin==0) ? 1 : 2;
-    MR_assert(nalm==ncomp, "incorrect number of a_lm components");
-    MR_assert(leg.shape(0)==ncomp, "incorrect number of Legendre components");
+    MR_assert(nalm%ncomp==0, "incorrect number of a_lm components");
+    MR_assert(leg.shape(0)==nalm, "incorrect number of Legendre components");
     }
 
   if (even_odd_m(mval))
@@ -1989,8 +2787,7 @@ template<typename T> void leg2alm(  // associated Legendre transform
         theta_tmp(i) = i*pi/(ntheta_tmp-1);
       auto leg_tmp(vmav<complex<T>,3>::build_noncritical({leg.shape(0), ntheta_tmp, leg.shape(2)}, UNINITIALIZED));
       resample_theta(leg, npi, spi, leg_tmp, true, true, spin, nthreads, true);
-      leg2alm(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode);
-      return;
+      return leg2alm_internal(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, false, epsilon, cl);
       }
   
     if (theta_interpol && (nrings>500) && (nrings>1.5*lmax)) // irregular and worth resampling
@@ -2001,20 +2798,25 @@ template<typename T> void leg2alm(  // associated Legendre transform
         theta_tmp(i) = i*pi/(ntheta_tmp-1);
       vmav<complex<T>,3> leg_tmp({leg.shape(0), ntheta_tmp, leg.shape(2)},UNINITIALIZED);
       resample_leg_irregular_to_CC(leg, leg_tmp, theta, spin, mval, nthreads);
-      leg2alm(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode);
-      return;
+      return leg2alm_internal(alm, leg_tmp, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, false, epsilon, cl);
       }
     }
 
-  auto norm_l = (mode==DERIV1) ? Ylmgen::get_d1norm (lmax) :
-                                 Ylmgen::get_norm (lmax, spin);
-  auto rdata = make_ringdata(theta, lmax, spin);
-  YlmBase base(lmax, mmax, spin);
+  auto &cache(sht_table_cache::get());
+  auto tables = cache.get_tables(lmax, mmax, spin);
+  const auto &norm_l((mode==DERIV1) ? tables->d1norm : tables->norm);
+  auto rdata_ptr = cache.get_ringdata(theta, lmax, spin, epsilon);
+  const auto &rdata(*rdata_ptr);
+  double maxskip = max_ring_skip(rdata, mmax);
+  Mutex mut;
 
   ducc0::execDynamic(nm, nthreads, 1, [&](ducc0::Scheduler &sched)
     {
-    Ylmgen gen(base);
+    Ylmgen gen(tables);
     vmav<complex<double>,2> almtmp({lmax+2,nalm}, UNINITIALIZED);
+    leg_truncation trunc;
+    trunc.epsilon = epsilon;
+    vmav<double,3> cltmp({cl ? lmax+1 : 0, nalm, nalm});
 
     while (auto rng=sched.getNext()) for(auto mi=rng.lo; mi<rng.hi; ++mi)
       {
@@ -2023,16 +2825,86 @@ template<typename T> void leg2alm(  // associated Legendre transform
       for (size_t l=m; l<almtmp.shape(0); ++l)
         for (size_t ialm=0; ialm<nalm; ++ialm)
           almtmp(l,ialm) = 0.;
-      inner_loop_m2a (mode, almtmp, leg, rdata, gen, mi);
+      inner_loop_m2a (mode, almtmp, leg, rdata, gen, mi, trunc);
       auto lmin=max(spin,m);
       for (size_t l=m; l<lmin; ++l)
         for (size_t ialm=0; ialm<nalm; ++ialm)
           alm(ialm,mstart(mi)+l*lstride) = 0;
       for (size_t l=lmin; l<=lmax; ++l)
         for (size_t ialm=0; ialm<nalm; ++ialm)
-          alm(ialm,mstart(mi)+l*lstride) = complex<T>(almtmp(l,ialm)*norm_l[l]);
+          {
+          auto val = complex<T>(almtmp(l,ialm)*norm_l[l]);
+          alm(ialm,mstart(mi)+l*lstride) = val;
+          almtmp(l,ialm) = val;
+          }
+      if (cl)  // accumulate the spectra while this column is still in cache
+        {
+        double wgt = (m==0) ? 1. : 2.;
+        for (size_t l=lmin; l<=lmax; ++l)
+          for (size_t i=0; i<nalm; ++i)
+            for (size_t j=i; j<nalm; ++j)
+              cltmp(l,i,j) += wgt*(almtmp(l,i).real()*almtmp(l,j).real()
+                                  +almtmp(l,i).imag()*almtmp(l,j).imag());
+        }
       }
+    LockGuard lock(mut);
+    maxskip = max(maxskip, trunc.maxskip);
+    if (cl)
+      for (size_t l=0; l<=lmax; ++l)
+        for (size_t i=0; i<nalm; ++i)
+          for (size_t j=i; j<nalm; ++j)
+            (*cl)(i,j,l) += cltmp(l,i,j);
     }); /* end of parallel region */
+  return maxskip;
+  }
+
+template<typename T> double leg2alm(  // associated Legendre transform
+  const vmav<complex<T>,2> &alm, // (ncomp, lmidx)
+  const cmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mval, // (nm)
+  const cmav<size_t,1> &mstart, // (nm)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  size_t nthreads,
+  SHT_mode mode,
+  bool theta_interpol,
+  double epsilon)
+  {
+  return leg2alm_internal(alm, leg, spin, lmax, mval, mstart, lstride, theta,
+    nthreads, mode, theta_interpol, epsilon, nullptr);
+  }
+
+template<typename T> double leg2alm_cl(
+  const vmav<complex<T>,2> &alm, // (ncomp, lmidx)
+  const vmav<double,3> &cl, // (ncomp, ncomp, lmax+1)
+  const cmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mval, // (nm)
+  const cmav<size_t,1> &mstart, // (nm)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  size_t nthreads,
+  SHT_mode mode,
+  bool theta_interpol,
+  double epsilon)
+  {
+  auto nalm = alm.shape(0);
+  MR_assert((cl.shape(0)==nalm) && (cl.shape(1)==nalm)
+    && (cl.shape(2)==lmax+1), "bad shape of cl array");
+  mav_apply([](double &v) { v=0.; }, nthreads, cl);
+  auto res = leg2alm_internal(alm, leg, spin, lmax, mval, mstart, lstride,
+    theta, nthreads, mode, theta_interpol, epsilon, &cl);
+  for (size_t l=0; l<=lmax; ++l)
+    {
+    double fct = 1./(2*l+1);
+    for (size_t i=0; i<nalm; ++i)
+      for (size_t j=i; j<nalm; ++j)
+        cl(i,j,l) = cl(j,i,l) = fct*cl(i,j,l);
+    }
+  return res;
   }
 
 template<typename T> void leg2map(  // FFT
@@ -2433,21 +3305,156 @@ void sanity_checks(
             (nphi.shape(0)==nrings) &&
             (ringstart.shape(0)==nrings),
     "inconsistency in the number of rings");
+  MR_assert(alm.shape(0)>0, "need at least one a_lm component");
   if ((mode==DERIV1) || (mode==GRAD_ONLY))
     {
     MR_assert(spin>0, "DERIV and GRAD_ONLY modes require spin>0");
-    MR_assert((alm.shape(0)==1) && (map.shape(0)==2),
+    MR_assert(map.shape(0)==2*alm.shape(0),
       "inconsistent number of components");
     }
   else
     {
     size_t ncomp = 1+(spin>0);
-    MR_assert((alm.shape(0)==ncomp) && (map.shape(0)==ncomp),
+    MR_assert((alm.shape(0)%ncomp==0) && (map.shape(0)==alm.shape(0)),
       "inconsistent number of components");
     }
   }
 
-template<typename T> void synthesis(
+// synthesis() switches to synthesis_ringblocks() if the full Legendre
+// coefficient array would need more memory than this (in bytes) ...
+constexpr size_t sht_ringblock_threshold = size_t(1)<<27;
+// ... and the Legendre coefficient buffer of every thread in
+// synthesis_ringblocks() needs at most this much memory
+constexpr size_t sht_ringblock_bufsize = size_t(1)<<24;
+
+// number of ring pairs processed together by synthesis_ringblocks();
+// a few chunks of the Legendre kernels, so that partially filled chunks
+// (caused by rings with mlim<m) are not too frequent
+static size_t ringblock_size(size_t spin)
+  { return 4*((spin==0) ? nv0 : nvx)*VLEN; }
+
+// number of m values processed together by synthesis_ringblocks(), so that
+// the buffer size stays below sht_ringblock_bufsize
+static size_t ringblock_mchunk(size_t spin, size_t ncomp, size_t nm,
+  size_t elemsize)
+  {
+  return max<size_t>(1, min(nm,
+    sht_ringblock_bufsize/(2*ringblock_size(spin)*ncomp*elemsize)));
+  }
+
+// Synthesis without an intermediate Legendre coefficient array for the whole
+// map: every task computes the coefficients of one block of ring pairs and
+// immediately transforms them into the map rings, so that at most one block
+// per thread exists at any time. For high mmax, the m values of a block are
+// processed in chunks, whose contributions to the Fourier coefficients of
+// the rings are accumulated in the map pixels before the final ring FFTs.
+template<typename T> double synthesis_ringblocks(
+  const cmav<complex<T>,2> &alm, // (ncomp, *)
+  const vmav<T,2> &map, // (ncomp, *)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mstart, // (mmax+1)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  const cmav<size_t,1> &nphi, // (nrings)
+  const cmav<double,1> &phi0, // (nrings)
+  const cmav<size_t,1> &ringstart, // (nrings)
+  ptrdiff_t pixstride,
+  size_t nthreads,
+  SHT_mode mode,
+  double epsilon)
+  {
+  if (mode==DERIV1) spin=1;
+  size_t nm = mstart.shape(0), mmax = nm-1;
+  size_t nalm = alm.shape(0), ncomp = map.shape(0);
+  size_t nphmax=0;
+  for (size_t i=0; i<nphi.shape(0); ++i)
+    nphmax=max(nphi(i),nphmax);
+  auto &cache(sht_table_cache::get());
+  auto tables = cache.get_tables(lmax, mmax, spin);
+  const auto &norm_l((mode==DERIV1) ? tables->d1norm : tables->norm);
+  auto rdata_ptr = cache.get_ringdata(theta, lmax, spin, epsilon);
+  const auto &rdata(*rdata_ptr);
+  double maxskip = max_ring_skip(rdata, mmax);
+  Mutex mut;
+  const size_t blocksize = ringblock_size(spin);
+  size_t nblocks = (rdata.size()+blocksize-1)/blocksize;
+  const size_t mchunk = ringblock_mchunk(spin, ncomp, nm, sizeof(complex<T>));
+
+  ducc0::execDynamic(nblocks, nthreads, 1, [&](ducc0::Scheduler &sched)
+    {
+    Ylmgen gen(tables);
+    vmav<complex<double>,2> almtmp({lmax+2,nalm}, UNINITIALIZED);
+    vmav<complex<T>,3> leg({ncomp,2*blocksize,mchunk}, UNINITIALIZED);
+    vector<ringdata> rdata_blk;
+    vector<size_t> ring; // global index of every ring in the block
+    ringhelper helper;
+    vmav<double,1> ringtmp({nphmax+2}, UNINITIALIZED);
+    leg_truncation trunc;
+    trunc.epsilon = epsilon;
+
+    while (auto rng=sched.getNext()) for(auto iblk=rng.lo; iblk<rng.hi; ++iblk)
+      {
+      rdata_blk.clear();
+      ring.clear();
+      for (size_t i=iblk*blocksize; i<min(rdata.size(),(iblk+1)*blocksize); ++i)
+        {
+        auto rd = rdata[i];
+        rd.idx = rd.midx = ring.size();
+        ring.push_back(rdata[i].idx);
+        if (rdata[i].midx!=rdata[i].idx)
+          {
+          rd.midx = ring.size();
+          ring.push_back(rdata[i].midx);
+          }
+        rdata_blk.push_back(rd);
+        }
+      for (size_t m0=0; m0<nm; m0+=mchunk)
+        {
+        size_t m1 = min(nm, m0+mchunk);
+        for (size_t m=m0; m<m1; ++m)
+          {
+          fill_almtmp(alm, almtmp, m, mstart(m), lstride, lmax, spin, norm_l);
+          gen.prepare(m);
+          inner_loop_a2m (mode, almtmp, leg, rdata_blk, gen, m-m0, trunc);
+          }
+        for (size_t i=0; i<ring.size(); ++i)
+          {
+          auto ith = ring[i];
+          for (size_t icomp=0; icomp<ncomp; ++icomp)
+            {
+            auto ltmp = subarray<1>(leg, {{icomp}, {i}, {0, m1-m0}});
+            if (mchunk==nm)
+              {
+              helper.phase2ring (nphi(ith),phi0(ith),ringtmp,mmax,ltmp);
+              for (size_t j=0; j<nphi(ith); ++j)
+                map(icomp,ringstart(ith)+j*pixstride) = T(ringtmp(j+1));
+              }
+            else
+              {
+              T *rptr = &map(icomp,ringstart(ith));
+              if (m0==0)
+                for (size_t j=0; j<nphi(ith); ++j)
+                  rptr[j*pixstride] = T(0);
+              ringhelper::add_phase(nphi(ith), phi0(ith), mmax, m0,
+                cmav<complex<T>,1>(ltmp), rptr, pixstride);
+              }
+            }
+          }
+        }
+      if (mchunk<nm)
+        for (auto ith: ring)
+          for (size_t icomp=0; icomp<ncomp; ++icomp)
+            helper.fourier2ring(nphi(ith), &map(icomp,ringstart(ith)),
+              pixstride, ringtmp);
+      }
+    LockGuard lock(mut);
+    maxskip = max(maxskip, trunc.maxskip);
+    }); /* end of parallel region */
+  return maxskip;
+  }
+
+template<typename T> double synthesis(
   const cmav<complex<T>,2> &alm, // (ncomp, *)
   const vmav<T,2> &map, // (ncomp, *)
   size_t spin,
@@ -2461,7 +3468,8 @@ template<typename T> void synthesis(
   ptrdiff_t pixstride,
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol)
+  bool theta_interpol,
+  double epsilon)
   {
   sanity_checks(alm, lmax, mstart, map, theta, phi0, nphi, ringstart, spin, mode);
   vmav<size_t,1> mval({mstart.shape(0)}, UNINITIALIZED);
@@ -2478,16 +3486,26 @@ template<typename T> void synthesis(
     auto leg(vmav<complex<T>,3>::build_noncritical({map.shape(0),max(theta.shape(0),ntheta_tmp),mstart.shape(0)}, UNINITIALIZED));
     auto legi(subarray<3>(leg, {{},{0,ntheta_tmp},{}}));
     auto lego(subarray<3>(leg, {{},{0,theta.shape(0)},{}}));
-    alm2leg(alm, legi, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, theta_interpol);
+    double res = alm2leg(alm, legi, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads, mode, theta_interpol, epsilon);
     resample_theta(legi, true, true, lego, npi, spi, spin, nthreads, false);
     leg2map(map, lego, nphi, phi0, ringstart, pixstride, nthreads);
+    return res;
     }
-  else
-    {
-    auto leg(vmav<complex<T>,3>::build_noncritical({map.shape(0),theta.shape(0),mstart.shape(0)}, UNINITIALIZED));
-    alm2leg(alm, leg, spin, lmax, mval, mstart, lstride, theta, nthreads, mode, theta_interpol);
-    leg2map(map, leg, nphi, phi0, ringstart, pixstride, nthreads);
-    }
+  // use the ring-blocked pipeline if the full Legendre coefficient array
+  // would be large, unless the per-thread blocks together need a similar
+  // amount of memory
+  size_t ncomp = map.shape(0), nm = mstart.shape(0);
+  size_t legsize = ncomp*theta.shape(0)*nm*sizeof(complex<T>),
+         blksize = 2*ringblock_size(spin)*ncomp*sizeof(complex<T>)
+                  *ringblock_mchunk(spin, ncomp, nm, sizeof(complex<T>));
+  if ((!theta_interpol) && (legsize>sht_ringblock_threshold)
+    && (legsize>2*blksize*adjust_nthreads(nthreads)))
+    return synthesis_ringblocks(alm, map, spin, lmax, mstart, lstride, theta,
+      nphi, phi0, ringstart, pixstride, nthreads, mode, epsilon);
+  auto leg(vmav<complex<T>,3>::build_noncritical({map.shape(0),theta.shape(0),mstart.shape(0)}, UNINITIALIZED));
+  double res = alm2leg(alm, leg, spin, lmax, mval, mstart, lstride, theta, nthreads, mode, theta_interpol, epsilon);
+  leg2map(map, leg, nphi, phi0, ringstart, pixstride, nthreads);
+  return res;
   }
 
 void get_ringtheta_2d(const string &type, const vmav<double, 1> &theta)
@@ -2555,7 +3573,7 @@ template void synthesis_2d(const cmav<complex<float>,2> &alm, const vmav<float,3
   size_t spin, size_t lmax, const cmav<size_t,1> &mstart, ptrdiff_t lstride,
   const string &geometry, double phi0, size_t nthreads, SHT_mode mode);
 
-template<typename T> void adjoint_synthesis(
+template<typename T> double adjoint_synthesis(
   const vmav<complex<T>,2> &alm, // (ncomp, *)
   const cmav<T,2> &map, // (ncomp, *)
   size_t spin,
@@ -2569,7 +3587,8 @@ template<typename T> void adjoint_synthesis(
   ptrdiff_t pixstride,
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol)
+  bool theta_interpol,
+  double epsilon)
   {
   sanity_checks(alm, lmax, mstart, map, theta, phi0, nphi, ringstart, spin, mode);
   vmav<size_t,1> mval({mstart.shape(0)}, UNINITIALIZED);
@@ -2588,15 +3607,337 @@ template<typename T> void adjoint_synthesis(
     auto lego(subarray<3>(leg, {{},{0,ntheta_tmp},{}}));
     map2leg(map, legi, nphi, phi0, ringstart, pixstride, nthreads);
     resample_theta(legi, npi, spi, lego, true, true, spin, nthreads, true);
-    leg2alm(alm, lego, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads,mode,theta_interpol);
+    return leg2alm(alm, lego, spin, lmax, mval, mstart, lstride, theta_tmp, nthreads,mode,theta_interpol,epsilon);
     }
-  else
+  auto leg(vmav<complex<T>,3>::build_noncritical({map.shape(0),theta.shape(0),mstart.shape(0)}, UNINITIALIZED));
+  map2leg(map, leg, nphi, phi0, ringstart, pixstride, nthreads);
+  return leg2alm(alm, leg, spin, lmax, mval, mstart, lstride, theta, nthreads, mode, theta_interpol, epsilon);
+  }
+
+// Parts of the rings which overlap a set of pixel index ranges:
+// ring rings[i] contains the selected pixels j0<=j<j1 for every (j0, j1) in
+// seg[segofs[i]] ... seg[segofs[i+1]-1].
+struct ring_segments
+  {
+  vector<size_t> rings, segofs;
+  vector<pair<size_t, size_t>> seg;
+
+  ring_segments(const cmav<size_t,1> &nphi, const cmav<size_t,1> &ringstart,
+    ptrdiff_t pixstride, const cmav<size_t,2> &pixranges)
     {
-    auto leg(vmav<complex<T>,3>::build_noncritical({map.shape(0),theta.shape(0),mstart.shape(0)}, UNINITIALIZED));
-    map2leg(map, leg, nphi, phi0, ringstart, pixstride, nthreads);
-    leg2alm(alm, leg, spin, lmax, mval, mstart, lstride, theta, nthreads, mode, theta_interpol);
+    MR_assert(pixstride>0, "pixstride must be positive");
+    MR_assert(pixranges.shape(1)==2, "pixranges must have shape (nranges, 2)");
+    size_t pstr = size_t(pixstride);
+    // sorted, non-overlapping copy of the ranges
+    vector<pair<size_t, size_t>> rng;
+    for (size_t i=0; i<pixranges.shape(0); ++i)
+      if (pixranges(i,1)>pixranges(i,0))
+        rng.emplace_back(pixranges(i,0), pixranges(i,1));
+    sort(rng.begin(), rng.end());
+    size_t nrng=0;
+    for (const auto &r: rng)
+      if ((nrng>0) && (r.first<=rng[nrng-1].second))
+        rng[nrng-1].second = max(rng[nrng-1].second, r.second);
+      else
+        rng[nrng++] = r;
+    rng.resize(nrng);
+    segofs.push_back(0);
+    for (size_t i=0; i<nphi.shape(0); ++i)
+      {
+      size_t lo=ringstart(i), hi=lo+(nphi(i)-1)*pstr+1;
+      auto it = upper_bound(rng.begin(), rng.end(), lo,
+        [](size_t v, const pair<size_t, size_t> &r) { return v<r.second; });
+      for (; (it!=rng.end()) && (it->first<hi); ++it)
+        {
+        size_t j0 = (max(it->first, lo)-lo+pstr-1)/pstr,
+               j1 = (min(it->second, hi)-lo+pstr-1)/pstr;
+        if (j1<=j0) continue;
+        if ((seg.size()>segofs.back()) && (seg.back().second==j0))
+          seg.back().second = j1;
+        else
+          seg.emplace_back(j0, j1);
+        }
+      if (seg.size()>segofs.back())
+        {
+        rings.push_back(i);
+        segofs.push_back(seg.size());
+        }
+      }
+    }
+
+  size_t npix(size_t i) const
+    {
+    size_t res=0;
+    for (size_t j=segofs[i]; j<segofs[i+1]; ++j)
+      res += seg[j].second-seg[j].first;
+    return res;
+    }
+  };
+
+// Decides whether the selected pixels of a ring are cheaper to compute by
+// direct summation over m (cost ~npix*mmax) than by a full FFT of the ring.
+static bool use_direct_sum(size_t npix, size_t nph, size_t mmax)
+  {
+  return 2*npix*(mmax+1) < nph*(ilog2(nph)+4);
+  }
+
+// Evaluates sum_m phase(m)*exp(i*m*phi) (with the conventions of
+// ringhelper::phase2ring()) for the pixels j0<=j<j1 of a ring, which lie at
+// phi = phi0 + 2*pi*j/nph.
+template<typename T> static void phase2pixels(size_t nph, double phi0,
+  size_t mmax, const cmav<complex<T>,1> &phase, size_t j0, size_t j1,
+  double * DUCC0_RESTRICT res)
+  {
+  constexpr size_t blksz=64;
+  for (size_t jb=j0; jb<j1; jb+=blksz)
+    {
+    size_t n=min(blksz, j1-jb);
+    double zr[blksz], zi[blksz], pr[blksz], pim[blksz];
+    for (size_t i=0; i<n; ++i)
+      {
+      double phi = phi0 + (2*pi*double(jb+i))/double(nph);
+      zr[i] = cos(phi); zi[i] = sin(phi);
+      pr[i] = pim[i] = 0.;
+      }
+    // Horner scheme for sum_{m>0} phase(m)*z^(m-1)
+    for (size_t m=mmax; m>0; --m)
+      {
+      double cr=phase(m).real(), ci=phase(m).imag();
+      for (size_t i=0; i<n; ++i)
+        {
+        double tmp = pr[i]*zr[i] - pim[i]*zi[i] + cr;
+        pim[i] = pr[i]*zi[i] + pim[i]*zr[i] + ci;
+        pr[i] = tmp;
+        }
+      }
+    for (size_t i=0; i<n; ++i)
+      res[jb-j0+i] = double(phase(0).real()) + 2*(pr[i]*zr[i]-pim[i]*zi[i]);
+    }
+  }
+
+// Adjoint of phase2pixels(): adds sum_j val(j)*exp(-i*m*phi_j) to phase(m).
+static void pixels2phase(size_t nph, double phi0, size_t mmax,
+  const double * DUCC0_RESTRICT val, size_t j0, size_t j1,
+  dcmplx * DUCC0_RESTRICT phase)
+  {
+  constexpr size_t blksz=64;
+  for (size_t jb=j0; jb<j1; jb+=blksz)
+    {
+    size_t n=min(blksz, j1-jb);
+    double zr[blksz], zi[blksz], wr[blksz], wi[blksz];
+    for (size_t i=0; i<n; ++i)
+      {
+      double phi = phi0 + (2*pi*double(jb+i))/double(nph);
+      zr[i] = cos(phi); zi[i] = -sin(phi);
+      wr[i] = val[jb-j0+i]; wi[i] = 0.;
+      }
+    for (size_t m=0; m<=mmax; ++m)
+      {
+      double sr=0, si=0;
+      for (size_t i=0; i<n; ++i)
+        {
+        sr += wr[i]; si += wi[i];
+        double tmp = wr[i]*zr[i] - wi[i]*zi[i];
+        wi[i] = wr[i]*zi[i] + wi[i]*zr[i];
+        wr[i] = tmp;
+        }
+      phase[m] += dcmplx(sr, si);
+      }
+    }
+  }
+
+template<typename T> void synthesis_partial(
+  const cmav<complex<T>,2> &alm, // (ncomp, *)
+  const vmav<T,2> &map, // (ncomp, *)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mstart, // (mmax+1)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  const cmav<size_t,1> &nphi, // (nrings)
+  const cmav<double,1> &phi0, // (nrings)
+  const cmav<size_t,1> &ringstart, // (nrings)
+  ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, // (nranges, 2)
+  size_t nthreads,
+  SHT_mode mode)
+  {
+  sanity_checks(alm, lmax, mstart, map, theta, phi0, nphi, ringstart, spin, mode);
+  ring_segments rs(nphi, ringstart, pixstride, pixranges);
+  size_t nsub = rs.rings.size();
+  if (nsub==0) return;
+  size_t mmax = mstart.shape(0)-1, ncomp = map.shape(0);
+  vmav<size_t,1> mval({mmax+1}, UNINITIALIZED);
+  for (size_t i=0; i<=mmax; ++i)
+    mval(i) = i;
+  vmav<double,1> theta_s({nsub}, UNINITIALIZED);
+  for (size_t i=0; i<nsub; ++i)
+    theta_s(i) = theta(rs.rings[i]);
+  auto leg(vmav<complex<T>,3>::build_noncritical({ncomp, nsub, mmax+1}, UNINITIALIZED));
+  alm2leg(alm, leg, spin, lmax, mval, mstart, lstride, theta_s, nthreads, mode);
+
+  size_t nphmax=0;
+  for (auto i: rs.rings)
+    nphmax = max(nphmax, nphi(i));
+  execDynamic(nsub, nthreads, 4, [&](Scheduler &sched)
+    {
+    ringhelper helper;
+    vmav<double,1> ringtmp({nphmax+2}, UNINITIALIZED);
+    while (auto rng=sched.getNext()) for(auto is=rng.lo; is<rng.hi; ++is)
+      {
+      size_t ith = rs.rings[is];
+      bool direct = use_direct_sum(rs.npix(is), nphi(ith), mmax);
+      for (size_t icomp=0; icomp<ncomp; ++icomp)
+        {
+        auto ltmp = subarray<1>(leg, {{icomp}, {is}, {}});
+        if (!direct)
+          helper.phase2ring (nphi(ith),phi0(ith),ringtmp,mmax,ltmp);
+        for (size_t iseg=rs.segofs[is]; iseg<rs.segofs[is+1]; ++iseg)
+          {
+          auto [j0, j1] = rs.seg[iseg];
+          if (direct)
+            phase2pixels(nphi(ith), phi0(ith), mmax, ltmp, j0, j1, &ringtmp(1));
+          for (size_t j=j0; j<j1; ++j)
+            map(icomp,ringstart(ith)+j*pixstride) = T(ringtmp(direct ? j-j0+1 : j+1));
+          }
+        }
+      }
+    }); /* end of parallel region */
+  }
+template void synthesis_partial(const cmav<complex<double>,2> &alm,
+  const vmav<double,2> &map, size_t spin, size_t lmax,
+  const cmav<size_t,1> &mstart, ptrdiff_t lstride, const cmav<double,1> &theta,
+  const cmav<size_t,1> &nphi, const cmav<double,1> &phi0,
+  const cmav<size_t,1> &ringstart, ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, size_t nthreads, SHT_mode mode);
+template void synthesis_partial(const cmav<complex<float>,2> &alm,
+  const vmav<float,2> &map, size_t spin, size_t lmax,
+  const cmav<size_t,1> &mstart, ptrdiff_t lstride, const cmav<double,1> &theta,
+  const cmav<size_t,1> &nphi, const cmav<double,1> &phi0,
+  const cmav<size_t,1> &ringstart, ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, size_t nthreads, SHT_mode mode);
+
+template<typename T> void adjoint_synthesis_partial(
+  const vmav<complex<T>,2> &alm, // (ncomp, *)
+  const cmav<T,2> &map, // (ncomp, *)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mstart, // (mmax+1)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  const cmav<size_t,1> &nphi, // (nrings)
+  const cmav<double,1> &phi0, // (nrings)
+  const cmav<size_t,1> &ringstart, // (nrings)
+  ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, // (nranges, 2)
+  size_t nthreads,
+  SHT_mode mode)
+  {
+  sanity_checks(alm, lmax, mstart, map, theta, phi0, nphi, ringstart, spin, mode);
+  ring_segments rs(nphi, ringstart, pixstride, pixranges);
+  size_t nsub = rs.rings.size();
+  size_t mmax = mstart.shape(0)-1, ncomp = map.shape(0);
+  if (nsub==0)
+    {
+    for (size_t i=0; i<alm.shape(0); ++i)
+      for (size_t m=0; m<=mmax; ++m)
+        for (size_t l=m; l<=lmax; ++l)
+          alm(i,mstart(m)+l*lstride) = complex<T>(0);
+    return;
+    }
+  vmav<size_t,1> mval({mmax+1}, UNINITIALIZED);
+  for (size_t i=0; i<=mmax; ++i)
+    mval(i) = i;
+  vmav<double,1> theta_s({nsub}, UNINITIALIZED);
+  for (size_t i=0; i<nsub; ++i)
+    theta_s(i) = theta(rs.rings[i]);
+  auto leg(vmav<complex<T>,3>::build_noncritical({ncomp, nsub, mmax+1}, UNINITIALIZED));
+
+  size_t nphmax=0;
+  for (auto i: rs.rings)
+    nphmax = max(nphmax, nphi(i));
+  execDynamic(nsub, nthreads, 4, [&](Scheduler &sched)
+    {
+    ringhelper helper;
+    vmav<double,1> ringtmp({nphmax+2}, UNINITIALIZED);
+    vector<dcmplx> phase(mmax+1);
+    while (auto rng=sched.getNext()) for(auto is=rng.lo; is<rng.hi; ++is)
+      {
+      size_t ith = rs.rings[is];
+      bool direct = use_direct_sum(rs.npix(is), nphi(ith), mmax);
+      for (size_t icomp=0; icomp<ncomp; ++icomp)
+        {
+        auto ltmp = subarray<1>(leg, {{icomp}, {is}, {}});
+        if (direct)
+          {
+          fill(phase.begin(), phase.end(), dcmplx(0));
+          for (size_t iseg=rs.segofs[is]; iseg<rs.segofs[is+1]; ++iseg)
+            {
+            auto [j0, j1] = rs.seg[iseg];
+            for (size_t j=j0; j<j1; ++j)
+              ringtmp(j-j0) = map(icomp,ringstart(ith)+j*pixstride);
+            pixels2phase(nphi(ith), phi0(ith), mmax, &ringtmp(0), j0, j1, phase.data());
+            }
+          for (size_t m=0; m<=mmax; ++m)
+            ltmp(m) = complex<T>(phase[m]);
+          }
+        else
+          {
+          for (size_t j=0; j<nphi(ith)+2; ++j)
+            ringtmp(j) = 0.;
+          for (size_t iseg=rs.segofs[is]; iseg<rs.segofs[is+1]; ++iseg)
+            for (size_t j=rs.seg[iseg].first; j<rs.seg[iseg].second; ++j)
+              ringtmp(j+1) = map(icomp,ringstart(ith)+j*pixstride);
+          helper.ring2phase (nphi(ith),phi0(ith),ringtmp,mmax,ltmp);
+          }
+        }
+      }
+    }); /* end of parallel region */
+  leg2alm(alm, leg, spin, lmax, mval, mstart, lstride, theta_s, nthreads, mode);
+  }
+template void adjoint_synthesis_partial(const vmav<complex<double>,2> &alm,
+  const cmav<double,2> &map, size_t spin, size_t lmax,
+  const cmav<size_t,1> &mstart, ptrdiff_t lstride, const cmav<double,1> &theta,
+  const cmav<size_t,1> &nphi, const cmav<double,1> &phi0,
+  const cmav<size_t,1> &ringstart, ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, size_t nthreads, SHT_mode mode);
+template void adjoint_synthesis_partial(const vmav<complex<float>,2> &alm,
+  const cmav<float,2> &map, size_t spin, size_t lmax,
+  const cmav<size_t,1> &mstart, ptrdiff_t lstride, const cmav<double,1> &theta,
+  const cmav<size_t,1> &nphi, const cmav<double,1> &phi0,
+  const cmav<size_t,1> &ringstart, ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, size_t nthreads, SHT_mode mode);
+
+// Approximate area of the pixels on every ring, assuming that the rings
+// divide the sphere into zones bounded by the midpoints between neighbouring
+// colatitudes (rings with identical colatitude share their zone), normalized
+// to an average of 1 per pixel.
+static vector<double> ring_pixel_area(const cmav<double,1> &theta,
+  const cmav<size_t,1> &nphi)
+  {
+  auto nrings = theta.shape(0);
+  vector<size_t> idx(nrings);
+  for (size_t i=0; i<nrings; ++i) idx[i]=i;
+  sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
+    { return theta(a)<theta(b); });
+  vector<double> res(nrings, 0.);
+  size_t npix=0;
+  for (size_t lo=0; lo<nrings;)
+    {
+    size_t hi=lo+1, np=nphi(idx[lo]);
+    while ((hi<nrings) && (theta(idx[hi])==theta(idx[lo])))
+      np += nphi(idx[hi++]);
+    double th0 = (lo==0) ? 0. : 0.5*(theta(idx[lo-1])+theta(idx[lo])),
+           th1 = (hi==nrings) ? pi : 0.5*(theta(idx[lo])+theta(idx[hi]));
+    for (size_t i=lo; i<hi; ++i)
+      res[idx[i]] = 2*pi*(cos(th0)-cos(th1))/max<size_t>(np,1);
+    npix += np;
+    lo = hi;
     }
+  for (auto &v: res) v *= npix/(4*pi);
+  return res;
   }
+
 template<typename T> tuple<size_t, size_t, double, double> pseudo_analysis(
   const vmav<complex<T>,2> &alm, // (ncomp, *)
   const cmav<T,2> &map, // (ncomp, *)
@@ -2612,17 +3953,81 @@ template<typename T> tuple<size_t, size_t, double, double> pseudo_analysis(
   size_t nthreads,
   size_t maxiter,
   double epsilon,
-  bool theta_interpol)
+  bool theta_interpol,
+  bool precondition,
+  bool warm_start)
   {
+  sanity_checks(alm, lmax, mstart, map, theta, phi0, nphi, ringstart, spin, STANDARD);
+  auto nrings = theta.shape(0);
+  vector<double> sqwgt;
+  if (precondition)
+    {
+    sqwgt = ring_pixel_area(theta, nphi);
+    for (auto &v: sqwgt) v = sqrt(v);
+    }
+  auto weight_rings = [&](const vmav<T,2> &xmap)
+    {
+    execParallel(nrings, nthreads, [&](size_t lo, size_t hi)
+      {
+      for (size_t icomp=0; icomp<xmap.shape(0); ++icomp)
+        for (size_t iring=lo; iring<hi; ++iring)
+          {
+          auto fct = T(sqwgt[iring]);
+          for (size_t ipix=0; ipix<nphi(iring); ++ipix)
+            xmap(icomp,ringstart(iring)+ipix*pixstride) *= fct;
+          }
+      });
+    };
+
+  // with preconditioning, the adjoint SHT is carried out step by step, so
+  // that the ring weights can be applied to the Legendre coefficients
+  // instead of a weighted copy of the map. The coefficient buffer only
+  // exists during the adjoint SHT, so that it never coexists with the one
+  // allocated by synthesis().
+  vmav<size_t,1> mval({mstart.shape(0)}, UNINITIALIZED);
+  for (size_t i=0; i<mstart.shape(0); ++i)
+    mval(i) = i;
+  bool npi, spi;
+  size_t ntheta_tmp=0;
+  bool downsample = downsampling_ok(theta, lmax, npi, spi, ntheta_tmp);
+  vmav<double,1> theta_tmp({downsample ? ntheta_tmp : 0}, UNINITIALIZED);
+  for (size_t i=0; i<theta_tmp.shape(0); ++i)
+    theta_tmp(i) = i*pi/(ntheta_tmp-1);
+
   auto op = [&](const cmav<complex<T>,2> &xalm, const vmav<T,2> &xmap)
     {
     synthesis(xalm, xmap, spin, lmax, mstart, lstride, theta, nphi, phi0,
               ringstart, pixstride, nthreads, STANDARD, theta_interpol);
+    if (precondition) weight_rings(xmap);
     };
   auto op_adj = [&](const cmav<T,2> &xmap, const vmav<complex<T>,2> &xalm)
     {
-    adjoint_synthesis(xalm, xmap, spin, lmax, mstart, lstride, theta, nphi,
-                      phi0, ringstart, pixstride, nthreads, STANDARD, theta_interpol);
+    if (!precondition)
+      {
+      adjoint_synthesis(xalm, xmap, spin, lmax, mstart, lstride, theta, nphi,
+        phi0, ringstart, pixstride, nthreads, STANDARD, theta_interpol);
+      return;
+      }
+    auto leg(vmav<complex<T>,3>::build_noncritical({xmap.shape(0),
+      max(nrings, theta_tmp.shape(0)), mstart.shape(0)}, UNINITIALIZED));
+    auto legi(subarray<3>(leg, {{},{0,nrings},{}}));
+    map2leg(xmap, legi, nphi, phi0, ringstart, pixstride, nthreads);
+    // weighting a ring commutes with its FFT
+    for (size_t icomp=0; icomp<legi.shape(0); ++icomp)
+      for (size_t iring=0; iring<nrings; ++iring)
+        for (size_t im=0; im<legi.shape(2); ++im)
+          legi(icomp,iring,im) *= T(sqwgt[iring]);
+    if (downsample)
+      {
+      auto lego(subarray<3>(leg, {{},{0,ntheta_tmp},{}}));
+      resample_theta(cmav<complex<T>,3>(legi), npi, spi, lego, true, true,
+        spin, nthreads, true);
+      leg2alm(xalm, lego, spin, lmax, mval, mstart, lstride, theta_tmp,
+        nthreads, STANDARD);
+      }
+    else
+      leg2alm(xalm, legi, spin, lmax, mval, mstart, lstride, theta, nthreads,
+        STANDARD, theta_interpol);
     };
   auto mapnorm = [&](const cmav<T,2> &xmap)
     {
@@ -2648,16 +4053,24 @@ template<typename T> tuple<size_t, size_t, double, double> pseudo_analysis(
           }
     return sqrt(res);
     };
-  auto alm0 = alm.build_uniform(alm.shape(), 0.);
+  auto alm0 = warm_start ? cmav<complex<T>,2>(alm)
+                         : alm.build_uniform(alm.shape(), 0.);
   // try to estimate ATOL according to Paige & Saunders
   // assuming an absolute error of machine epsilon in every matrix element
   // and a sum of squares of 1 along every row/column
   size_t npix=0;
   mav_apply([&npix](size_t v){npix+=v;}, 1, nphi);
   double atol = 1e-14*sqrt(npix);
+  vmav<T,2> wmap(precondition ? map.shape() : array<size_t,2>{0,0},
+    UNINITIALIZED);
+  if (precondition)
+    {
+    mav_apply([](T &v1, T v2) { v1=v2; }, nthreads, wmap, map);
+    weight_rings(wmap);
+    }
   auto [dum, istop, itn, normr, normar, normA, condA, normx, normb]
-    = lsmr(op, op_adj, almnorm, mapnorm, map, alm,
-           alm0, 0., atol, epsilon, 1e8, maxiter, false, nthreads);
+    = lsmr(op, op_adj, almnorm, mapnorm, precondition ? cmav<T,2>(wmap) : map,
+           alm, alm0, 0., atol, epsilon, 1e8, maxiter, false, nthreads);
   return make_tuple(istop, itn, normr/normb, normar/(normA*normr));
   }
 template tuple<size_t, size_t, double, double> pseudo_analysis(
@@ -2675,7 +4088,9 @@ template tuple<size_t, size_t, double, double> pseudo_analysis(
   size_t nthreads,
   size_t maxiter,
   double epsilon,
-  bool theta_interpol);
+  bool theta_interpol,
+  bool precondition,
+  bool warm_start);
 template tuple<size_t, size_t, double, double> pseudo_analysis(
   const vmav<complex<float>,2> &alm, // (ncomp, *)
   const cmav<float,2> &map, // (ncomp, *)
@@ -2691,7 +4106,9 @@ template tuple<size_t, size_t, double, double> pseudo_analysis(
   size_t nthreads,
   size_t maxiter,
   double epsilon,
-  bool theta_interpol);
+  bool theta_interpol,
+  bool precondition,
+  bool warm_start);
 
 template<typename T> void adjoint_synthesis_2d(const vmav<complex<T>,2> &alm,
   const cmav<T,3> &map, size_t spin, size_t lmax,
@@ -47,7 +47,46 @@ vmav<double,1> get_gridweights(const string &type, size_t nrings);
 // and number of rings.
 size_t maximum_safe_l(const string &geometry, size_t ntheta);
 
-template<typename T> void alm2leg(  // associated Legendre transform
+/// Statistics of the cache of Legendre recurrence tables and ring data.
+struct sht_table_cache_info
+  {
+  size_t hits,      ///< lookups served from the cache
+         misses,    ///< lookups that required building new data
+         evictions, ///< objects removed to stay within the limit
+         entries,   ///< objects currently held by the cache
+         bytes;     ///< estimated memory held by these objects
+  };
+
+/// Sets the maximum estimated memory of the cached recurrence tables and
+/// ring data (default: 256 MiB). A value of 0 disables the cache.
+void set_sht_table_cache_limit(size_t max_bytes);
+/// Returns hit/miss statistics and the current size of the table cache.
+sht_table_cache_info get_sht_table_cache_info();
+/// Removes all entries from the table cache. The statistics are kept.
+void clear_sht_table_cache();
+
+// For epsilon>0, alm2leg, leg2alm, synthesis and adjoint_synthesis neglect
+// all Wigner d values |d^l_{m,-s}(theta)| below epsilon (for spin 0, these
+// are the associated Legendre functions divided by sqrt((2l+1)/(4pi))).
+// This skips the polar parts of the recurrences (and rings with m beyond the
+// limit) more aggressively than the default, which only neglects values that
+// are tiny compared to double precision. The functions return the largest
+// such value that was actually neglected (0 for epsilon==0). This is not a
+// bound for the error of the result, but for random a_lm with lmax up to 4095
+// and spin up to 3 the measured relative L2 error of synthesis is 0.1 to 0.3
+// times epsilon.
+// For float data with lmax<=1024, alm2leg and synthesis evaluate most of the
+// Legendre recurrence in single precision if epsilon>=8e-7*(lmax+1); the
+// relative error caused by this is below epsilon/2.
+
+// alm2leg, leg2alm, synthesis and adjoint_synthesis accept several sets of
+// a_lm with the same spin in one call; the associated Legendre functions are
+// then computed only once for all sets.
+// For spin 0, and in GRAD_ONLY and DERIV1 modes, every a_lm component is a
+// separate set; for spin>0 in STANDARD mode, components 2*i and 2*i+1 form
+// set i. The Legendre coefficients (and maps) have one component per set for
+// spin 0 and two components per set otherwise, in the same order.
+template<typename T> double alm2leg(  // associated Legendre transform
   const cmav<complex<T>,2> &alm, // (ncomp, lmidx)
   const vmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
   size_t spin,
@@ -58,8 +97,9 @@ template<typename T> void alm2leg(  // associated Legendre transform
   const cmav<double,1> &theta, // (nrings)
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol=false);
-template<typename T> void leg2alm(  // associated Legendre transform
+  bool theta_interpol=false,
+  double epsilon=0.);
+template<typename T> double leg2alm(  // associated Legendre transform
   const vmav<complex<T>,2> &alm, // (ncomp, lmidx)
   const cmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
   size_t spin,
@@ -70,7 +110,26 @@ template<typename T> void leg2alm(  // associated Legendre transform
   const cmav<double,1> &theta, // (nrings)
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol=false);
+  bool theta_interpol=false,
+  double epsilon=0.);
+// Like leg2alm, but additionally stores the auto- and cross-power spectra of
+// all computed a_lm sets in cl (see alm2cl() in alm.h for the definition).
+// The spectra are accumulated while each m column of a_lm is produced, so
+// the a_lm need not be read a second time.
+template<typename T> double leg2alm_cl(
+  const vmav<complex<T>,2> &alm, // (ncomp, lmidx)
+  const vmav<double,3> &cl, // (ncomp, ncomp, lmax+1)
+  const cmav<complex<T>,3> &leg, // (ncomp, nrings, nm)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mval, // (nm)
+  const cmav<size_t,1> &mstart, // (nm)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  size_t nthreads,
+  SHT_mode mode,
+  bool theta_interpol=false,
+  double epsilon=0.);
 
 template<typename T> void map2leg(  // FFT
   const cmav<T,2> &map, // (ncomp, pix)
@@ -89,7 +148,7 @@ template<typename T> void leg2map(  // FFT
   ptrdiff_t pixstride,
   size_t nthreads);
 
-template<typename T> void synthesis(
+template<typename T> double synthesis(
   const cmav<complex<T>,2> &alm, // (ncomp, *)
   const vmav<T,2> &map, // (ncomp, *)
   size_t spin,
@@ -103,9 +162,10 @@ template<typename T> void synthesis(
   ptrdiff_t pixstride,
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol=false);
+  bool theta_interpol=false,
+  double epsilon=0.);
 
-template<typename T> void adjoint_synthesis(
+template<typename T> double adjoint_synthesis(
   const vmav<complex<T>,2> &alm, // (ncomp, *)
   const cmav<T,2> &map, // (ncomp, *)
   size_t spin,
@@ -119,8 +179,58 @@ template<typename T> void adjoint_synthesis(
   ptrdiff_t pixstride,
   size_t nthreads,
   SHT_mode mode,
-  bool theta_interpol=false);
+  bool theta_interpol=false,
+  double epsilon=0.);
+
+// Variants of synthesis and adjoint_synthesis which only work on the map
+// pixels whose index (ringstart(iring)+iphi*pixstride) lies in one of the
+// ranges [pixranges(i,0); pixranges(i,1)), e.g. a HEALPix rangeset in RING
+// ordering. Only the rings containing such pixels are processed; on rings
+// with few selected pixels, these are computed by direct summation over m
+// instead of an FFT. synthesis_partial leaves all other pixels untouched,
+// adjoint_synthesis_partial treats them as zero. pixstride must be positive.
+template<typename T> void synthesis_partial(
+  const cmav<complex<T>,2> &alm, // (ncomp, *)
+  const vmav<T,2> &map, // (ncomp, *)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mstart, // (mmax+1)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  const cmav<size_t,1> &nphi, // (nrings)
+  const cmav<double,1> &phi0, // (nrings)
+  const cmav<size_t,1> &ringstart, // (nrings)
+  ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, // (nranges, 2)
+  size_t nthreads,
+  SHT_mode mode);
+
+template<typename T> void adjoint_synthesis_partial(
+  const vmav<complex<T>,2> &alm, // (ncomp, *)
+  const cmav<T,2> &map, // (ncomp, *)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mstart, // (mmax+1)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (nrings)
+  const cmav<size_t,1> &nphi, // (nrings)
+  const cmav<double,1> &phi0, // (nrings)
+  const cmav<size_t,1> &ringstart, // (nrings)
+  ptrdiff_t pixstride,
+  const cmav<size_t,2> &pixranges, // (nranges, 2)
+  size_t nthreads,
+  SHT_mode mode);
 
+// Computes a_lm from maps by solving the least-squares problem
+// min ||synthesis(alm)-map|| with LSMR.
+// If precondition is true, every pixel residual is weighted with the square
+// root of its approximate area (derived from the spacing of the rings), so
+// that the operator becomes close to an isometry also for grids with very
+// non-uniform pixel sizes. For maps which are (close to) band-limited, this
+// yields the same a_lm, otherwise the least-squares solution with respect to
+// the L2 norm on the sphere. The reported residual is the weighted one.
+// If warm_start is true, the iteration starts from the a_lm passed in alm
+// instead of from zero.
 template<typename T> tuple<size_t, size_t, double, double> pseudo_analysis(
   const vmav<complex<T>,2> &alm, // (ncomp, *)
   const cmav<T,2> &map, // (ncomp, *)
@@ -136,7 +246,9 @@ template<typename T> tuple<size_t, size_t, double, double> pseudo_analysis(
   size_t nthreads,
   size_t maxiter,
   double epsilon,
-  bool theta_interpol=false);
+  bool theta_interpol=false,
+  bool precondition=false,
+  bool warm_start=false);
 
 template<typename T> void synthesis_2d(
   const cmav<complex<T>,2> &alm,
@@ -233,12 +345,19 @@ using detail_sht::GRAD_ONLY;
 using detail_sht::DERIV1;
 using detail_sht::get_gridweights;
 using detail_sht::maximum_safe_l;
+using detail_sht::sht_table_cache_info;
+using detail_sht::set_sht_table_cache_limit;
+using detail_sht::get_sht_table_cache_info;
+using detail_sht::clear_sht_table_cache;
 using detail_sht::alm2leg;
 using detail_sht::leg2alm;
+using detail_sht::leg2alm_cl;
 using detail_sht::map2leg;
 using detail_sht::leg2map;
 using detail_sht::synthesis;
 using detail_sht::adjoint_synthesis;
+using detail_sht::synthesis_partial;
+using detail_sht::adjoint_synthesis_partial;
 using detail_sht::pseudo_analysis;
 using detail_sht::synthesis_2d;
 using detail_sht::adjoint_synthesis_2d;
@@ -0,0 +1,328 @@
+/*
+ *  This code is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This code is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this code; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*! \file sht_distributed.h
+ *  Spherical harmonic transforms of data distributed over several tasks.
+ *
+ *  Every task holds the a_lm for a subset of m values and the map pixels
+ *  on a subset of rings. The transforms are split into the Legendre part
+ *  (alm2leg()/leg2alm()), which each task carries out for its m values on
+ *  all rings, and the FFT part (leg2map()/map2leg()), which each task
+ *  carries out for its rings and all m. In between, the Legendre
+ *  coefficients are exchanged in a single call to Communicator::all2allv().
+ *  Without DUCC0_USE_MPI, Communicator describes a single task, and the
+ *  functions below reduce to the corresponding local transforms.
+ *
+ *  The assignment of m values and rings to tasks is arbitrary; a balanced
+ *  choice is provided by distributed_mvals() and distributed_rings().
+ *  Since every task sees the colatitudes of all rings, the north-south
+ *  symmetry of the Legendre functions is exploited irrespective of the
+ *  ring distribution.
+ *
+ *  Copyright (C) 2023 Max-Planck-Society
+ *  \author Martin Reinecke
+ */
+
+#ifndef DUCC0_SHT_DISTRIBUTED_H
+#define DUCC0_SHT_DISTRIBUTED_H
+
+#include <cstddef>
+#include <complex>
+#include <limits>
+#include <vector>
+#include "ducc0/infra/error_handling.h"
+#include "ducc0/infra/mav.h"
+#include "ducc0/infra/misc_utils.h"
+#include "ducc0/infra/communication.h"
+#include "ducc0/sht/sht.h"
+
+namespace ducc0 {
+
+namespace detail_sht {
+
+using namespace std;
+
+/// Returns the m values in [0; mmax] which belong to the calling task.
+/** The m values are dealt out in the order 0, 1, ..., P-1, P-1, ..., 1, 0,
+ *  0, 1, ... to the P tasks of \a comm; since the cost of an m is roughly
+ *  proportional to lmax-m, this balances the load well. */
+inline vector<size_t> distributed_mvals(size_t mmax, const Communicator &comm)
+  {
+  size_t ntasks=size_t(comm.num_ranks()), rank=size_t(comm.rank());
+  vector<size_t> res;
+  for (size_t m=0; m<=mmax; ++m)
+    {
+    size_t pos = m%(2*ntasks);
+    if (((pos<ntasks) ? pos : 2*ntasks-1-pos)==rank)
+      res.push_back(m);
+    }
+  return res;
+  }
+
+/// Returns the indices of the rings which belong to the calling task.
+/** The rings of a map with \a nrings rings are assumed to be ordered from
+ *  north to south, so that rings i and nrings-1-i form a pair. Contiguous
+ *  ranges of pairs are assigned to the tasks of \a comm. */
+inline vector<size_t> distributed_rings(size_t nrings, const Communicator &comm)
+  {
+  size_t npairs=(nrings+1)/2;
+  auto [lo, hi] = calcShare(size_t(comm.num_ranks()), size_t(comm.rank()), npairs);
+  vector<size_t> res;
+  for (size_t i=lo; i<hi; ++i)
+    res.push_back(i);
+  for (size_t i=hi; i>lo; --i)
+    if (nrings-i!=i-1)
+      res.push_back(nrings-i);
+  return res;
+  }
+
+namespace util_distributed {
+
+inline int mpi_count(size_t n)
+  {
+  MR_assert(n<=size_t(numeric_limits<int>::max()),
+    "message too large; please use more tasks");
+  return int(n);
+  }
+
+// gathers the local arrays of all tasks, ordered by task
+template<typename T> vector<T> allgather_all(const Communicator &comm,
+  const vector<T> &in, vector<size_t> &num, vector<size_t> &ofs)
+  {
+  size_t ntasks=size_t(comm.num_ranks());
+  auto num_l = comm.allgatherVec(long(in.size()));
+  vector<int> num_i(ntasks), ofs_i(ntasks);
+  num.resize(ntasks);
+  ofs.resize(ntasks);
+  size_t n=0;
+  for (size_t i=0; i<ntasks; ++i)
+    {
+    num[i] = size_t(num_l[i]);
+    ofs[i] = n;
+    num_i[i] = mpi_count(num[i]);
+    ofs_i[i] = mpi_count(n);
+    n += num[i];
+    }
+  vector<T> res(n);
+  comm.allgathervRaw(in.data(), num_i[comm.rank()], res.data(), num_i.data(),
+    ofs_i.data());
+  return res;
+  }
+
+inline vmav<double,1> allgather_theta(const Communicator &comm,
+  const cmav<double,1> &theta_loc, vector<size_t> &num, vector<size_t> &ofs)
+  {
+  vector<double> tmp(theta_loc.shape(0));
+  for (size_t i=0; i<tmp.size(); ++i)
+    tmp[i] = theta_loc(i);
+  auto tall = allgather_all(comm, tmp, num, ofs);
+  MR_assert(!tall.empty(), "no rings on any task");
+  vmav<double,1> res({tall.size()}, UNINITIALIZED);
+  for (size_t i=0; i<tall.size(); ++i)
+    res(i) = tall[i];
+  return res;
+  }
+
+// Global layout of a distributed SHT: which task owns which m values and
+// rings, and the colatitudes of all rings in task order.
+struct sht_dist_layout
+  {
+  vector<size_t> nm, mofs, mval;
+  vector<size_t> nring, ringofs;
+  vmav<double,1> theta;
+  size_t mmax;
+
+  sht_dist_layout(const Communicator &comm, const cmav<size_t,1> &mval_loc,
+    const cmav<double,1> &theta_loc)
+    : theta(allgather_theta(comm, theta_loc, nring, ringofs)), mmax(0)
+    {
+    vector<long> mtmp(mval_loc.shape(0));
+    for (size_t i=0; i<mtmp.size(); ++i)
+      mtmp[i] = long(mval_loc(i));
+    auto mall = allgather_all(comm, mtmp, nm, mofs);
+    MR_assert(!mall.empty(), "no m values on any task");
+    mval.resize(mall.size());
+    for (size_t i=0; i<mall.size(); ++i)
+      {
+      mval[i] = size_t(mall[i]);
+      mmax = max(mmax, mval[i]);
+      }
+    vector<size_t> mcheck(mmax+1, 0);
+    for (auto m: mval)
+      MR_assert(++mcheck[m]==1, "m value assigned to more than one task");
+    }
+  };
+
+// leg_m: (ncomp, all rings, local m); leg_r: (ncomp, local rings, mmax+1)
+// If m2r is true, leg_m is scattered into leg_r, else leg_r is gathered
+// into leg_m. In leg_r, entries for m values which do not belong to any
+// task are not touched; they must be zero for m2r.
+template<typename T> void exchange_leg(const Communicator &comm,
+  const sht_dist_layout &lay, const vmav<complex<T>,3> &leg_m,
+  const vmav<complex<T>,3> &leg_r, bool m2r)
+  {
+  size_t ntasks=size_t(comm.num_ranks()), rank=size_t(comm.rank());
+  size_t ncomp=leg_m.shape(0);
+  size_t nm_loc=lay.nm[rank], nr_loc=lay.nring[rank];
+  // m side: one block (ncomp, nring[t], nm_loc) per task t
+  // r side: one block (ncomp, nr_loc, nm[t]) per task t
+  vector<int> num_m(ntasks), ofs_m(ntasks), num_r(ntasks), ofs_r(ntasks);
+  size_t nbuf_m=0, nbuf_r=0;
+  for (size_t t=0; t<ntasks; ++t)
+    {
+    num_m[t] = mpi_count(ncomp*lay.nring[t]*nm_loc);
+    ofs_m[t] = mpi_count(nbuf_m);
+    nbuf_m += size_t(num_m[t]);
+    num_r[t] = mpi_count(ncomp*nr_loc*lay.nm[t]);
+    ofs_r[t] = mpi_count(nbuf_r);
+    nbuf_r += size_t(num_r[t]);
+    }
+  vector<complex<T>> buf_m(nbuf_m), buf_r(nbuf_r);
+  if (m2r)
+    {
+    for (size_t t=0; t<ntasks; ++t)
+      for (size_t c=0, i=size_t(ofs_m[t]); c<ncomp; ++c)
+        for (size_t ir=0; ir<lay.nring[t]; ++ir)
+          for (size_t im=0; im<nm_loc; ++im, ++i)
+            buf_m[i] = leg_m(c, lay.ringofs[t]+ir, im);
+    comm.all2allvRaw(buf_m.data(), num_m.data(), ofs_m.data(),
+                     buf_r.data(), num_r.data(), ofs_r.data());
+    for (size_t t=0; t<ntasks; ++t)
+      for (size_t c=0, i=size_t(ofs_r[t]); c<ncomp; ++c)
+        for (size_t ir=0; ir<nr_loc; ++ir)
+          for (size_t im=0; im<lay.nm[t]; ++im, ++i)
+            leg_r(c, ir, lay.mval[lay.mofs[t]+im]) = buf_r[i];
+    }
+  else
+    {
+    for (size_t t=0; t<ntasks; ++t)
+      for (size_t c=0, i=size_t(ofs_r[t]); c<ncomp; ++c)
+        for (size_t ir=0; ir<nr_loc; ++ir)
+          for (size_t im=0; im<lay.nm[t]; ++im, ++i)
+            buf_r[i] = leg_r(c, ir, lay.mval[lay.mofs[t]+im]);
+    comm.all2allvRaw(buf_r.data(), num_r.data(), ofs_r.data(),
+                     buf_m.data(), num_m.data(), ofs_m.data());
+    for (size_t t=0; t<ntasks; ++t)
+      for (size_t c=0, i=size_t(ofs_m[t]); c<ncomp; ++c)
+        for (size_t ir=0; ir<lay.nring[t]; ++ir)
+          for (size_t im=0; im<nm_loc; ++im, ++i)
+            leg_m(c, lay.ringofs[t]+ir, im) = buf_m[i];
+    }
+  }
+
+// zero-initialized Legendre array; it may be empty on some tasks, which
+// build_noncritical() does not support
+template<typename T> vmav<complex<T>,3> leg_array(size_t ncomp,
+  size_t nrings, size_t nm)
+  {
+  if (nrings*nm==0) return vmav<complex<T>,3>({ncomp, nrings, nm});
+  return vmav<complex<T>,3>::build_noncritical({ncomp, nrings, nm});
+  }
+
+// as in alm2leg() and leg2alm(), spin is ignored (i.e. assumed to be 1) in
+// DERIV1 mode
+inline size_t num_leg_components(size_t nalm, size_t spin, SHT_mode mode)
+  {
+  if (mode==STANDARD) return nalm;
+  MR_assert((spin>0) || (mode==DERIV1), "GRAD_ONLY mode requires spin>0");
+  return 2*nalm;
+  }
+
+}
+
+/// Spherical harmonic synthesis of distributed a_lm onto a distributed map.
+/** The calling task holds the a_lm for the m values \a mval, stored as in
+ *  alm2leg(), and the map pixels on the rings described by \a theta,
+ *  \a nphi, \a phi0 and \a ringstart, stored as in synthesis(). All tasks
+ *  must pass identical \a spin, \a lmax and \a mode. Every m in [0; mmax]
+ *  (where mmax is the largest m on any task) may belong to at most one
+ *  task; missing m values are treated as zero.
+ *  As in alm2leg(), \a spin is ignored in DERIV1 mode; synthesis() instead
+ *  requires it to be positive. */
+template<typename T> void synthesis_mpi(const Communicator &comm,
+  const cmav<complex<T>,2> &alm, // (ncomp, local lmidx)
+  const vmav<T,2> &map, // (ncomp, local pix)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mval, // (local nm)
+  const cmav<size_t,1> &mstart, // (local nm)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (local nrings)
+  const cmav<size_t,1> &nphi, // (local nrings)
+  const cmav<double,1> &phi0, // (local nrings)
+  const cmav<size_t,1> &ringstart, // (local nrings)
+  ptrdiff_t pixstride,
+  size_t nthreads,
+  SHT_mode mode)
+  {
+  using namespace util_distributed;
+  sht_dist_layout lay(comm, mval, theta);
+  MR_assert(lay.mmax<=lmax, "lmax must be >= mmax");
+  size_t ncomp = num_leg_components(alm.shape(0), spin, mode);
+  MR_assert(map.shape(0)==ncomp, "inconsistent number of components");
+  auto leg_m(leg_array<T>(ncomp, lay.theta.shape(0), mval.shape(0)));
+  if (mval.shape(0)>0)
+    alm2leg(alm, leg_m, spin, lmax, mval, mstart, lstride, lay.theta,
+      nthreads, mode);
+  auto leg_r(leg_array<T>(ncomp, theta.shape(0), lay.mmax+1));
+  exchange_leg(comm, lay, leg_m, leg_r, true);
+  if (theta.shape(0)>0)
+    leg2map(map, leg_r, nphi, phi0, ringstart, pixstride, nthreads);
+  }
+
+/// Adjoint of synthesis_mpi().
+/** Arguments and data layout are identical to synthesis_mpi(). */
+template<typename T> void adjoint_synthesis_mpi(const Communicator &comm,
+  const vmav<complex<T>,2> &alm, // (ncomp, local lmidx)
+  const cmav<T,2> &map, // (ncomp, local pix)
+  size_t spin,
+  size_t lmax,
+  const cmav<size_t,1> &mval, // (local nm)
+  const cmav<size_t,1> &mstart, // (local nm)
+  ptrdiff_t lstride,
+  const cmav<double,1> &theta, // (local nrings)
+  const cmav<size_t,1> &nphi, // (local nrings)
+  const cmav<double,1> &phi0, // (local nrings)
+  const cmav<size_t,1> &ringstart, // (local nrings)
+  ptrdiff_t pixstride,
+  size_t nthreads,
+  SHT_mode mode)
+  {
+  using namespace util_distributed;
+  sht_dist_layout lay(comm, mval, theta);
+  MR_assert(lay.mmax<=lmax, "lmax must be >= mmax");
+  size_t ncomp = num_leg_components(alm.shape(0), spin, mode);
+  MR_assert(map.shape(0)==ncomp, "inconsistent number of components");
+  auto leg_r(leg_array<T>(ncomp, theta.shape(0), lay.mmax+1));
+  if (theta.shape(0)>0)
+    map2leg(map, leg_r, nphi, phi0, ringstart, pixstride, nthreads);
+  auto leg_m(leg_array<T>(ncomp, lay.theta.shape(0), mval.shape(0)));
+  exchange_leg(comm, lay, leg_m, leg_r, false);
+  if (mval.shape(0)>0)
+    leg2alm(alm, leg_m, spin, lmax, mval, mstart, lstride, lay.theta,
+      nthreads, mode);
+  }
+
+}
+
+using detail_sht::distributed_mvals;
+using detail_sht::distributed_rings;
+using detail_sht::synthesis_mpi;
+using detail_sht::adjoint_synthesis_mpi;
+
+}
+
+#endif
@@ -334,13 +334,23 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
     constexpr static int log2tile=is_same<Tacc,float>::value ? 5 : 4;
     bool gridding;
     TimerHierarchy timers;
-    const cmav<complex<Tms>,2> &ms_in;
-    const vmav<complex<Tms>,2> &ms_out;
-    const cmav<Timg,2> &dirty_in;
-    const vmav<Timg,2> &dirty_out;
-    const cmav<Tms,2> &wgt;
-    const cmav<uint8_t,2> &mask;
+    cmav<complex<Tms>,2> ms_in;
+    vmav<complex<Tms>,2> ms_out;
+    cmav<Timg,2> dirty_in;
+    vmav<Timg,2> dirty_out;
+    cmav<Tms,2> wgt;
+    cmav<uint8_t,2> mask;
     vmav<uint8_t,2> lmask;
+    // multi-image gridding and degridding: (ncorr,nrow,nchan) input or
+    // output visibilities and (nterm,nchan) Taylor weights; empty in
+    // single-image mode
+    cmav<complex<Tms>,3> ms_multi;
+    vmav<complex<Tms>,3> ms_multi_out;
+    cmav<Tms,2> taylor;
+    // streaming mode: channel frequencies and persistent uv grid(s);
+    // empty otherwise
+    vmav<double,1> sfreq;
+    vmav<complex<Tcalc>,3> acc_grid;
     double pixsize_x, pixsize_y;
     size_t nxdirty, nydirty;
     double epsilon;
@@ -349,6 +359,7 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
     size_t verbosity;
     bool negate_v, divide_by_n;
     double sigma_min, sigma_max;
+    size_t max_grid_mem;  // memory allowed for the uv grids of x2dirty
 
     Baselines bl;
     vector<RowchanRange> ranges;
@@ -363,6 +374,20 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
     double lshift, mshift, nshift;
     bool shifting, lmshift, no_nshift;
 
+    size_t nimg() const
+      {
+      if (ms_multi.size()!=0) return ms_multi.shape(0)*taylor.shape(0);
+      if (ms_multi_out.size()!=0) return ms_multi_out.shape(0)*taylor.shape(0);
+      return 1;
+      }
+    // number of w planes gridded and transformed together by x2dirty
+    size_t plane_batch() const
+      {
+      if (!do_wgridding) return 1;
+      size_t plane_mem = nimg()*nu*nv*sizeof(complex<Tcalc>);
+      return max<size_t>(1, min(nplanes, max_grid_mem/plane_mem));
+      }
+
     size_t nu, nv;
     double ofactor;
 
@@ -392,9 +417,13 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
       return twopi*(phs-floor(phs));
       }
 
-    void grid2dirty_post(const vmav<Tcalc,2> &tmav, const vmav<Timg,2> &dirty) const
+    // The gridding-side routines below work on a stack of images (and grids)
+    // along the first axis; single images are passed with a leading axis of
+    // length 1.
+    void grid2dirty_post(const vmav<Tcalc,3> &tmav, const vmav<Timg,3> &dirty) const
       {
-      checkShape(dirty.shape(), {nxdirty, nydirty});
+      size_t nimg = tmav.shape(0);
+      checkShape(dirty.shape(), {nimg, nxdirty, nydirty});
       auto cfu = krn->corfunc(nxdirty/2+1, 1./nu, nthreads);
       auto cfv = krn->corfunc(nydirty/2+1, 1./nv, nthreads);
       execParallel(nxdirty, nthreads, [&](size_t lo, size_t hi)
@@ -402,22 +431,28 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
         for (auto i=lo; i<hi; ++i)
           {
           int icfu = abs(int(nxdirty/2)-int(i));
-          for (size_t j=0; j<nydirty; ++j)
-            {
-            int icfv = abs(int(nydirty/2)-int(j));
-            size_t i2 = nu-nxdirty/2+i;
-            if (i2>=nu) i2-=nu;
-            size_t j2 = nv-nydirty/2+j;
-            if (j2>=nv) j2-=nv;
-            dirty(i,j) = Timg(tmav(i2,j2)*cfu[icfu]*cfv[icfv]);
-            }
+          size_t i2 = nu-nxdirty/2+i;
+          if (i2>=nu) i2-=nu;
+          for (size_t k=0; k<nimg; ++k)
+            for (size_t j=0; j<nydirty; ++j)
+              {
+              int icfv = abs(int(nydirty/2)-int(j));
+              size_t j2 = nv-nydirty/2+j;
+              if (j2>=nv) j2-=nv;
+              dirty(k,i,j) = Timg(tmav(k,i2,j2)*cfu[icfu]*cfv[icfv]);
+              }
           }
         });
       }
-    void grid2dirty_post2(const vmav<complex<Tcalc>,2> &tmav, const vmav<Timg,2> &dirty, double w)
+    // tmav may hold several consecutive w planes (starting at w), each
+    // consisting of dirty.shape(0) images; their sum is added to dirty.
+    void grid2dirty_post2(const vmav<complex<Tcalc>,3> &tmav, const vmav<Timg,3> &dirty, double w)
       {
       timers.push("wscreen+grid correction");
-      checkShape(dirty.shape(), {nxdirty,nydirty});
+      size_t nimg = dirty.shape(0);
+      checkShape(dirty.shape(), {nimg,nxdirty,nydirty});
+      MR_assert((nimg>0) && (tmav.shape(0)%nimg==0), "bad number of images");
+      size_t npl = tmav.shape(0)/nimg;
       double x0 = lshift-0.5*nxdirty*pixsize_x,
              y0 = mshift-0.5*nydirty*pixsize_y;
       size_t nxd = lmshift ? nxdirty : (nxdirty/2+1);
@@ -430,92 +465,123 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
           double xsq = sqr(x0+i*pixsize_x);
           size_t ix = nu-nxdirty/2+i;
           if (ix>=nu) ix-=nu;
-          expi(phases, buf, [&](size_t i)
-            { return Tcalc(phase(xsq, sqr(y0+i*pixsize_y), w, true, nshift)); });
-          if (lmshift)
-            for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
-              {
-              dirty(i,j) += Timg(tmav(ix,jx).real()*phases[j].real()
-                               - tmav(ix,jx).imag()*phases[j].imag());
-              tmav(ix,jx) = complex<Tcalc>(0);
-              }
-          else
+          for (size_t pl=0; pl<npl; ++pl)
             {
-            size_t i2 = nxdirty-i;
-            size_t ix2 = nu-nxdirty/2+i2;
-            if (ix2>=nu) ix2-=nu;
-            if ((i>0)&&(i<i2))
-              for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
-                {
-                size_t j2 = min(j, nydirty-j);
-                Tcalc re = phases[j2].real(), im = phases[j2].imag();
-                dirty(i ,j) += Timg(tmav(ix ,jx).real()*re - tmav(ix ,jx).imag()*im);
-                dirty(i2,j) += Timg(tmav(ix2,jx).real()*re - tmav(ix2,jx).imag()*im);
-                tmav(ix,jx) = tmav(ix2,jx) = complex<Tcalc>(0);
-                }
-            else
-              for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+            double wpl = w+pl*dw;
+            expi(phases, buf, [&](size_t i)
+              { return Tcalc(phase(xsq, sqr(y0+i*pixsize_y), wpl, true, nshift)); });
+            for (size_t k=0; k<nimg; ++k)
+              {
+              size_t kg = pl*nimg+k;
+              if (lmshift)
+                for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                  {
+                  dirty(k,i,j) += Timg(tmav(kg,ix,jx).real()*phases[j].real()
+                                     - tmav(kg,ix,jx).imag()*phases[j].imag());
+                  tmav(kg,ix,jx) = complex<Tcalc>(0);
+                  }
+              else
                 {
-                size_t j2 = min(j, nydirty-j);
-                Tcalc re = phases[j2].real(), im = phases[j2].imag();
-                dirty(i,j) += Timg(tmav(ix,jx).real()*re - tmav(ix,jx).imag()*im); // lower left
-                tmav(ix,jx) = complex<Tcalc>(0);
+                size_t i2 = nxdirty-i;
+                size_t ix2 = nu-nxdirty/2+i2;
+                if (ix2>=nu) ix2-=nu;
+                if ((i>0)&&(i<i2))
+                  for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                    {
+                    size_t j2 = min(j, nydirty-j);
+                    Tcalc re = phases[j2].real(), im = phases[j2].imag();
+                    dirty(k,i ,j) += Timg(tmav(kg,ix ,jx).real()*re - tmav(kg,ix ,jx).imag()*im);
+                    dirty(k,i2,j) += Timg(tmav(kg,ix2,jx).real()*re - tmav(kg,ix2,jx).imag()*im);
+                    tmav(kg,ix,jx) = tmav(kg,ix2,jx) = complex<Tcalc>(0);
+                    }
+                else
+                  for (size_t j=0, jx=nv-nydirty/2; j<nydirty; ++j, jx=(jx+1>=nv)? jx+1-nv : jx+1)
+                    {
+                    size_t j2 = min(j, nydirty-j);
+                    Tcalc re = phases[j2].real(), im = phases[j2].imag();
+                    dirty(k,i,j) += Timg(tmav(kg,ix,jx).real()*re - tmav(kg,ix,jx).imag()*im); // lower left
+                    tmav(kg,ix,jx) = complex<Tcalc>(0);
+                    }
                 }
+              }
             }
           }
         });
       timers.poppush("zeroing grid");
       // only zero the parts of the grid that have not been zeroed before
-      { auto a0 = subarray<2>(tmav, {{0,nxdirty/2}, {nydirty/2,nv-nydirty/2}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(tmav, {{nxdirty/2, nu-nxdirty/2}, {}}); quickzero(a0, nthreads); }
-      { auto a0 = subarray<2>(tmav, {{nu-nxdirty/2,MAXIDX}, {nydirty/2, nv-nydirty/2}}); quickzero(a0, nthreads); }
+      for (size_t k=0; k<tmav.shape(0); ++k)
+        {
+        { auto a0 = subarray<2>(tmav, {{k}, {0,nxdirty/2}, {nydirty/2,nv-nydirty/2}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(tmav, {{k}, {nxdirty/2, nu-nxdirty/2}, {}}); quickzero(a0, nthreads); }
+        { auto a0 = subarray<2>(tmav, {{k}, {nu-nxdirty/2,MAXIDX}, {nydirty/2, nv-nydirty/2}}); quickzero(a0, nthreads); }
+        }
       timers.pop();
       }
 
-    void grid2dirty_overwrite(const vmav<Tcalc,2> &grid, const vmav<Timg,2> &dirty)
+    void grid2dirty_overwrite(const vmav<Tcalc,3> &grid, const vmav<Timg,3> &dirty)
       {
       timers.push("FFT");
-      checkShape(grid.shape(), {nu,nv});
-      hartley2_2D(grid, vlim, uv_side_fast, nthreads);
+      checkShape(grid.shape(), {grid.shape(0),nu,nv});
+      for (size_t k=0; k<grid.shape(0); ++k)
+        {
+        auto grid2 = subarray<2>(grid, {{k}, {}, {}});
+        hartley2_2D(grid2, vlim, uv_side_fast, nthreads);
+        }
       timers.poppush("grid correction");
       grid2dirty_post(grid, dirty);
       timers.pop();
       }
 
     void grid2dirty_c_overwrite_wscreen_add
-      (const vmav<complex<Tcalc>,2> &grid, const vmav<Timg,2> &dirty, double w, size_t iplane)
+      (const vmav<complex<Tcalc>,3> &grid, const vmav<Timg,3> &dirty, double w, size_t iplane)
       {
       timers.push("FFT");
-      checkShape(grid.shape(), {nu,nv});
+      checkShape(grid.shape(), {grid.shape(0),nu,nv});
       vfmav<complex<Tcalc>> inout(grid);
 
-      const auto &rsu(uranges[iplane]);
-      const auto &rsv(vranges[iplane]);
-      auto cost_ufirst = nxdirty*log(nv)*nv + rsv.nval()*log(nu)*nu;
-      auto cost_vfirst = nydirty*log(nu)*nu + rsu.nval()*log(nv)*nv;
+      // grid may hold several consecutive w planes, starting at iplane.
+      // The first (sparse) pass is done plane by plane, restricted to the
+      // occupied region of the respective plane; the second pass is done
+      // for all planes together.
+      size_t nimg = dirty.shape(0);
+      size_t npl = grid.shape(0)/nimg;
+      double cost_ufirst=0, cost_vfirst=0;
+      for (size_t pl=0; pl<npl; ++pl)
+        {
+        cost_ufirst += nxdirty*log(nv)*nv + vranges[iplane+pl].nval()*log(nu)*nu;
+        cost_vfirst += nydirty*log(nu)*nu + uranges[iplane+pl].nval()*log(nv)*nv;
+        }
       if (cost_ufirst<cost_vfirst)
         {
-        for (size_t i=0; i<rsv.nranges(); ++i)
+        for (size_t pl=0; pl<npl; ++pl)
           {
-          auto inout_tmp = inout.subarray({{},{size_t(rsv.ivbegin(i)), size_t(rsv.ivend(i))}});
-          c2c(inout_tmp, inout_tmp, {0}, BACKWARD, Tcalc(1), nthreads);
+          const auto &rsv(vranges[iplane+pl]);
+          for (size_t i=0; i<rsv.nranges(); ++i)
+            {
+            auto inout_tmp = inout.subarray({{pl*nimg, (pl+1)*nimg},{},{size_t(rsv.ivbegin(i)), size_t(rsv.ivend(i))}});
+            c2c(inout_tmp, inout_tmp, {1}, BACKWARD, Tcalc(1), nthreads);
+            }
           }
-        auto inout_lo = inout.subarray({{0,nxdirty/2},{}});
-        c2c(inout_lo, inout_lo, {1}, BACKWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{inout.shape(0)-nxdirty/2, MAXIDX},{}});
-        c2c(inout_hi, inout_hi, {1}, BACKWARD, Tcalc(1), nthreads);
+        auto inout_lo = inout.subarray({{},{0,nxdirty/2},{}});
+        c2c(inout_lo, inout_lo, {2}, BACKWARD, Tcalc(1), nthreads);
+        auto inout_hi = inout.subarray({{},{inout.shape(1)-nxdirty/2, MAXIDX},{}});
+        c2c(inout_hi, inout_hi, {2}, BACKWARD, Tcalc(1), nthreads);
         }
       else
         {
-        for (size_t i=0; i<rsu.nranges(); ++i)
+        for (size_t pl=0; pl<npl; ++pl)
           {
-          auto inout_tmp = inout.subarray({{size_t(rsu.ivbegin(i)), size_t(rsu.ivend(i))}, {}});
-          c2c(inout_tmp, inout_tmp, {1}, BACKWARD, Tcalc(1), nthreads);
+          const auto &rsu(uranges[iplane+pl]);
+          for (size_t i=0; i<rsu.nranges(); ++i)
+            {
+            auto inout_tmp = inout.subarray({{pl*nimg, (pl+1)*nimg},{size_t(rsu.ivbegin(i)), size_t(rsu.ivend(i))}, {}});
+            c2c(inout_tmp, inout_tmp, {2}, BACKWARD, Tcalc(1), nthreads);
+            }
           }
-        auto inout_lo = inout.subarray({{}, {0,nydirty/2}});
-        c2c(inout_lo, inout_lo, {0}, BACKWARD, Tcalc(1), nthreads);
-        auto inout_hi = inout.subarray({{},{inout.shape(1)-nydirty/2, MAXIDX}});
-        c2c(inout_hi, inout_hi, {0}, BACKWARD, Tcalc(1), nthreads);
+        auto inout_lo = inout.subarray({{},{}, {0,nydirty/2}});
+        c2c(inout_lo, inout_lo, {1}, BACKWARD, Tcalc(1), nthreads);
+        auto inout_hi = inout.subarray({{},{},{inout.shape(2)-nydirty/2, MAXIDX}});
+        c2c(inout_hi, inout_hi, {1}, BACKWARD, Tcalc(1), nthreads);
         }
 
       timers.pop();
@@ -676,17 +742,6 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> class Wgrid
       size_t nrow=bl.Nrows(),
              nchan=bl.Nchannels();
 
-      if (do_wgridding)
-        {
-        dw = 0.5/ofactor/max(abs(nm1max+nshift), abs(nm1min+nshift));
-        xdw = 1./dw;
-        nplanes = size_t((wmax_d-wmin_d)/dw+supp);
-        MR_assert(nplanes<(size_t(1)<<16), "too many w planes");
-        wmin = (wmin_d+wmax_d)*0.5 - 0.5*(nplanes-1)*dw;
-        wshift = dw-(0.5*supp*dw)-wmin;
-        }
-      else
-        dw = wmin  = xdw = wshift = nplanes = 0;
       size_t nbunch = do_wgridding ? supp : 1;
       // we want a maximum deviation of 1% in gridding time between threads
       constexpr double max_asymm = 0.01;
@@ -936,7 +991,8 @@ timers.pop();
         static constexpr double xsupp=2./supp;
         const Wgridder *parent;
         TemplateKernel<supp, mysimd<Tacc>> tkrn;
-        const vmav<complex<Tcalc>,2> &grid;
+        vmav<complex<Tcalc>,3> grid;
+        size_t nimg;
         int iu0, iv0; // start index of the current visibility
         int bu0, bv0; // start index of the current buffer
 
@@ -955,14 +1011,17 @@ timers.pop();
           int idxv0 = (bv0+inv)%inv;
           for (int iu=0; iu<su; ++iu)
             {
-            int idxv = idxv0;
             {
             LockGuard lock(locks[idxu]);
-            for (int iv=0; iv<sv; ++iv)
+            for (size_t k=0; k<nimg; ++k)
               {
-              grid(idxu,idxv) += complex<Tcalc>(Tcalc(bufr(iu,iv)), Tcalc(bufi(iu,iv)));
-              bufr(iu,iv) = bufi(iu,iv) = 0;
-              if (++idxv>=inv) idxv=0;
+              int idxv = idxv0;
+              for (int iv=0; iv<sv; ++iv)
+                {
+                grid(k,idxu,idxv) += complex<Tcalc>(Tcalc(bufr(k*su+iu,iv)), Tcalc(bufi(k*su+iu,iv)));
+                bufr(k*su+iu,iv) = bufi(k*su+iu,iv) = 0;
+                if (++idxv>=inv) idxv=0;
+                }
               }
             }
             if (++idxu>=inu) idxu=0;
@@ -980,21 +1039,26 @@ timers.pop();
           };
         kbuf buf;
 
-        HelperX2g2(const Wgridder *parent_, const vmav<complex<Tcalc>,2> &grid_,
+        /*! \a grid_ holds one uv grid per image along its first axis;
+            the local buffers are kept for all images simultaneously. */
+        HelperX2g2(const Wgridder *parent_, const vmav<complex<Tcalc>,3> &grid_,
           vector<Mutex> &locks_, double w0_=-1, double dw_=-1)
           : parent(parent_), tkrn(*parent->krn), grid(grid_),
+            nimg(grid.shape(0)),
             iu0(-1000000), iv0(-1000000),
             bu0(-1000000), bv0(-1000000),
-            bufr({size_t(su),size_t(svvec)}),
-            bufi({size_t(su),size_t(svvec)}),
+            bufr({nimg*size_t(su),size_t(svvec)}),
+            bufi({nimg*size_t(su),size_t(svvec)}),
             px0r(bufr.data()), px0i(bufi.data()),
             w0(w0_),
             xdw(1./dw_),
             locks(locks_)
-          { checkShape(grid.shape(), {parent->nu,parent->nv}); }
+          { checkShape(grid.shape(), {nimg,parent->nu,parent->nv}); }
         ~HelperX2g2() { dump(); }
 
-        constexpr int lineJump() const { return svvec; }
+        static constexpr int lineJump() { return svvec; }
+        // distance between the local buffers of consecutive images
+        static constexpr int imgJump() { return su*svvec; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(const UVW &in,
           [[maybe_unused]] size_t nth=0)
@@ -1038,7 +1102,8 @@ timers.pop();
         const Wgridder *parent;
 
         TemplateKernel<supp, mysimd<Tcalc>> tkrn;
-        const cmav<complex<Tcalc>,2> &grid;
+        cmav<complex<Tcalc>,3> grid;
+        size_t nimg;
         int iu0, iv0; // start index of the current visibility
         int bu0, bv0; // start index of the current buffer
 
@@ -1054,12 +1119,15 @@ timers.pop();
           int idxv0 = (bv0+inv)%inv;
           for (int iu=0; iu<su; ++iu)
             {
-            int idxv = idxv0;
-            for (int iv=0; iv<sv; ++iv)
+            for (size_t k=0; k<nimg; ++k)
               {
-              bufr(iu,iv) = grid(idxu, idxv).real();
-              bufi(iu,iv) = grid(idxu, idxv).imag();
-              if (++idxv>=inv) idxv=0;
+              int idxv = idxv0;
+              for (int iv=0; iv<sv; ++iv)
+                {
+                bufr(k*su+iu,iv) = grid(k,idxu,idxv).real();
+                bufi(k*su+iu,iv) = grid(k,idxu,idxv).imag();
+                if (++idxv>=inv) idxv=0;
+                }
               }
             if (++idxu>=inu) idxu=0;
             }
@@ -1076,19 +1144,24 @@ timers.pop();
           };
         kbuf buf;
 
-        HelperG2x2(const Wgridder *parent_, const cmav<complex<Tcalc>,2> &grid_,
+        /*! \a grid_ holds one uv grid per image along its first axis;
+            the local buffers are loaded for all images simultaneously. */
+        HelperG2x2(const Wgridder *parent_, const cmav<complex<Tcalc>,3> &grid_,
           double w0_=-1, double dw_=-1)
           : parent(parent_), tkrn(*parent->krn), grid(grid_),
+            nimg(grid.shape(0)),
             iu0(-1000000), iv0(-1000000),
             bu0(-1000000), bv0(-1000000),
-            bufr({size_t(su),size_t(svvec)}),
-            bufi({size_t(su),size_t(svvec)}),
+            bufr({nimg*size_t(su),size_t(svvec)}),
+            bufi({nimg*size_t(su),size_t(svvec)}),
             px0r(bufr.data()), px0i(bufi.data()),
             w0(w0_),
             xdw(1./dw_)
-          { checkShape(grid.shape(), {parent->nu,parent->nv}); }
+          { checkShape(grid.shape(), {nimg,parent->nu,parent->nv}); }
 
-        constexpr int lineJump() const { return svvec; }
+        static constexpr int lineJump() { return svvec; }
+        // distance between the local buffers of consecutive images
+        static constexpr int imgJump() { return su*svvec; }
 
         [[gnu::always_inline]] [[gnu::hot]] void prep(const UVW &in,
           [[maybe_unused]] size_t nth=0)
@@ -1116,6 +1189,100 @@ timers.pop();
           }
       };
 
+    /*! Adds the visibility (\a vr, \a vi), multiplied by the kernel values
+        prepared in \a hlp, to the helper's local grid buffer for image
+        \a img. */
+    template<size_t SUPP, typename Thlp> [[gnu::always_inline]] [[gnu::hot]]
+      static void spread(const Thlp &hlp, Tacc vr_, Tacc vi_, size_t img=0)
+      {
+      constexpr size_t vlen=mysimd<Tacc>::size();
+      constexpr size_t NVEC((SUPP+vlen-1)/vlen);
+      constexpr int jump = Thlp::lineJump();
+      const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
+      const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+      auto * DUCC0_RESTRICT p0r = hlp.p0r+img*Thlp::imgJump();
+      auto * DUCC0_RESTRICT p0i = hlp.p0i+img*Thlp::imgJump();
+      if constexpr (NVEC==1)
+        {
+        mysimd<Tacc> vr=vr_*kv[0], vi=vi_*kv[0];
+        for (size_t cu=0; cu<SUPP; ++cu)
+          {
+          auto * DUCC0_RESTRICT pxr = p0r+cu*jump;
+          auto * DUCC0_RESTRICT pxi = p0i+cu*jump;
+          auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
+          auto ti = mysimd<Tacc>(pxi,element_aligned_tag());
+          tr += vr*ku[cu];
+          ti += vi*ku[cu];
+          tr.copy_to(pxr,element_aligned_tag());
+          ti.copy_to(pxi,element_aligned_tag());
+          }
+        }
+      else
+        {
+        mysimd<Tacc> vr(vr_), vi(vi_);
+        for (size_t cu=0; cu<SUPP; ++cu)
+          {
+          mysimd<Tacc> tmpr=vr*ku[cu], tmpi=vi*ku[cu];
+          for (size_t cv=0; cv<NVEC; ++cv)
+            {
+            auto * DUCC0_RESTRICT pxr = p0r+cu*jump+cv*vlen;
+            auto * DUCC0_RESTRICT pxi = p0i+cu*jump+cv*vlen;
+            auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
+            tr += tmpr*kv[cv];
+            tr.copy_to(pxr,element_aligned_tag());
+            auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
+            ti += tmpi*kv[cv];
+            ti.copy_to(pxi,element_aligned_tag());
+            }
+          }
+        }
+      }
+
+    /*! Computes the (not yet horizontally summed) kernel-weighted sum over
+        the values of image \a img's grid around the visibility prepared
+        in \a hlp. */
+    template<size_t SUPP, typename Thlp> [[gnu::always_inline]] [[gnu::hot]]
+      static void interpolate(const Thlp &hlp, mysimd<Tcalc> &rr, mysimd<Tcalc> &ri,
+      size_t img=0)
+      {
+      constexpr size_t vlen=mysimd<Tcalc>::size();
+      constexpr size_t NVEC((SUPP+vlen-1)/vlen);
+      constexpr int jump = Thlp::lineJump();
+      const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
+      const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+      const auto * DUCC0_RESTRICT p0r = hlp.p0r+img*Thlp::imgJump();
+      const auto * DUCC0_RESTRICT p0i = hlp.p0i+img*Thlp::imgJump();
+      rr = ri = 0;
+      if constexpr (NVEC==1)
+        {
+        for (size_t cu=0; cu<SUPP; ++cu)
+          {
+          const auto * DUCC0_RESTRICT pxr = p0r + cu*jump;
+          const auto * DUCC0_RESTRICT pxi = p0i + cu*jump;
+          rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
+          ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
+          }
+        rr *= kv[0];
+        ri *= kv[0];
+        }
+      else
+        {
+        for (size_t cu=0; cu<SUPP; ++cu)
+          {
+          mysimd<Tcalc> tmpr(0), tmpi(0);
+          for (size_t cv=0; cv<NVEC; ++cv)
+            {
+            const auto * DUCC0_RESTRICT pxr = p0r + cu*jump + vlen*cv;
+            const auto * DUCC0_RESTRICT pxi = p0i + cu*jump + vlen*cv;
+            tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
+            tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+            }
+          rr += ku[cu]*tmpr;
+          ri += ku[cu]*tmpi;
+          }
+        }
+      }
+
     void compute_phases(vector<complex<Tcalc>> &phases, vector<Tcalc> &buf,
       Tcalc imflip, const UVW &bcoord, const RowchanRange &rcr)
       {
@@ -1132,25 +1299,29 @@ timers.pop();
                       });
       }
 
+    // grid holds npl consecutive w planes (starting at p0), each consisting
+    // of nimg() images
     template<size_t SUPP, bool wgrid> [[gnu::hot]] void x2grid_c_helper
-      (size_t supp, const vmav<complex<Tcalc>,2> &grid, size_t p0, double w0)
+      (size_t supp, const vmav<complex<Tcalc>,3> &grid, size_t p0, double w0,
+      size_t npl)
       {
       if constexpr (SUPP>=8)
-        if (supp<=SUPP/2) return x2grid_c_helper<SUPP/2, wgrid>(supp, grid, p0, w0);
+        if (supp<=SUPP/2) return x2grid_c_helper<SUPP/2, wgrid>(supp, grid, p0, w0, npl);
       if constexpr (SUPP>4)
-        if (supp<SUPP) return x2grid_c_helper<SUPP-1, wgrid>(supp, grid, p0, w0);
+        if (supp<SUPP) return x2grid_c_helper<SUPP-1, wgrid>(supp, grid, p0, w0, npl);
       MR_assert(supp==SUPP, "requested support out of range");
 
+      bool multi = ms_multi.size()!=0;
+      size_t ncorr = ms_multi.shape(0), nterm = taylor.shape(0);
+      size_t ni = nimg();
       vector<Mutex> locks(nu);
 
       execDynamic(blockstart.size(), nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
         {
-        constexpr auto vlen=mysimd<Tacc>::size();
-        constexpr auto NVEC((SUPP+vlen-1)/vlen);
-        HelperX2g2<SUPP,wgrid> hlp(this, grid, locks, w0, dw);
-        constexpr auto jump = hlp.lineJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
+        vector<unique_ptr<HelperX2g2<SUPP,wgrid>>> hlps;
+        for (size_t pl=0; pl<npl; ++pl)
+          hlps.push_back(make_unique<HelperX2g2<SUPP,wgrid>>(this,
+            subarray<3>(grid, {{pl*ni, (pl+1)*ni}, {}, {}}), locks, w0+pl*dw, dw));
         vector<complex<Tcalc>> phases;
         vector<Tcalc> buf;
 
@@ -1158,10 +1329,12 @@ timers.pop();
           {
 //auto ix = ix_+ranges.size()/2; if (ix>=ranges.size()) ix -=ranges.size();
           const auto &uvwidx(blockstart[ix].first);
-          if ((!wgrid) || ((uvwidx.minplane+SUPP>p0)&&(uvwidx.minplane<=p0)))
+          if ((!wgrid) || ((uvwidx.minplane+SUPP>p0)&&(uvwidx.minplane<p0+npl)))
             {
 //bool lastplane = (!wgrid) || (uvwidx.minplane+SUPP-1==p0);
-            size_t nth = p0-uvwidx.minplane;
+            // planes of this batch touched by the visibilities of this block
+            size_t plo = wgrid ? max<size_t>(p0, uvwidx.minplane) : p0;
+            size_t phi = wgrid ? min<size_t>(p0+npl, uvwidx.minplane+SUPP) : p0+1;
             size_t iend = (ix+1<blockstart.size()) ? blockstart[ix+1].second : ranges.size();
             for (size_t cnt=blockstart[ix].second; cnt<iend; ++cnt)
               {
@@ -1170,7 +1343,8 @@ timers.pop();
                 {
                 const auto &nextrcr(ranges[cnt+1]);
                 DUCC0_PREFETCH_R(&wgt(nextrcr.row, nextrcr.ch_begin));
-                DUCC0_PREFETCH_R(&ms_in(nextrcr.row, nextrcr.ch_begin));
+                if (!multi)
+                  DUCC0_PREFETCH_R(&ms_in(nextrcr.row, nextrcr.ch_begin));
                 bl.prefetchRow(nextrcr.row);
                 }
               size_t row = rcr.row;
@@ -1181,45 +1355,34 @@ timers.pop();
               for (size_t ch=rcr.ch_begin; ch<rcr.ch_end; ++ch)
                 {
                 auto coord = bcoord*bl.ffact(ch);
-                hlp.prep(coord, nth);
-                auto v(ms_in(row, ch));
-                if (shifting)
-                  v*=phases[ch-rcr.ch_begin];
-                v*=wgt(row, ch);
-
-                if constexpr (NVEC==1)
-                  {
-                  mysimd<Tacc> vr=v.real()*kv[0], vi=v.imag()*imflip*kv[0];
-                  for (size_t cu=0; cu<SUPP; ++cu)
-                    {
-                    auto * DUCC0_RESTRICT pxr = hlp.p0r+cu*jump;
-                    auto * DUCC0_RESTRICT pxi = hlp.p0i+cu*jump;
-                    auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
-                    auto ti = mysimd<Tacc>(pxi,element_aligned_tag());
-                    tr += vr*ku[cu];
-                    ti += vi*ku[cu];
-                    tr.copy_to(pxr,element_aligned_tag());
-                    ti.copy_to(pxi,element_aligned_tag());
-                    }
-                  }
-                else
+                for (size_t pl=plo; pl<phi; ++pl)
                   {
-                  mysimd<Tacc> vr(v.real()), vi(v.imag()*imflip);
-                  for (size_t cu=0; cu<SUPP; ++cu)
+                  auto &hlp(*hlps[pl-p0]);
+                  hlp.prep(coord, wgrid ? pl-uvwidx.minplane : 0);
+                  if (multi)
                     {
-                    mysimd<Tacc> tmpr=vr*ku[cu], tmpi=vi*ku[cu];
-                    for (size_t cv=0; cv<NVEC; ++cv)
+                    // kernel weights are computed once and reused for every
+                    // correlation and Taylor term of this visibility
+                    complex<Tcalc> fct(wgt(row, ch));
+                    if (shifting)
+                      fct*=phases[ch-rcr.ch_begin];
+                    for (size_t c=0; c<ncorr; ++c)
                       {
-                      auto * DUCC0_RESTRICT pxr = hlp.p0r+cu*jump+cv*hlp.vlen;
-                      auto * DUCC0_RESTRICT pxi = hlp.p0i+cu*jump+cv*hlp.vlen;
-                      auto tr = mysimd<Tacc>(pxr,element_aligned_tag());
-                      tr += tmpr*kv[cv];
-                      tr.copy_to(pxr,element_aligned_tag());
-                      auto ti = mysimd<Tacc>(pxi, element_aligned_tag());
-                      ti += tmpi*kv[cv];
-                      ti.copy_to(pxi,element_aligned_tag());
+                      auto v = complex<Tcalc>(ms_multi(c, row, ch))*fct;
+                      for (size_t t=0; t<nterm; ++t)
+                        {
+                        Tcalc tw = taylor(t, ch);
+                        spread<SUPP>(hlp, Tacc(v.real()*tw),
+                          Tacc(v.imag()*imflip*tw), c*nterm+t);
+                        }
                       }
+                    continue;
                     }
+                  auto v(ms_in(row, ch));
+                  if (shifting)
+                    v*=phases[ch-rcr.ch_begin];
+                  v*=wgt(row, ch);
+                  spread<SUPP>(hlp, Tacc(v.real()), Tacc(v.imag()*imflip));
                   }
                 }
               }
@@ -1228,16 +1391,19 @@ timers.pop();
         });
       }
 
-    template<bool wgrid> void x2grid_c(const vmav<complex<Tcalc>,2> &grid,
+    template<bool wgrid> void x2grid_c(const vmav<complex<Tcalc>,3> &grid,
       size_t p0, double w0=-1)
       {
-      checkShape(grid.shape(), {nu, nv});
+      size_t npl = grid.shape(0)/nimg();
+      checkShape(grid.shape(), {npl*nimg(), nu, nv});
+      MR_assert(wgrid || (npl==1), "only one plane allowed without w-gridding");
       constexpr size_t maxsupp = is_same<Tacc, double>::value ? 16 : 8;
-      x2grid_c_helper<maxsupp, wgrid>(supp, grid, p0, w0);
+      x2grid_c_helper<maxsupp, wgrid>(supp, grid, p0, w0, npl);
       }
 
+    // grid holds the w plane p0 of nimg() images
     template<size_t SUPP, bool wgrid> [[gnu::hot]] void grid2x_c_helper
-      (size_t supp, const cmav<complex<Tcalc>,2> &grid, size_t p0, double w0)
+      (size_t supp, const cmav<complex<Tcalc>,3> &grid, size_t p0, double w0)
       {
       if constexpr (SUPP>=8)
         if (supp<=SUPP/2) return grid2x_c_helper<SUPP/2, wgrid>(supp, grid, p0, w0);
@@ -1245,15 +1411,13 @@ timers.pop();
         if (supp<SUPP) return grid2x_c_helper<SUPP-1, wgrid>(supp, grid, p0, w0);
       MR_assert(supp==SUPP, "requested support out of range");
 
+      bool multi = ms_multi_out.size()!=0;
+      size_t ncorr = ms_multi_out.shape(0), nterm = taylor.shape(0);
+
       // Loop over sampling points
       execDynamic(blockstart.size(), nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
         {
-        constexpr size_t vlen=mysimd<Tcalc>::size();
-        constexpr size_t NVEC((SUPP+vlen-1)/vlen);
         HelperG2x2<SUPP,wgrid> hlp(this, grid, w0, dw);
-        constexpr int jump = hlp.lineJump();
-        const auto * DUCC0_RESTRICT ku = hlp.buf.scalar;
-        const auto * DUCC0_RESTRICT kv = hlp.buf.simd+NVEC;
         vector<complex<Tcalc>> phases;
         vector<Tcalc> buf;
 
@@ -1273,8 +1437,11 @@ timers.pop();
                 {
                 const auto &nextrcr(ranges[cnt+1]);
                 DUCC0_PREFETCH_R(&wgt(nextrcr.row, nextrcr.ch_begin));
-                DUCC0_PREFETCH_R(&ms_out(nextrcr.row, nextrcr.ch_begin));
-                DUCC0_PREFETCH_W(&ms_out(nextrcr.row, nextrcr.ch_begin));
+                if (!multi)
+                  {
+                  DUCC0_PREFETCH_R(&ms_out(nextrcr.row, nextrcr.ch_begin));
+                  DUCC0_PREFETCH_W(&ms_out(nextrcr.row, nextrcr.ch_begin));
+                  }
                 bl.prefetchRow(nextrcr.row);
                 }
               size_t row = rcr.row;
@@ -1286,35 +1453,34 @@ timers.pop();
                 {
                 auto coord = bcoord*bl.ffact(ch);
                 hlp.prep(coord, nth);
-                mysimd<Tcalc> rr=0, ri=0;
-                if constexpr (NVEC==1)
+                if (multi)
                   {
-                  for (size_t cu=0; cu<SUPP; ++cu)
+                  // kernel weights are computed once and reused for every
+                  // correlation and Taylor term of this visibility
+                  complex<Tcalc> fct(wgt(row, ch));
+                  if (shifting&&lastplane)
+                    fct*=phases[ch-rcr.ch_begin];
+                  for (size_t c=0; c<ncorr; ++c)
                     {
-                    const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump;
-                    const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump;
-                    rr += mysimd<Tcalc>(pxr,element_aligned_tag())*ku[cu];
-                    ri += mysimd<Tcalc>(pxi,element_aligned_tag())*ku[cu];
-                    }
-                  rr *= kv[0];
-                  ri *= kv[0];
-                  }
-                else
-                  {
-                  for (size_t cu=0; cu<SUPP; ++cu)
-                    {
-                    mysimd<Tcalc> tmpr(0), tmpi(0);
-                    for (size_t cv=0; cv<NVEC; ++cv)
+                    mysimd<Tcalc> sr=0, si=0;
+                    for (size_t t=0; t<nterm; ++t)
                       {
-                      const auto * DUCC0_RESTRICT pxr = hlp.p0r + cu*jump + hlp.vlen*cv;
-                      const auto * DUCC0_RESTRICT pxi = hlp.p0i + cu*jump + hlp.vlen*cv;
-                      tmpr += kv[cv]*mysimd<Tcalc>(pxr,element_aligned_tag());
-                      tmpi += kv[cv]*mysimd<Tcalc>(pxi,element_aligned_tag());
+                      mysimd<Tcalc> rr, ri;
+                      interpolate<SUPP>(hlp, rr, ri, c*nterm+t);
+                      Tcalc tw = taylor(t, ch);
+                      sr += rr*tw;
+                      si += ri*tw;
                       }
-                    rr += ku[cu]*tmpr;
-                    ri += ku[cu]*tmpi;
+                    si *= imflip;
+                    auto r = hsum_cmplx<Tcalc>(sr,si);
+                    if (!firstplane) r += complex<Tcalc>(ms_multi_out(c, row, ch));
+                    if (lastplane) r *= fct;
+                    ms_multi_out(c, row, ch) = complex<Tms>(r);
                     }
+                  continue;
                   }
+                mysimd<Tcalc> rr, ri;
+                interpolate<SUPP>(hlp, rr, ri);
                 ri *= imflip;
                 auto r = hsum_cmplx<Tcalc>(rr,ri);
                 if (!firstplane) r += ms_out(row, ch);
@@ -1330,17 +1496,113 @@ timers.pop();
         });
       }
 
-    template<bool wgrid> void grid2x_c(const cmav<complex<Tcalc>,2> &grid,
+    template<bool wgrid> void grid2x_c(const cmav<complex<Tcalc>,3> &grid,
       size_t p0, double w0=-1)
       {
-      checkShape(grid.shape(), {nu, nv});
+      checkShape(grid.shape(), {nimg(), nu, nv});
       constexpr size_t maxsupp = is_same<Tcalc, double>::value ? 16 : 8;
       grid2x_c_helper<maxsupp, wgrid>(supp, grid, p0, w0);
       }
 
-    void apply_global_corrections(const vmav<Timg,2> &dirty)
+    /*! Degrids the visibilities from \a grid_in (w plane \a p_in),
+        multiplies them by their squared weights and grids them onto
+        \a grid_out (w plane \a p_in+1-supp), without storing them in an
+        (nrow, nchan) array.
+        With w-gridding, a visibility is only complete after it has been
+        degridded from all its planes, so the partial sums are kept in the
+        ring buffer \a vbuf until they have been gridded onto the first
+        output plane. \a blockofs holds the position of every block's first
+        visibility in the (minplane-major) visibility order. */
+    template<size_t SUPP, bool wgrid> [[gnu::hot]] void x2x_c_helper
+      (size_t supp, const cmav<complex<Tcalc>,2> &grid_in,
+      const vmav<complex<Tcalc>,2> &grid_out, size_t p_in, double w_in,
+      double w_out, const vector<size_t> &blockofs,
+      const vmav<complex<Tcalc>,1> &vbuf)
+      {
+      if constexpr (SUPP>=8)
+        if (supp<=SUPP/2) return x2x_c_helper<SUPP/2, wgrid>(supp, grid_in, grid_out, p_in, w_in, w_out, blockofs, vbuf);
+      if constexpr (SUPP>4)
+        if (supp<SUPP) return x2x_c_helper<SUPP-1, wgrid>(supp, grid_in, grid_out, p_in, w_in, w_out, blockofs, vbuf);
+      MR_assert(supp==SUPP, "requested support out of range");
+
+      vector<Mutex> locks(nu);
+
+      execDynamic(blockstart.size(), nthreads, wgrid ? SUPP : 1, [&](Scheduler &sched)
+        {
+        HelperG2x2<SUPP,wgrid> hlp_in(this, grid_in.prepend_1(), w_in, dw);
+        HelperX2g2<SUPP,wgrid> hlp_out(this, grid_out.prepend_1(), locks, w_out, dw);
+        size_t nbuf = vbuf.shape(0);
+
+        while (auto rng=sched.getNext()) for(auto ix=rng.lo; ix<rng.hi; ++ix)
+          {
+          size_t mp = blockstart[ix].first.minplane;
+          bool do_in = (!wgrid) || ((mp<=p_in)&&(p_in<mp+SUPP));
+          bool do_out = (!wgrid) || ((mp+SUPP<=p_in+1)&&(p_in+1<mp+2*SUPP));
+          if (!(do_in||do_out)) continue;
+          size_t nth_in = p_in-mp, nth_out = p_in+1-SUPP-mp;
+          size_t ibuf = wgrid ? blockofs[ix]%nbuf : 0;
+          size_t iend = (ix+1<blockstart.size()) ? blockstart[ix+1].second : ranges.size();
+          for (size_t cnt=blockstart[ix].second; cnt<iend; ++cnt)
+            {
+            const auto &rcr(ranges[cnt]);
+            if (cnt+1<iend)
+              {
+              const auto &nextrcr(ranges[cnt+1]);
+              DUCC0_PREFETCH_R(&wgt(nextrcr.row, nextrcr.ch_begin));
+              bl.prefetchRow(nextrcr.row);
+              }
+            size_t row = rcr.row;
+            auto bcoord = bl.baseCoord(row);
+            // the phase factors and imaginary sign flips of degridding and
+            // gridding cancel, so they are not applied at all
+            bcoord.FixW();
+            for (size_t ch=rcr.ch_begin; ch<rcr.ch_end; ++ch)
+              {
+              auto coord = bcoord*bl.ffact(ch);
+              complex<Tcalc> v;
+              if (do_in)
+                {
+                hlp_in.prep(coord, nth_in);
+                mysimd<Tcalc> rr, ri;
+                interpolate<SUPP>(hlp_in, rr, ri);
+                v = hsum_cmplx<Tcalc>(rr,ri);
+                if constexpr (wgrid)
+                  {
+                  if (nth_in!=0) v += vbuf(ibuf);
+                  vbuf(ibuf) = v;
+                  }
+                }
+              else
+                v = vbuf(ibuf);
+              if (do_out)
+                {
+                hlp_out.prep(coord, nth_out);
+                auto fct = Tcalc(wgt(row, ch))*Tcalc(wgt(row, ch));
+                spread<SUPP>(hlp_out, Tacc(v.real()*fct), Tacc(v.imag()*fct));
+                }
+              if constexpr (wgrid)
+                if (++ibuf==nbuf) ibuf=0;
+              }
+            }
+          }
+        });
+      }
+
+    template<bool wgrid> void x2x_c(const cmav<complex<Tcalc>,2> &grid_in,
+      const vmav<complex<Tcalc>,2> &grid_out, size_t p_in, double w_in,
+      double w_out, const vector<size_t> &blockofs,
+      const vmav<complex<Tcalc>,1> &vbuf)
+      {
+      checkShape(grid_in.shape(), {nu, nv});
+      checkShape(grid_out.shape(), {nu, nv});
+      constexpr size_t maxsupp = is_same<Tcalc, double>::value ? 16 : 8;
+      x2x_c_helper<maxsupp, wgrid>(supp, grid_in, grid_out, p_in, w_in, w_out, blockofs, vbuf);
+      }
+
+    void apply_global_corrections(const vmav<Timg,3> &dirty)
       {
       timers.push("global corrections");
+      size_t nimg = dirty.shape(0);
       double x0 = lshift-0.5*nxdirty*pixsize_x,
              y0 = mshift-0.5*nydirty*pixsize_y;
       auto cfu = krn->corfunc(nxdirty/2+1, 1./nu, nthreads);
@@ -1371,21 +1633,25 @@ timers.pop();
               {
               auto i2=min(i, nxdirty-i), j2=min(j, nydirty-j);
               fct *= cfu[nxdirty/2-i2]*cfv[nydirty/2-j2];
-              dirty(i,j)*=Timg(fct);
+              for (size_t k=0; k<nimg; ++k)
+                dirty(k,i,j)*=Timg(fct);
               }
             else
               {
               fct *= cfu[nxdirty/2-i]*cfv[nydirty/2-j];
               size_t i2 = nxdirty-i, j2 = nydirty-j;
-              dirty(i,j)*=Timg(fct);
-              if ((i>0)&&(i<i2))
+              for (size_t k=0; k<nimg; ++k)
                 {
-                dirty(i2,j)*=Timg(fct);
+                dirty(k,i,j)*=Timg(fct);
+                if ((i>0)&&(i<i2))
+                  {
+                  dirty(k,i2,j)*=Timg(fct);
+                  if ((j>0)&&(j<j2))
+                    dirty(k,i2,j2)*=Timg(fct);
+                  }
                 if ((j>0)&&(j<j2))
-                  dirty(i2,j2)*=Timg(fct);
+                  dirty(k,i,j2)*=Timg(fct);
                 }
-              if ((j>0)&&(j<j2))
-                dirty(i,j2)*=Timg(fct);
               }
             }
           }
@@ -1401,7 +1667,11 @@ timers.pop();
            << "dirty=(" << nxdirty << "x" << nydirty << "), "
            << "grid=(" << nu << "x" << nv;
       if (do_wgridding) cout << "x" << nplanes;
-      cout << "), supp=" << supp
+      cout << ")";
+      if (gridding && (plane_batch()>1))
+        cout << ", planes per batch=" << plane_batch();
+      if (nimg()>1) cout << ", nimg=" << nimg();
+      cout << ", supp=" << supp
            << ", eps=" << epsilon
            << endl;
       cout << "  nrow=" << bl.Nrows() << ", nchan=" << bl.Nchannels()
@@ -1411,68 +1681,162 @@ timers.pop();
              << ", dw=" << dw << ", (wmax-wmin)/dw=" << (wmax_d-wmin_d)/dw << endl;
       size_t ovh0 = ranges.size()*sizeof(ranges[0]);
       ovh0 += blockstart.size()*sizeof(blockstart[0]);
-      size_t ovh1 = nu*nv*sizeof(complex<Tcalc>);             // grid
+      size_t ovh1 = (acc_grid.size()!=0) ? acc_grid.size()*sizeof(complex<Tcalc>)
+                  : (gridding ? plane_batch() : 1)
+                    *nimg()*nu*nv*sizeof(complex<Tcalc>);    // grid
       if (!do_wgridding)
-        ovh1 += nu*nv*sizeof(Tcalc);                          // rgrid
+        ovh1 += (gridding ? nimg() : 1)*nu*nv*sizeof(Tcalc); // rgrid
       if (!gridding)
-        ovh1 += nxdirty*nydirty*sizeof(Timg);                 // tdirty
+        ovh1 += nimg()*nxdirty*nydirty*sizeof(Timg);          // tdirty
       cout << "  memory overhead: "
            << ovh0/double(1<<30) << "GB (index) + "
            << ovh1/double(1<<30) << "GB (2D arrays)" << endl;
       }
 
-    void x2dirty()
+    void x2dirty(const vmav<Timg,3> &dirty)
       {
       if (do_wgridding)
         {
         timers.push("zeroing dirty image");
-        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty);
         timers.poppush("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv});
+        // Several w planes can be processed at once if memory permits; this
+        // gives the FFTs and the w-screen application more independent work
+        // to distribute over the threads than a single plane.
+        size_t nbatch = plane_batch();
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({nbatch*nimg(),nu,nv});
         timers.pop();
-        for (size_t pl=0; pl<nplanes; ++pl)
+        for (size_t pl=0; pl<nplanes; pl+=nbatch)
           {
           double w = wmin+pl*dw;
+          size_t npl = min(nbatch, nplanes-pl);
+          auto gsub = subarray<3>(grid, {{0, npl*nimg()}, {}, {}});
           timers.push("gridding proper");
-          x2grid_c<true>(grid, pl, w);
+          x2grid_c<true>(gsub, pl, w);
           timers.pop();
-          grid2dirty_c_overwrite_wscreen_add(grid, dirty_out, w, pl);
+          grid2dirty_c_overwrite_wscreen_add(gsub, dirty, w, pl);
           }
         // correct for w gridding etc.
-        apply_global_corrections(dirty_out);
+        apply_global_corrections(dirty);
         }
       else
         {
         timers.push("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv});
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({nimg(),nu,nv});
         timers.poppush("gridding proper");
         x2grid_c<false>(grid, 0);
         timers.poppush("allocating rgrid");
-        auto rgrid = vmav<Tcalc,2>::build_noncritical(grid.shape(), UNINITIALIZED);
+        auto rgrid = vmav<Tcalc,3>::build_noncritical(grid.shape(), UNINITIALIZED);
         timers.poppush("complex2hartley");
-        complex2hartley(grid, rgrid, nthreads);
+        for (size_t k=0; k<grid.shape(0); ++k)
+          {
+          auto gsub = subarray<2>(grid, {{k},{},{}});
+          auto rsub = subarray<2>(rgrid, {{k},{},{}});
+          complex2hartley(gsub, rsub, nthreads);
+          }
         timers.pop();
-        grid2dirty_overwrite(rgrid, dirty_out);
+        grid2dirty_overwrite(rgrid, dirty);
         }
       }
 
-    void dirty2x()
+    void dirty2dirty_internal(const cmav<Timg,2> &dirty_in_, const vmav<Timg,2> &dirty_out_)
       {
       if (do_wgridding)
         {
         timers.push("copying dirty image");
         vmav<Timg,2> tdirty({nxdirty,nydirty}, UNINITIALIZED);
-        mav_apply([](Timg &a, const Timg &b) {a=b;}, nthreads, tdirty, dirty_in);
+        mav_apply([](Timg &a, const Timg &b) {a=b;}, nthreads, tdirty, dirty_in_);
+        timers.pop();
+        apply_global_corrections(tdirty.prepend_1());
+        timers.push("zeroing dirty image");
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out_);
+        timers.poppush("visibility buffer setup");
+        // Number the visibilities by minplane. While input plane p is
+        // processed, only those with minplane in [p+2-2*supp; p] are in use,
+        // so a ring buffer covering 2*supp-1 consecutive minplanes suffices.
+        vector<size_t> blockofs(blockstart.size()), planeofs(nplanes+1, 0);
+        for (size_t ix=0; ix<blockstart.size(); ++ix)
+          {
+          size_t mp = blockstart[ix].first.minplane;
+          size_t iend = (ix+1<blockstart.size()) ? blockstart[ix+1].second : ranges.size();
+          blockofs[ix] = planeofs[mp+1];
+          for (size_t i=blockstart[ix].second; i<iend; ++i)
+            planeofs[mp+1] += ranges[i].nchan();
+          }
+        for (size_t i=1; i<planeofs.size(); ++i)
+          planeofs[i] += planeofs[i-1];
+        for (size_t ix=0; ix<blockstart.size(); ++ix)
+          blockofs[ix] += planeofs[blockstart[ix].first.minplane];
+        size_t nbuf=1;
+        for (size_t p=0; p<nplanes; ++p)
+          nbuf = max(nbuf, planeofs[min(nplanes, p+2*supp-1)]-planeofs[p]);
+        if (verbosity>0)
+          cout << "  visibility buffer: " << nbuf << "/" << nvis << " entries"
+               << endl;
+        vmav<complex<Tcalc>,1> vbuf({nbuf}, UNINITIALIZED);
+        timers.poppush("allocating grid");
+        auto grid_in = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv}, UNINITIALIZED);
+        auto grid_out = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv});
+        timers.pop();
+        // the output planes lag supp-1 planes behind the input planes
+        for (size_t p=0; p+1<nplanes+supp; ++p)
+          {
+          double w_in = wmin+p*dw;
+          double w_out = w_in-(supp-1)*dw;
+          if (p<nplanes)
+            dirty2grid_c_wscreen(tdirty, grid_in, w_in, p);
+          timers.push("degridding/gridding proper");
+          x2x_c<true>(grid_in, grid_out, p, w_in, w_out, blockofs, vbuf);
+          timers.pop();
+          if (p+1>=supp)
+            grid2dirty_c_overwrite_wscreen_add(grid_out.prepend_1(),
+              dirty_out_.prepend_1(), w_out, p+1-supp);
+          }
+        apply_global_corrections(dirty_out_.prepend_1());
+        }
+      else
+        {
+        timers.push("allocating grid");
+        auto rgrid = vmav<Tcalc,2>::build_noncritical({nu,nv}, UNINITIALIZED);
+        timers.pop();
+        dirty2grid(dirty_in_, rgrid);
+        timers.push("allocating grid");
+        auto grid_in = vmav<complex<Tcalc>,2>::build_noncritical(rgrid.shape());
+        timers.poppush("hartley2complex");
+        hartley2complex(rgrid, grid_in, nthreads);
+        timers.poppush("allocating grid");
+        auto grid_out = vmav<complex<Tcalc>,2>::build_noncritical(rgrid.shape());
+        timers.poppush("degridding/gridding proper");
+        x2x_c<false>(grid_in, grid_out, 0, -1, -1, {},
+          vmav<complex<Tcalc>,1>::build_empty());
+        timers.poppush("complex2hartley");
+        complex2hartley(grid_out, rgrid, nthreads);
+        timers.pop();
+        grid2dirty_overwrite(rgrid.prepend_1(), dirty_out_.prepend_1());
+        }
+      }
+
+    void dirty2x(const cmav<Timg,3> &dirty)
+      {
+      size_t ni = dirty.shape(0);
+      checkShape(dirty.shape(), {nimg(), nxdirty, nydirty});
+      if (do_wgridding)
+        {
+        timers.push("copying dirty image");
+        vmav<Timg,3> tdirty({ni,nxdirty,nydirty}, UNINITIALIZED);
+        mav_apply([](Timg &a, const Timg &b) {a=b;}, nthreads, tdirty, dirty);
         timers.pop();
         // correct for w gridding etc.
         apply_global_corrections(tdirty);
         timers.push("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical({nu,nv}, UNINITIALIZED);
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({ni,nu,nv}, UNINITIALIZED);
         timers.pop();
         for (size_t pl=0; pl<nplanes; ++pl)
           {
           double w = wmin+pl*dw;
-          dirty2grid_c_wscreen(tdirty, grid, w, pl);
+          for (size_t k=0; k<ni; ++k)
+            dirty2grid_c_wscreen(subarray<2>(tdirty, {{k},{},{}}),
+              subarray<2>(grid, {{k},{},{}}), w, pl);
           timers.push("degridding proper");
           grid2x_c<true>(grid, pl, w);
           timers.pop();
@@ -1482,13 +1846,17 @@ timers.pop();
         {
         timers.push("allocating grid");
         auto rgrid = vmav<Tcalc,2>::build_noncritical({nu,nv}, UNINITIALIZED);
+        auto grid = vmav<complex<Tcalc>,3>::build_noncritical({ni,nu,nv});
         timers.pop();
-        dirty2grid(dirty_in, rgrid);
-        timers.push("allocating grid");
-        auto grid = vmav<complex<Tcalc>,2>::build_noncritical(rgrid.shape());
-        timers.poppush("hartley2complex");
-        hartley2complex(rgrid, grid, nthreads);
-        timers.poppush("degridding proper");
+        for (size_t k=0; k<ni; ++k)
+          {
+          dirty2grid(subarray<2>(dirty, {{k},{},{}}), rgrid);
+          timers.push("hartley2complex");
+          auto gsub = subarray<2>(grid, {{k},{},{}});
+          hartley2complex(rgrid, gsub, nthreads);
+          timers.pop();
+          }
+        timers.push("degridding proper");
         grid2x_c<false>(grid, 0);
         timers.pop();
         }
@@ -1618,6 +1986,65 @@ timers.pop();
       timers.pop();
       }
 
+    // everything that only depends on the uv coverage and the image geometry
+    void prepare(const cmav<double,2> &uvw, const cmav<double,1> &freq)
+      {
+      timers.push("Baseline construction");
+      bl = Baselines(uvw, freq, negate_v);
+      MR_assert(bl.Nrows()<(uint64_t(1)<<32), "too many rows in the MS");
+      MR_assert(bl.Nchannels()<(uint64_t(1)<<16), "too many channels in the MS");
+      timers.pop();
+      scanData();
+      if (nvis==0) return;
+      setupGeometry(bl.Vmax());
+      countRanges();
+      }
+
+    // grid dimensions, kernel and w planes; depends on the extent of the
+    // data only via wmin_d, wmax_d, nvis and vmax
+    void setupGeometry(double vmax)
+      {
+      auto kidx = getNuNv();
+      MR_assert((nu>>log2tile)<(size_t(1)<<16), "nu too large");
+      MR_assert((nv>>log2tile)<(size_t(1)<<16), "nv too large");
+      ofactor = min(double(nu)/nxdirty, double(nv)/nydirty);
+      krn = selectKernel(kidx);
+      supp = krn->support();
+      nsafe = (supp+1)/2;
+      ushift = supp*(-0.5)+1+nu;
+      vshift = supp*(-0.5)+1+nv;
+      maxiu0 = (nu+nsafe)-supp;
+      maxiv0 = (nv+nsafe)-supp;
+      vlim = min(nv/2, size_t(nv*vmax*pixsize_y+0.5*supp+1));
+      uv_side_fast = true;
+      size_t vlim2 = (nydirty+1)/2+(supp+1)/2;
+      if (vlim2<vlim)
+        {
+        vlim = vlim2;
+        uv_side_fast = false;
+        }
+      MR_assert(nu>=2*nsafe, "nu too small");
+      MR_assert(nv>=2*nsafe, "nv too small");
+      MR_assert((nxdirty&1)==0, "nx_dirty must be even");
+      MR_assert((nydirty&1)==0, "ny_dirty must be even");
+      MR_assert((nu&1)==0, "nu must be even");
+      MR_assert((nv&1)==0, "nv must be even");
+      MR_assert(epsilon>0, "epsilon must be positive");
+      MR_assert(pixsize_x>0, "pixsize_x must be positive");
+      MR_assert(pixsize_y>0, "pixsize_y must be positive");
+      if (do_wgridding)
+        {
+        dw = 0.5/ofactor/max(abs(nm1max+nshift), abs(nm1min+nshift));
+        xdw = 1./dw;
+        nplanes = size_t((wmax_d-wmin_d)/dw+supp);
+        MR_assert(nplanes<(size_t(1)<<16), "too many w planes");
+        wmin = (wmin_d+wmax_d)*0.5 - 0.5*(nplanes-1)*dw;
+        wshift = dw-(0.5*supp*dw)-wmin;
+        }
+      else
+        dw = wmin  = xdw = wshift = nplanes = 0;
+      }
+
   public:
     Wgridder(const cmav<double,2> &uvw, const cmav<double,1> &freq,
            const cmav<complex<Tms>,2> &ms_in_, const vmav<complex<Tms>,2> &ms_out_,
@@ -1633,6 +2060,11 @@ timers.pop();
         dirty_in(dirty_in_), dirty_out(dirty_out_),
         wgt(wgt_), mask(mask_),
         lmask(gridding ? ms_in.shape() : ms_out.shape()),
+        ms_multi(vmav<complex<Tms>,3>::build_empty()),
+        ms_multi_out(vmav<complex<Tms>,3>::build_empty()),
+        taylor(vmav<Tms,2>::build_empty()),
+        sfreq(vmav<double,1>::build_empty()),
+        acc_grid(vmav<complex<Tcalc>,3>::build_empty()),
         pixsize_x(pixsize_x_), pixsize_y(pixsize_y_),
         nxdirty(gridding ? dirty_out.shape(0) : dirty_in.shape(0)),
         nydirty(gridding ? dirty_out.shape(1) : dirty_in.shape(1)),
@@ -1642,53 +2074,385 @@ timers.pop();
         verbosity(verbosity_),
         negate_v(negate_v_), divide_by_n(divide_by_n_),
         sigma_min(sigma_min_), sigma_max(sigma_max_),
+        max_grid_mem(0),
+        lshift(center_x), mshift(negate_v ? -center_y : center_y),
+        lmshift((lshift!=0) || (mshift!=0)),
+        no_nshift(!allow_nshift)
+      {
+      prepare(uvw, freq);
+      if (nvis==0)
+        {
+        if (gridding) mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+        return;
+        }
+      report();
+      gridding ? x2dirty(dirty_out.prepend_1()) : dirty2x(dirty_in.prepend_1());
+
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Constructs a reusable plan for the given uv coverage and dirty image
+        geometry. All work that does not depend on the visibility or image
+        values (baseline setup, kernel and grid size selection, sorting of
+        the visibilities into tiles) is done here; subsequent calls to
+        ms2dirty() and dirty2ms() only carry out the actual (de)gridding and
+        FFTs.
+        Visibilities with zero weight or mask are ignored by all executions.
+        \note The plan does not copy \a wgt_ and \a mask_, but accesses them
+        during every execution; the arrays must therefore stay alive and
+        unchanged for the whole lifetime of the plan.
+        \note A plan object must not be executed by several threads
+        simultaneously. */
+    Wgridder(const cmav<double,2> &uvw, const cmav<double,1> &freq,
+           const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_,
+           size_t nxdirty_, size_t nydirty_,
+           double pixsize_x_, double pixsize_y_, double epsilon_,
+           bool do_wgridding_, size_t nthreads_, size_t verbosity_,
+           bool negate_v_, bool divide_by_n_, double sigma_min_,
+           double sigma_max_, double center_x, double center_y, bool allow_nshift)
+      : gridding(true),
+        timers("plan construction"),
+        ms_in(cmav<complex<Tms>,2>::build_uniform({uvw.shape(0),freq.shape(0)}, 1.)),
+        ms_out(vmav<complex<Tms>,2>::build_empty()),
+        dirty_in(vmav<Timg,2>::build_empty()),
+        dirty_out(vmav<Timg,2>::build_empty()),
+        wgt(wgt_.size()!=0 ? wgt_ : wgt_.build_uniform(ms_in.shape(), 1.)),
+        mask(mask_.size()!=0 ? mask_ : mask_.build_uniform(ms_in.shape(), 1)),
+        lmask(ms_in.shape()),
+        ms_multi(vmav<complex<Tms>,3>::build_empty()),
+        ms_multi_out(vmav<complex<Tms>,3>::build_empty()),
+        taylor(vmav<Tms,2>::build_empty()),
+        sfreq(vmav<double,1>::build_empty()),
+        acc_grid(vmav<complex<Tcalc>,3>::build_empty()),
+        pixsize_x(pixsize_x_), pixsize_y(pixsize_y_),
+        nxdirty(nxdirty_), nydirty(nydirty_),
+        epsilon(epsilon_),
+        do_wgridding(do_wgridding_),
+        nthreads(adjust_nthreads(nthreads_)),
+        verbosity(verbosity_),
+        negate_v(negate_v_), divide_by_n(divide_by_n_),
+        sigma_min(sigma_min_), sigma_max(sigma_max_),
+        max_grid_mem(0),
+        lshift(center_x), mshift(negate_v ? -center_y : center_y),
+        lmshift((lshift!=0) || (mshift!=0)),
+        no_nshift(!allow_nshift)
+      {
+      prepare(uvw, freq);
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Constructs an accumulator for visibilities which arrive in chunks
+        (e.g. in time order) and cannot be held in memory all at once.
+        Every call of add() grids a chunk onto persistent uv grids (one per
+        w plane if \a do_wgridding_ is set), and finalize() computes the dirty
+        image from them, so the memory consumption is determined by the grid
+        size rather than by the amount of data.
+        Since the data are not known in advance, the w planes are set up for
+        all visibilities with |w|<=\a wmax (in meters) at the frequencies
+        \a freq. The kernel is chosen for an expected total number of
+        \a nvis_estimate visibilities; if this is 0, the kernel with the
+        smallest grids is used, which minimizes memory but makes gridding
+        more expensive.
+        \note An accumulator object must not be used by several threads
+        simultaneously. */
+    Wgridder(const cmav<double,1> &freq, double wmax, size_t nvis_estimate,
+           size_t nxdirty_, size_t nydirty_,
+           double pixsize_x_, double pixsize_y_, double epsilon_,
+           bool do_wgridding_, size_t nthreads_, size_t verbosity_,
+           bool negate_v_, bool divide_by_n_, double sigma_min_,
+           double sigma_max_, double center_x, double center_y, bool allow_nshift)
+      : gridding(true),
+        timers("accumulator construction"),
+        ms_in(vmav<complex<Tms>,2>::build_empty()),
+        ms_out(vmav<complex<Tms>,2>::build_empty()),
+        dirty_in(vmav<Timg,2>::build_empty()),
+        dirty_out(vmav<Timg,2>::build_empty()),
+        wgt(vmav<Tms,2>::build_empty()),
+        mask(vmav<uint8_t,2>::build_empty()),
+        lmask(vmav<uint8_t,2>::build_empty()),
+        ms_multi(vmav<complex<Tms>,3>::build_empty()),
+        ms_multi_out(vmav<complex<Tms>,3>::build_empty()),
+        taylor(vmav<Tms,2>::build_empty()),
+        sfreq({freq.shape(0)}),
+        acc_grid(vmav<complex<Tcalc>,3>::build_empty()),
+        pixsize_x(pixsize_x_), pixsize_y(pixsize_y_),
+        nxdirty(nxdirty_), nydirty(nydirty_),
+        epsilon(epsilon_),
+        do_wgridding(do_wgridding_),
+        nthreads(adjust_nthreads(nthreads_)),
+        verbosity(verbosity_),
+        negate_v(negate_v_), divide_by_n(divide_by_n_),
+        sigma_min(sigma_min_), sigma_max(sigma_max_),
+        max_grid_mem(0),
         lshift(center_x), mshift(negate_v ? -center_y : center_y),
         lmshift((lshift!=0) || (mshift!=0)),
         no_nshift(!allow_nshift)
       {
+      MR_assert(freq.shape(0)>0, "need at least one channel");
+      MR_assert(wmax>=0, "wmax must be nonnegative");
+      for (size_t i=0; i<freq.shape(0); ++i)
+        sfreq(i) = freq(i);
       timers.push("Baseline construction");
-      bl = Baselines(uvw, freq, negate_v);
+      bl = Baselines(vmav<double,2>({0,3}), sfreq, negate_v);
+      timers.pop();
+      nvis = nvis_estimate;
+      wmin_d = 0;
+      wmax_d = wmax*bl.ffact(bl.Nchannels()-1);
+      // data with |v|>0.5/pixsize_y are aliased anyway, so this does not
+      // restrict the FFT region
+      setupGeometry(0.5/pixsize_y);
+      nvis = 0;
+      timers.push("allocating grid");
+      auto tgrid = vmav<complex<Tcalc>,3>::build_noncritical
+        ({do_wgridding ? nplanes : 1, nu, nv});
+      acc_grid.assign(tgrid);
+      timers.pop();
+      if (verbosity>0)
+        {
+        cout << "Accumulator: grid=(" << nu << "x" << nv;
+        if (do_wgridding) cout << "x" << nplanes;
+        cout << "), supp=" << supp << ", eps=" << epsilon << endl
+             << "  memory: " << acc_grid.size()*sizeof(complex<Tcalc>)/double(1<<30)
+             << "GB" << endl;
+        timers.report(cout);
+        }
+      }
+
+    /*! Grids a chunk of visibilities onto the uv grids of an accumulator.
+        \a uvw has the shape (nrow,3), \a ms, \a wgt_ and \a mask_ the
+        shape (nrow,nchan). Empty \a wgt_ or \a mask_ arrays are
+        interpreted as all ones. The arrays are not referenced after the call
+        returns. */
+    void add(const cmav<double,2> &uvw, const cmav<complex<Tms>,2> &ms,
+      const cmav<Tms,2> &wgt_, const cmav<uint8_t,2> &mask_)
+      {
+      MR_assert(acc_grid.size()!=0, "not an accumulator object");
+      checkShape(uvw.shape(), {uvw.shape(0), 3});
+      checkShape(ms.shape(), {uvw.shape(0), sfreq.shape(0)});
+      timers.reset("gridding chunk");
+      timers.push("Baseline construction");
+      bl = Baselines(uvw, sfreq, negate_v);
       MR_assert(bl.Nrows()<(uint64_t(1)<<32), "too many rows in the MS");
-      MR_assert(bl.Nchannels()<(uint64_t(1)<<16), "too many channels in the MS");
       timers.pop();
+      ms_in.assign(ms);
+      wgt.assign(wgt_.size()!=0 ? wgt_ : wgt_.build_uniform(ms.shape(), 1.));
+      mask.assign(mask_.size()!=0 ? mask_ : mask_.build_uniform(ms.shape(), 1));
+      vmav<uint8_t,2> tlmask(ms.shape());
+      lmask.assign(tlmask);
+      // the w planes are fixed; make sure that the chunk fits into them
+      double wmin_fix=wmin_d, wmax_fix=wmax_d;
       scanData();
+      MR_assert((!do_wgridding) || (nvis==0) || (wmax_d<=wmax_fix*(1+1e-10)),
+        "|w| exceeds the maximum specified at construction");
+      wmin_d = wmin_fix;
+      wmax_d = wmax_fix;
+      if (nvis!=0)
+        {
+        // also accumulates the occupied grid regions of all chunks
+        countRanges();
+        report();
+        timers.push("gridding proper");
+        // Gridding into all planes at once would keep too many local
+        // buffers per thread alive; batches of supp planes work well.
+        if (do_wgridding)
+          for (size_t pl=0; pl<nplanes; pl+=supp)
+            {
+            size_t npl = min(supp, nplanes-pl);
+            x2grid_c<true>(subarray<3>(acc_grid, {{pl, pl+npl}, {}, {}}), pl, wmin+pl*dw);
+            }
+        else
+          x2grid_c<false>(acc_grid, 0);
+        timers.pop();
+        }
+      lmask.dealloc();
+      ms_in.assign(vmav<complex<Tms>,2>::build_empty());
+      wgt.assign(vmav<Tms,2>::build_empty());
+      mask.assign(vmav<uint8_t,2>::build_empty());
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Computes the dirty image from all visibilities passed to add() so
+        far, and resets the accumulator to its initial (empty) state. */
+    void finalize(const vmav<Timg,2> &dirty)
+      {
+      MR_assert(acc_grid.size()!=0, "not an accumulator object");
+      checkShape(dirty.shape(), {nxdirty, nydirty});
+      timers.reset("finalizing");
+      if (do_wgridding)
+        {
+        timers.push("zeroing dirty image");
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty);
+        timers.pop();
+        if (uranges.empty())  // no data added so far
+          {
+          uranges.resize(nplanes);
+          vranges.resize(nplanes);
+          }
+        // zeroes acc_grid as a side effect
+        grid2dirty_c_overwrite_wscreen_add(acc_grid, dirty.prepend_1(), wmin, 0);
+        apply_global_corrections(dirty.prepend_1());
+        uranges.clear();
+        vranges.clear();
+        }
+      else
+        {
+        timers.push("allocating rgrid");
+        auto rgrid = vmav<Tcalc,3>::build_noncritical(acc_grid.shape(), UNINITIALIZED);
+        timers.poppush("complex2hartley");
+        auto gsub = subarray<2>(acc_grid, {{0},{},{}});
+        auto rsub = subarray<2>(rgrid, {{0},{},{}});
+        complex2hartley(gsub, rsub, nthreads);
+        timers.poppush("zeroing grid");
+        quickzero(gsub, nthreads);
+        timers.pop();
+        grid2dirty_overwrite(rgrid, dirty.prepend_1());
+        }
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Grids \a ms onto \a dirty, using the geometry stored in the plan. */
+    void ms2dirty(const cmav<complex<Tms>,2> &ms, const vmav<Timg,2> &dirty)
+      {
+      checkShape(ms.shape(), {bl.Nrows(), bl.Nchannels()});
+      checkShape(dirty.shape(), {nxdirty, nydirty});
+      gridding = true;
+      timers.reset("gridding");
+      ms_in.assign(ms);
+      vmav<Timg,2> tdirty(dirty);
+      dirty_out.assign(tdirty);
       if (nvis==0)
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+      else
         {
-        if (gridding) mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
-        return;
+        report();
+        x2dirty(dirty_out.prepend_1());
         }
-      auto kidx = getNuNv();
-      MR_assert((nu>>log2tile)<(size_t(1)<<16), "nu too large");
-      MR_assert((nv>>log2tile)<(size_t(1)<<16), "nv too large");
-      ofactor = min(double(nu)/nxdirty, double(nv)/nydirty);
-      krn = selectKernel(kidx);
-      supp = krn->support();
-      nsafe = (supp+1)/2;
-      ushift = supp*(-0.5)+1+nu;
-      vshift = supp*(-0.5)+1+nv;
-      maxiu0 = (nu+nsafe)-supp;
-      maxiv0 = (nv+nsafe)-supp;
-      vlim = min(nv/2, size_t(nv*bl.Vmax()*pixsize_y+0.5*supp+1));
-      uv_side_fast = true;
-      size_t vlim2 = (nydirty+1)/2+(supp+1)/2;
-      if (vlim2<vlim)
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Grids the visibilities of several correlations into several images
+        in a single pass over the data.
+        \a ms has the shape (ncorr, nrow, nchan), \a taylor_ the shape
+        (nterm, nchan). Image c*nterm+t of \a dirty (shape
+        (ncorr*nterm, nxdirty, nydirty)) receives correlation c, with each
+        channel multiplied by taylor_(t, channel). If \a taylor_ is empty,
+        a single term of ones is used.
+        The gridding kernel is evaluated only once per visibility, and the
+        FFTs and corrections are carried out for all images together. */
+    void ms2dirty_multi(const cmav<complex<Tms>,3> &ms,
+      const cmav<Tms,2> &taylor_, const vmav<Timg,3> &dirty)
+      {
+      size_t nrow=bl.Nrows(), nchan=bl.Nchannels();
+      MR_assert(ms.shape(1)==nrow, "bad number of rows");
+      MR_assert(ms.shape(2)==nchan, "bad number of channels");
+      auto tw = (taylor_.size()!=0) ? taylor_
+              : cmav<Tms,2>::build_uniform({1,nchan}, 1.);
+      checkShape(tw.shape(), {tw.shape(0), nchan});
+      checkShape(dirty.shape(), {ms.shape(0)*tw.shape(0), nxdirty, nydirty});
+      gridding = true;
+      timers.reset("gridding");
+      if ((nvis==0) || (dirty.size()==0))
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty);
+      else
         {
-        vlim = vlim2;
-        uv_side_fast = false;
+        ms_multi.assign(ms);
+        taylor.assign(tw);
+        report();
+        x2dirty(dirty);
+        ms_multi.assign(vmav<complex<Tms>,3>::build_empty());
+        taylor.assign(vmav<Tms,2>::build_empty());
         }
-      MR_assert(nu>=2*nsafe, "nu too small");
-      MR_assert(nv>=2*nsafe, "nv too small");
-      MR_assert((nxdirty&1)==0, "nx_dirty must be even");
-      MR_assert((nydirty&1)==0, "ny_dirty must be even");
-      MR_assert((nu&1)==0, "nu must be even");
-      MR_assert((nv&1)==0, "nv must be even");
-      MR_assert(epsilon>0, "epsilon must be positive");
-      MR_assert(pixsize_x>0, "pixsize_x must be positive");
-      MR_assert(pixsize_y>0, "pixsize_y must be positive");
-      countRanges();
-      report();
-      gridding ? x2dirty() : dirty2x();
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Degrids the (ncorr*nterm, nx, ny) images \a dirty into the
+        (ncorr, nrow, nchan) visibilities \a ms; this is the adjoint of
+        ms2dirty_multi().
+        ms(c, row, channel) is the sum over t of the visibility degridded
+        from image c*nterm+t, multiplied by taylor_(t, channel). If
+        \a taylor_ is empty, a single term of ones is used.
+        The kernel is evaluated only once per visibility, and the
+        corrections and FFTs are carried out for all images together.
+        Visibilities excluded by the plan are set to zero. */
+    void dirty2ms_multi(const cmav<Timg,3> &dirty, const cmav<Tms,2> &taylor_,
+      const vmav<complex<Tms>,3> &ms)
+      {
+      size_t nrow=bl.Nrows(), nchan=bl.Nchannels();
+      MR_assert(ms.shape(1)==nrow, "bad number of rows");
+      MR_assert(ms.shape(2)==nchan, "bad number of channels");
+      auto tw = (taylor_.size()!=0) ? taylor_
+              : cmav<Tms,2>::build_uniform({1,nchan}, 1.);
+      checkShape(tw.shape(), {tw.shape(0), nchan});
+      checkShape(dirty.shape(), {ms.shape(0)*tw.shape(0), nxdirty, nydirty});
+      gridding = false;
+      timers.reset("degridding");
+      timers.push("zeroing visibilities");
+      mav_apply([](complex<Tms> &v){v=complex<Tms>(0);}, nthreads, ms);
+      timers.pop();
+      if ((nvis!=0) && (ms.size()!=0))
+        {
+        vmav<complex<Tms>,3> tms(ms);
+        ms_multi_out.assign(tms);
+        taylor.assign(tw);
+        report();
+        dirty2x(dirty);
+        auto empty = vmav<complex<Tms>,3>::build_empty();
+        ms_multi_out.assign(empty);
+        taylor.assign(vmav<Tms,2>::build_empty());
+        }
+      if (verbosity>0)
+        timers.report(cout);
+      }
+
+    /*! Allows ms2dirty() and ms2dirty_multi() to use up to \a bytes for the
+        uv grids when w-gridding. As many w planes as fit into this budget
+        (but at least one) are then gridded, transformed and added to the
+        dirty image together, which improves the scaling with the number of
+        threads. The default of 0 processes the planes one at a time. */
+    void set_max_grid_memory(size_t bytes)
+      { max_grid_mem = bytes; }
+
+    /*! Computes ms2dirty(dirty2ms(\a dirty_in)) with the plan's weights
+        applied in both steps, i.e. the normal operator of the measurement,
+        without ever storing the visibilities.
+        \a dirty_in and \a dirty_out may refer to the same array. */
+    void dirty2dirty(const cmav<Timg,2> &dirty_in, const vmav<Timg,2> &dirty_out)
+      {
+      checkShape(dirty_in.shape(), {nxdirty, nydirty});
+      checkShape(dirty_out.shape(), {nxdirty, nydirty});
+      timers.reset("dirty2dirty");
+      if (nvis==0)
+        mav_apply([](Timg &v){v=Timg(0);}, nthreads, dirty_out);
+      else
+        dirty2dirty_internal(dirty_in, dirty_out);
+      if (verbosity>0)
+        timers.report(cout);
+      }
 
+    /*! Degrids \a dirty into \a ms, using the geometry stored in the plan.
+        Visibilities excluded by the plan are set to zero. */
+    void dirty2ms(const cmav<Timg,2> &dirty, const vmav<complex<Tms>,2> &ms)
+      {
+      checkShape(ms.shape(), {bl.Nrows(), bl.Nchannels()});
+      checkShape(dirty.shape(), {nxdirty, nydirty});
+      gridding = false;
+      timers.reset("degridding");
+      vmav<complex<Tms>,2> tms(ms);
+      ms_out.assign(tms);
+      timers.push("zeroing visibilities");
+      mav_apply([](complex<Tms> &v){v=complex<Tms>(0);}, nthreads, ms_out);
+      timers.pop();
+      if (nvis!=0)
+        {
+        report();
+        dirty2x(dirty.prepend_1());
+        }
       if (verbosity>0)
         timers.report(cout);
       }
@@ -1727,6 +2491,58 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2
     divide_by_n, sigma_min, sigma_max, center_x, center_y, allow_nshift);
   }
 
+/*! Computes ms2dirty(dirty2ms(\a dirty_in)), with \a wgt applied in both
+    steps, without storing the intermediate visibilities. */
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2dirty(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<Timg,2> &dirty_in,
+  const cmav<Tms,2> &wgt, const cmav<uint8_t,2> &mask, double pixsize_x, double pixsize_y,
+  double epsilon, bool do_wgridding, size_t nthreads, const vmav<Timg,2> &dirty_out,
+  size_t verbosity, bool negate_v=false, bool divide_by_n=true,
+  double sigma_min=1.1, double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  {
+  Wgridder<Tcalc, Tacc, Tms, Timg> plan(uvw, freq, wgt, mask, dirty_in.shape(0),
+    dirty_in.shape(1), pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads,
+    verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y,
+    allow_nshift);
+  plan.dirty2dirty(dirty_in, dirty_out);
+  }
+
+/*! Grids the (ncorr, nrow, nchan) visibilities \a ms into the
+    (ncorr*nterm, nx, ny) images \a dirty in a single pass; see
+    Wgridder::ms2dirty_multi() for details. */
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void ms2dirty_multi(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<complex<Tms>,3> &ms,
+  const cmav<Tms,2> &taylor, const cmav<Tms,2> &wgt, const cmav<uint8_t,2> &mask,
+  double pixsize_x, double pixsize_y, double epsilon, bool do_wgridding,
+  size_t nthreads, const vmav<Timg,3> &dirty, size_t verbosity,
+  bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
+  double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  {
+  Wgridder<Tcalc, Tacc, Tms, Timg> plan(uvw, freq, wgt, mask, dirty.shape(1),
+    dirty.shape(2), pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads,
+    verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y,
+    allow_nshift);
+  plan.ms2dirty_multi(ms, taylor, dirty);
+  }
+
+/*! Degrids the (ncorr*nterm, nx, ny) images \a dirty into the
+    (ncorr, nrow, nchan) visibilities \a ms in a single pass; see
+    Wgridder::dirty2ms_multi() for details. */
+template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2ms_multi(const cmav<double,2> &uvw,
+  const cmav<double,1> &freq, const cmav<Timg,3> &dirty,
+  const cmav<Tms,2> &taylor, const cmav<Tms,2> &wgt, const cmav<uint8_t,2> &mask,
+  double pixsize_x, double pixsize_y, double epsilon, bool do_wgridding,
+  size_t nthreads, const vmav<complex<Tms>,3> &ms, size_t verbosity,
+  bool negate_v=false, bool divide_by_n=true, double sigma_min=1.1,
+  double sigma_max=2.6, double center_x=0, double center_y=0, bool allow_nshift=true)
+  {
+  Wgridder<Tcalc, Tacc, Tms, Timg> plan(uvw, freq, wgt, mask, dirty.shape(1),
+    dirty.shape(2), pixsize_x, pixsize_y, epsilon, do_wgridding, nthreads,
+    verbosity, negate_v, divide_by_n, sigma_min, sigma_max, center_x, center_y,
+    allow_nshift);
+  plan.dirty2ms_multi(dirty, taylor, ms);
+  }
+
 tuple<size_t, size_t, size_t, size_t, double, double>
  get_facet_data(size_t npix_x, size_t npix_y, size_t nfx, size_t nfy, size_t ifx, size_t ify,
   double pixsize_x, double pixsize_y, double center_x, double center_y);
@@ -1881,8 +2697,12 @@ template<typename Tcalc, typename Tacc, typename Tms, typename Timg> void dirty2
 // public names
 using detail_gridder::ms2dirty;
 using detail_gridder::dirty2ms;
+using detail_gridder::dirty2dirty;
+using detail_gridder::ms2dirty_multi;
+using detail_gridder::dirty2ms_multi;
 using detail_gridder::ms2dirty_tuning;
 using detail_gridder::dirty2ms_tuning;
+using detail_gridder::Wgridder;
 
 } // namespace ducc0
 